@@ -0,0 +1,3 @@
+UPDATE playlist_items SET title = NULL, album = NULL, artist = NULL, albumartist = NULL, track = NULL, disc = NULL, year = NULL, originalyear = NULL, genre = NULL, compilation = NULL, composer = NULL, performer = NULL, grouping = NULL, comment = NULL, lyrics = NULL, artist_id = NULL, album_id = NULL, song_id = NULL, beginning = NULL, length = NULL, bitrate = NULL, samplerate = NULL, bitdepth = NULL, source = NULL, directory_id = NULL, url = NULL, filetype = NULL, filesize = NULL, mtime = NULL, ctime = NULL, unavailable = NULL, playcount = NULL, skipcount = NULL, lastplayed = NULL, compilation_detected = NULL, compilation_on = NULL, compilation_off = NULL, compilation_effective = NULL, art_automatic = NULL, art_manual = NULL, effective_albumartist = NULL, effective_originalyear = NULL, cue_path = NULL, rating = NULL WHERE type = 2 AND collection_id IS NOT NULL;
+
+UPDATE schema_version SET version=15;
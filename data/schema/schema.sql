@@ -4,7 +4,7 @@ CREATE TABLE IF NOT EXISTS schema_version (
 
 DELETE FROM schema_version;
 
-INSERT INTO schema_version (version) VALUES (13);
+INSERT INTO schema_version (version) VALUES (15);
 
 CREATE TABLE IF NOT EXISTS directories (
   path TEXT NOT NULL,
@@ -510,6 +510,7 @@ CREATE TABLE IF NOT EXISTS playlist_items (
   type INTEGER NOT NULL DEFAULT 0,
   collection_id INTEGER,
   playlist_url TEXT,
+  position INTEGER NOT NULL DEFAULT 0,
 
   title TEXT,
   album TEXT,
@@ -590,6 +591,8 @@ CREATE INDEX IF NOT EXISTS idx_album ON songs (album);
 
 CREATE INDEX IF NOT EXISTS idx_title ON songs (title);
 
+CREATE UNIQUE INDEX IF NOT EXISTS idx_playlist_items_position ON playlist_items (playlist, position);
+
 CREATE VIEW IF NOT EXISTS duplicated_songs as select artist dup_artist, album dup_album, title dup_title from songs as inner_songs where artist != '' and album != '' and title != '' and unavailable = 0 group by artist, album , title having count(*) > 1;
 
 CREATE VIRTUAL TABLE IF NOT EXISTS songs_fts USING fts5(
@@ -102,6 +102,10 @@ class AbstractMessageHandler : public _MessageHandlerBase {
   // Sets the "id" field of reply to the same as the request, and sends the reply on the socket.  Used on the worker side.
   void SendReply(const MessageType &request, MessageType *reply);
 
+  // Like SendReply, but marks the reply as partial, so the request stays pending until the final reply is sent.
+  // MessageType must have a "partial" field.  Used on the worker side.
+  void SendPartialReply(const MessageType &request, MessageType *reply);
+
  protected:
   // Called when a message is received from the socket.
   virtual void MessageArrived(const MessageType &message) { Q_UNUSED(message); }
@@ -144,6 +148,13 @@ void AbstractMessageHandler<MT>::SendReply(const MessageType &request, MessageTy
   SendMessage(*reply);
 }
 
+template<typename MT>
+void AbstractMessageHandler<MT>::SendPartialReply(const MessageType &request, MessageType *reply) {
+  reply->set_id(request.id());
+  reply->set_partial(true);
+  SendMessage(*reply);
+}
+
 template<typename MT>
 bool AbstractMessageHandler<MT>::RawMessageArrived(const QByteArray &data) {
 
@@ -152,7 +163,11 @@ bool AbstractMessageHandler<MT>::RawMessageArrived(const QByteArray &data) {
     return false;
   }
 
-  if (pending_replies_.contains(message.id())) {
+  if (message.partial() && pending_replies_.contains(message.id())) {
+    // More replies will follow for this message.
+    pending_replies_[message.id()]->AddPartialReply(message);
+  }
+  else if (pending_replies_.contains(message.id())) {
     // This is a reply to a message that we created earlier.
     ReplyType *reply = pending_replies_.take(message.id());
     reply->SetReply(message);
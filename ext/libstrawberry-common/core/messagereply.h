@@ -22,6 +22,8 @@
 #include <QObject>
 #include <QThread>
 #include <QSemaphore>
+#include <QMutex>
+#include <QList>
 #include <QString>
 
 #include "core/logging.h"
@@ -46,6 +48,8 @@ class _MessageReplyBase : public QObject {
 
  signals:
   void Finished(bool success);
+  // Emitted for each partial reply that arrives before the final one.
+  void PartialReplyArrived();
 
  protected:
   bool finished_;
@@ -66,9 +70,16 @@ class MessageReply : public _MessageReplyBase {
 
   void SetReply(const MessageType &message);
 
+  // Requests that stream back several messages get these before the final reply.  Can be called from any thread.
+  void AddPartialReply(const MessageType &message);
+  QList<MessageType> TakePartialReplies();
+
  private:
   MessageType request_message_;
   MessageType reply_message_;
+
+  QMutex partial_replies_mutex_;
+  QList<MessageType> partial_replies_;
 };
 
 
@@ -96,4 +107,28 @@ void MessageReply<MessageType>::SetReply(const MessageType &message) {
 
 }
 
+template<typename MessageType>
+void MessageReply<MessageType>::AddPartialReply(const MessageType &message) {
+
+  Q_ASSERT(!finished_);
+
+  {
+    QMutexLocker l(&partial_replies_mutex_);
+    partial_replies_ << message;
+  }
+
+  emit PartialReplyArrived();
+
+}
+
+template<typename MessageType>
+QList<MessageType> MessageReply<MessageType>::TakePartialReplies() {
+
+  QMutexLocker l(&partial_replies_mutex_);
+  QList<MessageType> ret = partial_replies_;
+  partial_replies_.clear();
+  return ret;
+
+}
+
 #endif  // MESSAGEREPLY_H
@@ -0,0 +1,222 @@
+/* This file is part of Strawberry.
+   Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#ifdef HAVE_POSIX_SHM
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <signal.h>
+#  include <cerrno>
+#  include <cstring>
+#endif
+
+#include <QtGlobal>
+#include <QCoreApplication>
+#include <QDir>
+#include <QMutex>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QAtomicInt>
+
+#include "core/logging.h"
+#include "sharedmemorybuffer.h"
+
+namespace {
+QMutex sCreatedMutex;
+QStringList sCreated;
+QAtomicInt sNextId(0);
+
+// All names are kNamePrefix followed by the pid of the writer, a dash and a number.
+const char *kNamePrefix = "sb-";
+}
+
+SharedMemoryBuffer::SharedMemoryBuffer() : data_(nullptr), size_(0) {}
+
+SharedMemoryBuffer::~SharedMemoryBuffer() {
+
+#ifdef HAVE_POSIX_SHM
+  if (data_) {
+    munmap(data_, size_);
+  }
+#endif
+
+}
+
+bool SharedMemoryBuffer::IsSupported() {
+
+#ifdef HAVE_POSIX_SHM
+  return true;
+#else
+  return false;
+#endif
+
+}
+
+QString SharedMemoryBuffer::Create(const QByteArray &data) {
+
+#ifdef HAVE_POSIX_SHM
+  if (data.isEmpty()) return QString();
+
+  // Keep the name short, macOS only allows 31 characters.
+  const QString name = QString("/%1%2-%3").arg(kNamePrefix).arg(QCoreApplication::applicationPid()).arg(sNextId.fetchAndAddOrdered(1));
+  const QByteArray name_utf8 = name.toUtf8();
+
+  const int fd = shm_open(name_utf8.constData(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    qLog(Error) << "Failed to create shared memory" << name << strerror(errno);
+    return QString();
+  }
+
+  if (ftruncate(fd, data.size()) == -1) {
+    qLog(Error) << "Failed to resize shared memory" << name << strerror(errno);
+    close(fd);
+    shm_unlink(name_utf8.constData());
+    return QString();
+  }
+
+  void *memory = mmap(nullptr, data.size(), PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    qLog(Error) << "Failed to map shared memory" << name << strerror(errno);
+    shm_unlink(name_utf8.constData());
+    return QString();
+  }
+
+  memcpy(memory, data.constData(), data.size());
+  munmap(memory, data.size());
+
+  QMutexLocker l(&sCreatedMutex);
+  sCreated << name;
+
+  return name;
+#else
+  Q_UNUSED(data);
+  return QString();
+#endif
+
+}
+
+void SharedMemoryBuffer::HandedOver(const QString &name) {
+
+  QMutexLocker l(&sCreatedMutex);
+  sCreated.removeAll(name);
+
+}
+
+void SharedMemoryBuffer::RemoveCreated() {
+
+  QMutexLocker l(&sCreatedMutex);
+
+#ifdef HAVE_POSIX_SHM
+  for (const QString &name : sCreated) {
+    shm_unlink(name.toUtf8().constData());
+  }
+#endif
+
+  sCreated.clear();
+
+}
+
+void SharedMemoryBuffer::Remove(const QString &name) {
+
+#ifdef HAVE_POSIX_SHM
+  if (shm_unlink(name.toUtf8().constData()) == -1 && errno != ENOENT) {
+    qLog(Error) << "Failed to remove shared memory" << name << strerror(errno);
+  }
+#else
+  Q_UNUSED(name);
+#endif
+
+}
+
+void SharedMemoryBuffer::RemoveStale() {
+
+#ifdef HAVE_POSIX_SHM
+  // Only Linux lists the objects as files, elsewhere they're removed when the system restarts.
+  const QDir dir("/dev/shm");
+  if (!dir.exists()) return;
+
+  for (const QString &filename : dir.entryList(QStringList() << QString("%1*").arg(kNamePrefix), QDir::Files | QDir::System | QDir::Hidden)) {
+    bool ok = false;
+    const qint64 pid = filename.mid(static_cast<int>(strlen(kNamePrefix))).section('-', 0, 0).toLongLong(&ok);
+    if (!ok || pid <= 0) continue;
+    // The writer is still running if it can be signalled, or exists and belongs to another user.
+    if (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM) continue;
+    qLog(Debug) << "Removing stale shared memory" << filename;
+    Remove("/" + filename);
+  }
+#endif
+
+}
+
+bool SharedMemoryBuffer::Open(const QString &name, const qint64 size) {
+
+  Q_ASSERT(!data_);
+
+#ifdef HAVE_POSIX_SHM
+  if (size <= 0) {
+    Remove(name);
+    return false;
+  }
+
+  const QByteArray name_utf8 = name.toUtf8();
+  const int fd = shm_open(name_utf8.constData(), O_RDONLY, 0);
+  const int open_error = errno;
+
+  // The mapping stays valid after the name is removed, this just makes sure nothing is left behind.
+  shm_unlink(name_utf8.constData());
+
+  if (fd == -1) {
+    qLog(Error) << "Failed to open shared memory" << name << strerror(open_error);
+    return false;
+  }
+
+  // The size comes from the message, reading past the end of the object would crash, so it has to match.
+  struct stat info;
+  if (fstat(fd, &info) == -1) {
+    qLog(Error) << "Failed to get the size of shared memory" << name << strerror(errno);
+    close(fd);
+    return false;
+  }
+  if (static_cast<qint64>(info.st_size) != size) {
+    qLog(Error) << "Shared memory" << name << "has" << static_cast<qint64>(info.st_size) << "bytes, expected" << size;
+    close(fd);
+    return false;
+  }
+
+  void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    qLog(Error) << "Failed to map shared memory" << name << strerror(errno);
+    return false;
+  }
+
+  data_ = static_cast<uchar*>(memory);
+  size_ = size;
+
+  return true;
+#else
+  Q_UNUSED(name);
+  Q_UNUSED(size);
+  return false;
+#endif
+
+}
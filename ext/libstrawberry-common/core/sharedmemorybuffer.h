@@ -0,0 +1,62 @@
+/* This file is part of Strawberry.
+   Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+
+   Strawberry is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Strawberry is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHAREDMEMORYBUFFER_H
+#define SHAREDMEMORYBUFFER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+
+// A named POSIX shared memory object used to hand large payloads to another process without sending them through a socket.
+// The writer creates the object and sends its name, the reader maps it read-only and removes the name,
+// so the memory is freed as soon as the reader unmaps it.
+// The reader owns every name it receives, it has to call Remove() for names it doesn't open.
+class SharedMemoryBuffer {
+ public:
+  SharedMemoryBuffer();
+  ~SharedMemoryBuffer();
+
+  // Returns false on platforms without POSIX shared memory.
+  static bool IsSupported();
+
+  // Writer side: creates a new object containing data and returns its name, or an empty string on failure.
+  static QString Create(const QByteArray &data);
+  // Writer side: the name was sent to the reader, which removes the object from now on.
+  static void HandedOver(const QString &name);
+  // Writer side: removes the objects that were created but never handed over to a reader.
+  static void RemoveCreated();
+
+  // Reader side: maps the object read-only and removes its name.  The name is removed even if mapping it fails.
+  bool Open(const QString &name, const qint64 size);
+  // Reader side: removes an object that won't be opened.
+  static void Remove(const QString &name);
+
+  // Removes the objects left behind by processes that are not running anymore, for example workers that crashed.
+  static void RemoveStale();
+
+  const uchar *data() const { return data_; }
+  qint64 size() const { return size_; }
+
+ private:
+  Q_DISABLE_COPY(SharedMemoryBuffer)
+
+  uchar *data_;
+  qint64 size_;
+};
+
+#endif  // SHAREDMEMORYBUFFER_H
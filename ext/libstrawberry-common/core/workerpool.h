@@ -29,7 +29,9 @@
 #include <QProcess>
 #include <QFile>
 #include <QList>
+#include <QHash>
 #include <QQueue>
+#include <QElapsedTimer>
 #include <QString>
 #include <QStringList>
 #include <QAtomicInteger>
@@ -38,6 +40,7 @@
 #endif
 
 #include "core/logging.h"
+#include "core/messagereply.h"
 
 class QLocalSocket;
 
@@ -54,9 +57,11 @@ class _WorkerPoolBase : public QObject {
 
  protected slots:
   virtual void DoStart() {}
+  virtual void DoSetWorkerCount(const int) {}
   virtual void NewConnection() {}
   virtual void ProcessError(QProcess::ProcessError) {}
   virtual void SendQueuedMessages() {}
+  virtual void ReplyFinished() {}
 };
 
 
@@ -64,6 +69,8 @@ class _WorkerPoolBase : public QObject {
 // A local socket server is started for each process, and the address is passed to the process as argv[1].
 // The process is expected to connect back to the socket server, and when it does a HandlerType is created for it.
 // Instances of HandlerType are created in the WorkerPool's thread.
+// Each worker has its own queue of messages and only a few requests are written to its socket at a time.
+// A worker with an empty queue steals messages from the worker with the longest queue, so one slow request doesn't hold up the others.
 template <typename HandlerType>
 class WorkerPool : public _WorkerPoolBase {
  public:
@@ -73,11 +80,25 @@ class WorkerPool : public _WorkerPoolBase {
   typedef typename HandlerType::MessageType MessageType;
   typedef typename HandlerType::ReplyType ReplyType;
 
+  struct WorkerStatistics {
+    WorkerStatistics() : queue_depth(0), in_flight(0), requests_finished(0), requests_stolen(0), total_latency_msec(0), max_latency_msec(0) {}
+    int queue_depth;
+    int in_flight;
+    qint64 requests_finished;
+    qint64 requests_stolen;
+    qint64 total_latency_msec;
+    qint64 max_latency_msec;
+  };
+
+  // Maximum number of requests written to a worker's socket before it replies.
+  static const int kMaxInFlightPerWorker = 2;
+
   // Sets the name of the worker executable.  This is looked for first in the current directory, and then in $PATH.
   // You must call this before calling Start().
   void SetExecutableName(const QString &executable_name);
 
-  // Sets the number of worker process to use.  Defaults to 1 <= (processors / 2) <= 2.
+  // Sets the number of worker process to use.  Defaults to processors / 2, at least 1 and at most 4.
+  // Can be called from any thread, also after Start() to add more workers.  The pool never shrinks, a lower count is ignored once the workers are started.
   void SetWorkerCount(const int count);
 
   // Sets the prefix to use for the local server (on unix this is a named pipe in /tmp).
@@ -93,12 +114,17 @@ class WorkerPool : public _WorkerPoolBase {
   // Can be called from any thread.
   ReplyType *SendMessageWithReply(MessageType *message);
 
+  // Returns the queue depth and latency of each worker.  Can be called from any thread.
+  QList<WorkerStatistics> Statistics() const;
+
  protected:
   // These are all reimplemented slots, they are called on the WorkerPool's thread.
   void DoStart() override;
+  void DoSetWorkerCount(const int count) override;
   void NewConnection() override;
   void ProcessError(QProcess::ProcessError error) override;
   void SendQueuedMessages() override;
+  void ReplyFinished() override;
 
  private:
   struct Worker {
@@ -108,8 +134,20 @@ class WorkerPool : public _WorkerPoolBase {
     QLocalSocket *local_socket_;
     QProcess *process_;
     HandlerType *handler_;
+
+    QQueue<ReplyType*> queue_;
+    WorkerStatistics statistics_;
   };
 
+  struct InFlightReply {
+    InFlightReply() : worker_index(-1) {}
+    int worker_index;
+    QElapsedTimer timer;
+  };
+
+  // Starts the workers that haven't been started yet.  Must only ever be called on my thread.
+  void AddWorkers();
+
   // Must only ever be called on my thread.
   void StartOneWorker(Worker *worker);
 
@@ -135,29 +173,36 @@ class WorkerPool : public _WorkerPoolBase {
   // and sets the request's ID to the ID of the reply.  Can be called from any thread
   ReplyType *NewReply(MessageType *message);
 
-  // Returns the next handler, or nullptr if there isn't one.  Must be called from my thread.
-  HandlerType *NextHandler() const;
+  // Returns true if the worker is connected and can take requests.
+  static bool IsWorkerAvailable(const Worker &worker);
+  // Returns the available worker with the least queued and in flight messages, or -1 if there isn't one.  Must be called with the queue locked.
+  int ShortestQueueWorker() const;
+  // Returns the worker with the most queued messages, or -1 if all queues are empty.  Must be called with the queue locked.
+  int LongestQueueWorker() const;
+  // Writes the request to the worker's socket.  Must be called from my thread with the queue locked.
+  void SendToWorker(const int worker_index, ReplyType *reply);
 
  private:
   QString local_server_name_;
   QString executable_name_;
   QString executable_path_;
 
+  // Only used on my thread.
   int worker_count_;
-  mutable int next_worker_;
   QList<Worker> workers_;
 
   QAtomicInteger<qint64> next_id_;
 
-  QMutex message_queue_mutex_;
+  // Protects message_queue_, the worker queues and the statistics.
+  mutable QMutex message_queue_mutex_;
   QQueue<ReplyType*> message_queue_;
+  QHash<_MessageReplyBase*, InFlightReply> in_flight_replies_;
 };
 
 
 template <typename HandlerType>
 WorkerPool<HandlerType>::WorkerPool(QObject *parent)
   : _WorkerPoolBase(parent),
-    next_worker_(0),
     next_id_(0) {
 
   worker_count_ = qBound(1, QThread::idealThreadCount() / 2, 4);
@@ -195,12 +240,33 @@ WorkerPool<HandlerType>::~WorkerPool() {
     reply->Abort();
   }
 
+  for (const Worker &worker : workers_) {
+    for (ReplyType *reply : worker.queue_) {
+      reply->Abort();
+    }
+  }
+
 }
 
 template <typename HandlerType>
 void WorkerPool<HandlerType>::SetWorkerCount(const int count) {
-  Q_ASSERT(workers_.isEmpty());
+  metaObject()->invokeMethod(this, "DoSetWorkerCount", Q_ARG(int, count));
+}
+
+template <typename HandlerType>
+void WorkerPool<HandlerType>::DoSetWorkerCount(const int count) {
+
+  Q_ASSERT(QThread::currentThread() == thread());
+
+  if (count <= worker_count_ && !workers_.isEmpty()) return;
+
+  qLog(Debug) << "Using" << count << "workers";
   worker_count_ = count;
+
+  if (!workers_.isEmpty()) {
+    AddWorkers();
+  }
+
 }
 
 template <typename HandlerType>
@@ -223,10 +289,14 @@ void WorkerPool<HandlerType>::Start() {
 template <typename HandlerType>
 void WorkerPool<HandlerType>::DoStart() {
 
-  Q_ASSERT(workers_.isEmpty());
   Q_ASSERT(!executable_name_.isEmpty());
   Q_ASSERT(QThread::currentThread() == thread());
 
+  if (!workers_.isEmpty()) {
+    AddWorkers();
+    return;
+  }
+
   // Find the executable if we can, default to searching $PATH
   executable_path_ = executable_name_;
 
@@ -244,12 +314,20 @@ void WorkerPool<HandlerType>::DoStart() {
     }
   }
 
-  // Start all the workers
-  for (int i = 0; i < worker_count_; ++i) {
-    Worker worker;
-    StartOneWorker(&worker);
+  AddWorkers();
+
+}
+
+template <typename HandlerType>
+void WorkerPool<HandlerType>::AddWorkers() {
+
+  Q_ASSERT(QThread::currentThread() == thread());
 
-    workers_ << worker;
+  // Start the workers we don't have yet
+  QMutexLocker l(&message_queue_mutex_);
+  while (workers_.count() < worker_count_) {
+    workers_ << Worker();
+    StartOneWorker(&workers_.last());
   }
 
 }
@@ -382,36 +460,131 @@ void WorkerPool<HandlerType>::SendQueuedMessages() {
 
   QMutexLocker l(&message_queue_mutex_);
 
+  // Put each new message on the queue of the worker with the least work.
   while (!message_queue_.isEmpty()) {
-    ReplyType *reply = message_queue_.dequeue();
-
-    // Find a worker for this message
-    HandlerType *handler = NextHandler();
-    if (!handler) {
-      // No available handlers - put the message on the front of the queue.
-      message_queue_.prepend(reply);
+    const int worker_index = ShortestQueueWorker();
+    if (worker_index == -1) {
+      // No available handlers - leave the messages in the queue.
       qLog(Debug) << "No available handlers to process request";
       break;
     }
+    workers_[worker_index].queue_.enqueue(message_queue_.dequeue());
+  }
 
-    handler->SendRequest(reply);
+  // Keep every worker busy, workers with an empty queue steal from the back of the longest queue.
+  for (int i = 0; i < workers_.count(); ++i) {
+    Worker &worker = workers_[i];
+    if (!IsWorkerAvailable(worker)) continue;
+
+    while (worker.statistics_.in_flight < kMaxInFlightPerWorker) {
+      ReplyType *reply = nullptr;
+      if (!worker.queue_.isEmpty()) {
+        reply = worker.queue_.dequeue();
+      }
+      else {
+        const int victim_index = LongestQueueWorker();
+        if (victim_index == -1) break;
+        reply = workers_[victim_index].queue_.takeLast();
+        ++worker.statistics_.requests_stolen;
+      }
+      SendToWorker(i, reply);
+    }
   }
 
 }
 
 template <typename HandlerType>
-HandlerType *WorkerPool<HandlerType>::NextHandler() const {
+void WorkerPool<HandlerType>::SendToWorker(const int worker_index, ReplyType *reply) {
 
+  Worker &worker = workers_[worker_index];
+
+  InFlightReply in_flight;
+  in_flight.worker_index = worker_index;
+  in_flight.timer.start();
+  in_flight_replies_.insert(reply, in_flight);
+  ++worker.statistics_.in_flight;
+
+  connect(reply, SIGNAL(Finished(bool)), SLOT(ReplyFinished()), Qt::DirectConnection);
+  worker.handler_->SendRequest(reply);
+
+}
+
+template <typename HandlerType>
+void WorkerPool<HandlerType>::ReplyFinished() {
+
+  _MessageReplyBase *reply = qobject_cast<_MessageReplyBase*>(sender());
+  if (!reply) return;
+
+  {
+    QMutexLocker l(&message_queue_mutex_);
+    if (!in_flight_replies_.contains(reply)) return;
+    const InFlightReply in_flight = in_flight_replies_.take(reply);
+    WorkerStatistics &statistics = workers_[in_flight.worker_index].statistics_;
+    const qint64 latency = in_flight.timer.elapsed();
+    --statistics.in_flight;
+    ++statistics.requests_finished;
+    statistics.total_latency_msec += latency;
+    statistics.max_latency_msec = qMax(statistics.max_latency_msec, latency);
+  }
+
+  // The worker can take another message now.
+  metaObject()->invokeMethod(this, "SendQueuedMessages", Qt::QueuedConnection);
+
+}
+
+template <typename HandlerType>
+bool WorkerPool<HandlerType>::IsWorkerAvailable(const Worker &worker) {
+  return worker.handler_ && !worker.handler_->is_device_closed();
+}
+
+template <typename HandlerType>
+int WorkerPool<HandlerType>::ShortestQueueWorker() const {
+
+  int ret = -1;
+  int shortest = 0;
   for (int i = 0; i < workers_.count(); ++i) {
-    const int worker_index = (next_worker_ + i) % workers_.count();
+    if (!IsWorkerAvailable(workers_[i])) continue;
+    const int length = workers_[i].queue_.count() + workers_[i].statistics_.in_flight;
+    if (ret == -1 || length < shortest) {
+      ret = i;
+      shortest = length;
+    }
+  }
+
+  return ret;
+
+}
+
+template <typename HandlerType>
+int WorkerPool<HandlerType>::LongestQueueWorker() const {
 
-    if (workers_[worker_index].handler_ && !workers_[worker_index].handler_->is_device_closed()) {
-      next_worker_ = (worker_index + 1) % workers_.count();
-      return workers_[worker_index].handler_;
+  // Workers that crashed are included, so their queued messages are picked up by the others while they restart.
+  int ret = -1;
+  int longest = 0;
+  for (int i = 0; i < workers_.count(); ++i) {
+    if (workers_[i].queue_.count() > longest) {
+      ret = i;
+      longest = workers_[i].queue_.count();
     }
   }
 
-  return nullptr;
+  return ret;
+
+}
+
+template <typename HandlerType>
+QList<typename WorkerPool<HandlerType>::WorkerStatistics> WorkerPool<HandlerType>::Statistics() const {
+
+  QMutexLocker l(&message_queue_mutex_);
+
+  QList<WorkerStatistics> ret;
+  for (const Worker &worker : workers_) {
+    WorkerStatistics statistics = worker.statistics_;
+    statistics.queue_depth = worker.queue_.count();
+    ret << statistics;
+  }
+
+  return ret;
 
 }
 
@@ -24,8 +24,11 @@
 #include <QIODevice>
 #include <QByteArray>
 
+#include "core/sharedmemorybuffer.h"
 #include "tagreaderworker.h"
 
+const int TagReaderWorker::kSharedMemoryThreshold = 256 * 1024;
+
 TagReaderWorker::TagReaderWorker(QIODevice *socket, QObject *parent)
   : AbstractMessageHandler<pb::tagreader::Message>(socket, parent) {}
 
@@ -36,6 +39,18 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message &message) {
   if (message.has_read_file_request()) {
     tag_reader_.ReadFile(QStringFromStdString(message.read_file_request().filename()), reply.mutable_read_file_response()->mutable_metadata());
   }
+  else if (message.has_read_files_request()) {
+    // Stream back each song as soon as it's read, the empty final reply tells the client we're done.
+    for (int i = 0; i < message.read_files_request().filenames_size(); ++i) {
+      const std::string &filename = message.read_files_request().filenames(i);
+      pb::tagreader::Message partial_reply;
+      pb::tagreader::ReadFilesResponse *response = partial_reply.mutable_read_files_response();
+      response->set_index(i);
+      response->set_filename(filename);
+      tag_reader_.ReadFile(QStringFromStdString(filename), response->mutable_metadata());
+      SendPartialReply(message, &partial_reply);
+    }
+  }
   else if (message.has_save_file_request()) {
     reply.mutable_save_file_response()->set_success(tag_reader_.SaveFile(QStringFromStdString(message.save_file_request().filename()), message.save_file_request().metadata()));
   }
@@ -44,8 +59,23 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message &message) {
     reply.mutable_is_media_file_response()->set_success(tag_reader_.IsMediaFile(QStringFromStdString(message.is_media_file_request().filename())));
   }
   else if (message.has_load_embedded_art_request()) {
-    QByteArray data = tag_reader_.LoadEmbeddedArt(QStringFromStdString(message.load_embedded_art_request().filename()));
-    reply.mutable_load_embedded_art_response()->set_data(data.constData(), data.size());
+    const QByteArray data = tag_reader_.LoadEmbeddedArt(QStringFromStdString(message.load_embedded_art_request().filename()));
+    pb::tagreader::LoadEmbeddedArtResponse *response = reply.mutable_load_embedded_art_response();
+    QString shared_memory_name;
+    if (message.load_embedded_art_request().allow_shared_memory() && data.size() >= kSharedMemoryThreshold) {
+      shared_memory_name = SharedMemoryBuffer::Create(data);
+    }
+    if (shared_memory_name.isEmpty()) {
+      response->set_data(data.constData(), data.size());
+    }
+    else {
+      response->set_shared_memory_name(DataCommaSizeFromQString(shared_memory_name));
+      response->set_shared_memory_size(data.size());
+      SendReply(message, &reply);
+      // The client removes the object from now on, unless it never got the reply.
+      if (!is_device_closed()) SharedMemoryBuffer::HandedOver(shared_memory_name);
+      return;
+    }
   }
 
   SendReply(message, &reply);
@@ -56,5 +86,7 @@ void TagReaderWorker::MessageArrived(const pb::tagreader::Message &message) {
 void TagReaderWorker::DeviceClosed() {
   AbstractMessageHandler<pb::tagreader::Message>::DeviceClosed();
 
+  SharedMemoryBuffer::RemoveCreated();
+
   qApp->exit();
 }
@@ -37,6 +37,9 @@ class TagReaderWorker : public AbstractMessageHandler<pb::tagreader::Message> {
   void DeviceClosed() override;
 
  private:
+  // Embedded art at least this big is sent through shared memory when the client allows it.
+  static const int kSharedMemoryThreshold;
+
   TagReader tag_reader_;
 };
 
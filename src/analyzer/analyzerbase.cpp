@@ -26,10 +26,8 @@
 
 #include <algorithm>
 #include <cmath>
-#include <cstdint>
 
 #include <QWidget>
-#include <QVector>
 #include <QPainter>
 #include <QPalette>
 #include <QTimerEvent>
@@ -42,12 +40,11 @@
 // 1. do anything that depends on height() in init(), Base2D will call it before you are shown
 // 2. otherwise you can use the constructor to initialize things
 // 3. reimplement analyze(), and paint to canvas(), Base2D will update the widget when you return control to it
-// 4. if you want to manipulate the scope, reimplement transform()
+// 4. call SetBands() to choose the bands of the spectrum analyze() gets
 // 5. for convenience <vector> <qpixmap.h> <qwdiget.h> are pre-included
 //
 // TODO:
 // Make an INSTRUCTIONS file
-// can't mod scope in analyze you have to use transform
 // for 2D use setErasePixmap Qt function insetead of m_background
 
 // make the linker happy only for gcc < 4.0
@@ -56,36 +53,62 @@
 template class Analyzer::Base<QWidget>;
 #endif
 
-Analyzer::Base::Base(QWidget *parent, uint scopeSize)
+Analyzer::Base::Base(QWidget *parent)
     : QWidget(parent),
       timeout_(40),
-      fht_(new FHT(scopeSize)),
       engine_(nullptr),
-      lastscope_(512),
+      lastscope_(32),
+      bands_bins_(0),
+      bands_count_(0),
+      bands_mode_(SpectrumService::BandMode_Interpolate),
+      bands_scale_(1.0),
+      bands_id_(-1),
       new_frame_(false),
       is_playing_(false) {}
 
-void Analyzer::Base::hideEvent(QHideEvent*) { timer_.stop(); }
+Analyzer::Base::~Base() {
 
-void Analyzer::Base::showEvent(QShowEvent*) { timer_.start(timeout(), this); }
+  if (spectrum_ && bands_id_ != -1) spectrum_->RemoveBands(bands_id_);
+
+}
 
-void Analyzer::Base::transform(Scope& scope) {
+void Analyzer::Base::set_spectrum(SpectrumService *spectrum) {
 
-  QVector<float> aux(fht_->size());
-  if (static_cast<long unsigned int>(aux.size()) >= scope.size()) {
-    std::copy(scope.begin(), scope.end(), aux.begin());
+  if (spectrum_) {
+    disconnect(spectrum_, nullptr, this, nullptr);
+    if (bands_id_ != -1) spectrum_->RemoveBands(bands_id_);
   }
-  else {
-    std::copy(scope.begin(), scope.begin() + aux.size(), aux.begin());
+  bands_id_ = -1;
+
+  spectrum_ = spectrum;
+  if (!spectrum_) return;
+
+  connect(spectrum_, SIGNAL(SpectrumReady()), SLOT(SpectrumReady()));
+  if (bands_count_ > 0) {
+    bands_id_ = spectrum_->AddBands(bands_bins_, bands_count_, bands_mode_, bands_scale_);
   }
 
-  fht_->logSpectrum(scope.data(), aux.data());
-  fht_->scale(scope.data(), 1.0 / 20);
+}
+
+void Analyzer::Base::SetBands(const int bins, const int count, const SpectrumService::BandMode mode, const float scale) {
+
+  bands_bins_ = bins;
+  bands_count_ = count;
+  bands_mode_ = mode;
+  bands_scale_ = scale;
+  lastscope_ = Scope(qMax(0, count), 0);
 
-  scope.resize(fht_->size() / 2);  // second half of values are rubbish
+  if (spectrum_) {
+    if (bands_id_ != -1) spectrum_->RemoveBands(bands_id_);
+    bands_id_ = spectrum_->AddBands(bands_bins_, bands_count_, bands_mode_, bands_scale_);
+  }
 
 }
 
+void Analyzer::Base::hideEvent(QHideEvent*) { timer_.stop(); }
+
+void Analyzer::Base::showEvent(QShowEvent*) { timer_.start(timeout(), this); }
+
 void Analyzer::Base::paintEvent(QPaintEvent *e) {
 
   QPainter p(this);
@@ -93,21 +116,11 @@ void Analyzer::Base::paintEvent(QPaintEvent *e) {
 
   switch (engine_->state()) {
     case Engine::Playing: {
-      const Engine::Scope& thescope = engine_->scope(timeout_);
-      int i = 0;
-
-      // convert to mono here - our built in analyzers need mono, but the engines provide interleaved pcm
-      for (uint x = 0; static_cast<int>(x) < fht_->size(); ++x) {
-        lastscope_[x] = double(thescope[i] + thescope[i + 1]) / (2 * (1 << 15));
-        i += 2;
+      if (spectrum_ && bands_id_ != -1) {
+        lastscope_ = spectrum_->bands(bands_id_);
       }
-
       is_playing_ = true;
-      transform(lastscope_);
       analyze(p, lastscope_, new_frame_);
-
-      lastscope_.resize(fht_->size());
-
       break;
     }
     case Engine::Paused:
@@ -124,49 +137,15 @@ void Analyzer::Base::paintEvent(QPaintEvent *e) {
 
 }
 
-int Analyzer::Base::resizeExponent(int exp) {
-
-  if (exp < 3)
-    exp = 3;
-  else if (exp > 9)
-    exp = 9;
-
-  if (exp != fht_->sizeExp()) {
-    delete fht_;
-    fht_ = new FHT(exp);
-  }
-  return exp;
-
-}
-
-int Analyzer::Base::resizeForBands(int bands) {
-
-  int exp;
-  if (bands <= 8)
-    exp = 4;
-  else if (bands <= 16)
-    exp = 5;
-  else if (bands <= 32)
-    exp = 6;
-  else if (bands <= 64)
-    exp = 7;
-  else if (bands <= 128)
-    exp = 8;
-  else
-    exp = 9;
-
-  resizeExponent(exp);
-  return fht_->size() / 2;
-
-}
-
 void Analyzer::Base::demo(QPainter& p) {
 
   static int t = 201;  // FIXME make static to namespace perhaps
 
+  const int count = bands_count_ > 0 ? bands_count_ : 32;
+
   if (t > 999) t = 1;  // 0 = wasted calculations
   if (t < 201) {
-    Scope s(32);
+    Scope s(count);
 
     const double dt = double(t) / 200;
     for (uint i = 0; i < s.size(); ++i)
@@ -175,7 +154,7 @@ void Analyzer::Base::demo(QPainter& p) {
     analyze(p, s, new_frame_);
   }
   else
-    analyze(p, Scope(32, 0), new_frame_);
+    analyze(p, Scope(count, 0), new_frame_);
 
   ++t;
 
@@ -185,28 +164,6 @@ void Analyzer::Base::polishEvent() {
   init();
 }
 
-void Analyzer::interpolate(const Scope& inVec, Scope& outVec) {
-
-  double pos = 0.0;
-  const double step = static_cast<double>(inVec.size()) / outVec.size();
-
-  for (uint i = 0; i < outVec.size(); ++i, pos += step) {
-    const double error = pos - std::floor(pos);
-    const uint64_t offset = static_cast<uint64_t>(pos);
-
-    uint64_t indexLeft = offset + 0;
-
-    if (indexLeft >= inVec.size()) indexLeft = inVec.size() - 1;
-
-    uint64_t indexRight = offset + 1;
-
-    if (indexRight >= inVec.size()) indexRight = inVec.size() - 1;
-
-    outVec[i] = inVec[indexLeft] * (1.0 - error) + inVec[indexRight] * error;
-  }
-
-}
-
 void Analyzer::initSin(Scope& v, const uint size) {
 
   double step = (M_PI * 2) / size;
@@ -225,6 +182,14 @@ void Analyzer::Base::timerEvent(QTimerEvent *e) {
   if (e->timerId() != timer_.timerId()) return;
 
   new_frame_ = true;
+
+  // Paint when the spectrum of this frame is ready.
+  if (!spectrum_ || !spectrum_->Update(timeout_)) update();
+
+}
+
+void Analyzer::Base::SpectrumReady() {
+
   update();
 
 }
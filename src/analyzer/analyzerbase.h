@@ -35,12 +35,13 @@
 #include <QObject>
 #include <QWidget>
 #include <QBasicTimer>
+#include <QPointer>
 #include <QString>
 #include <QPainter>
 
-#include "analyzer/fht.h"
 #include "engine/engine_fwd.h"
 #include "engine/enginebase.h"
+#include "spectrumservice.h"
 
 class QHideEvent;
 class QShowEvent;
@@ -55,12 +56,15 @@ class Base : public QWidget {
   Q_OBJECT
 
  public:
-  ~Base() override { delete fht_; }
+  ~Base() override;
 
   uint timeout() const { return timeout_; }
 
   void set_engine(EngineBase *engine) { engine_ = engine; }
 
+  // The analyzer gets its bands from the spectrum service instead of transforming the samples itself.
+  void set_spectrum(SpectrumService *spectrum);
+
   void changeTimeout(uint newTimeout) {
     timeout_ = newTimeout;
     if (timer_.isActive()) {
@@ -72,7 +76,7 @@ class Base : public QWidget {
   virtual void framerateChanged() {}
 
  protected:
-  explicit Base(QWidget*, uint scopeSize = 7);
+  explicit Base(QWidget*);
 
   void hideEvent(QHideEvent*) override;
   void showEvent(QShowEvent*) override;
@@ -81,25 +85,33 @@ class Base : public QWidget {
 
   void polishEvent();
 
-  int resizeExponent(int);
-  int resizeForBands(int);
+  // Sets the bands passed to analyze(), made from the lowest bins of the spectrum.
+  void SetBands(const int bins, const int count, const SpectrumService::BandMode mode, const float scale = 1.0);
+
   virtual void init() {}
-  virtual void transform(Scope&);
   virtual void analyze(QPainter& p, const Scope&, bool new_frame) = 0;
   virtual void demo(QPainter& p);
 
+ private slots:
+  void SpectrumReady();
+
  protected:
   QBasicTimer timer_;
   uint timeout_;
-  FHT *fht_;
   EngineBase *engine_;
+  QPointer<SpectrumService> spectrum_;
   Scope lastscope_;
 
+  int bands_bins_;
+  int bands_count_;
+  SpectrumService::BandMode bands_mode_;
+  float bands_scale_;
+  int bands_id_;
+
   bool new_frame_;
   bool is_playing_;
 };
 
-void interpolate(const Scope&, Scope&);
 void initSin(Scope&, const uint = 6000);
 
 }  //  namespace Analyzer
@@ -39,6 +39,7 @@
 #include "blockanalyzer.h"
 #include "boomanalyzer.h"
 #include "rainbowanalyzer.h"
+#include "spectrumservice.h"
 
 #include "core/logging.h"
 #include "engine/enginebase.h"
@@ -63,7 +64,8 @@ AnalyzerContainer::AnalyzerContainer(QWidget *parent)
       double_click_timer_(new QTimer(this)),
       ignore_next_click_(false),
       current_analyzer_(nullptr),
-      engine_(nullptr) {
+      engine_(nullptr),
+      spectrum_(new SpectrumService(this)) {
 
   QHBoxLayout *layout = new QHBoxLayout(this);
   setLayout(layout);
@@ -122,6 +124,7 @@ void AnalyzerContainer::wheelEvent(QWheelEvent *e) {
 void AnalyzerContainer::SetEngine(EngineBase *engine) {
   if (current_analyzer_) current_analyzer_->set_engine(engine);
   engine_ = engine;
+  spectrum_->set_engine(engine);
 }
 
 void AnalyzerContainer::DisableAnalyzer() {
@@ -143,6 +146,7 @@ void AnalyzerContainer::ChangeAnalyzer(int id) {
   delete current_analyzer_;
   current_analyzer_ = qobject_cast<Analyzer::Base*>(instance);
   current_analyzer_->set_engine(engine_);
+  current_analyzer_->set_spectrum(spectrum_);
   // Even if it is not supposed to happen, I don't want to get a dbz error
   current_framerate_ = current_framerate_ == 0 ? kMediumFramerate : current_framerate_;
   current_analyzer_->changeTimeout(1000 / current_framerate_);
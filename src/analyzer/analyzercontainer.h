@@ -36,6 +36,8 @@ class QTimer;
 class QMouseEvent;
 class QWheelEvent;
 
+class SpectrumService;
+
 namespace Analyzer {
 class Base;
 }  // namespace Analyzer
@@ -96,6 +98,7 @@ class AnalyzerContainer : public QWidget {
 
   Analyzer::Base* current_analyzer_;
   EngineBase *engine_;
+  SpectrumService *spectrum_;
 
 };
 
@@ -27,13 +27,13 @@
 #include <cmath>
 
 #include <QWidget>
-#include <QPixmap>
+#include <QImage>
 #include <QPainter>
 #include <QPalette>
 #include <QColor>
 
 #include "analyzerbase.h"
-#include "fht.h"
+#include "spectrumservice.h"
 
 const uint BlockAnalyzer::kHeight = 2;
 const uint BlockAnalyzer::kWidth = 4;
@@ -45,15 +45,14 @@ const uint BlockAnalyzer::kFadeSize = 90;
 const char *BlockAnalyzer::kName = QT_TRANSLATE_NOOP("AnalyzerContainer", "Block analyzer");
 
 BlockAnalyzer::BlockAnalyzer(QWidget *parent)
-    : Analyzer::Base(parent, 9),
+    : Analyzer::Base(parent),
       columns_(0),
       rows_(0),
       y_(0),
-      barpixmap_(1, 1),
-      topbarpixmap_(kWidth, kHeight),
-      scope_(kMinColumns),
+      background_color_(0),
+      topbar_color_(0),
+      fade_colors_(kFadeSize, 0),
       store_(1 << 8, 0),
-      fade_bars_(kFadeSize),
       fade_pos_(1 << 8, 50),
       fade_intensity_(1 << 8, 32),
       step_(0)
@@ -62,17 +61,13 @@ BlockAnalyzer::BlockAnalyzer(QWidget *parent)
   setMinimumSize(kMinColumns * (kWidth + 1) - 1, kMinRows * (kHeight + 1) - 1);  //-1 is padding, no drawing takes place there
   setMaximumWidth(kMaxColumns * (kWidth + 1) - 1);
 
-  // mxcl says null pixmaps cause crashes, so let's play it safe
-  for (uint i = 0; i < kFadeSize; ++i) fade_bars_[i] = QPixmap(1, 1);
-
 }
 
 void BlockAnalyzer::resizeEvent(QResizeEvent *e) {
 
   QWidget::resizeEvent(e);
 
-  background_ = QPixmap(size());
-  canvas_ = QPixmap(size());
+  canvas_ = QImage(size(), QImage::Format_RGB32);
 
   const uint oldRows = rows_;
 
@@ -84,13 +79,13 @@ void BlockAnalyzer::resizeEvent(QResizeEvent *e) {
   // this is the y-offset for drawing from the top of the widget
   y_ = (height() - (rows_ * (kHeight + 1)) + 2) / 2;
 
-  scope_.resize(columns_);
+  // The second half of the spectrum is pretty dull, so only show it if the analyzer is large.
+  SetBands(columns_ <= kMaxColumns / 2 ? kMaxColumns / 2 : columns_, columns_, SpectrumService::BandMode_Interpolate, 1.0 / 10);
 
-  if (rows_ != oldRows) {
-    barpixmap_ = QPixmap(kWidth, rows_ * (kHeight + 1));
+  columns_drawn_.resize(columns_);
 
-    for (uint i = 0; i < kFadeSize; ++i)
-      fade_bars_[i] = QPixmap(kWidth, rows_ * (kHeight + 1));
+  if (rows_ != oldRows) {
+    bar_lines_.resize(rows_ * (kHeight + 1));
 
     yscale_.resize(rows_ + 1);
 
@@ -125,18 +120,6 @@ void BlockAnalyzer::framerateChanged() {
   determineStep();
 }
 
-void BlockAnalyzer::transform(Analyzer::Scope &s) {
-
-  for (uint x = 0; x < s.size(); ++x) s[x] *= 2;
-
-  fht_->spectrum(s.data());
-  fht_->scale(s.data(), 1.0 / 20);
-
-  // the second half is pretty dull, so only show it if the user has a large analyzer by setting to scope_.size() if large we prevent interpolation of large analyzers, this is good!
-  s.resize(scope_.size() <= kMaxColumns / 2 ? kMaxColumns / 2 : scope_.size());
-
-}
-
 void BlockAnalyzer::analyze(QPainter &p, const Analyzer::Scope &s, bool new_frame) {
 
   // y = 2 3 2 1 0 2
@@ -152,21 +135,16 @@ void BlockAnalyzer::analyze(QPainter &p, const Analyzer::Scope &s, bool new_fram
   // yscale_ looks similar to: { 0.7, 0.5, 0.25, 0.15, 0.1, 0 }
   // if it contains 6 elements there are 5 rows in the analyzer
 
-  if (!new_frame) {
-    p.drawPixmap(0, 0, canvas_);
+  if (!new_frame || canvas_.isNull()) {
+    p.drawImage(0, 0, canvas_);
     return;
   }
 
-  QPainter canvas_painter(&canvas_);
-
-  Analyzer::interpolate(s, scope_);
-
-  // Paint the background
-  canvas_painter.drawPixmap(0, 0, background_);
-
-  for (uint y, x = 0; x < scope_.size(); ++x) {
+  // s has a band for each column
+  for (uint y, x = 0; x < columns_; ++x) {
     // determine y
-    for (y = 0; scope_[x] < yscale_[y]; ++y) continue;
+    const float value = x < static_cast<uint>(s.size()) ? s[x] : 0.0F;
+    for (y = 0; value < yscale_[y]; ++y) continue;
 
     // This is opposite to what you'd think, higher than y means the bar is lower than y (physically)
     if (static_cast<float>(y) > store_[x])
@@ -181,22 +159,64 @@ void BlockAnalyzer::analyze(QPainter &p, const Analyzer::Scope &s, bool new_fram
       fade_intensity_[x] = kFadeSize;
     }
 
+    // REMEMBER: y is a number from 0 to rows_, 0 means all blocks are glowing, rows_ means none are
+    Column column;
+    column.bar = y;
+    column.top = static_cast<int>(store_[x]);
     if (fade_intensity_[x] > 0) {
-      const uint offset = --fade_intensity_[x];
-      const uint y2 = y_ + (fade_pos_[x] * (kHeight + 1));
-      canvas_painter.drawPixmap(x * (kWidth + 1), y2, fade_bars_[offset], 0, 0, kWidth, height() - y2);
+      column.fade = fade_pos_[x];
+      column.fade_intensity = --fade_intensity_[x];
     }
 
     if (fade_intensity_[x] == 0) fade_pos_[x] = rows_;
 
-    // REMEMBER: y is a number from 0 to rows_, 0 means all blocks are glowing, rows_ means none are
-    canvas_painter.drawPixmap(x * (kWidth + 1), y * (kHeight + 1) + y_, *bar(), 0, y * (kHeight + 1), bar()->width(), bar()->height());
+    // Most columns look the same as in the last frame when the music is quiet or the bars are at the top.
+    if (column != columns_drawn_[x]) {
+      drawColumn(x, column);
+      columns_drawn_[x] = column;
+    }
   }
 
-  for (int x = 0; x < store_.size(); ++x)
-    canvas_painter.drawPixmap(x * (kWidth + 1), static_cast<int>(store_[x]) * (kHeight + 1) + y_, topbarpixmap_);
+  p.drawImage(0, 0, canvas_);
+
+}
 
-  p.drawPixmap(0, 0, canvas_);
+void BlockAnalyzer::drawColumn(const uint x, const Column &column) {
+
+  const int left = x * (kWidth + 1);
+  const int width = qMin(static_cast<int>(kWidth), canvas_.width() - left);
+  if (width <= 0) return;
+
+  const int height = canvas_.height();
+  const int blocks_top = y_;
+  const int blocks_bottom = y_ + rows_ * (kHeight + 1);
+  const int bar_top = y_ + column.bar * (kHeight + 1);
+  const int fade_top = column.fade == -1 ? height : y_ + column.fade * (kHeight + 1);
+  const int fade_bottom = fade_top + rows_ * (kHeight + 1);
+  const int topbar_top = y_ + column.top * (kHeight + 1);
+  const int topbar_bottom = topbar_top + kHeight;
+
+  uchar *bits = canvas_.bits();
+  const int bytes_per_line = canvas_.bytesPerLine();
+
+  for (int line = 0; line < height; ++line) {
+    QRgb color;
+    if (line >= topbar_top && line < topbar_bottom) {
+      color = topbar_color_;
+    }
+    else if (line >= bar_top && line < blocks_bottom) {
+      color = bar_lines_[line - blocks_top];
+    }
+    else if (line >= fade_top && line < fade_bottom) {
+      color = (line - fade_top) % (kHeight + 1) < static_cast<int>(kHeight) ? fade_colors_[column.fade_intensity] : background_color_;
+    }
+    else {
+      color = background_lines_[line];
+    }
+
+    QRgb *dest = reinterpret_cast<QRgb*>(bits + line * bytes_per_line) + left;
+    for (int i = 0; i < width; ++i) dest[i] = color;
+  }
 
 }
 
@@ -328,19 +348,18 @@ void BlockAnalyzer::paletteChange(const QPalette&) {
   const QColor bg = palette().color(QPalette::Window);
   const QColor fg = ensureContrast(bg, palette().color(QPalette::Highlight));
 
-  topbarpixmap_.fill(fg);
+  topbar_color_ = fg.rgb();
 
   const double dr = 15 * static_cast<double>(bg.red() - fg.red()) / (rows_ * 16);
   const double dg = 15 * static_cast<double>(bg.green() - fg.green()) / (rows_ * 16);
   const double db = 15 * static_cast<double>(bg.blue() - fg.blue()) / (rows_ * 16);
   const int r = fg.red(), g = fg.green(), b = fg.blue();
 
-  bar()->fill(bg);
-
-  QPainter p(bar());
-  for (int y = 0; static_cast<uint>(y) < rows_; ++y)
+  for (int line = 0; line < bar_lines_.size(); ++line) {
+    const int y = line / (kHeight + 1);
     // graduate the fg color
-    p.fillRect(0, y * (kHeight + 1), kWidth, kHeight, QColor(r + static_cast<int>(dr * y), g + static_cast<int>(dg * y), b + static_cast<int>(db * y)));
+    bar_lines_[line] = line % (kHeight + 1) < static_cast<int>(kHeight) ? QColor(r + static_cast<int>(dr * y), g + static_cast<int>(dg * y), b + static_cast<int>(db * y)).rgb() : bg.rgb();
+  }
 
   {
     const QColor bg2 = palette().color(QPalette::Window).darker(112);
@@ -356,14 +375,10 @@ void BlockAnalyzer::paletteChange(const QPalette&) {
     const double db2 = fg2.blue() - bg2.blue();
     const int r2 = bg2.red(), g2 = bg2.green(), b2 = bg2.blue();
 
-    // Precalculate all fade-bar pixmaps
+    // Precalculate all fade-bar colours
     for (uint y = 0; y < kFadeSize; ++y) {
-      fade_bars_[y].fill(palette().color(QPalette::Window));
-      QPainter f(&fade_bars_[y]);
-      for (int z = 0; static_cast<uint>(z) < rows_; ++z) {
-        const double Y = 1.0 - (log10(kFadeSize - y) / log10(kFadeSize));
-        f.fillRect(0, z * (kHeight + 1), kWidth, kHeight, QColor(r2 + static_cast<int>(dr2 * Y), g2 + static_cast<int>(dg2 * Y), b2 + static_cast<int>(db2 * Y)));
-      }
+      const double Y = 1.0 - (log10(kFadeSize - y) / log10(kFadeSize));
+      fade_colors_[y] = QColor(r2 + static_cast<int>(dr2 * Y), g2 + static_cast<int>(dg2 * Y), b2 + static_cast<int>(db2 * Y)).rgb();
     }
   }
 
@@ -373,21 +388,22 @@ void BlockAnalyzer::paletteChange(const QPalette&) {
 
 void BlockAnalyzer::drawBackground() {
 
-  if (background_.isNull()) {
+  if (canvas_.isNull()) {
     return;
   }
 
   const QColor bg = palette().color(QPalette::Window);
   const QColor bgdark = bg.darker(112);
 
-  background_.fill(bg);
-
-  QPainter p(&background_);
-
-  if (!p.paintEngine()) return;
+  background_color_ = bg.rgb();
+  background_lines_.resize(canvas_.height());
+  for (int line = 0; line < background_lines_.size(); ++line) {
+    const int y = line - static_cast<int>(y_);
+    background_lines_[line] = y >= 0 && y < static_cast<int>(rows_ * (kHeight + 1)) && y % (kHeight + 1) < static_cast<int>(kHeight) ? bgdark.rgb() : bg.rgb();
+  }
 
-  for (int x = 0; static_cast<uint>(x) < columns_; ++x)
-    for (int y = 0; static_cast<uint>(y) < rows_; ++y)
-      p.fillRect(x * (kWidth + 1), y * (kHeight + 1) + y_, kWidth, kHeight, bgdark);
+  // Draw the gaps between the columns once, and every column again in the next frame.
+  canvas_.fill(bg);
+  columns_drawn_.fill(Column());
 
 }
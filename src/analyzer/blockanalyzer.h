@@ -28,9 +28,10 @@
 #include <QObject>
 #include <QVector>
 #include <QString>
-#include <QPixmap>
+#include <QImage>
 #include <QPainter>
 #include <QPalette>
+#include <QColor>
 
 #include "analyzerbase.h"
 
@@ -53,7 +54,6 @@ class BlockAnalyzer : public Analyzer::Base {
   static const char *kName;
 
  protected:
-  void transform(Analyzer::Scope&) override;
   void analyze(QPainter &p, const Analyzer::Scope&, bool new_frame) override;
   void resizeEvent(QResizeEvent*) override;
   virtual void paletteChange(const QPalette&);
@@ -63,19 +63,36 @@ class BlockAnalyzer : public Analyzer::Base {
   void determineStep();
 
  private:
-  QPixmap *bar() { return &barpixmap_; }
+  // What is drawn in a column of the canvas, in rows of blocks.
+  struct Column {
+    Column() : bar(-1), fade(-1), fade_intensity(-1), top(-1) {}
+    bool operator==(const Column &other) const { return bar == other.bar && fade == other.fade && fade_intensity == other.fade_intensity && top == other.top; }
+    bool operator!=(const Column &other) const { return !(*this == other); }
+    int bar;
+    int fade;  // -1 if there's no fade bar
+    int fade_intensity;
+    int top;
+  };
+
+  void drawColumn(const uint x, const Column &column);
 
   uint columns_, rows_;      // number of rows and columns of blocks
   uint y_;                   // y-offset from top of widget
-  QPixmap barpixmap_;
-  QPixmap topbarpixmap_;
-  QPixmap background_;
-  QPixmap canvas_;
-  Analyzer::Scope scope_;    // so we don't create a vector every frame
+
+  // The canvas is kept between frames and only the columns that changed are drawn again,
+  // by writing the colours below straight into its scanlines.
+  QImage canvas_;
+  QVector<Column> columns_drawn_;
+
+  QRgb background_color_;
+  QRgb topbar_color_;
+  QVector<QRgb> background_lines_;  // colour of each line of the widget without bars
+  QVector<QRgb> bar_lines_;         // colour of each line of a full bar, from the top of the blocks
+  QVector<QRgb> fade_colors_;       // colour of the blocks of a fade bar for each intensity
+
   QVector<float> store_;     // current bar heights
   QVector<float> yscale_;
 
-  QVector<QPixmap> fade_bars_;
   QVector<uint> fade_pos_;
   QVector<int> fade_intensity_;
 
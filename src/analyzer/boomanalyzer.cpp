@@ -34,8 +34,8 @@
 
 #include "engine/engine_fwd.h"
 #include "engine/enginebase.h"
-#include "fht.h"
 #include "analyzerbase.h"
+#include "spectrumservice.h"
 
 using Analyzer::Scope;
 
@@ -46,9 +46,8 @@ const uint BoomAnalyzer::kMinBandCount = 32;
 const char* BoomAnalyzer::kName = QT_TRANSLATE_NOOP("AnalyzerContainer", "Boom analyzer");
 
 BoomAnalyzer::BoomAnalyzer(QWidget* parent)
-    : Analyzer::Base(parent, 9),
+    : Analyzer::Base(parent),
       bands_(0),
-      scope_(kMinBandCount),
       fg_(palette().color(QPalette::Highlight)),
       K_barHeight_(1.271)  // 1.471
       ,
@@ -81,7 +80,7 @@ void BoomAnalyzer::resizeEvent(QResizeEvent* e) {
   const double h = 1.2 / HEIGHT;
 
   bands_ = qMin(static_cast<uint>(static_cast<double>(width() + 1) / (kColumnWidth + 1)) + 1, kMaxBandCount);
-  scope_.resize(bands_);
+  SetBands(bands_ <= kMaxBandCount / 2 ? kMaxBandCount / 2 : bands_, bands_, SpectrumService::BandMode_Interpolate, 1.0 / 50);
 
   F_ = static_cast<double>(HEIGHT) / (log10(256) * 1.1 /*<- max. amplitude*/);
 
@@ -101,15 +100,6 @@ void BoomAnalyzer::resizeEvent(QResizeEvent* e) {
 
 }
 
-void BoomAnalyzer::transform(Scope& s) {
-
-  fht_->spectrum(s.data());
-  fht_->scale(s.data(), 1.0 / 50);
-
-  s.resize(scope_.size() <= kMaxBandCount / 2 ? kMaxBandCount / 2 : scope_.size());
-
-}
-
 void BoomAnalyzer::analyze(QPainter& p, const Scope& scope, bool new_frame) {
 
   if (!new_frame || engine_->state() == Engine::Paused) {
@@ -122,10 +112,9 @@ void BoomAnalyzer::analyze(QPainter& p, const Scope& scope, bool new_frame) {
   QPainter canvas_painter(&canvas_);
   canvas_.fill(palette().color(QPalette::Window));
 
-  Analyzer::interpolate(scope, scope_);
-
-  for (uint i = 0, x = 0, y; i < bands_; ++i, x += kColumnWidth + 1) {
-    h = log10(scope_[i] * 256.0) * F_;
+  const uint bands = qMin(bands_, static_cast<uint>(scope.size()));
+  for (uint i = 0, x = 0, y; i < bands; ++i, x += kColumnWidth + 1) {
+    h = log10(scope[i] * 256.0) * F_;
 
     if (h > MAX_HEIGHT) h = MAX_HEIGHT;
 
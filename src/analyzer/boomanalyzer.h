@@ -44,7 +44,6 @@ class BoomAnalyzer : public Analyzer::Base {
 
   static const char* kName;
 
-  void transform(Analyzer::Scope& s) override;
   void analyze(QPainter& p, const Analyzer::Scope&, bool new_frame) override;
 
  public slots:
@@ -59,7 +58,6 @@ class BoomAnalyzer : public Analyzer::Base {
   static const uint kMinBandCount;
 
   uint bands_;
-  Analyzer::Scope scope_;
   QColor fg_;
 
   double K_barHeight_, F_peakSpeed_, F_;
@@ -0,0 +1,169 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <vector>
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define FFT_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define FFT_NEON
+#  include <arm_neon.h>
+#endif
+
+#include "fft.h"
+
+namespace {
+
+// One radix-2 stage on the pairs (a[j], b[j]) of a block, with the twiddle factors w[j].
+void Butterflies(float *ar, float *ai, float *br, float *bi, const float *wr, const float *wi, const int count) {
+
+  int j = 0;
+
+#if defined(FFT_SSE2)
+  for (; j + 4 <= count; j += 4) {
+    const __m128 vbr = _mm_loadu_ps(br + j);
+    const __m128 vbi = _mm_loadu_ps(bi + j);
+    const __m128 vwr = _mm_loadu_ps(wr + j);
+    const __m128 vwi = _mm_loadu_ps(wi + j);
+    const __m128 tr = _mm_sub_ps(_mm_mul_ps(vbr, vwr), _mm_mul_ps(vbi, vwi));
+    const __m128 ti = _mm_add_ps(_mm_mul_ps(vbr, vwi), _mm_mul_ps(vbi, vwr));
+    const __m128 var = _mm_loadu_ps(ar + j);
+    const __m128 vai = _mm_loadu_ps(ai + j);
+    _mm_storeu_ps(br + j, _mm_sub_ps(var, tr));
+    _mm_storeu_ps(bi + j, _mm_sub_ps(vai, ti));
+    _mm_storeu_ps(ar + j, _mm_add_ps(var, tr));
+    _mm_storeu_ps(ai + j, _mm_add_ps(vai, ti));
+  }
+#elif defined(FFT_NEON)
+  for (; j + 4 <= count; j += 4) {
+    const float32x4_t vbr = vld1q_f32(br + j);
+    const float32x4_t vbi = vld1q_f32(bi + j);
+    const float32x4_t vwr = vld1q_f32(wr + j);
+    const float32x4_t vwi = vld1q_f32(wi + j);
+    const float32x4_t tr = vmlsq_f32(vmulq_f32(vbr, vwr), vbi, vwi);
+    const float32x4_t ti = vmlaq_f32(vmulq_f32(vbr, vwi), vbi, vwr);
+    const float32x4_t var = vld1q_f32(ar + j);
+    const float32x4_t vai = vld1q_f32(ai + j);
+    vst1q_f32(br + j, vsubq_f32(var, tr));
+    vst1q_f32(bi + j, vsubq_f32(vai, ti));
+    vst1q_f32(ar + j, vaddq_f32(var, tr));
+    vst1q_f32(ai + j, vaddq_f32(vai, ti));
+  }
+#endif
+
+  for (; j < count; ++j) {
+    const float tr = br[j] * wr[j] - bi[j] * wi[j];
+    const float ti = br[j] * wi[j] + bi[j] * wr[j];
+    br[j] = ar[j] - tr;
+    bi[j] = ai[j] - ti;
+    ar[j] += tr;
+    ai[j] += ti;
+  }
+
+}
+
+}  // namespace
+
+FFT::FFT(const int size_exp)
+    : size_(1 << qMax(2, size_exp)),
+      half_(size_ / 2),
+      window_(size_),
+      bit_reverse_(half_),
+      split_re_(half_),
+      split_im_(half_),
+      re_(half_),
+      im_(half_) {
+
+  // Hann window, doubled so a sine wave keeps its magnitude.
+  for (int i = 0; i < size_; ++i) {
+    window_[i] = static_cast<float>(1.0 - std::cos(2.0 * M_PI * i / size_));
+  }
+
+  int bits = 0;
+  while ((1 << bits) < half_) ++bits;
+  for (int i = 0; i < half_; ++i) {
+    int reversed = 0;
+    for (int bit = 0; bit < bits; ++bit) {
+      if (i & (1 << bit)) reversed |= 1 << (bits - 1 - bit);
+    }
+    bit_reverse_[i] = reversed;
+  }
+
+  // The stage combining blocks of n into blocks of 2n starts at twiddle n - 1.
+  twiddle_re_.reserve(half_);
+  twiddle_im_.reserve(half_);
+  for (int n = 1; n < half_; n *= 2) {
+    for (int j = 0; j < n; ++j) {
+      twiddle_re_.push_back(static_cast<float>(std::cos(M_PI * j / n)));
+      twiddle_im_.push_back(static_cast<float>(-std::sin(M_PI * j / n)));
+    }
+  }
+
+  for (int k = 0; k < half_; ++k) {
+    split_re_[k] = static_cast<float>(std::cos(2.0 * M_PI * k / size_));
+    split_im_[k] = static_cast<float>(-std::sin(2.0 * M_PI * k / size_));
+  }
+
+}
+
+void FFT::Spectrum(const float *samples, float *magnitudes) {
+
+  // Pack the even samples as the real parts and the odd ones as the imaginary parts, in bit reversed order.
+  for (int i = 0; i < half_; ++i) {
+    const int j = bit_reverse_[i] * 2;
+    re_[i] = samples[j] * window_[j];
+    im_[i] = samples[j + 1] * window_[j + 1];
+  }
+
+  Transform();
+
+  // Split the transform of the packed samples into the transforms of the even and odd samples, and combine them.
+  for (int k = 0; k < half_; ++k) {
+    const int m = (half_ - k) & (half_ - 1);
+    const float even_re = (re_[k] + re_[m]) * 0.5F;
+    const float even_im = (im_[k] - im_[m]) * 0.5F;
+    const float odd_re = (im_[k] + im_[m]) * 0.5F;
+    const float odd_im = (re_[m] - re_[k]) * 0.5F;
+    const float re = even_re + split_re_[k] * odd_re - split_im_[k] * odd_im;
+    const float im = even_im + split_re_[k] * odd_im + split_im_[k] * odd_re;
+    magnitudes[k] = std::sqrt(re * re + im * im);
+  }
+
+}
+
+void FFT::Transform() {
+
+  float *re = re_.data();
+  float *im = im_.data();
+
+  for (int n = 1; n < half_; n *= 2) {
+    const float *wr = twiddle_re_.data() + n - 1;
+    const float *wi = twiddle_im_.data() + n - 1;
+    for (int start = 0; start < half_; start += n * 2) {
+      Butterflies(re + start, im + start, re + start + n, im + start + n, wr, wi, n);
+    }
+  }
+
+}
@@ -0,0 +1,67 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include "config.h"
+
+#include <vector>
+
+#include <QtGlobal>
+
+// Magnitude spectrum of real samples, for the analyzers.
+// The samples are Hann windowed and transformed as a complex FFT of half the size, the real and imaginary parts are kept
+// in separate arrays so the butterflies work on four values at a time with SSE2 or NEON.
+class FFT {
+ public:
+  // Transforms of 2^size_exp samples, size_exp should be at least 2.
+  explicit FFT(const int size_exp);
+
+  Q_DISABLE_COPY(FFT)
+
+  int size() const { return size_; }
+
+  // Writes the magnitudes of the size() / 2 lowest frequencies of the size() samples to magnitudes.
+  // A sine wave with amplitude a at bin k gives about a * size() / 2 at k, like the unwindowed transform.
+  void Spectrum(const float *samples, float *magnitudes);
+
+ private:
+  void Transform();
+
+ private:
+  const int size_;
+  const int half_;
+
+  std::vector<float> window_;
+  std::vector<int> bit_reverse_;
+
+  // The twiddle factors of every stage after each other, so each stage reads them in order.
+  std::vector<float> twiddle_re_;
+  std::vector<float> twiddle_im_;
+
+  // The twiddle factors that split the half size transform into the real one.
+  std::vector<float> split_re_;
+  std::vector<float> split_im_;
+
+  std::vector<float> re_;
+  std::vector<float> im_;
+};
+
+#endif  // FFT_H
@@ -26,10 +26,12 @@
 #include "rainbowanalyzer.h"
 
 #include <cmath>
+#include <cstring>
 
 #include <QtGlobal>
 #include <QWidget>
 #include <QPixmap>
+#include <QImage>
 #include <QPainter>
 #include <QColor>
 #include <QBrush>
@@ -38,8 +40,8 @@
 #include <QSize>
 #include <QTimerEvent>
 
-#include "fht.h"
 #include "analyzerbase.h"
+#include "spectrumservice.h"
 
 using Analyzer::Scope;
 
@@ -57,10 +59,9 @@ const float Rainbow::RainbowAnalyzer::kPixelScale = 0.02f;
 Rainbow::RainbowAnalyzer::RainbowType Rainbow::RainbowAnalyzer::rainbowtype;
 
 Rainbow::RainbowAnalyzer::RainbowAnalyzer(const RainbowType& rbtype, QWidget* parent)
-    : Analyzer::Base(parent, 9),
+    : Analyzer::Base(parent),
       timer_id_(startTimer(kFrameIntervalMs)),
       frame_(0),
-      current_buffer_(0),
       available_rainbow_width_(0),
       px_per_frame_(0),
       x_offset_(0),
@@ -80,9 +81,11 @@ Rainbow::RainbowAnalyzer::RainbowAnalyzer(const RainbowType& rbtype, QWidget* pa
     band_scale_[i] = -std::cos(M_PI * i / (kRainbowBands - 1)) * 0.5 * std::pow(2.3, i);
   }
 
-}
+  // Accumulate the spectrum into each band.  Should maybe use a series of band pass filters for this,
+  // so bands can leak into neighbouring bands, but for now it's a series of separate square filters.
+  SetBands(SpectrumService::kBins, kRainbowBands, SpectrumService::BandMode_Sum);
 
-void Rainbow::RainbowAnalyzer::transform(Scope& s) { fht_->spectrum(s.data()); }
+}
 
 void Rainbow::RainbowAnalyzer::timerEvent(QTimerEvent* e) {
 
@@ -100,8 +103,7 @@ void Rainbow::RainbowAnalyzer::resizeEvent(QResizeEvent* e) {
   Q_UNUSED(e);
 
   // Invalidate the buffer so it's recreated from scratch in the next paint event.
-  buffer_[0] = QPixmap();
-  buffer_[1] = QPixmap();
+  buffer_ = QImage();
 
   available_rainbow_width_ = width() - kWidth[rainbowtype] + kRainbowOverlap[rainbowtype];
   px_per_frame_ = static_cast<float>(available_rainbow_width_) / (kHistorySize - 1) + 1;
@@ -111,10 +113,7 @@ void Rainbow::RainbowAnalyzer::resizeEvent(QResizeEvent* e) {
 
 void Rainbow::RainbowAnalyzer::analyze(QPainter& p, const Analyzer::Scope& s, bool new_frame) {
 
-  // Discard the second half of the transform
-  const int scope_size = s.size() / 2;
-
-  if ((new_frame && is_playing_) || (buffer_[0].isNull() && buffer_[1].isNull())) {
+  if ((new_frame && is_playing_) || buffer_.isNull()) {
     // Transform the music into rainbows!
     for (int band = 0; band < kRainbowBands; ++band) {
       float* band_start = history_ + band * kHistorySize;
@@ -123,18 +122,10 @@ void Rainbow::RainbowAnalyzer::analyze(QPainter& p, const Analyzer::Scope& s, bo
       memmove(band_start, band_start + 1, (kHistorySize - 1) * sizeof(float));
     }
 
-    // Now accumulate the scope data into each band.  Should maybe use a series
-    // of band pass filters for this, so bands can leak into neighbouring bands,
-    // but for now it's a series of separate square filters.
-    const int samples_per_band = scope_size / kRainbowBands;
-    int sample = 0;
+    // Add the new value of each band.
     for (int band = 0; band < kRainbowBands; ++band) {
-      float accumulator = 0.0;
-      for (int i = 0; i < samples_per_band; ++i) {
-        accumulator += s[sample++];
-      }
-
-      history_[(band + 1) * kHistorySize - 1] = accumulator * band_scale_[band];
+      const float value = band < static_cast<int>(s.size()) ? s[band] : 0.0F;
+      history_[(band + 1) * kHistorySize - 1] = value * band_scale_[band];
     }
 
     // Create polylines for the rainbows.
@@ -156,14 +147,11 @@ void Rainbow::RainbowAnalyzer::analyze(QPainter& p, const Analyzer::Scope& s, bo
     }
 
     // Do we have to draw the whole rainbow into the buffer?
-    if (buffer_[0].isNull()) {
-      for (int i = 0; i < 2; ++i) {
-        buffer_[i] = QPixmap(QSize(width() + x_offset_, height()));
-        buffer_[i].fill(background_brush_.color());
-      }
-      current_buffer_ = 0;
+    if (buffer_.isNull()) {
+      buffer_ = QImage(QSize(width() + x_offset_, height()), QImage::Format_ARGB32_Premultiplied);
+      buffer_.fill(background_brush_.color());
 
-      QPainter buffer_painter(&buffer_[0]);
+      QPainter buffer_painter(&buffer_);
       buffer_painter.setRenderHint(QPainter::Antialiasing);
       for (int band = kRainbowBands - 1; band >= 0; --band) {
         buffer_painter.setPen(colors_[band]);
@@ -172,14 +160,17 @@ void Rainbow::RainbowAnalyzer::analyze(QPainter& p, const Analyzer::Scope& s, bo
       }
     }
     else {
-      const int last_buffer = current_buffer_;
-      current_buffer_ = (current_buffer_ + 1) % 2;
-
       // We can just shuffle the buffer along a bit and draw the new frame's data.
-      QPainter buffer_painter(&buffer_[current_buffer_]);
+      const int shift = qBound(0, px_per_frame_, buffer_.width());
+      const int bytes = (buffer_.width() - shift) * 4;
+      for (int y = 0; y < buffer_.height(); ++y) {
+        uchar *line = buffer_.scanLine(y);
+        memmove(line, line + shift * 4, bytes);
+      }
+
+      QPainter buffer_painter(&buffer_);
       buffer_painter.setRenderHint(QPainter::Antialiasing);
 
-      buffer_painter.drawPixmap(0, 0, buffer_[last_buffer], px_per_frame_, 0, x_offset_ + available_rainbow_width_ - px_per_frame_, 0);
       buffer_painter.fillRect(x_offset_ + available_rainbow_width_ - px_per_frame_, 0, kWidth[rainbowtype] - kRainbowOverlap[rainbowtype] + px_per_frame_, height(), background_brush_);
 
       for (int band = kRainbowBands - 1; band >= 0; --band) {
@@ -190,7 +181,7 @@ void Rainbow::RainbowAnalyzer::analyze(QPainter& p, const Analyzer::Scope& s, bo
   }
 
   // Draw the buffer on to the widget
-  p.drawPixmap(0, 0, buffer_[current_buffer_], x_offset_, 0, 0, 0);
+  p.drawImage(0, 0, buffer_, x_offset_, 0);
 
   // Draw rainbow analyzer (nyan cat or rainbowdash)
   // Nyan nyan nyan nyan dash dash dash dash.
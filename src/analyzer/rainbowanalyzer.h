@@ -31,6 +31,7 @@
 #include <QObject>
 #include <QWidget>
 #include <QPixmap>
+#include <QImage>
 #include <QPainter>
 #include <QPen>
 #include <QBrush>
@@ -53,7 +54,6 @@ class RainbowAnalyzer : public Analyzer::Base {
   RainbowAnalyzer(const RainbowType& rbtype, QWidget* parent);
 
  protected:
-  void transform(Analyzer::Scope&) override;
   void analyze(QPainter& p, const Analyzer::Scope&, bool new_frame) override;
 
   void timerEvent(QTimerEvent* e) override;
@@ -106,10 +106,9 @@ class RainbowAnalyzer : public Analyzer::Base {
   // The y positions of each point on the rainbow.
   float history_[kHistorySize * kRainbowBands];
 
-  // A cache of the last frame's rainbow, 
-  // so it can be used in the next frame.
-  QPixmap buffer_[2];
-  int current_buffer_;
+  // A cache of the last frame's rainbow, it's scrolled to the left in place
+  // so only the newest part of the rainbow is drawn in the next frame.
+  QImage buffer_;
 
   // Geometry information that's updated on resize:
   // The width of the widget minus the space for the cat
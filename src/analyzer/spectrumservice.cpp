@@ -0,0 +1,176 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+#include <vector>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QtConcurrent>
+#include <QFuture>
+#include <QMutex>
+#include <QMap>
+
+#include "engine/enginebase.h"
+#include "fft.h"
+#include "spectrumservice.h"
+
+const int SpectrumService::kSizeExp = 9;
+const int SpectrumService::kBins = (1 << kSizeExp) / 2;
+
+SpectrumService::SpectrumService(QObject *parent)
+    : QObject(parent),
+      engine_(nullptr),
+      next_id_(0),
+      fft_(kSizeExp),
+      samples_(fft_.size(), 0),
+      spectrum_(fft_.size() / 2, 0),
+      busy_(false) {
+
+  threadpool_.setMaxThreadCount(1);
+
+}
+
+SpectrumService::~SpectrumService() {
+
+  threadpool_.waitForDone();
+
+}
+
+int SpectrumService::AddBands(const int bins, const int count, const BandMode mode, const float scale) {
+
+  Bands bands;
+  bands.count = qMax(0, count);
+  bands.mode = mode;
+  bands.scale = scale;
+  bands.left.resize(bands.count);
+  bands.right.resize(bands.count);
+  bands.weight.resize(bands.count);
+
+  const int bin_count = qBound(1, bins, kBins);
+
+  switch (mode) {
+    case BandMode_Interpolate:{
+      const double step = static_cast<double>(bin_count) / qMax(1, bands.count);
+      double pos = 0.0;
+      for (int i = 0; i < bands.count; ++i, pos += step) {
+        const int offset = static_cast<int>(pos);
+        bands.left[i] = qMin(offset, bin_count - 1);
+        bands.right[i] = qMin(offset + 1, bin_count - 1);
+        bands.weight[i] = static_cast<float>(pos - std::floor(pos));
+      }
+      break;
+    }
+    case BandMode_Sum:{
+      const int bins_per_band = bin_count / qMax(1, bands.count);
+      for (int i = 0; i < bands.count; ++i) {
+        bands.left[i] = i * bins_per_band;
+        bands.right[i] = (i + 1) * bins_per_band;
+      }
+      break;
+    }
+  }
+
+  const int id = next_id_++;
+  bands_.insert(id, bands);
+
+  QMutexLocker l(&mutex_);
+  results_.insert(id, std::vector<float>(bands.count, 0));
+
+  return id;
+
+}
+
+void SpectrumService::RemoveBands(const int id) {
+
+  bands_.remove(id);
+
+  QMutexLocker l(&mutex_);
+  results_.remove(id);
+
+}
+
+std::vector<float> SpectrumService::bands(const int id) const {
+
+  QMutexLocker l(&mutex_);
+  return results_.value(id);
+
+}
+
+bool SpectrumService::Update(const int chunk_length) {
+
+  if (!engine_ || engine_->state() != Engine::Playing || busy_) return false;
+
+  busy_ = true;
+
+  const Engine::Scope scope = engine_->scope(chunk_length);
+  const QMap<int, Bands> bands = bands_;
+  QFuture<void> future = QtConcurrent::run(&threadpool_, [this, scope, bands]() { Transform(scope, bands); });
+
+  return true;
+
+}
+
+void SpectrumService::Transform(const Engine::Scope &scope, const QMap<int, Bands> &bands) {
+
+  // The analyzers show the left and right channels together.
+  const int size = fft_.size();
+  for (int i = 0; i < size; ++i) {
+    const size_t j = static_cast<size_t>(i) * 2;
+    samples_[i] = j + 1 < scope.size() ? static_cast<float>(scope[j] + scope[j + 1]) / (2 * (1 << 15)) : 0.0F;
+  }
+
+  fft_.Spectrum(samples_.data(), spectrum_.data());
+
+  QMap<int, std::vector<float>> results;
+  for (QMap<int, Bands>::const_iterator it = bands.begin(); it != bands.end(); ++it) {
+    const Bands &b = it.value();
+    std::vector<float> values(b.count);
+    switch (b.mode) {
+      case BandMode_Interpolate:
+        for (int i = 0; i < b.count; ++i) {
+          values[i] = (spectrum_[b.left[i]] * (1.0F - b.weight[i]) + spectrum_[b.right[i]] * b.weight[i]) * b.scale;
+        }
+        break;
+      case BandMode_Sum:
+        for (int i = 0; i < b.count; ++i) {
+          float sum = 0.0F;
+          for (int bin = b.left[i]; bin < b.right[i]; ++bin) sum += spectrum_[bin];
+          values[i] = sum * b.scale;
+        }
+        break;
+    }
+    results.insert(it.key(), values);
+  }
+
+  {
+    QMutexLocker l(&mutex_);
+    // Bands removed while the spectrum was computed are not wanted anymore.
+    for (QMap<int, std::vector<float>>::const_iterator it = results.begin(); it != results.end(); ++it) {
+      if (results_.contains(it.key())) results_[it.key()] = it.value();
+    }
+  }
+
+  busy_ = false;
+
+  emit SpectrumReady();
+
+}
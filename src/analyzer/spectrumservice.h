@@ -0,0 +1,107 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SPECTRUMSERVICE_H
+#define SPECTRUMSERVICE_H
+
+#include "config.h"
+
+#include <atomic>
+#include <vector>
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMutex>
+#include <QMap>
+#include <QThreadPool>
+
+#include "engine/engine_fwd.h"
+#include "engine/enginebase.h"
+#include "fft.h"
+
+// Computes the spectrum of the audio that is playing for the analyzers.
+// Update() takes the samples from the engine and the transform runs in a worker thread, the spectrum is turned into
+// the bands of every analyzer there too, and SpectrumReady() is emitted when the bands can be read with bands().
+class SpectrumService : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SpectrumService(QObject *parent = nullptr);
+  ~SpectrumService() override;
+
+  // How the frequency bins are turned into bands.
+  enum BandMode {
+    // Each band is interpolated between the two nearest bins, for more bands than bins.
+    BandMode_Interpolate,
+    // Each band is the sum of the same number of bins.
+    BandMode_Sum
+  };
+
+  static const int kSizeExp;
+  static const int kBins;
+
+  void set_engine(EngineBase *engine) { engine_ = engine; }
+
+  // Adds bands made from the lowest bins of the spectrum, multiplied by scale, and returns their ID.
+  int AddBands(const int bins, const int count, const BandMode mode, const float scale = 1.0);
+  void RemoveBands(const int id);
+
+  // Returns the bands computed last, or zeros if they were not computed yet.
+  std::vector<float> bands(const int id) const;
+
+  // Starts computing the spectrum of the samples playing now, chunk_length is the time between two frames in msec.
+  // Returns false if the last one is still being computed or there's nothing playing.
+  bool Update(const int chunk_length);
+
+ signals:
+  void SpectrumReady();
+
+ private:
+  struct Bands {
+    Bands() : count(0), mode(BandMode_Interpolate), scale(1.0) {}
+    int count;
+    BandMode mode;
+    float scale;
+    // Interpolate: The bins left and right of each band, and the weight of the right one.
+    // Sum: The first bin of each band in left and the bin after the last one in right.
+    std::vector<int> left;
+    std::vector<int> right;
+    std::vector<float> weight;
+  };
+
+  void Transform(const Engine::Scope &scope, const QMap<int, Bands> &bands);
+
+ private:
+  EngineBase *engine_;
+  int next_id_;
+  QMap<int, Bands> bands_;
+
+  // Only used by the worker thread.
+  FFT fft_;
+  std::vector<float> samples_;
+  std::vector<float> spectrum_;
+
+  mutable QMutex mutex_;
+  QMap<int, std::vector<float>> results_;
+
+  std::atomic<bool> busy_;
+  QThreadPool threadpool_;
+};
+
+#endif  // SPECTRUMSERVICE_H
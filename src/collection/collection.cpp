@@ -25,6 +25,7 @@
 #include <QObject>
 #include <QThread>
 #include <QList>
+#include <QSettings>
 #include <QtDebug>
 
 #include "core/application.h"
@@ -41,6 +42,7 @@
 #include "collectionmodel.h"
 #include "playlist/playlistmanager.h"
 #include "scrobbler/lastfmimport.h"
+#include "settings/collectionsettingspage.h"
 
 const char *SCollection::kSongsTable = "songs";
 const char *SCollection::kDirsTable = "directories";
@@ -164,6 +166,11 @@ void SCollection::ReloadSettings() {
   watcher_->ReloadSettingsAsync();
   model_->ReloadSettings();
 
+  QSettings s;
+  s.beginGroup(CollectionSettingsPage::kSettingsGroup);
+  backend_->SetIndexEnabledAsync(s.value("memory_index", false).toBool());
+  s.endGroup();
+
 }
 
 void SCollection::Stopped() {
@@ -29,6 +29,7 @@
 #include <QThread>
 #include <QMutex>
 #include <QSet>
+#include <QHash>
 #include <QMap>
 #include <QVector>
 #include <QVariant>
@@ -38,6 +39,7 @@
 #include <QUrl>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QRegularExpression>
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -53,14 +55,24 @@
 #include "sqlrow.h"
 
 const char *CollectionBackend::kSettingsGroup = "Collection";
+const int CollectionBackend::kBulkUpsertThreshold = 50;
+const int CollectionBackend::kBulkInsertRows = 16;
 
 CollectionBackend::CollectionBackend(QObject *parent) :
     CollectionBackendInterface(parent),
     db_(nullptr),
-    original_thread_(nullptr) {
+    original_thread_(nullptr),
+    index_enabled_(false) {
 
   original_thread_ = thread();
 
+  // Update the index before the songs reach the receivers in other threads.
+  connect(this, SIGNAL(SongsDiscovered(SongList)), SLOT(UpdateIndex(SongList)), Qt::DirectConnection);
+  connect(this, SIGNAL(SongsStatisticsChanged(SongList)), SLOT(UpdateIndex(SongList)), Qt::DirectConnection);
+  connect(this, SIGNAL(SongsRatingChanged(SongList)), SLOT(UpdateIndex(SongList)), Qt::DirectConnection);
+  connect(this, SIGNAL(SongsDeleted(SongList)), SLOT(RemoveFromIndex(SongList)), Qt::DirectConnection);
+  connect(this, SIGNAL(DatabaseReset()), SLOT(ReloadIndex()), Qt::DirectConnection);
+
 }
 
 void CollectionBackend::Init(Database *db, const Song::Source source, const QString &songs_table, const QString &dirs_table, const QString &subdirs_table, const QString &fts_table) {
@@ -98,6 +110,10 @@ void CollectionBackend::LoadDirectoriesAsync() {
   metaObject()->invokeMethod(this, "LoadDirectories", Qt::QueuedConnection);
 }
 
+void CollectionBackend::SetIndexEnabledAsync(const bool enabled) {
+  metaObject()->invokeMethod(this, "SetIndexEnabled", Qt::QueuedConnection, Q_ARG(bool, enabled));
+}
+
 void CollectionBackend::UpdateTotalSongCountAsync() {
   metaObject()->invokeMethod(this, "UpdateTotalSongCount", Qt::QueuedConnection);
 }
@@ -341,9 +357,10 @@ SongList CollectionBackend::FindSongsInDirectory(const int id) {
   if (db_->CheckErrors(q)) return SongList();
 
   SongList ret;
+  SqlQueryCursor cursor(q);
   while (q.next()) {
     Song song(source_);
-    song.InitFromQuery(q, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -417,6 +434,11 @@ void CollectionBackend::AddOrUpdateSongsAsync(const SongList &songs) {
 
 void CollectionBackend::AddOrUpdateSongs(const SongList &songs) {
 
+  if (songs.count() >= kBulkUpsertThreshold) {
+    AddOrUpdateSongsBulk(songs);
+    return;
+  }
+
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
@@ -534,6 +556,179 @@ void CollectionBackend::AddOrUpdateSongs(const SongList &songs) {
 
 }
 
+void CollectionBackend::AddOrUpdateSongsBulk(const SongList &songs) {
+
+  QMutexLocker l(db_->Mutex());
+  QSqlDatabase db(db_->Connect());
+
+  // Check that the directories still exist once for the whole batch instead of once per song.
+  QSet<int> directory_ids;
+  if (!dirs_table_.isEmpty()) {
+    QSet<int> song_directory_ids;
+    for (const Song &song : songs) {
+      song_directory_ids << song.directory_id();
+    }
+    QStringList ids;
+    for (const int id : song_directory_ids) {
+      ids << QString::number(id);
+    }
+    QSqlQuery check_dirs(db);
+    check_dirs.prepare(QString("SELECT ROWID FROM %1 WHERE ROWID IN (%2)").arg(dirs_table_, ids.join(",")));
+    check_dirs.exec();
+    if (db_->CheckErrors(check_dirs)) return;
+    while (check_dirs.next()) {
+      directory_ids << check_dirs.value(0).toInt();
+    }
+  }
+
+  // A song can be in the batch more than once, only write the last version of it.
+  SongList batch;
+  QHash<QString, int> batch_index;
+  for (const Song &song : songs) {
+    QString key;
+    if (song.id() != -1) key = "id:" + QString::number(song.id());
+    else if (!song.song_id().isEmpty()) key = "song_id:" + song.song_id();
+    if (!key.isEmpty() && batch_index.contains(key)) {
+      batch[batch_index.value(key)] = song;
+      continue;
+    }
+    if (!key.isEmpty()) batch_index.insert(key, batch.count());
+    batch << song;
+  }
+
+  // Get the previous data of all the songs that are already in the database.
+  QStringList ids;
+  QStringList song_ids;
+  for (const Song &song : batch) {
+    if (song.id() != -1) ids << QString::number(song.id());
+    else if (!song.song_id().isEmpty()) song_ids << song.song_id();
+  }
+  QHash<int, Song> old_songs;
+  if (!ids.isEmpty()) {
+    for (const Song &song : GetSongsById(ids, db)) {
+      old_songs.insert(song.id(), song);
+    }
+  }
+  QHash<QString, Song> old_songs_by_song_id;
+  if (!song_ids.isEmpty()) {
+    for (const Song &song : GetSongsBySongId(song_ids, db)) {
+      old_songs_by_song_id.insert(song.song_id(), song);
+    }
+  }
+
+  ScopedTransaction transaction(&db);
+
+  QSqlQuery update_song(db);
+  update_song.prepare(QString("UPDATE %1 SET " + Song::kUpdateSpec + " WHERE ROWID = :id").arg(songs_table_));
+
+  SongList added_songs;
+  SongList deleted_songs;
+  SongList new_songs;
+  QStringList fts_ids;
+
+  for (const Song &song : batch) {
+
+    // Skip songs from directories that were removed while CollectionWatcher was scanning them.
+    if (!dirs_table_.isEmpty() && !directory_ids.contains(song.directory_id())) continue;
+
+    Song old_song;
+    if (song.id() != -1) {
+      old_song = old_songs.value(song.id());
+      if (!old_song.is_valid()) continue;
+    }
+    else if (!song.song_id().isEmpty()) {
+      old_song = old_songs_by_song_id.value(song.song_id());
+    }
+
+    if (!old_song.is_valid() || old_song.id() == -1) {
+      new_songs << song;
+      continue;
+    }
+
+    Song new_song = song;
+    new_song.set_id(old_song.id());
+    new_song.BindToQuery(&update_song);
+    update_song.bindValue(":id", new_song.id());
+    update_song.exec();
+    if (db_->CheckErrors(update_song)) continue;
+
+    fts_ids << QString::number(new_song.id());
+    deleted_songs << old_song;
+    added_songs << new_song;
+
+  }
+
+  // Insert the new songs several rows at a time.
+  // The ROWIDs are given explicitly, so the IDs of the songs don't depend on how SQLite numbers the rows of one statement.
+  int next_id = 1;
+  if (!new_songs.isEmpty()) {
+    QSqlQuery max_id(db);
+    max_id.prepare(QString("SELECT MAX(ROWID) FROM %1").arg(songs_table_));
+    max_id.exec();
+    if (db_->CheckErrors(max_id)) return;
+    if (max_id.next()) next_id = max_id.value(0).toInt() + 1;
+  }
+
+  QStringList placeholders;
+  for (int i = 0; i < Song::kColumns.count() + 1; ++i) {
+    placeholders << "?";
+  }
+  const QString row_spec = "(" + placeholders.join(", ") + ")";
+  QSqlQuery add_songs(db);
+  int add_songs_rows = 0;
+  for (int i = 0; i < new_songs.count(); i += kBulkInsertRows) {
+    const int rows = qMin(kBulkInsertRows, new_songs.count() - i);
+    if (rows != add_songs_rows) {
+      QStringList values;
+      for (int row = 0; row < rows; ++row) {
+        values << row_spec;
+      }
+      add_songs.prepare(QString("INSERT INTO %1 (ROWID, " + Song::kColumnSpec + ") VALUES " + values.join(", ")).arg(songs_table_));
+      add_songs_rows = rows;
+    }
+    for (int row = 0; row < rows; ++row) {
+      add_songs.addBindValue(next_id + row);
+      new_songs.at(i + row).AddBindValues(&add_songs);
+    }
+    add_songs.exec();
+    if (db_->CheckErrors(add_songs)) continue;
+
+    const int first_id = next_id;
+    next_id += rows;
+    for (int row = 0; row < rows; ++row) {
+      Song copy(new_songs.at(i + row));
+      copy.set_id(first_id + row);
+      fts_ids << QString::number(copy.id());
+      added_songs << copy;
+    }
+  }
+
+  // Update the FTS index in one pass from the rows that were just written.
+  if (!fts_ids.isEmpty()) {
+    const QString in = fts_ids.join(",");
+    QSqlQuery delete_fts(db);
+    delete_fts.prepare(QString("DELETE FROM %1 WHERE ROWID IN (%2)").arg(fts_table_, in));
+    delete_fts.exec();
+    db_->CheckErrors(delete_fts);
+
+    QSqlQuery add_fts(db);
+    add_fts.prepare(QString("INSERT INTO %1 (ROWID, " + Song::kFtsColumnSpec + ") SELECT ROWID, " + Song::kFtsSourceColumnSpec + " FROM %2 WHERE ROWID IN (%3)").arg(fts_table_, songs_table_, in));
+    add_fts.exec();
+    db_->CheckErrors(add_fts);
+  }
+
+  transaction.Commit();
+
+  if (!deleted_songs.isEmpty()) emit SongsDeleted(deleted_songs);
+
+  if (!added_songs.isEmpty()) emit SongsDiscovered(added_songs);
+
+  UpdateTotalSongCountAsync();
+  UpdateTotalArtistCountAsync();
+  UpdateTotalAlbumCountAsync();
+
+}
+
 void CollectionBackend::UpdateMTimesOnly(const SongList &songs) {
 
   QMutexLocker l(db_->Mutex());
@@ -612,7 +807,7 @@ QStringList CollectionBackend::GetAll(const QString &column, const QueryOptions
   query.SetColumnSpec("DISTINCT " + column);
   query.AddCompilationRequirement(false);
 
-  QMutexLocker l(db_->Mutex());
+  QMutexLocker l(db_->ReaderMutex());
   if (!ExecQuery(&query)) return QStringList();
 
   QStringList ret;
@@ -644,7 +839,7 @@ QStringList CollectionBackend::GetAllArtistsWithAlbums(const QueryOptions &opt)
   query2.AddWhere("albumartist", "", "=");
 
   {
-    QMutexLocker l(db_->Mutex());
+    QMutexLocker l(db_->ReaderMutex());
     if (!ExecQuery(&query) || !ExecQuery(&query2)) {
       return QStringList();
     }
@@ -689,13 +884,14 @@ SongList CollectionBackend::GetSongs(const QString &artist, const QString &album
 SongList CollectionBackend::ExecCollectionQuery(CollectionQuery *query) {
 
   query->SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
-  QMutexLocker l(db_->Mutex());
+  QMutexLocker l(db_->ReaderMutex());
   if (!ExecQuery(query)) return SongList();
 
   SongList ret;
+  SqlQueryCursor cursor(*query);
   while (query->Next()) {
     Song song(source_);
-    song.InitFromQuery(*query, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -709,8 +905,8 @@ Song CollectionBackend::GetSongById(const int id) {
 }
 
 SongList CollectionBackend::GetSongsById(const QList<int> &ids) {
-  QMutexLocker l(db_->Mutex());
-  QSqlDatabase db(db_->Connect());
+  QMutexLocker l(db_->ReaderMutex());
+  QSqlDatabase db(db_->ConnectReader());
 
   QStringList str_ids;
   for (int id : ids) {
@@ -721,8 +917,8 @@ SongList CollectionBackend::GetSongsById(const QList<int> &ids) {
 }
 
 SongList CollectionBackend::GetSongsById(const QStringList &ids) {
-  QMutexLocker l(db_->Mutex());
-  QSqlDatabase db(db_->Connect());
+  QMutexLocker l(db_->ReaderMutex());
+  QSqlDatabase db(db_->ConnectReader());
 
   return GetSongsById(ids, db);
 }
@@ -740,12 +936,13 @@ SongList CollectionBackend::GetSongsByForeignId(const QStringList &ids, const QS
   if (db_->CheckErrors(q)) return SongList();
 
   QVector<Song> ret(ids.count());
+  SqlQueryCursor cursor(q);
   while (q.next()) {
     const QString foreign_id = q.value(Song::kColumns.count() + 1).toString();
     const int index = ids.indexOf(foreign_id);
     if (index == -1) continue;
 
-    ret[index].InitFromQuery(q, true);
+    ret[index].InitFromQuery(cursor, true);
   }
   return ret.toList();
 
@@ -767,9 +964,10 @@ SongList CollectionBackend::GetSongsById(const QStringList &ids, QSqlDatabase &d
   if (db_->CheckErrors(q)) return SongList();
 
   SongList ret;
+  SqlQueryCursor cursor(q);
   while (q.next()) {
     Song song(source_);
-    song.InitFromQuery(q, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -778,8 +976,8 @@ SongList CollectionBackend::GetSongsById(const QStringList &ids, QSqlDatabase &d
 
 Song CollectionBackend::GetSongByUrl(const QUrl &url, const qint64 beginning) {
 
-  QMutexLocker l(db_->Mutex());
-  QSqlDatabase db(db_->Connect());
+  QMutexLocker l(db_->ReaderMutex());
+  QSqlDatabase db(db_->ConnectReader());
 
   QSqlQuery q(db);
   q.prepare(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE (url = :url1 OR url = :url2 OR url = :url3 OR url = :url4) AND beginning = :beginning AND unavailable = 0").arg(songs_table_));
@@ -801,8 +999,8 @@ Song CollectionBackend::GetSongByUrl(const QUrl &url, const qint64 beginning) {
 
 SongList CollectionBackend::GetSongsByUrl(const QUrl &url) {
 
-  QMutexLocker l(db_->Mutex());
-  QSqlDatabase db(db_->Connect());
+  QMutexLocker l(db_->ReaderMutex());
+  QSqlDatabase db(db_->ConnectReader());
 
   QSqlQuery q(db);
   q.prepare(QString("SELECT ROWID, " + Song::kColumnSpec + " FROM %1 WHERE (url = :url1 OR url = :url2 OR url = :url3 OR url = :url4) AND unavailable = 0").arg(songs_table_));
@@ -814,9 +1012,10 @@ SongList CollectionBackend::GetSongsByUrl(const QUrl &url) {
 
   SongList songs;
   if (q.exec()) {
+    SqlQueryCursor cursor(q);
     while (q.next()) {
       Song song(source_);
-      song.InitFromQuery(q, true);
+      song.InitFromQuery(cursor, true);
       songs << song;
     }
   }
@@ -865,9 +1064,10 @@ SongList CollectionBackend::GetSongsBySongId(const QStringList &song_ids, QSqlDa
   if (db_->CheckErrors(q)) return SongList();
 
   SongList ret;
+  SqlQueryCursor cursor(q);
   while (q.next()) {
     Song song(source_);
-    song.InitFromQuery(q, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -885,13 +1085,14 @@ SongList CollectionBackend::GetCompilationSongs(const QString &album, const Quer
   query.AddCompilationRequirement(true);
   query.AddWhere("album", album);
 
-  QMutexLocker l(db_->Mutex());
+  QMutexLocker l(db_->ReaderMutex());
   if (!ExecQuery(&query)) return SongList();
 
   SongList ret;
+  SqlQueryCursor cursor(query);
   while (query.Next()) {
     Song song(source_);
-    song.InitFromQuery(query, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -983,9 +1184,10 @@ void CollectionBackend::UpdateCompilations(QSqlQuery &find_song, QSqlQuery &upda
   find_song.bindValue(":url4", url.toEncoded());
 
   if (find_song.exec()) {
+    SqlQueryCursor cursor(find_song);
     while (find_song.next()) {
       Song song(source_);
-      song.InitFromQuery(find_song, true);
+      song.InitFromQuery(cursor, true);
       deleted_songs << song;
       song.set_compilation_detected(compilation_detected);
       added_songs << song;
@@ -1018,7 +1220,7 @@ CollectionBackend::AlbumList CollectionBackend::GetAlbums(const QString &artist,
   }
 
   {
-    QMutexLocker l(db_->Mutex());
+    QMutexLocker l(db_->ReaderMutex());
     if (!ExecQuery(&query)) return AlbumList();
   }
 
@@ -1087,7 +1289,7 @@ CollectionBackend::Album CollectionBackend::GetAlbumArt(const QString &artist, c
   }
   query.AddWhere("album", album);
 
-  QMutexLocker l(db_->Mutex());
+  QMutexLocker l(db_->ReaderMutex());
   if (!ExecQuery(&query)) return ret;
 
   if (query.Next()) {
@@ -1126,9 +1328,10 @@ void CollectionBackend::UpdateManualAlbumArt(const QString &artist, const QStrin
   if (!ExecQuery(&query)) return;
 
   SongList deleted_songs;
+  SqlQueryCursor cursor(query);
   while (query.Next()) {
     Song song(source_);
-    song.InitFromQuery(query, true);
+    song.InitFromQuery(cursor, true);
     deleted_songs << song;
   }
 
@@ -1160,9 +1363,10 @@ void CollectionBackend::UpdateManualAlbumArt(const QString &artist, const QStrin
   if (!ExecQuery(&query)) return;
 
   SongList added_songs;
+  SqlQueryCursor updated_cursor(query);
   while (query.Next()) {
     Song song(source_);
-    song.InitFromQuery(query, true);
+    song.InitFromQuery(updated_cursor, true);
     added_songs << song;
   }
 
@@ -1188,9 +1392,10 @@ void CollectionBackend::ForceCompilation(const QString &album, const QList<QStri
 
     if (!ExecQuery(&query)) return;
 
+    SqlQueryCursor cursor(query);
     while (query.Next()) {
       Song song(source_);
-      song.InitFromQuery(query, true);
+      song.InitFromQuery(cursor, true);
       deleted_songs << song;
     }
 
@@ -1211,9 +1416,10 @@ void CollectionBackend::ForceCompilation(const QString &album, const QList<QStri
     // Now get the updated songs
     if (!ExecQuery(&query)) return;
 
+    SqlQueryCursor updated_cursor(query);
     while (query.Next()) {
       Song song(source_);
-      song.InitFromQuery(query, true);
+      song.InitFromQuery(updated_cursor, true);
       added_songs << song;
     }
   }
@@ -1226,7 +1432,7 @@ void CollectionBackend::ForceCompilation(const QString &album, const QList<QStri
 }
 
 bool CollectionBackend::ExecQuery(CollectionQuery *q) {
-  return !db_->CheckErrors(q->Exec(db_->Connect(), songs_table_, fts_table_));
+  return !db_->CheckErrors(q->Exec(db_->ConnectReader(), songs_table_, fts_table_));
 }
 
 void CollectionBackend::IncrementPlayCount(const int id) {
@@ -1324,9 +1530,10 @@ SongList CollectionBackend::FindSongs(const SmartPlaylistSearch &search) {
   if (db_->CheckErrors(query)) return ret;
 
   // Read the results
+  SqlQueryCursor cursor(query);
   while (query.next()) {
     Song song;
-    song.InitFromQuery(query, true);
+    song.InitFromQuery(cursor, true);
     ret << song;
   }
   return ret;
@@ -1358,9 +1565,10 @@ SongList CollectionBackend::GetSongsBy(const QString &artist, const QString &alb
   q.bindValue(":title", title);
   q.exec();
   if (db_->CheckErrors(q)) return SongList();
+  SqlQueryCursor cursor(q);
   while (q.next()) {
     Song song(source_);
-    song.InitFromQuery(q, true);
+    song.InitFromQuery(cursor, true);
     songs << song;
   }
 
@@ -1456,3 +1664,41 @@ void CollectionBackend::UpdateSongsRatingAsync(const QList<int>& ids, const floa
   metaObject()->invokeMethod(this, "UpdateSongsRating", Qt::QueuedConnection, Q_ARG(QList<int>, ids), Q_ARG(float, rating));
 }
 
+void CollectionBackend::SetIndexEnabled(const bool enabled) {
+
+  if (enabled == index_enabled_) return;
+  index_enabled_ = enabled;
+
+  if (index_enabled_) {
+    ReloadIndex();
+  }
+  else {
+    index_.Clear();
+  }
+
+}
+
+void CollectionBackend::UpdateIndex(const SongList &songs) {
+
+  if (index_enabled_) index_.AddOrUpdateSongs(songs);
+
+}
+
+void CollectionBackend::RemoveFromIndex(const SongList &songs) {
+
+  if (index_enabled_) index_.RemoveSongs(songs);
+
+}
+
+void CollectionBackend::ReloadIndex() {
+
+  if (!index_enabled_) return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  index_.Reset(GetAllSongs());
+
+  qLog(Debug) << "Indexed" << index_.song_count() << "songs from" << songs_table_ << "in" << timer.elapsed() << "ms";
+
+}
@@ -36,6 +36,7 @@
 
 #include "core/song.h"
 #include "collectionquery.h"
+#include "collectionindex.h"
 #include "directory.h"
 
 class QThread;
@@ -129,6 +130,10 @@ class CollectionBackend : public CollectionBackendInterface {
 
   Database *db() const { return db_; }
 
+  // The in-memory index of the songs table, it answers queries once it is enabled and loaded.
+  const CollectionIndex *index() const { return &index_; }
+  void SetIndexEnabledAsync(const bool enabled);
+
   QString songs_table() const override { return songs_table_; }
   QString dirs_table() const { return dirs_table_; }
   QString subdirs_table() const { return subdirs_table_; }
@@ -219,6 +224,13 @@ class CollectionBackend : public CollectionBackendInterface {
   void UpdateSongRating(const int id, const float rating);
   void UpdateSongsRating(const QList<int> &id_list, const float rating);
 
+  void SetIndexEnabled(const bool enabled);
+
+ private slots:
+  void UpdateIndex(const SongList &songs);
+  void RemoveFromIndex(const SongList &songs);
+  void ReloadIndex();
+
  signals:
   void DirectoryDiscovered(Directory, SubdirectoryList);
   void DirectoryDeleted(Directory);
@@ -247,6 +259,7 @@ class CollectionBackend : public CollectionBackendInterface {
     int has_not_compilation_detected;
   };
 
+  void AddOrUpdateSongsBulk(const SongList &songs);
   void UpdateCompilations(QSqlQuery &find_song, QSqlQuery &update_song, SongList &deleted_songs, SongList &added_songs, const QUrl &url, const bool compilation_detected);
   AlbumList GetAlbums(const QString &artist, const QString &album_artist, const bool compilation_required = false, const QueryOptions &opt = QueryOptions());
   AlbumList GetAlbums(const QString &artist, const bool compilation_required, const QueryOptions &opt = QueryOptions());
@@ -259,6 +272,11 @@ class CollectionBackend : public CollectionBackendInterface {
   SongList GetSongsBySongId(const QStringList &song_ids, QSqlDatabase &db);
 
  private:
+  // Batches with at least this many songs are written with AddOrUpdateSongsBulk()
+  static const int kBulkUpsertThreshold;
+  // Rows per INSERT statement in bulk mode, this keeps the number of bind values (ROWID and the song columns per row) below SQLite's default limit of 999.
+  static const int kBulkInsertRows;
+
   Database *db_;
   Song::Source source_;
   QString songs_table_;
@@ -267,6 +285,9 @@ class CollectionBackend : public CollectionBackendInterface {
   QString fts_table_;
   QThread *original_thread_;
 
+  bool index_enabled_;
+  CollectionIndex index_;
+
 };
 
 #endif  // COLLECTIONBACKEND_H
@@ -0,0 +1,509 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QReadWriteLock>
+#include <QDateTime>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QHash>
+#include <QChar>
+#include <QString>
+#include <QStringList>
+#include <QRegularExpression>
+
+#include "core/song.h"
+#include "collectionquery.h"
+#include "collectionindex.h"
+
+const QStringList CollectionIndex::kColumnNames = QStringList() << "effective_albumartist"
+                                                                << "artist"
+                                                                << "album"
+                                                                << "album_id"
+                                                                << "grouping"
+                                                                << "genre"
+                                                                << "composer"
+                                                                << "performer"
+                                                                << "year"
+                                                                << "originalyear"
+                                                                << "effective_originalyear"
+                                                                << "disc"
+                                                                << "filetype"
+                                                                << "samplerate"
+                                                                << "bitdepth"
+                                                                << "bitrate"
+                                                                << "compilation_effective";
+
+CollectionIndex::CollectionIndex() : loaded_(false) {
+
+  Q_ASSERT(kColumnNames.count() == ColumnCount);
+  Q_ASSERT(Song::kFtsColumns.count() == kFtsColumnCount);
+
+  // The empty string is always ID 0.
+  Intern(QString());
+
+}
+
+bool CollectionIndex::is_loaded() const {
+
+  QReadLocker l(&lock_);
+  return loaded_;
+
+}
+
+int CollectionIndex::song_count() const {
+
+  QReadLocker l(&lock_);
+  return songs_.count();
+
+}
+
+void CollectionIndex::Reset(const SongList &songs) {
+
+  Clear();
+
+  QWriteLocker l(&lock_);
+  for (const Song &song : songs) {
+    AddSong(song);
+  }
+  loaded_ = true;
+
+}
+
+void CollectionIndex::Clear() {
+
+  QWriteLocker l(&lock_);
+
+  loaded_ = false;
+  strings_.clear();
+  words_.clear();
+  string_ids_.clear();
+  songs_.clear();
+  for (int i = 0; i < ColumnCount; ++i) columns_[i].clear();
+  for (int i = 0; i < kFtsColumnCount; ++i) fts_columns_[i].clear();
+  rows_.clear();
+
+  Intern(QString());
+
+}
+
+void CollectionIndex::AddOrUpdateSongs(const SongList &songs) {
+
+  QWriteLocker l(&lock_);
+  if (!loaded_) return;
+
+  for (const Song &song : songs) {
+    if (rows_.contains(song.id())) RemoveRow(rows_[song.id()]);
+    AddSong(song);
+  }
+
+}
+
+void CollectionIndex::RemoveSongs(const SongList &songs) {
+
+  QWriteLocker l(&lock_);
+  if (!loaded_) return;
+
+  for (const Song &song : songs) {
+    if (rows_.contains(song.id())) RemoveRow(rows_[song.id()]);
+  }
+
+}
+
+void CollectionIndex::AddSong(const Song &song) {
+
+  // The collection model never shows unavailable songs, so they are left out.
+  if (song.id() == -1 || song.is_unavailable()) return;
+
+  rows_[song.id()] = songs_.count();
+  songs_ << song;
+
+  for (int i = 0; i < ColumnCount; ++i) {
+    columns_[i] << ColumnValue(song, Column(i));
+  }
+
+  const QStringList fts_values = FtsValues(song);
+  for (int i = 0; i < kFtsColumnCount; ++i) {
+    fts_columns_[i] << Intern(fts_values[i]);
+  }
+
+}
+
+void CollectionIndex::RemoveRow(const int row) {
+
+  // Move the last song into the row, so the vectors don't have to be shifted.
+  const int last = songs_.count() - 1;
+  rows_.remove(songs_[row].id());
+  if (row != last) {
+    songs_[row] = songs_[last];
+    rows_[songs_[row].id()] = row;
+    for (int i = 0; i < ColumnCount; ++i) columns_[i][row] = columns_[i][last];
+    for (int i = 0; i < kFtsColumnCount; ++i) fts_columns_[i][row] = fts_columns_[i][last];
+  }
+
+  songs_.removeLast();
+  for (int i = 0; i < ColumnCount; ++i) columns_[i].removeLast();
+  for (int i = 0; i < kFtsColumnCount; ++i) fts_columns_[i].removeLast();
+
+}
+
+int CollectionIndex::Intern(const QString &text) {
+
+  // Strings are not removed again until the index is reset, there are few of them compared to songs.
+  // NULL and empty strings are the same in the songs table.
+  const QString key = text.isNull() ? QString("") : text;
+  QHash<QString, int>::const_iterator it = string_ids_.constFind(key);
+  if (it != string_ids_.constEnd()) return it.value();
+
+  const int id = strings_.count();
+  strings_ << key;
+  words_ << Tokenize(key);
+  string_ids_.insert(key, id);
+
+  return id;
+
+}
+
+int CollectionIndex::FindString(const QString &text) const {
+
+  return string_ids_.value(text.isNull() ? QString("") : text, -1);
+
+}
+
+bool CollectionIndex::IsStringColumn(const Column column) {
+
+  return column <= Column_Performer;
+
+}
+
+CollectionIndex::Column CollectionIndex::ColumnFromName(const QString &name) {
+
+  const int i = kColumnNames.indexOf(name);
+  return i == -1 ? ColumnCount : Column(i);
+
+}
+
+int CollectionIndex::ColumnValue(const Song &song, const Column column) {
+
+  switch (column) {
+    case Column_EffectiveAlbumArtist:      return Intern(song.effective_albumartist());
+    case Column_Artist:                    return Intern(song.artist());
+    case Column_Album:                     return Intern(song.album());
+    case Column_AlbumId:                   return Intern(song.album_id());
+    case Column_Grouping:                  return Intern(song.grouping());
+    case Column_Genre:                     return Intern(song.genre());
+    case Column_Composer:                  return Intern(song.composer());
+    case Column_Performer:                 return Intern(song.performer());
+    case Column_Year:                      return song.year();
+    case Column_OriginalYear:              return song.originalyear();
+    case Column_EffectiveOriginalYear:     return song.effective_originalyear();
+    case Column_Disc:                      return song.disc();
+    case Column_FileType:                  return song.filetype();
+    case Column_Samplerate:                return song.samplerate();
+    case Column_Bitdepth:                  return song.bitdepth();
+    case Column_Bitrate:                   return song.bitrate();
+    case Column_CompilationEffective:      return song.is_compilation() ? 1 : 0;
+    case ColumnCount:                      break;
+  }
+
+  return 0;
+
+}
+
+void CollectionIndex::SetColumn(Song *song, const Column column, const int value) const {
+
+  // Sets the same fields as CollectionModel does for a row of the equivalent SQL query.
+  switch (column) {
+    case Column_EffectiveAlbumArtist:  song->set_albumartist(strings_[value]); break;
+    case Column_Artist:                song->set_artist(strings_[value]); break;
+    case Column_Album:                 song->set_album(strings_[value]); break;
+    case Column_AlbumId:               song->set_album_id(strings_[value]); break;
+    case Column_Grouping:              song->set_grouping(strings_[value]); break;
+    case Column_Genre:                 song->set_genre(strings_[value]); break;
+    case Column_Composer:              song->set_composer(strings_[value]); break;
+    case Column_Performer:             song->set_performer(strings_[value]); break;
+    case Column_Year:                  song->set_year(value); break;
+    case Column_OriginalYear:          song->set_originalyear(value); break;
+    case Column_EffectiveOriginalYear: song->set_originalyear(value); break;
+    case Column_Disc:                  song->set_disc(value); break;
+    case Column_FileType:              song->set_filetype(Song::FileType(value)); break;
+    case Column_Samplerate:            song->set_samplerate(value); break;
+    case Column_Bitdepth:              song->set_bitdepth(value); break;
+    case Column_Bitrate:               song->set_bitrate(value); break;
+    case Column_CompilationEffective:  song->set_compilation(value == 1); break;
+    case ColumnCount:                  break;
+  }
+
+}
+
+QStringList CollectionIndex::Tokenize(const QString &text) {
+
+  QStringList words;
+  QString word;
+  const QString decomposed = text.normalized(QString::NormalizationForm_D);
+  for (const QChar c : decomposed) {
+    if (c.isLetterOrNumber()) {
+      word.append(c.toCaseFolded());
+    }
+    else if (c.category() == QChar::Mark_NonSpacing) {
+      // Diacritics are dropped without splitting the word.
+      continue;
+    }
+    else if (!word.isEmpty()) {
+      words << word;
+      word.clear();
+    }
+  }
+  if (!word.isEmpty()) words << word;
+
+  return words;
+
+}
+
+QList<CollectionIndex::FilterTerm> CollectionIndex::ParseFilter(const QString &filter) {
+
+  // This follows how CollectionQuery turns the filter text into an FTS5 query.
+
+  QList<FilterTerm> terms;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+  const QStringList tokens = filter.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+#else
+  const QStringList tokens = filter.split(QRegularExpression("\\s+"), QString::SkipEmptyParts);
+#endif
+  for (QString token : tokens) {
+    token.remove('(');
+    token.remove(')');
+    token.remove('"');
+    token.replace('-', ' ');
+
+    FilterTerm term;
+    if (token.contains(':')) {
+      const int fts_column = Song::kFtsColumns.indexOf("fts" + token.section(':', 0, 0).toLower());
+      if (fts_column != -1) {
+        term.fts_column = fts_column;
+        token = token.section(':', 1, -1);
+        if (token.trimmed().isEmpty()) continue;
+      }
+      token.replace(':', ' ');
+    }
+    term.words = Tokenize(token);
+    terms << term;
+  }
+
+  return terms;
+
+}
+
+QStringList CollectionIndex::FtsValues(const Song &song) {
+
+  return QStringList() << song.title()
+                       << song.album()
+                       << song.artist()
+                       << song.albumartist()
+                       << song.composer()
+                       << song.performer()
+                       << song.grouping()
+                       << song.genre()
+                       << song.comment();
+
+}
+
+bool CollectionIndex::WordsMatch(const QStringList &words, const FilterTerm &term) {
+
+  const int count = term.words.count();
+  if (count == 0) return true;
+
+  for (int i = 0; i + count <= words.count(); ++i) {
+    int j = 0;
+    while (j < count - 1 && words[i + j] == term.words[j]) ++j;
+    if (j == count - 1 && words[i + j].startsWith(term.words[j])) return true;
+  }
+
+  return false;
+
+}
+
+bool CollectionIndex::RowMatches(const int row, const FilterTerm &term, QVector<qint8> *memo) const {
+
+  for (int i = 0; i < kFtsColumnCount; ++i) {
+    if (term.fts_column != -1 && term.fts_column != i) continue;
+    const int id = fts_columns_[i][row];
+    qint8 &match = (*memo)[id];
+    if (match == -1) match = WordsMatch(words_[id], term) ? 1 : 0;
+    if (match == 1) return true;
+  }
+
+  return false;
+
+}
+
+bool CollectionIndex::Query(const CollectionQuery &query, const QList<Column> &columns, SongList *songs) const {
+
+  // The duplicated songs view isn't kept in the index.
+  const QueryOptions &options = query.options();
+  if (!query.has_only_conditions() || query.include_unavailable() || options.query_mode() == QueryOptions::QueryMode_Duplicates) {
+    return false;
+  }
+
+  QReadLocker l(&lock_);
+
+  if (!loaded_) return false;
+
+  // Turn the conditions into integer comparisons.
+  QList<Condition> conditions;
+  for (const CollectionQuery::Condition &where : query.conditions()) {
+    Condition condition;
+    condition.column = ColumnFromName(where.column);
+    if (condition.column == ColumnCount || where.op != "=") return false;
+    if (IsStringColumn(condition.column)) {
+      condition.value = FindString(where.value.toString());
+      // No song has this value.
+      if (condition.value == -1) return true;
+    }
+    else {
+      condition.value = where.value.toInt();
+    }
+    conditions << condition;
+  }
+
+  const QList<FilterTerm> terms = ParseFilter(options.filter());
+  QVector<QVector<qint8>> memos(terms.count(), QVector<qint8>(strings_.count(), -1));
+
+  const qint64 cutoff = options.max_age() == -1 ? -1 : QDateTime::currentDateTime().toSecsSinceEpoch() - options.max_age();
+  const bool untagged = options.query_mode() == QueryOptions::QueryMode_Untagged;
+
+  QSet<QVector<int>> distinct;
+  QVector<int> key(columns.count());
+  int count = 0;
+  for (int row = 0; row < songs_.count(); ++row) {
+    bool match = true;
+    for (const Condition &condition : conditions) {
+      if (columns_[condition.column][row] != condition.value) {
+        match = false;
+        break;
+      }
+    }
+    if (!match) continue;
+
+    if (cutoff != -1 && songs_[row].ctime() <= cutoff) continue;
+
+    // Title, album and artist, the empty string is ID 0.
+    if (untagged && fts_columns_[0][row] != 0 && fts_columns_[1][row] != 0 && fts_columns_[2][row] != 0) continue;
+
+    for (int i = 0; i < terms.count() && match; ++i) {
+      match = RowMatches(row, terms[i], &memos[i]);
+    }
+    if (!match) continue;
+
+    if (columns.isEmpty()) {
+      *songs << songs_[row];
+    }
+    else {
+      for (int i = 0; i < columns.count(); ++i) {
+        key[i] = columns_[columns[i]][row];
+      }
+      if (distinct.contains(key)) continue;
+      distinct.insert(key);
+
+      Song song;
+      for (int i = 0; i < columns.count(); ++i) {
+        SetColumn(&song, columns[i], key[i]);
+      }
+      *songs << song;
+    }
+
+    if (++count == query.limit()) break;
+  }
+
+  return true;
+
+}
+
+void CollectionIndex::Narrow(const QString &filter) {
+
+  QWriteLocker l(&lock_);
+
+  const QList<FilterTerm> terms = ParseFilter(filter);
+  if (terms.isEmpty()) return;
+
+  QVector<QVector<qint8>> memos(terms.count(), QVector<qint8>(strings_.count(), -1));
+
+  // Walk backwards, RemoveRow moves the last row, which is already checked, into the removed one.
+  for (int row = songs_.count() - 1; row >= 0; --row) {
+    for (int i = 0; i < terms.count(); ++i) {
+      if (!RowMatches(row, terms[i], &memos[i])) {
+        RemoveRow(row);
+        break;
+      }
+    }
+  }
+
+}
+
+bool CollectionIndex::Matches(const Song &song, const QString &filter) {
+
+  const QList<FilterTerm> terms = ParseFilter(filter);
+  if (terms.isEmpty()) return true;
+
+  QList<QStringList> words;
+  for (const QString &value : FtsValues(song)) {
+    words << Tokenize(value);
+  }
+
+  for (const FilterTerm &term : terms) {
+    bool match = false;
+    for (int i = 0; i < kFtsColumnCount && !match; ++i) {
+      if (term.fts_column != -1 && term.fts_column != i) continue;
+      match = WordsMatch(words[i], term);
+    }
+    if (!match) return false;
+  }
+
+  return true;
+
+}
+
+bool CollectionIndex::IsFilterRefinement(const QString &old_filter, const QString &new_filter) {
+
+  const QList<FilterTerm> old_terms = ParseFilter(old_filter);
+  if (old_terms.isEmpty()) return false;
+
+  const QList<FilterTerm> new_terms = ParseFilter(new_filter);
+
+  // Every old term must be implied by one of the new terms:
+  // searching the same column, or any column if the old term didn't name one,
+  // and with the old words as a run of the new words, where the last old word may be a prefix of the new word.
+  for (const FilterTerm &old_term : old_terms) {
+    bool implied = false;
+    for (const FilterTerm &new_term : new_terms) {
+      if ((old_term.fts_column == -1 || old_term.fts_column == new_term.fts_column) && WordsMatch(new_term.words, old_term)) {
+        implied = true;
+        break;
+      }
+    }
+    if (!implied) return false;
+  }
+
+  return true;
+
+}
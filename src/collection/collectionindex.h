@@ -0,0 +1,145 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COLLECTIONINDEX_H
+#define COLLECTIONINDEX_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QReadWriteLock>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include "core/song.h"
+
+class CollectionQuery;
+
+// An in-memory copy of the available songs in a songs table, used to answer the collection model's queries without SQLite.
+// Each column is stored as a vector of integers, strings are interned so grouping and equality filters compare integers.
+// CollectionBackend keeps it in sync from the songs it emits, and it is safe to query from any thread.
+class CollectionIndex {
+ public:
+  CollectionIndex();
+
+  // Columns that can be filtered and grouped on, named after the songs table columns.
+  enum Column {
+    Column_EffectiveAlbumArtist,
+    Column_Artist,
+    Column_Album,
+    Column_AlbumId,
+    Column_Grouping,
+    Column_Genre,
+    Column_Composer,
+    Column_Performer,
+    Column_Year,
+    Column_OriginalYear,
+    Column_EffectiveOriginalYear,
+    Column_Disc,
+    Column_FileType,
+    Column_Samplerate,
+    Column_Bitdepth,
+    Column_Bitrate,
+    Column_CompilationEffective,
+    ColumnCount
+  };
+
+  bool is_loaded() const;
+  int song_count() const;
+
+  // Replaces the contents with songs and marks the index loaded, only a loaded index answers queries.
+  void Reset(const SongList &songs);
+  void Clear();
+
+  void AddOrUpdateSongs(const SongList &songs);
+  void RemoveSongs(const SongList &songs);
+
+  // Runs the query against the index.
+  // If columns is empty the matching songs are returned whole,
+  // otherwise one song per distinct combination of the columns is returned with only those fields set, like a SELECT DISTINCT.
+  // Returns false if the index isn't loaded or the query uses something it can't evaluate, run it in SQLite then.
+  bool Query(const CollectionQuery &query, const QList<Column> &columns, SongList *songs) const;
+
+  // Removes the songs that don't match filter, for an index that holds the results of a broader filter.
+  void Narrow(const QString &filter);
+
+  // Whether song matches the filter text, the way the FTS query made by CollectionQuery would match it.
+  static bool Matches(const Song &song, const QString &filter);
+  // Whether every song matching new_filter also matches old_filter, like when more letters are typed.
+  // Removing text or turning a token into a column qualifier ("artist" into "artist:") is not a refinement.
+  static bool IsFilterRefinement(const QString &old_filter, const QString &new_filter);
+
+ private:
+  // A filter token, the words must follow each other in the column and the last one is a prefix.
+  struct FilterTerm {
+    FilterTerm() : fts_column(-1) {}
+    int fts_column;
+    QStringList words;
+  };
+
+  struct Condition {
+    Condition() : column(ColumnCount), value(0) {}
+    Column column;
+    int value;
+  };
+
+  static const int kFtsColumnCount = 9;
+  static const QStringList kColumnNames;
+
+  static bool IsStringColumn(const Column column);
+  static Column ColumnFromName(const QString &name);
+  // Splits text into lowercase words without diacritics, like the unicode61 tokenizer of the FTS table.
+  static QStringList Tokenize(const QString &text);
+  static QList<FilterTerm> ParseFilter(const QString &filter);
+  // The values of the FTS columns of the song, in the order of Song::kFtsColumns.
+  static QStringList FtsValues(const Song &song);
+  static bool WordsMatch(const QStringList &words, const FilterTerm &term);
+  // memo caches the result for each interned string, most of them are shared by many songs.
+  bool RowMatches(const int row, const FilterTerm &term, QVector<qint8> *memo) const;
+
+  int Intern(const QString &text);
+  int FindString(const QString &text) const;
+  int ColumnValue(const Song &song, const Column column);
+  void SetColumn(Song *song, const Column column, const int value) const;
+
+  void AddSong(const Song &song);
+  void RemoveRow(const int row);
+
+  mutable QReadWriteLock lock_;
+  bool loaded_;
+
+  // Interned strings and their words, shared by all string columns.
+  QVector<QString> strings_;
+  QVector<QStringList> words_;
+  QHash<QString, int> string_ids_;
+
+  // One entry per song in each vector.
+  SongList songs_;
+  QVector<int> columns_[ColumnCount];
+  // Interned strings for the columns of the FTS table, in the order of Song::kFtsColumns.
+  QVector<int> fts_columns_[kFtsColumnCount];
+
+  // Keyed on database ID
+  QHash<int, int> rows_;
+};
+
+#endif  // COLLECTIONINDEX_H
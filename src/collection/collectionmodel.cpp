@@ -37,6 +37,8 @@
 #include <QList>
 #include <QSet>
 #include <QMap>
+#include <QHash>
+#include <QPair>
 #include <QMetaType>
 #include <QVariant>
 #include <QByteArray>
@@ -59,6 +61,7 @@
 #include "core/logging.h"
 #include "core/taskmanager.h"
 #include "collectionquery.h"
+#include "collectionindex.h"
 #include "collectionbackend.h"
 #include "collectiondirectorymodel.h"
 #include "collectionitem.h"
@@ -76,6 +79,8 @@ using std::placeholders::_2;
 const char *CollectionModel::kSavedGroupingsSettingsGroup = "SavedGroupings";
 const int CollectionModel::kPrettyCoverSize = 32;
 const char *CollectionModel::kPixmapDiskCacheDir = "pixmapcache";
+const int CollectionModel::kFilterIndexMaxSongs = 5000;
+const int CollectionModel::kDiffMaxRemovedRanges = 200;
 
 QNetworkDiskCache *CollectionModel::sIconCache = nullptr;
 
@@ -91,6 +96,9 @@ CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, Q
       artist_icon_(IconLoader::Load("folder-sound")),
       album_icon_(IconLoader::Load("cdcase")),
       init_task_id_(-1),
+      populate_async_(false),
+      next_request_id_(0),
+      reset_request_id_(-1),
       use_pretty_covers_(true),
       show_dividers_(true),
       use_disk_cache_(false),
@@ -101,6 +109,7 @@ CollectionModel::CollectionModel(CollectionBackend *backend, Application *app, Q
   group_by_[0] = GroupBy_AlbumArtist;
   group_by_[1] = GroupBy_AlbumDisc;
   group_by_[2] = GroupBy_None;
+  tree_group_by_ = group_by_;
 
   cover_loader_options_.desired_height_ = kPrettyCoverSize;
   cover_loader_options_.pad_output_image_ = true;
@@ -199,6 +208,8 @@ void CollectionModel::ReloadSettings() {
 
 void CollectionModel::Init(const bool async) {
 
+  populate_async_ = async;
+
   if (async) {
     // Show a loading indicator in the model.
     CollectionItem *loading = new CollectionItem(CollectionItem::Type_LoadingIndicator, root_);
@@ -221,6 +232,70 @@ void CollectionModel::Init(const bool async) {
 
 void CollectionModel::SongsDiscovered(const SongList &songs) {
 
+  UpdateFilterIndex(songs);
+
+  if (!populate_async_) {
+    AddSongs(songs);
+    return;
+  }
+
+  // A scan emits songs in many small batches, they're added once per event loop iteration so the view lays out once.
+  if (pending_songs_.isEmpty()) {
+    metaObject()->invokeMethod(this, "AddPendingSongs", Qt::QueuedConnection);
+  }
+  pending_songs_ << songs;
+
+}
+
+void CollectionModel::AddPendingSongs() {
+
+  // A reset since the songs were discovered took them.
+  if (pending_songs_.isEmpty()) return;
+
+  const SongList songs = pending_songs_;
+  pending_songs_.clear();
+  AddSongs(songs);
+
+}
+
+CollectionItem *CollectionModel::NewItemParent(CollectionItem *parent, const QSet<CollectionItem*> &new_items, QMap<CollectionItem*, CollectionItem*> *staging) {
+
+  // Items that aren't in the model yet get their children directly.
+  if (new_items.contains(parent)) return parent;
+
+  if (!staging->contains(parent)) {
+    CollectionItem *staging_item = new CollectionItem(this);
+    if (parent != root_) staging_item->key = parent->key;
+    staging->insert(parent, staging_item);
+  }
+
+  return staging->value(parent);
+
+}
+
+void CollectionModel::InsertChildren(CollectionItem *parent, const QList<CollectionItem*> &items) {
+
+  if (items.isEmpty()) return;
+
+  const int first = parent->children.count();
+  BeginInsert(parent, first, first + items.count() - 1);
+  for (CollectionItem *item : items) {
+    item->parent = parent;
+    item->row = parent->children.count();
+    parent->children << item;
+  }
+  EndInsert();
+
+}
+
+void CollectionModel::AddSongs(const SongList &songs) {
+
+  // The new items are made outside the model first, under a staging item for each parent that is in the model.
+  // Each of those parents then gets all its new children in one sorted range.
+  QMap<CollectionItem*, CollectionItem*> staging;
+  QSet<CollectionItem*> new_items;
+
+  QSet<CollectionItem*> repopulate;
   for (const Song &song : songs) {
 
     // Sanity check to make sure we don't add songs that are outside the user's filter
@@ -245,7 +320,8 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
       // Special case: if the song is a compilation and the current GroupBy level is Artists, then we want the Various Artists node :(
       if (IsArtistGroupBy(type) && song.is_compilation()) {
         if (container->compilation_artist_node_ == nullptr) {
-          CreateCompilationArtistNode(true, container);
+          CreateCompilationArtistNode(!new_items.contains(container), container);
+          if (new_items.contains(container)) new_items << container->compilation_artist_node_;
         }
         container = container->compilation_artist_node_;
         key = container->key;
@@ -332,7 +408,9 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
         // Does it exist already?
         if (!container_nodes_[i].contains(key)) {
           // Create the container
-          container_nodes_[i][key] = ItemFromSong(type, true, i == 0, container, song, i);
+          CollectionItem *item = ItemFromSong(type, false, i == 0, NewItemParent(container, new_items, &staging), song, i);
+          new_items << item;
+          container_nodes_[i][key] = item;
         }
         container = container_nodes_[i][key];
 
@@ -340,17 +418,43 @@ void CollectionModel::SongsDiscovered(const SongList &songs) {
 
       // If we just created the damn thing then we don't need to continue into it any further because it'll get lazy-loaded properly later.
       if (!container->lazy_loaded && use_lazy_loading_) break;
+
+      // The children of a node that is being populated come from its query, so run that again instead.
+      if (IsPopulating(container)) {
+        repopulate << container;
+        break;
+      }
+      if (IsRefreshing(container)) {
+        stale_refreshes_ << container;
+        break;
+      }
     }
-    if (!container->lazy_loaded && use_lazy_loading_) continue;
+    if ((!container->lazy_loaded && use_lazy_loading_) || IsPopulating(container) || IsRefreshing(container)) continue;
 
     // We've gone all the way down to the deepest level and everything was already lazy loaded, so now we have to create the song in the container.
-    song_nodes_[song.id()] = ItemFromSong(GroupBy_None, true, false, container, song, -1);
+    CollectionItem *item = ItemFromSong(GroupBy_None, false, false, NewItemParent(container, new_items, &staging), song, -1);
+    new_items << item;
+    song_nodes_[song.id()] = item;
+  }
+
+  for (QMap<CollectionItem*, CollectionItem*>::const_iterator it = staging.constBegin(); it != staging.constEnd(); ++it) {
+    QList<CollectionItem*> items = it.value()->children;
+    it.value()->children.clear();
+    delete it.value();
+    std::stable_sort(items.begin(), items.end(), std::bind(&CollectionModel::CompareItems, this, _1, _2));
+    InsertChildren(it.key(), items);
+  }
+
+  for (CollectionItem *item : repopulate) {
+    StartPopulateQuery(item);
   }
 
 }
 
 void CollectionModel::SongsSlightlyChanged(const SongList &songs) {
 
+  UpdateFilterIndex(songs);
+
   // This is called if there was a minor change to the songs that will not normally require the collection to be restructured.
   // We can just update our internal cache of Song objects without worrying about resetting the model.
   for (const Song &song : songs) {
@@ -493,18 +597,40 @@ QString CollectionModel::DividerDisplayText(const GroupBy type, const QString &k
 
 void CollectionModel::SongsDeleted(const SongList &songs) {
 
+  if (filter_index_) filter_index_->RemoveSongs(songs);
+
+  // Songs that are still waiting to be added are just dropped.
+  QSet<int> pending_ids;
+  if (!pending_songs_.isEmpty()) {
+    QSet<int> deleted_ids;
+    for (const Song &song : songs) deleted_ids << song.id();
+    SongList pending_songs;
+    for (const Song &song : pending_songs_) {
+      if (deleted_ids.contains(song.id())) {
+        pending_ids << song.id();
+      }
+      else {
+        pending_songs << song;
+      }
+    }
+    pending_songs_ = pending_songs;
+  }
+
   // Delete the actual song nodes first, keeping track of each parent so we might check to see if they're empty later.
   QSet<CollectionItem*> parents;
   for (const Song &song : songs) {
 
+    if (pending_ids.contains(song.id())) continue;
+
     if (song_nodes_.contains(song.id())) {
       CollectionItem *node = song_nodes_[song.id()];
 
       if (node->parent != root_) parents << node->parent;
 
+      MarkRefreshesStale(node);
       beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
+      ForgetItem(node);
       node->parent->Delete(node->row);
-      song_nodes_.remove(song.id());
       endRemoveRows();
 
     }
@@ -534,14 +660,6 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
       if (node->container_level == 0)
         divider_keys << DividerKey(group_by_[0], node);
 
-      // Special case the Various Artists node
-      if (IsCompilationArtistNode(node)) {
-        node->parent->compilation_artist_node_ = nullptr;
-      }
-      else if (container_nodes_[node->container_level].contains(node->key)) {
-        container_nodes_[node->container_level].remove(node->key);
-      }
-
       // Remove from pixmap cache
       const QString cache_key = AlbumIconPixmapCacheKey(ItemToIndex(node));
       QPixmapCache::remove(cache_key);
@@ -550,19 +668,10 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
         pending_cache_keys_.remove(cache_key);
       }
 
-      // Remove from pending art loading
-      QMap<quint64, ItemAndCacheKey>::iterator i = pending_art_.begin();
-      while (i != pending_art_.end()) {
-        if (i.value().first == node) {
-          i = pending_art_.erase(i);
-        }
-        else {
-          ++i;
-        }
-      }
-
-      // It was empty - delete it
+      // It was empty - delete it, this also takes it out of the container nodes, the pending art and the running queries.
+      MarkRefreshesStale(node);
       beginRemoveRows(ItemToIndex(node->parent), node->row, node->row);
+      ForgetItem(node);
       node->parent->Delete(node->row);
       endRemoveRows();
     }
@@ -584,11 +693,13 @@ void CollectionModel::SongsDeleted(const SongList &songs) {
     if (found) continue;
 
     // Remove the divider
-    int row = divider_nodes_[divider_key]->row;
+    CollectionItem *divider = divider_nodes_[divider_key];
+    const int row = divider->row;
+    MarkRefreshesStale(divider);
     beginRemoveRows(ItemToIndex(root_), row, row);
+    ForgetItem(divider);
     root_->Delete(row);
     endRemoveRows();
-    divider_nodes_.remove(divider_key);
   }
 
 }
@@ -797,26 +908,32 @@ QVariant CollectionModel::data(const CollectionItem *item, const int role) const
 
 }
 
-bool CollectionModel::HasCompilations(const CollectionQuery &query) {
+bool CollectionModel::HasCompilations(const CollectionQuery &query, std::shared_ptr<CollectionIndex> filter_index) {
 
   CollectionQuery q = query;
   q.AddCompilationRequirement(true);
   q.SetLimit(1);
 
-  QMutexLocker l(backend_->db()->Mutex());
+  SongList songs;
+  if ((filter_index && filter_index->Query(q, QList<CollectionIndex::Column>(), &songs)) || backend_->index()->Query(q, QList<CollectionIndex::Column>(), &songs)) {
+    return !songs.isEmpty();
+  }
+
+  QMutexLocker l(backend_->db()->ReaderMutex());
   if (!backend_->ExecQuery(&q)) return false;
 
   return q.Next();
 
 }
 
-CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
+CollectionModel::GroupBy CollectionModel::ChildType(CollectionItem *parent) const {
 
-  QueryResult result;
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  return child_level >= 3 ? GroupBy_None : group_by_[child_level];
 
-  // Information about what we want the children to be
-  int child_level = parent == root_ ? 0 : parent->container_level + 1;
-  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+}
+
+CollectionQuery CollectionModel::ChildQuery(CollectionItem *parent, const GroupBy child_type) {
 
   // Initialize the query.  child_type says what type of thing we want (artists, songs, etc.)
   CollectionQuery q(query_options_);
@@ -829,10 +946,18 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
     p = p->parent;
   }
 
+  return q;
+
+}
+
+CollectionModel::QueryResult CollectionModel::ExecChildQuery(const GroupBy child_type, CollectionQuery q, std::shared_ptr<CollectionIndex> filter_index) {
+
+  QueryResult result;
+
   // Artists GroupBy is special - we don't want compilation albums appearing
   if (IsArtistGroupBy(child_type)) {
     // Add the special Various artists node
-    if (show_various_artists_ && HasCompilations(q)) {
+    if (show_various_artists_ && HasCompilations(q, filter_index)) {
       result.create_va = true;
     }
 
@@ -840,11 +965,15 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
     q.AddCompilationRequirement(false);
   }
 
-  // Execute the query
-  QMutexLocker l(backend_->db()->Mutex());
-  if (backend_->ExecQuery(&q)) {
-    while (q.Next()) {
-      result.rows << SqlRow(q);
+  // Answer it from the songs matching the filter or the in-memory index if one is loaded, otherwise execute the query
+  const QList<CollectionIndex::Column> columns = IndexColumns(child_type);
+  if (!(filter_index && filter_index->Query(q, columns, &result.rows)) && !backend_->index()->Query(q, columns, &result.rows)) {
+    QMutexLocker l(backend_->db()->ReaderMutex());
+    if (backend_->ExecQuery(&q)) {
+      SqlQueryCursor cursor(q);
+      while (q.Next()) {
+        result.rows << SongFromQuery(child_type, cursor);
+      }
     }
   }
 
@@ -856,18 +985,87 @@ CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
 
 }
 
+CollectionModel::QueryResult CollectionModel::ExecResetQuery(const GroupBy child_type, CollectionQuery q, std::shared_ptr<CollectionIndex> filter_index) {
+
+  // Filtering only works in the All mode, see CollectionQuery.
+  const QueryOptions &options = q.options();
+  if (!filter_index && !options.filter().isEmpty() && options.query_mode() == QueryOptions::QueryMode_All) {
+    filter_index = LoadFilterIndex(options);
+  }
+
+  QueryResult result = ExecChildQuery(child_type, q, filter_index);
+  result.filter_index = filter_index;
+
+  return result;
+
+}
+
+std::shared_ptr<CollectionIndex> CollectionModel::LoadFilterIndex(const QueryOptions &options) {
+
+  CollectionQuery q(options);
+  InitQuery(GroupBy_None, &q);
+  q.SetLimit(kFilterIndexMaxSongs + 1);
+
+  SongList songs;
+  if (!backend_->index()->Query(q, QList<CollectionIndex::Column>(), &songs)) {
+    QMutexLocker l(backend_->db()->ReaderMutex());
+    if (!backend_->ExecQuery(&q)) return nullptr;
+    SqlQueryCursor cursor(q);
+    while (q.Next()) {
+      songs << SongFromQuery(GroupBy_None, cursor);
+    }
+  }
+
+  // Too many songs to keep around, the filter is run in the database until it gets narrower.
+  if (songs.count() > kFilterIndexMaxSongs) return nullptr;
+
+  std::shared_ptr<CollectionIndex> filter_index = std::make_shared<CollectionIndex>();
+  filter_index->Reset(songs);
+
+  return filter_index;
+
+}
+
+void CollectionModel::UpdateFilterIndex(const SongList &songs) {
+
+  if (!filter_index_) return;
+
+  // Edited songs can stop matching the filter too.
+  SongList matching;
+  SongList not_matching;
+  for (const Song &song : songs) {
+    if (CollectionIndex::Matches(song, query_options_.filter())) {
+      matching << song;
+    }
+    else {
+      not_matching << song;
+    }
+  }
+
+  filter_index_->RemoveSongs(not_matching);
+  filter_index_->AddOrUpdateSongs(matching);
+
+}
+
+CollectionModel::QueryResult CollectionModel::RunQuery(CollectionItem *parent) {
+
+  const GroupBy child_type = ChildType(parent);
+  return ExecChildQuery(child_type, ChildQuery(parent, child_type), filter_index_);
+
+}
+
 void CollectionModel::PostQuery(CollectionItem *parent, const CollectionModel::QueryResult &result, const bool signal) {
 
   // Information about what we want the children to be
-  int child_level = parent == root_ ? 0 : parent->container_level + 1;
-  GroupBy child_type = child_level >= 3 ? GroupBy_None : group_by_[child_level];
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  const GroupBy child_type = ChildType(parent);
 
   if (result.create_va && parent->compilation_artist_node_ == nullptr) {
     CreateCompilationArtistNode(signal, parent);
   }
 
   // Step through the results
-  for (const SqlRow &row : result.rows) {
+  for (const Song &row : result.rows) {
     // Create the item - it will get inserted into the model here
     CollectionItem *item = ItemFromQuery(child_type, signal, child_level == 0, parent, row, child_level);
 
@@ -882,8 +1080,22 @@ void CollectionModel::PostQuery(CollectionItem *parent, const CollectionModel::Q
 
 }
 
+void CollectionModel::LazyPopulate(CollectionItem *item) {
+
+  if (populate_async_) {
+    LazyPopulateAsync(item);
+  }
+  else {
+    LazyPopulate(item, true);
+  }
+
+}
+
 void CollectionModel::LazyPopulate(CollectionItem *parent, const bool signal) {
 
+  // A background query might still be running for it, we need the children now.
+  if (IsPopulating(parent)) CancelPopulate(parent);
+
   if (parent->lazy_loaded) return;
   parent->lazy_loaded = true;
 
@@ -892,23 +1104,120 @@ void CollectionModel::LazyPopulate(CollectionItem *parent, const bool signal) {
 
 }
 
-void CollectionModel::ResetAsync() {
+void CollectionModel::LazyPopulateAsync(CollectionItem *parent) {
+
+  if (parent->lazy_loaded) return;
+  parent->lazy_loaded = true;
+
+  // Show a loading indicator under the node until the query finishes.
+  CollectionItem *loading = new CollectionItem(CollectionItem::Type_LoadingIndicator);
+  loading->display_text = tr("Loading...");
+  loading->lazy_loaded = true;
+  loading->InsertNotify(parent);
+
+  StartPopulateQuery(parent);
+
+}
+
+void CollectionModel::StartPopulateQuery(CollectionItem *parent) {
+
+  const int request_id = next_request_id_++;
+  populate_requests_[parent] = request_id;
+
+  const GroupBy child_type = ChildType(parent);
+  const CollectionQuery q = ChildQuery(parent, child_type);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(&CollectionModel::RunQuery, this, root_);
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(&CollectionModel::ExecChildQuery, this, child_type, q, filter_index_);
 #else
-  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::RunQuery, root_);
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::ExecChildQuery, child_type, q, filter_index_);
 #endif
-  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult>)), future);
+  NewClosure(future, this, SLOT(LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult>, int)), future, request_id);
+
 }
 
-void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future) {
+void CollectionModel::LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id) {
 
-  if (QThread::currentThread() != thread() && QThread::currentThread() != backend_->thread()) {
-    backend_->Close();
+  const struct QueryResult result = future.result();
+
+  // The node was collapsed, the model was reset or the query was restarted since this was started.
+  CollectionItem *parent = populate_requests_.key(request_id, nullptr);
+  if (!parent) return;
+
+  CancelPopulate(parent);
+  parent->lazy_loaded = true;
+
+  PostQuery(parent, result, true);
+
+}
+
+void CollectionModel::CancelPopulate(const QModelIndex &idx) {
+
+  CollectionItem *item = IndexToItem(idx);
+  if (item && IsPopulating(item)) CancelPopulate(item);
+
+}
+
+void CollectionModel::CancelPopulate(CollectionItem *parent) {
+
+  populate_requests_.remove(parent);
+
+  // Nothing else is added to a node while it is being populated, so the loading indicator is all there is to remove.
+  for (int i = parent->children.count() - 1; i >= 0; --i) {
+    if (parent->children[i]->type == CollectionItem::Type_LoadingIndicator) {
+      parent->DeleteNotify(i);
+    }
   }
+  parent->lazy_loaded = false;
+
+}
+
+void CollectionModel::Populate(const QModelIndex &idx) {
+
+  CollectionItem *item = IndexToItem(idx);
+  if (item) LazyPopulate(item, true);
+
+}
+
+void CollectionModel::ResetAsync() {
+
+  const int request_id = next_request_id_++;
+  reset_request_id_ = request_id;
+
+  const GroupBy child_type = ChildType(root_);
+  const CollectionQuery q = ChildQuery(root_, child_type);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(&CollectionModel::ExecResetQuery, this, child_type, q, filter_index_);
+#else
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::ExecResetQuery, child_type, q, filter_index_);
+#endif
+  NewClosure(future, this, SLOT(ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult>, int)), future, request_id);
+
+}
+
+void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id) {
 
   const struct QueryResult result = future.result();
 
+  // The filter or grouping changed again while this was running, only the latest result is used.
+  if (request_id != reset_request_id_) return;
+  reset_request_id_ = -1;
+
+  filter_index_ = result.filter_index;
+
+  // Update the tree in place if the top level is grouped the same, so the view keeps its state.
+  if (init_task_id_ == -1 && root_->lazy_loaded && tree_group_by_.first == group_by_.first) {
+    // Pending refreshes were started for the previous filter, the kept nodes are refreshed again.
+    refresh_requests_.clear();
+    stale_refreshes_.clear();
+    if (DiffChildren(root_, result, tree_group_by_)) {
+      tree_group_by_ = group_by_;
+      return;
+    }
+  }
+
+  // Songs discovered while the query was running might not be in the result.
+  const SongList pending_songs = pending_songs_;
+
   BeginReset();
   root_->lazy_loaded = true;
 
@@ -923,6 +1232,256 @@ void CollectionModel::ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResu
 
   endResetModel();
 
+  if (!pending_songs.isEmpty()) AddSongs(pending_songs);
+
+}
+
+QString CollectionModel::DiffKey(const CollectionItem *item) {
+
+  // Songs in the same container can have the same title.
+  if (item->type == CollectionItem::Type_Song) return QString::number(item->metadata.id());
+  return item->key;
+
+}
+
+bool CollectionModel::DiffChildren(CollectionItem *parent, const CollectionModel::QueryResult &result, const Grouping &old_grouping) {
+
+  const int child_level = parent == root_ ? 0 : parent->container_level + 1;
+  const GroupBy child_type = ChildType(parent);
+  // Items made for another grouping are replaced, even where the keys are the same.
+  const bool same_grouping = child_level >= 3 || old_grouping[child_level] == group_by_[child_level];
+
+  // Make the items outside the model first, only the ones that aren't in the tree already are inserted.
+  CollectionItem staging(this);
+  if (parent != root_) staging.key = parent->key;
+  for (const Song &row : result.rows) {
+    ItemFromQuery(child_type, false, child_level == 0, &staging, row, child_level);
+  }
+
+  // Keys aren't always unique, albums with the same name and a different album ID for example.
+  QHash<QString, QList<CollectionItem*>> new_items;
+  for (CollectionItem *item : staging.children) {
+    if (item->type != CollectionItem::Type_Divider) new_items[DiffKey(item)] << item;
+  }
+
+  // Pair the children to keep with their new items, and collect the rows to remove as ranges.
+  // Go backwards so removing a range doesn't move the next one.
+  QHash<CollectionItem*, CollectionItem*> kept;
+  QList<QPair<int, int>> removed_ranges;
+  for (int i = parent->children.count() - 1; i >= 0; --i) {
+    CollectionItem *child = parent->children[i];
+    bool keep = false;
+    if (child->type == CollectionItem::Type_Divider) {
+      // Unused dividers are removed at the end.
+      keep = true;
+    }
+    else if (child == parent->compilation_artist_node_) {
+      keep = same_grouping && result.create_va;
+    }
+    else if (same_grouping) {
+      QList<CollectionItem*> &items = new_items[DiffKey(child)];
+      if (!items.isEmpty()) {
+        kept[child] = items.takeFirst();
+        keep = true;
+      }
+    }
+    if (keep) continue;
+
+    if (!removed_ranges.isEmpty() && removed_ranges.last().first == i + 1) {
+      removed_ranges.last().first = i;
+    }
+    else {
+      removed_ranges << qMakePair(i, i);
+    }
+  }
+
+  if (removed_ranges.count() > kDiffMaxRemovedRanges) {
+    // The dividers made for the new items were registered already.
+    for (CollectionItem *item : staging.children) {
+      if (item->type == CollectionItem::Type_Divider) divider_nodes_.remove(item->key);
+    }
+    return false;
+  }
+
+  for (const QPair<int, int> &range : removed_ranges) {
+    for (int i = range.first; i <= range.second; ++i) {
+      ForgetItem(parent->children[i]);
+    }
+    BeginDelete(parent, range.first, range.second);
+    for (int i = range.second; i >= range.first; --i) {
+      delete parent->children.takeAt(i);
+    }
+    for (int i = range.first; i < parent->children.count(); ++i) {
+      parent->children[i]->row = i;
+    }
+    EndDelete();
+  }
+
+  // Update the items that are kept from their new rows.
+  for (CollectionItem *child : parent->children) {
+    if (child->type == CollectionItem::Type_Divider) continue;
+    if (kept.contains(child)) {
+      CollectionItem *item = kept[child];
+      child->metadata = item->metadata;
+      if (child->display_text != item->display_text || child->sort_text != item->sort_text) {
+        child->display_text = item->display_text;
+        child->sort_text = item->sort_text;
+        child->ChangedNotify();
+      }
+    }
+
+    if (child->type != CollectionItem::Type_Container) continue;
+    if (IsPopulating(child)) {
+      // Its query was started with the old filter.
+      StartPopulateQuery(child);
+    }
+    else if (child->lazy_loaded) {
+      StartRefreshQuery(child, old_grouping);
+    }
+  }
+
+  if (result.create_va && parent->compilation_artist_node_ == nullptr) {
+    CreateCompilationArtistNode(true, parent);
+  }
+
+  // Insert the new items in one range, the view sorts them.
+  QSet<CollectionItem*> matched;
+  for (CollectionItem *item : kept) {
+    matched << item;
+  }
+  QList<CollectionItem*> inserted;
+  for (CollectionItem *item : staging.children) {
+    if (matched.contains(item)) {
+      delete item;
+    }
+    else {
+      inserted << item;
+    }
+  }
+  staging.children.clear();
+
+  InsertChildren(parent, inserted);
+  for (CollectionItem *item : inserted) {
+    if (item->type == CollectionItem::Type_Song) {
+      song_nodes_[item->metadata.id()] = item;
+    }
+    else if (item->type == CollectionItem::Type_Container) {
+      container_nodes_[child_level][item->key] = item;
+    }
+  }
+
+  if (parent == root_) RemoveUnusedDividers();
+
+  return true;
+
+}
+
+void CollectionModel::StartRefreshQuery(CollectionItem *parent, const Grouping &old_grouping) {
+
+  const int request_id = next_request_id_++;
+  refresh_requests_[parent] = request_id;
+
+  const GroupBy child_type = ChildType(parent);
+  const CollectionQuery q = ChildQuery(parent, child_type);
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(&CollectionModel::ExecChildQuery, this, child_type, q, filter_index_);
+#else
+  QFuture<CollectionModel::QueryResult> future = QtConcurrent::run(this, &CollectionModel::ExecChildQuery, child_type, q, filter_index_);
+#endif
+  NewClosure(future, this, SLOT(RefreshQueryFinished(QFuture<CollectionModel::QueryResult>, int, CollectionModel::Grouping)), future, request_id, old_grouping);
+
+}
+
+void CollectionModel::RefreshQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id, const CollectionModel::Grouping &old_grouping) {
+
+  const struct QueryResult result = future.result();
+
+  // The node was removed, the model was reset or the refresh was restarted since this was started.
+  CollectionItem *parent = refresh_requests_.key(request_id, nullptr);
+  if (!parent) return;
+  refresh_requests_.remove(parent);
+
+  if (stale_refreshes_.remove(parent)) {
+    StartRefreshQuery(parent, old_grouping);
+    return;
+  }
+
+  if (!DiffChildren(parent, result, old_grouping)) {
+    for (CollectionItem *child : parent->children) {
+      ForgetItem(child);
+    }
+    parent->ClearNotify();
+    PostQuery(parent, result, true);
+  }
+
+}
+
+void CollectionModel::MarkRefreshesStale(CollectionItem *item) {
+
+  for (CollectionItem *parent = item->parent; parent; parent = parent->parent) {
+    if (IsRefreshing(parent)) stale_refreshes_ << parent;
+  }
+
+}
+
+void CollectionModel::ForgetItem(CollectionItem *item) {
+
+  for (CollectionItem *child : item->children) {
+    ForgetItem(child);
+  }
+
+  switch (item->type) {
+    case CollectionItem::Type_Song:
+      if (song_nodes_.value(item->metadata.id()) == item) song_nodes_.remove(item->metadata.id());
+      break;
+    case CollectionItem::Type_Container:
+      if (IsCompilationArtistNode(item)) {
+        item->parent->compilation_artist_node_ = nullptr;
+      }
+      else if (container_nodes_[item->container_level].value(item->key) == item) {
+        container_nodes_[item->container_level].remove(item->key);
+      }
+      break;
+    case CollectionItem::Type_Divider:
+      if (divider_nodes_.value(item->key) == item) divider_nodes_.remove(item->key);
+      break;
+    default:
+      break;
+  }
+
+  populate_requests_.remove(item);
+  refresh_requests_.remove(item);
+  stale_refreshes_.remove(item);
+
+  QMap<quint64, ItemAndCacheKey>::iterator i = pending_art_.begin();
+  while (i != pending_art_.end()) {
+    if (i.value().first == item) {
+      i = pending_art_.erase(i);
+    }
+    else {
+      ++i;
+    }
+  }
+
+}
+
+void CollectionModel::RemoveUnusedDividers() {
+
+  QSet<QString> divider_keys;
+  for (CollectionItem *child : root_->children) {
+    if (child->type != CollectionItem::Type_Divider && !IsCompilationArtistNode(child)) {
+      divider_keys << DividerKey(group_by_[0], child);
+    }
+  }
+
+  for (int i = root_->children.count() - 1; i >= 0; --i) {
+    CollectionItem *child = root_->children[i];
+    if (child->type == CollectionItem::Type_Divider && !divider_keys.contains(child->key)) {
+      divider_nodes_.remove(child->key);
+      root_->DeleteNotify(i);
+    }
+  }
+
 }
 
 void CollectionModel::BeginReset() {
@@ -936,6 +1495,11 @@ void CollectionModel::BeginReset() {
   divider_nodes_.clear();
   pending_art_.clear();
   pending_cache_keys_.clear();
+  populate_requests_.clear();
+  refresh_requests_.clear();
+  stale_refreshes_.clear();
+  pending_songs_.clear();
+  tree_group_by_ = group_by_;
 
   root_ = new CollectionItem(this);
   root_->compilation_artist_node_ = nullptr;
@@ -945,6 +1509,9 @@ void CollectionModel::BeginReset() {
 
 void CollectionModel::Reset() {
 
+  // The database was reset, the songs matching the filter are queried again on the next filter change.
+  filter_index_.reset();
+
   BeginReset();
 
   // Populate top level
@@ -1026,6 +1593,81 @@ void CollectionModel::InitQuery(const GroupBy type, CollectionQuery *q) {
 
 }
 
+QList<CollectionIndex::Column> CollectionModel::IndexColumns(const GroupBy type) {
+
+  // The same columns as InitQuery, in the order SongFromQuery reads them.
+  QList<CollectionIndex::Column> columns;
+  switch (type) {
+    case GroupBy_AlbumArtist:
+      columns << CollectionIndex::Column_EffectiveAlbumArtist;
+      break;
+    case GroupBy_Artist:
+      columns << CollectionIndex::Column_Artist;
+      break;
+    case GroupBy_Album:
+      columns << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId;
+      break;
+    case GroupBy_AlbumDisc:
+      columns << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId << CollectionIndex::Column_Disc;
+      break;
+    case GroupBy_YearAlbum:
+      columns << CollectionIndex::Column_Year << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId << CollectionIndex::Column_Grouping;
+      break;
+    case GroupBy_YearAlbumDisc:
+      columns << CollectionIndex::Column_Year << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId << CollectionIndex::Column_Disc;
+      break;
+    case GroupBy_OriginalYearAlbum:
+      columns << CollectionIndex::Column_Year << CollectionIndex::Column_OriginalYear << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId << CollectionIndex::Column_Grouping;
+      break;
+    case GroupBy_OriginalYearAlbumDisc:
+      columns << CollectionIndex::Column_Year << CollectionIndex::Column_OriginalYear << CollectionIndex::Column_Album << CollectionIndex::Column_AlbumId << CollectionIndex::Column_Disc;
+      break;
+    case GroupBy_Disc:
+      columns << CollectionIndex::Column_Disc;
+      break;
+    case GroupBy_Year:
+      columns << CollectionIndex::Column_Year;
+      break;
+    case GroupBy_OriginalYear:
+      columns << CollectionIndex::Column_EffectiveOriginalYear;
+      break;
+    case GroupBy_Genre:
+      columns << CollectionIndex::Column_Genre;
+      break;
+    case GroupBy_Composer:
+      columns << CollectionIndex::Column_Composer;
+      break;
+    case GroupBy_Performer:
+      columns << CollectionIndex::Column_Performer;
+      break;
+    case GroupBy_Grouping:
+      columns << CollectionIndex::Column_Grouping;
+      break;
+    case GroupBy_FileType:
+      columns << CollectionIndex::Column_FileType;
+      break;
+    case GroupBy_Format:
+      columns << CollectionIndex::Column_FileType << CollectionIndex::Column_Samplerate << CollectionIndex::Column_Bitdepth;
+      break;
+    case GroupBy_Samplerate:
+      columns << CollectionIndex::Column_Samplerate;
+      break;
+    case GroupBy_Bitdepth:
+      columns << CollectionIndex::Column_Bitdepth;
+      break;
+    case GroupBy_Bitrate:
+      columns << CollectionIndex::Column_Bitrate;
+      break;
+    case GroupBy_None:
+    case GroupByCount:
+      // Whole songs
+      break;
+  }
+
+  return columns;
+
+}
+
 void CollectionModel::FilterQuery(const GroupBy type, CollectionItem *item, CollectionQuery *q) {
 
   // Say how we want the query to be filtered.  This is done once for each parent going up the tree.
@@ -1147,9 +1789,104 @@ CollectionItem *CollectionModel::InitItem(const GroupBy type, const bool signal,
 
 }
 
-CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool signal, const bool create_divider, CollectionItem *parent, const SqlRow &row, const int container_level) {
+Song CollectionModel::SongFromQuery(const GroupBy type, const SqlQueryCursor &row) {
+
+  Song song;
+
+  switch (type) {
+    case GroupBy_AlbumArtist:
+      song.set_albumartist(row.value(0).toString());
+      break;
+    case GroupBy_Artist:
+      song.set_artist(row.value(0).toString());
+      break;
+    case GroupBy_Album:
+      song.set_album(row.value(0).toString());
+      song.set_album_id(row.value(1).toString());
+      break;
+    case GroupBy_AlbumDisc:
+      song.set_album(row.value(0).toString());
+      song.set_album_id(row.value(1).toString());
+      song.set_disc(row.value(2).toInt());
+      break;
+    case GroupBy_YearAlbum:
+      song.set_year(row.value(0).toInt());
+      song.set_album(row.value(1).toString());
+      song.set_album_id(row.value(2).toString());
+      song.set_grouping(row.value(3).toString());
+      break;
+    case GroupBy_YearAlbumDisc:
+      song.set_year(row.value(0).toInt());
+      song.set_album(row.value(1).toString());
+      song.set_album_id(row.value(2).toString());
+      song.set_disc(row.value(3).toInt());
+      break;
+    case GroupBy_OriginalYearAlbum:
+      song.set_year(row.value(0).toInt());
+      song.set_originalyear(row.value(1).toInt());
+      song.set_album(row.value(2).toString());
+      song.set_album_id(row.value(3).toString());
+      song.set_grouping(row.value(4).toString());
+      break;
+    case GroupBy_OriginalYearAlbumDisc:
+      song.set_year(row.value(0).toInt());
+      song.set_originalyear(row.value(1).toInt());
+      song.set_album(row.value(2).toString());
+      song.set_album_id(row.value(3).toString());
+      song.set_disc(row.value(4).toInt());
+      break;
+    case GroupBy_Disc:
+      song.set_disc(row.value(0).toInt());
+      break;
+    case GroupBy_Year:
+      song.set_year(row.value(0).toInt());
+      break;
+    case GroupBy_OriginalYear:
+      song.set_originalyear(row.value(0).toInt());
+      break;
+    case GroupBy_Genre:
+      song.set_genre(row.value(0).toString());
+      break;
+    case GroupBy_Composer:
+      song.set_composer(row.value(0).toString());
+      break;
+    case GroupBy_Performer:
+      song.set_performer(row.value(0).toString());
+      break;
+    case GroupBy_Grouping:
+      song.set_grouping(row.value(0).toString());
+      break;
+    case GroupBy_FileType:
+      song.set_filetype(Song::FileType(row.value(0).toInt()));
+      break;
+    case GroupBy_Format:
+      song.set_filetype(Song::FileType(row.value(0).toInt()));
+      song.set_samplerate(row.value(1).toInt());
+      song.set_bitdepth(row.value(2).toInt());
+      break;
+    case GroupBy_Samplerate:
+      song.set_samplerate(row.value(0).toInt());
+      break;
+    case GroupBy_Bitdepth:
+      song.set_bitdepth(row.value(0).toInt());
+      break;
+    case GroupBy_Bitrate:
+      song.set_bitrate(row.value(0).toInt());
+      break;
+    case GroupBy_None:
+    case GroupByCount:
+      song.InitFromQuery(row, true);
+      break;
+  }
+
+  return song;
+
+}
+
+CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool signal, const bool create_divider, CollectionItem *parent, const Song &row, const int container_level) {
 
   CollectionItem *item = InitItem(type, signal, parent, container_level);
+  item->metadata = row;
 
   if (parent != root_ && !parent->key.isEmpty()) {
     item->key = parent->key + "-";
@@ -1157,31 +1894,24 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
 
   switch (type) {
     case GroupBy_AlbumArtist:{
-      item->metadata.set_albumartist(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.albumartist()));
       item->display_text = TextOrUnknown(item->metadata.albumartist());
       item->sort_text = SortTextForArtist(item->metadata.albumartist());
       break;
     }
     case GroupBy_Artist:{
-      item->metadata.set_artist(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.artist()));
       item->display_text = TextOrUnknown(item->metadata.artist());
       item->sort_text = SortTextForArtist(item->metadata.artist());
       break;
     }
     case GroupBy_Album:{
-      item->metadata.set_album(row.value(0).toString());
-      item->metadata.set_album_id(row.value(1).toString());
       item->key.append(TextOrUnknown(item->metadata.album()));
       item->display_text = TextOrUnknown(item->metadata.album());
       item->sort_text = SortTextForArtist(item->metadata.album());
       break;
     }
     case GroupBy_AlbumDisc:{
-      item->metadata.set_album(row.value(0).toString());
-      item->metadata.set_album_id(row.value(1).toString());
-      item->metadata.set_disc(row.value(2).toInt());
       item->key.append(PrettyAlbumDisc(item->metadata.album(), item->metadata.disc()));
       const int disc = qMax(0, item->metadata.disc());
       item->display_text = PrettyAlbumDisc(item->metadata.album(), item->metadata.disc());
@@ -1189,57 +1919,37 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_YearAlbum:{
-      item->metadata.set_year(row.value(0).toInt());
-      item->metadata.set_album(row.value(1).toString());
-      item->metadata.set_album_id(row.value(2).toString());
-      item->metadata.set_grouping(row.value(3).toString());
       item->key.append(PrettyYearAlbum(item->metadata.year(), item->metadata.album()));
       item->display_text = PrettyYearAlbum(item->metadata.year(), item->metadata.album());
       item->sort_text = SortTextForNumber(qMax(0, item->metadata.year())) + item->metadata.grouping() + item->metadata.album();
       break;
     }
     case GroupBy_YearAlbumDisc:{
-      item->metadata.set_year(row.value(0).toInt());
-      item->metadata.set_album(row.value(1).toString());
-      item->metadata.set_album_id(row.value(2).toString());
-      item->metadata.set_disc(row.value(3).toInt());
       item->key.append(PrettyYearAlbumDisc(item->metadata.year(), item->metadata.album(), item->metadata.disc()));
       item->display_text = PrettyYearAlbumDisc(item->metadata.year(), item->metadata.album(), item->metadata.disc());
       item->sort_text = SortTextForNumber(qMax(0, item->metadata.year())) + item->metadata.album() + SortTextForNumber(qMax(0, item->metadata.disc()));
       break;
     }
     case GroupBy_OriginalYearAlbum:{
-      item->metadata.set_year(row.value(0).toInt());
-      item->metadata.set_originalyear(row.value(1).toInt());
-      item->metadata.set_album(row.value(2).toString());
-      item->metadata.set_album_id(row.value(3).toString());
-      item->metadata.set_grouping(row.value(4).toString());
       item->key.append(PrettyYearAlbum(item->metadata.effective_originalyear(), item->metadata.album()));
       item->display_text = PrettyYearAlbum(item->metadata.effective_originalyear(), item->metadata.album());
       item->sort_text = SortTextForNumber(qMax(0, item->metadata.effective_originalyear())) + item->metadata.grouping() + item->metadata.album();
       break;
     }
     case GroupBy_OriginalYearAlbumDisc:{
-      item->metadata.set_year(row.value(0).toInt());
-      item->metadata.set_originalyear(row.value(1).toInt());
-      item->metadata.set_album(row.value(2).toString());
-      item->metadata.set_album_id(row.value(3).toString());
-      item->metadata.set_disc(row.value(4).toInt());
       item->key.append(PrettyYearAlbumDisc(item->metadata.effective_originalyear(), item->metadata.album(), item->metadata.disc()));
       item->display_text = PrettyYearAlbumDisc(item->metadata.effective_originalyear(), item->metadata.album(), item->metadata.disc());
       item->sort_text = SortTextForNumber(qMax(0, item->metadata.effective_originalyear())) + item->metadata.album() + SortTextForNumber(qMax(0, item->metadata.disc()));
       break;
     }
     case GroupBy_Disc:{
-      item->metadata.set_disc(row.value(0).toInt());
-      const int disc = qMax(0, row.value(0).toInt());
+      const int disc = qMax(0, item->metadata.disc());
       item->key.append(PrettyDisc(disc));
       item->display_text = PrettyDisc(disc);
       item->sort_text = SortTextForNumber(disc);
       break;
     }
     case GroupBy_Year:{
-      item->metadata.set_year(row.value(0).toInt());
       const int year = qMax(0, item->metadata.year());
       item->key.append(QString::number(year));
       item->display_text = QString::number(year);
@@ -1247,7 +1957,6 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_OriginalYear:{
-      item->metadata.set_originalyear(row.value(0).toInt());
       const int year = qMax(0, item->metadata.originalyear());
       item->key.append(QString::number(year));
       item->display_text = QString::number(year);
@@ -1255,44 +1964,36 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_Genre:{
-      item->metadata.set_genre(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.genre()));
       item->display_text = TextOrUnknown(item->metadata.genre());
       item->sort_text = SortTextForArtist(item->metadata.genre());
       break;
     }
     case GroupBy_Composer:{
-      item->metadata.set_composer(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.composer()));
       item->display_text = TextOrUnknown(item->metadata.composer());
       item->sort_text = SortTextForArtist(item->metadata.composer());
       break;
     }
     case GroupBy_Performer:{
-      item->metadata.set_performer(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.performer()));
       item->display_text = TextOrUnknown(item->metadata.performer());
       item->sort_text = SortTextForArtist(item->metadata.performer());
       break;
     }
     case GroupBy_Grouping:{
-      item->metadata.set_grouping(row.value(0).toString());
       item->key.append(TextOrUnknown(item->metadata.grouping()));
       item->display_text = TextOrUnknown(item->metadata.grouping());
       item->sort_text = SortTextForArtist(item->metadata.grouping());
       break;
     }
     case GroupBy_FileType:{
-      item->metadata.set_filetype(Song::FileType(row.value(0).toInt()));
       item->key.append(item->metadata.TextForFiletype());
       item->display_text = item->metadata.TextForFiletype();
       item->sort_text = item->metadata.TextForFiletype();
       break;
     }
     case GroupBy_Format:{
-      item->metadata.set_filetype(Song::FileType(row.value(0).toInt()));
-      item->metadata.set_samplerate(row.value(1).toInt());
-      item->metadata.set_bitdepth(row.value(2).toInt());
       QString key;
       if (item->metadata.samplerate() <= 0) {
         key = item->metadata.TextForFiletype();
@@ -1311,7 +2012,6 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_Samplerate:{
-      item->metadata.set_samplerate(row.value(0).toInt());
       const int samplerate = qMax(0, item->metadata.samplerate());
       item->key.append(QString::number(samplerate));
       item->display_text = QString::number(samplerate);
@@ -1319,7 +2019,6 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_Bitdepth:{
-      item->metadata.set_bitdepth(row.value(0).toInt());
       const int bitdepth = qMax(0, item->metadata.bitdepth());
       item->key.append(QString::number(bitdepth));
       item->display_text = QString::number(bitdepth);
@@ -1327,7 +2026,6 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
       break;
     }
     case GroupBy_Bitrate:{
-      item->metadata.set_bitrate(row.value(0).toInt());
       const int bitrate = qMax(0, item->metadata.bitrate());
       item->key.append(QString::number(bitrate));
       item->display_text = QString::number(bitrate);
@@ -1336,7 +2034,6 @@ CollectionItem *CollectionModel::ItemFromQuery(const GroupBy type, const bool si
     }
     case GroupBy_None:
     case GroupByCount:
-      item->metadata.InitFromQuery(row, true);
       item->key.append(TextOrUnknown(item->metadata.title()));
       item->display_text = item->metadata.TitleWithCompilationArtist();
       if (item->container_level == 1 && !IsAlbumGroupBy(group_by_[0])) {
@@ -1579,7 +2276,7 @@ void CollectionModel::FinishItem(const GroupBy type, const bool signal, const bo
       if (signal)
         beginInsertRows(ItemToIndex(parent), parent->children.count(), parent->children.count());
 
-      CollectionItem *divider = new CollectionItem(CollectionItem::Type_Divider, root_);
+      CollectionItem *divider = new CollectionItem(CollectionItem::Type_Divider, parent);
       divider->key = divider_key;
       divider->display_text = DividerDisplayText(type, divider_key);
       divider->sort_text = divider_key + "  ";
@@ -1765,7 +2462,7 @@ void CollectionModel::GetChildSongs(CollectionItem *item, QList<QUrl> *urls, Son
 
   switch (item->type) {
     case CollectionItem::Type_Container: {
-      const_cast<CollectionModel*>(this)->LazyPopulate(item);
+      const_cast<CollectionModel*>(this)->LazyPopulate(item, true);
 
       QList<CollectionItem*> children = item->children;
       std::sort(children.begin(), children.end(), std::bind(&CollectionModel::CompareItems, this, _1, _2));
@@ -1808,10 +2505,20 @@ SongList CollectionModel::GetChildSongs(const QModelIndex &idx) const {
 
 void CollectionModel::SetFilterAge(const int age) {
   query_options_.set_max_age(age);
+  filter_index_.reset();
   ResetAsync();
 }
 
 void CollectionModel::SetFilterText(const QString &text) {
+
+  // A refined filter matches a subset of the songs loaded for the current one, so they're narrowed instead of queried again.
+  if (filter_index_ && CollectionIndex::IsFilterRefinement(query_options_.filter(), text)) {
+    filter_index_->Narrow(text);
+  }
+  else {
+    filter_index_.reset();
+  }
+
   query_options_.set_filter(text);
   ResetAsync();
 
@@ -1819,6 +2526,7 @@ void CollectionModel::SetFilterText(const QString &text) {
 
 void CollectionModel::SetFilterQueryMode(QueryOptions::QueryMode query_mode) {
   query_options_.set_query_mode(query_mode);
+  filter_index_.reset();
   ResetAsync();
 
 }
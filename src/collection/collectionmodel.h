@@ -24,6 +24,8 @@
 
 #include "config.h"
 
+#include <memory>
+
 #include <QtGlobal>
 #include <QObject>
 #include <QAbstractItemModel>
@@ -47,6 +49,7 @@
 #include "core/song.h"
 #include "covermanager/albumcoverloader.h"
 #include "collectionquery.h"
+#include "collectionindex.h"
 #include "collectionitem.h"
 #include "sqlrow.h"
 #include "covermanager/albumcoverloaderoptions.h"
@@ -70,6 +73,10 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   static const int kPrettyCoverSize;
   static const char *kPixmapDiskCacheDir;
+  // The most songs a filter may match for them to be kept in memory and narrowed as the filter is refined.
+  static const int kFilterIndexMaxSongs;
+  // Above this many separate ranges of removed rows a node's children are replaced instead of updated in place.
+  static const int kDiffMaxRemovedRanges;
 
   enum Role {
     Role_Type = Qt::UserRole + 1,
@@ -127,8 +134,11 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   struct QueryResult {
     QueryResult() : create_va(false) {}
 
-    SqlRowList rows;
+    // Rows are decoded while the query runs, container rows only have the fields for their group set.
+    SongList rows;
     bool create_va;
+    // The songs matching the filter, loaded by the reset query for a new filter.
+    std::shared_ptr<CollectionIndex> filter_index;
   };
 
   CollectionBackend *backend() const { return backend_; }
@@ -195,6 +205,9 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   void ExpandAll(CollectionItem *item = nullptr) const;
 
+  // Populates the node right away, for callers that need its children before a background query could finish.
+  void Populate(const QModelIndex &idx);
+
  signals:
   void TotalSongCountUpdated(const int count);
   void TotalArtistCountUpdated(const int count);
@@ -212,8 +225,12 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   void Reset();
   void ResetAsync();
 
+  // Drops the background query of a node that was collapsed before it finished, it is queried again on the next expand.
+  void CancelPopulate(const QModelIndex &idx);
+
  protected:
-  void LazyPopulate(CollectionItem *item) override { LazyPopulate(item, true); }
+  // Populates the node in the background if the model was initialized with async.
+  void LazyPopulate(CollectionItem *item) override;
   void LazyPopulate(CollectionItem *parent, const bool signal);
 
  private slots:
@@ -221,13 +238,18 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   void SongsDiscovered(const SongList &songs);
   void SongsDeleted(const SongList &songs);
   void SongsSlightlyChanged(const SongList &songs);
+  void AddPendingSongs();
   void TotalSongCountUpdatedSlot(const int count);
   void TotalArtistCountUpdatedSlot(const int count);
   void TotalAlbumCountUpdatedSlot(const int count);
   void ClearDiskCache();
 
   // Called after ResetAsync
-  void ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future);
+  void ResetAsyncQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id);
+  // Called after LazyPopulateAsync
+  void LazyPopulateQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id);
+  // Called after StartRefreshQuery
+  void RefreshQueryFinished(QFuture<CollectionModel::QueryResult> future, const int request_id, const CollectionModel::Grouping &old_grouping);
 
   void AlbumCoverLoaded(const quint64 id, const AlbumCoverLoaderResult &result);
 
@@ -237,7 +259,45 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   QueryResult RunQuery(CollectionItem *parent);
   void PostQuery(CollectionItem *parent, const QueryResult &result, const bool signal);
 
-  bool HasCompilations(const CollectionQuery &query);
+  // RunQuery split in two for the background queries.
+  // ChildQuery walks the tree so it must be called on the model's thread, ExecChildQuery only touches the database.
+  GroupBy ChildType(CollectionItem *parent) const;
+  CollectionQuery ChildQuery(CollectionItem *parent, const GroupBy child_type);
+  QueryResult ExecChildQuery(const GroupBy child_type, CollectionQuery q, std::shared_ptr<CollectionIndex> filter_index);
+  // ExecChildQuery for the root, which first loads the songs matching the filter if there is no filter index for it yet.
+  QueryResult ExecResetQuery(const GroupBy child_type, CollectionQuery q, std::shared_ptr<CollectionIndex> filter_index);
+  std::shared_ptr<CollectionIndex> LoadFilterIndex(const QueryOptions &options);
+  // Keeps the filter index in sync with the backend.
+  void UpdateFilterIndex(const SongList &songs);
+
+  // Helpers for populating nodes in the background, the node shows a loading indicator until its query finishes.
+  void LazyPopulateAsync(CollectionItem *parent);
+  void StartPopulateQuery(CollectionItem *parent);
+  void CancelPopulate(CollectionItem *parent);
+  bool IsPopulating(CollectionItem *item) const { return populate_requests_.contains(item); }
+
+  // Helpers for updating the tree in place after a reset query, so the view keeps its expanded nodes and scroll position.
+  // The children of a node are matched by key with the rows of its new query, only the ones that changed are removed or inserted.
+  // The loaded nodes that are kept are queried again in the background and updated the same way.
+  // Returns false without changing anything if there are too many changes to be worth it.
+  bool DiffChildren(CollectionItem *parent, const QueryResult &result, const Grouping &old_grouping);
+  void StartRefreshQuery(CollectionItem *parent, const Grouping &old_grouping);
+  bool IsRefreshing(CollectionItem *item) const { return refresh_requests_.contains(item); }
+  // Drops the item and its children from the node maps and requests before it's deleted.
+  void ForgetItem(CollectionItem *item);
+  // Makes the refreshes running for the ancestors of the item start again, their results may still have it.
+  void MarkRefreshesStale(CollectionItem *item);
+  void RemoveUnusedDividers();
+  static QString DiffKey(const CollectionItem *item);
+
+  bool HasCompilations(const CollectionQuery &query, std::shared_ptr<CollectionIndex> filter_index);
+
+  // Adds the items for discovered songs, see SongsDiscovered.
+  void AddSongs(const SongList &songs);
+  // The parent to make a new child of parent under, a staging item if parent is in the model already.
+  CollectionItem *NewItemParent(CollectionItem *parent, const QSet<CollectionItem*> &new_items, QMap<CollectionItem*, CollectionItem*> *staging);
+  // Appends items made outside the model to parent in one range.
+  void InsertChildren(CollectionItem *parent, const QList<CollectionItem*> &items);
 
   void BeginReset();
 
@@ -245,10 +305,13 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
   // When the model is reset or when a node is lazy-loaded the Collection constructs a database query to populate the items.
   // Filters are added for each parent item, restricting the songs returned to a particular album or artist for example.
   static void InitQuery(const GroupBy type, CollectionQuery *q);
+  // The columns to ask the in-memory index for, instead of running the query made by InitQuery.
+  static QList<CollectionIndex::Column> IndexColumns(const GroupBy type);
   void FilterQuery(const GroupBy type, CollectionItem *item, CollectionQuery *q);
 
   // Items can be created either from a query that's been run to populate a node, or by a spontaneous SongsDiscovered emission from the backend.
-  CollectionItem *ItemFromQuery(const GroupBy type, const bool signal, const bool create_divider, CollectionItem *parent, const SqlRow &row, const int container_level);
+  static Song SongFromQuery(const GroupBy type, const SqlQueryCursor &row);
+  CollectionItem *ItemFromQuery(const GroupBy type, const bool signal, const bool create_divider, CollectionItem *parent, const Song &row, const int container_level);
   CollectionItem *ItemFromSong(const GroupBy type, const bool signal, const bool create_divider, CollectionItem *parent, const Song &s, const int container_level);
 
   // The "Various Artists" node is an annoying special case.
@@ -300,6 +363,24 @@ class CollectionModel : public SimpleTreeModel<CollectionItem> {
 
   int init_task_id_;
 
+  bool populate_async_;
+  int next_request_id_;
+  int reset_request_id_;
+  // Nodes waiting for a background query, the request ID tells a current result from one that was cancelled.
+  QMap<CollectionItem*, int> populate_requests_;
+
+  // The grouping the items in the tree were made with, and the kept nodes waiting for their children to be updated.
+  Grouping tree_group_by_;
+  QMap<CollectionItem*, int> refresh_requests_;
+  // Refreshing nodes that songs were discovered for, their result may be older than the songs so they're queried again.
+  QSet<CollectionItem*> stale_refreshes_;
+
+  // Discovered songs waiting to be added to the tree.
+  SongList pending_songs_;
+
+  // The songs matching the current filter, so typing more of it narrows them in memory instead of querying the database again.
+  std::shared_ptr<CollectionIndex> filter_index_;
+
   bool use_pretty_covers_;
   bool show_dividers_;
   bool use_disk_cache_;
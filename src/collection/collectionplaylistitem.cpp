@@ -24,30 +24,36 @@
 #include <QUrl>
 
 #include "collectionplaylistitem.h"
+#include "sqlrow.h"
 #include "core/tagreaderclient.h"
 
-class SqlRow;
-
-CollectionPlaylistItem::CollectionPlaylistItem() : PlaylistItem(Song::Source_Collection) {
+CollectionPlaylistItem::CollectionPlaylistItem() : PlaylistItem(Song::Source_Collection), has_metadata_(false) {
   song_.set_source(Song::Source_Collection);
 }
 
-CollectionPlaylistItem::CollectionPlaylistItem(const Song &song) : PlaylistItem(Song::Source_Collection), song_(song) {
+CollectionPlaylistItem::CollectionPlaylistItem(const Song &song) : PlaylistItem(Song::Source_Collection), song_(song), has_metadata_(true) {
   song_.set_source(Song::Source_Collection);
 }
 
 QUrl CollectionPlaylistItem::Url() const { return song_.url(); }
 
 void CollectionPlaylistItem::Reload() {
+  // Without the metadata there's nothing to update, the whole song is read from the collection when the item is loaded, see Playlist::ReloadItems.
+  if (!has_metadata_) return;
   TagReaderClient::Instance()->ReadFileBlocking(song_.url().toLocalFile(), &song_);
 }
 
 bool CollectionPlaylistItem::InitFromQuery(const SqlRow &query) {
 
-  // Rows from the songs tables come first
-  song_.InitFromQuery(query, true);
-  song_.set_source(Song::Source_Collection);
-  return song_.is_valid();
+  // Only the id, length and URL are read from the songs table, the rest of the metadata is loaded when the item is shown or played.
+  // The id is null if the song was removed from the collection.
+  const int collection_column = Song::kColumns.count() + 3;
+  if (query.value(collection_column).isNull()) return false;
+
+  song_.set_id(query.value(collection_column).toInt());
+  song_.set_length_nanosec(query.value(collection_column + 1).toLongLong());
+  song_.set_url(QUrl::fromEncoded(query.value(collection_column + 2).toString().toUtf8()));
+  return true;
 
 }
 
@@ -40,8 +40,10 @@ class CollectionPlaylistItem : public PlaylistItem {
   void Reload() override;
 
   Song Metadata() const override;
+  const Song &MetadataRef() const override { return HasTemporaryMetadata() ? temp_metadata_ : song_; }
   Song OriginalMetadata() const override { return song_; }
-  void SetMetadata(const Song &song) { song_ = song; }
+  bool HasMetadata() const override { return has_metadata_; }
+  void SetMetadata(const Song &song) { song_ = song; has_metadata_ = true; }
 
   QUrl Url() const override;
 
@@ -51,10 +53,10 @@ class CollectionPlaylistItem : public PlaylistItem {
 
  protected:
   QVariant DatabaseValue(DatabaseColumn column) const override;
-  Song DatabaseSongMetadata() const override { return Song(Song::Source_Collection); }
 
  protected:
   Song song_;
+  bool has_metadata_;
 };
 
 #endif  // COLLECTIONPLAYLISTITEM_H
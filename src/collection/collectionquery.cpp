@@ -37,7 +37,7 @@
 QueryOptions::QueryOptions() : max_age_(-1), query_mode_(QueryMode_All) {}
 
 CollectionQuery::CollectionQuery(const QueryOptions &options)
-    : include_unavailable_(false), join_with_fts_(false), limit_(-1) {
+    : options_(options), has_only_conditions_(true), include_unavailable_(false), join_with_fts_(false), limit_(-1) {
 
   if (!options.filter().isEmpty()) {
     // We need to munge the filter text a little bit to get it to work as expected with sqlite's FTS5:
@@ -122,6 +122,8 @@ QString CollectionQuery::GetInnerQuery() {
 
 void CollectionQuery::AddWhere(const QString &column, const QVariant &value, const QString &op) {
 
+  conditions_ << Condition(column, value, op);
+
   // ignore 'literal' for IN
   if (!op.compare("IN", Qt::CaseInsensitive)) {
     QStringList final;
@@ -161,6 +163,8 @@ void CollectionQuery::AddWhere(const QString &column, const QVariant &value, con
 
 void CollectionQuery::AddWhereArtist(const QVariant &value) {
 
+  has_only_conditions_ = false;
+
   where_clauses_ << QString("((artist = ? AND albumartist = '') OR albumartist = ?)");
   bound_values_ << value;
   bound_values_ << value;
@@ -172,6 +176,7 @@ void CollectionQuery::AddCompilationRequirement(bool compilation) {
   // When joining with fts, sqlite 3.8 has a tendency to use this index and thereby nesting the tables in an order which gives very poor performance
 
   where_clauses_ << QString("+compilation_effective = %1").arg(compilation ? 1 : 0);
+  conditions_ << Condition("compilation_effective", compilation ? 1 : 0, "=");
 
 }
 
@@ -202,6 +207,8 @@ QSqlQuery CollectionQuery::Exec(QSqlDatabase db, const QString &songs_table, con
   sql.replace("%fts_table", fts_table);
 
   query_ = QSqlQuery(db);
+  // Results are only ever read front to back, this stops the driver from keeping a copy of every row read so far.
+  query_.setForwardOnly(true);
   query_.prepare(sql);
 
   // Bind values
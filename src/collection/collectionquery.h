@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <QMetaType>
+#include <QList>
 #include <QVariant>
 #include <QString>
 #include <QStringList>
@@ -74,6 +75,14 @@ class CollectionQuery {
  public:
   explicit CollectionQuery(const QueryOptions &options = QueryOptions());
 
+  // A WHERE clause fragment kept in structured form, so CollectionIndex can evaluate the query without SQLite.
+  struct Condition {
+    Condition(const QString &_column = QString(), const QVariant &_value = QVariant(), const QString &_op = QString()) : column(_column), value(_value), op(_op) {}
+    QString column;
+    QVariant value;
+    QString op;
+  };
+
   // Sets contents of SELECT clause on the query (list of columns to get).
   void SetColumnSpec(const QString &spec) { column_spec_ = spec; }
   // Sets an ORDER BY clause on the query.
@@ -94,9 +103,20 @@ class CollectionQuery {
 
   operator const QSqlQuery &() const { return query_; }
 
+  const QueryOptions &options() const { return options_; }
+  const QList<Condition> &conditions() const { return conditions_; }
+  // False if the query has WHERE clauses that are not in conditions().
+  bool has_only_conditions() const { return has_only_conditions_; }
+  bool include_unavailable() const { return include_unavailable_; }
+  int limit() const { return limit_; }
+
  private:
   QString GetInnerQuery();
 
+  QueryOptions options_;
+  QList<Condition> conditions_;
+  bool has_only_conditions_;
+
   bool include_unavailable_;
   bool join_with_fts_;
   QString column_spec_;
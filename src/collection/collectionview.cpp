@@ -106,6 +106,8 @@ CollectionView::CollectionView(QWidget *parent)
 
   setStyleSheet("QTreeView::item{padding-top:1px;}");
 
+  connect(this, SIGNAL(collapsed(QModelIndex)), SLOT(ItemCollapsed(QModelIndex)));
+
 }
 
 CollectionView::~CollectionView() = default;
@@ -172,8 +174,9 @@ void CollectionView::RestoreFocus() {
 
 bool CollectionView::RestoreLevelFocus(const QModelIndex &parent) {
 
+  // Populate the level right away, fetchMore() would only start a background query.
   if (model()->canFetchMore(parent)) {
-    model()->fetchMore(parent);
+    app_->collection_model()->Populate(qobject_cast<QSortFilterProxyModel*>(model())->mapToSource(parent));
   }
   int rows = model()->rowCount(parent);
   for (int i = 0; i < rows; i++) {
@@ -247,6 +250,15 @@ void CollectionView::SetApplication(Application *app) {
 
 void CollectionView::SetFilter(CollectionFilterWidget *filter) { filter_ = filter; }
 
+void CollectionView::ItemCollapsed(const QModelIndex &idx) {
+
+  if (!app_) return;
+
+  // Don't keep loading a node the user is no longer looking at.
+  app_->collection_model()->CancelPopulate(qobject_cast<QSortFilterProxyModel*>(model())->mapToSource(idx));
+
+}
+
 void CollectionView::TotalSongCountUpdated(const int count) {
 
   int old = total_song_count_;
@@ -111,6 +111,7 @@ class CollectionView : public AutoExpandingTreeView {
   void NoShowInVarious();
   void Delete();
   void DeleteFilesFinished(const SongList &songs_with_errors);
+  void ItemCollapsed(const QModelIndex &idx);
 
  private:
   void RecheckIsEmpty();
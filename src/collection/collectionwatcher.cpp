@@ -25,6 +25,8 @@
 
 #include <QObject>
 #include <QThread>
+#include <QtConcurrentRun>
+#include <QFuture>
 #include <QIODevice>
 #include <QDir>
 #include <QDirIterator>
@@ -66,6 +68,10 @@ static const char *kNoMusicFile = ".nomusic";
 }
 
 QStringList CollectionWatcher::sValidImages = QStringList() << "jpg" << "png" << "gif" << "jpeg";
+const int CollectionWatcher::kMaxTagReadsInFlight = 128;
+const int CollectionWatcher::kTagReadBatchSize = 16;
+const int CollectionWatcher::kMaxPrefetchedListings = 4;
+const int CollectionWatcher::kCommitBatchSize = 1000;
 
 CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
     : QObject(parent),
@@ -76,6 +82,8 @@ CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
       scan_on_startup_(true),
       monitor_(true),
       mark_songs_unavailable_(false),
+      parallel_scan_(true),
+      tagreader_workers_(0),
       stop_requested_(false),
       rescan_in_progress_(false),
       rescan_timer_(new QTimer(this)),
@@ -86,6 +94,8 @@ CollectionWatcher::CollectionWatcher(Song::Source source, QObject *parent)
 
   original_thread_ = thread();
 
+  enumerate_threadpool_.setMaxThreadCount(1);
+
   rescan_timer_->setInterval(1000);
   rescan_timer_->setSingleShot(true);
 
@@ -118,7 +128,8 @@ CollectionWatcher::ScanTransaction::ScanTransaction(CollectionWatcher *watcher,
       mark_songs_unavailable_(mark_songs_unavailable),
       watcher_(watcher),
       cached_songs_dirty_(true),
-      known_subdirs_dirty_(true)
+      known_subdirs_dirty_(true),
+      pending_tag_reads_count_(0)
       {
 
   QString description;
@@ -135,8 +146,22 @@ CollectionWatcher::ScanTransaction::ScanTransaction(CollectionWatcher *watcher,
 
 CollectionWatcher::ScanTransaction::~ScanTransaction() {
 
+  // Listings of directories that weren't scanned because the scan was stopped.
+  for (QFuture<DirectoryListing> &future : prefetched_listings_) {
+    future.waitForFinished();
+  }
+  prefetched_listings_.clear();
+
   // If we're stopping then don't commit the transaction
-  if (!watcher_->stop_requested_) {
+  if (watcher_->stop_requested_) {
+    // The replies are still referenced by the tagreader handlers, so they can't be deleted before they are finished.
+    for (const PendingTagReadRequest &request : pending_tag_reads_) {
+      request.reply->WaitForFinished();
+      request.reply->deleteLater();
+    }
+    pending_tag_reads_.clear();
+  }
+  else {
     CommitNewOrUpdatedSongs();
   }
 
@@ -158,33 +183,123 @@ void CollectionWatcher::ScanTransaction::AddToProgressMax(int n) {
 
 }
 
-void CollectionWatcher::ScanTransaction::CommitNewOrUpdatedSongs() {
+void CollectionWatcher::ScanTransaction::PrefetchDirectoryListing(const QString &path) {
 
-  if (!new_songs.isEmpty()) {
-    emit watcher_->NewOrUpdatedSongs(new_songs);
-    new_songs.clear();
+  if (!watcher_->parallel_scan_ || prefetched_listings_.contains(path)) return;
+
+  prefetched_listings_.insert(path, QtConcurrent::run(&watcher_->enumerate_threadpool_, &CollectionWatcher::ListDirectory, path));
+
+}
+
+CollectionWatcher::DirectoryListing CollectionWatcher::ScanTransaction::TakeDirectoryListing(const QString &path) {
+
+  if (prefetched_listings_.contains(path)) {
+    return prefetched_listings_.take(path).result();
   }
 
-  if (!touched_songs.isEmpty()) {
-    emit watcher_->SongsMTimeUpdated(touched_songs);
-    touched_songs.clear();
+  return ListDirectory(path);
+
+}
+
+void CollectionWatcher::ScanTransaction::DropDirectoryListing(const QString &path) {
+
+  if (prefetched_listings_.contains(path)) {
+    prefetched_listings_.take(path).waitForFinished();
   }
 
-  if (!deleted_songs.isEmpty()) {
-    if (mark_songs_unavailable_) {
-      emit watcher_->SongsUnavailable(deleted_songs);
+}
+
+void CollectionWatcher::ScanTransaction::ReadFileAsync(const QString &file, const Song &matching_song, const QUrl &image) {
+
+  PendingTagRead pending;
+  pending.file = file;
+  pending.matching_song = matching_song;
+  pending.image = image;
+  queued_tag_reads_ << pending;
+
+  if (queued_tag_reads_.count() >= kTagReadBatchSize) {
+    SendQueuedTagReads();
+  }
+
+}
+
+void CollectionWatcher::ScanTransaction::SendQueuedTagReads() {
+
+  if (queued_tag_reads_.isEmpty()) return;
+
+  while (!pending_tag_reads_.isEmpty() && pending_tag_reads_count_ + queued_tag_reads_.count() > kMaxTagReadsInFlight) {
+    FinishOldestTagRead();
+  }
+
+  QStringList filenames;
+  for (const PendingTagRead &pending : queued_tag_reads_) {
+    filenames << pending.file;
+  }
+
+  PendingTagReadRequest request;
+  request.files = queued_tag_reads_;
+  request.reply = TagReaderClient::Instance()->ReadFiles(filenames);
+  pending_tag_reads_ << request;
+  pending_tag_reads_count_ += queued_tag_reads_.count();
+  queued_tag_reads_.clear();
+
+}
+
+void CollectionWatcher::ScanTransaction::WaitForPendingTagReads() {
+
+  SendQueuedTagReads();
+
+  while (!pending_tag_reads_.isEmpty()) {
+    FinishOldestTagRead();
+  }
+
+}
+
+void CollectionWatcher::ScanTransaction::FinishOldestTagRead() {
+
+  PendingTagReadRequest request = pending_tag_reads_.takeFirst();
+  pending_tag_reads_count_ -= request.files.count();
+
+  request.reply->WaitForFinished();
+  const QList<pb::tagreader::Message> replies = request.reply->TakePartialReplies();
+  request.reply->deleteLater();
+
+  if (watcher_->stop_requested_) return;
+
+  for (const pb::tagreader::Message &message : replies) {
+    const pb::tagreader::ReadFilesResponse &response = message.read_files_response();
+    if (response.index() < 0 || response.index() >= request.files.count()) continue;
+    const PendingTagRead &pending = request.files[response.index()];
+
+    Song song(watcher_->source_);
+    song.set_directory_id(dir_);
+    song.InitFromProtobuf(response.metadata());
+    if (!song.is_valid()) continue;
+
+    if (pending.matching_song.is_valid()) {
+      watcher_->PreserveUserSetData(pending.file, pending.image, pending.matching_song, &song, this);
     }
     else {
-      emit watcher_->SongsDeleted(deleted_songs);
+      qLog(Debug) << pending.file << "created";
+      song.set_source(watcher_->source_);
+      if (song.art_automatic().isEmpty()) song.set_art_automatic(pending.image);
+      new_songs << song;
     }
-    deleted_songs.clear();
   }
 
-  if (!readded_songs.isEmpty()) {
-    emit watcher_->SongsReadded(readded_songs);
-    readded_songs.clear();
+  // Hand the songs over to the backend in batches, instead of keeping all of them until the whole directory is scanned.
+  if (new_songs.count() + touched_songs.count() >= kCommitBatchSize) {
+    CommitSongs();
   }
 
+}
+
+void CollectionWatcher::ScanTransaction::CommitNewOrUpdatedSongs() {
+
+  WaitForPendingTagReads();
+
+  CommitSongs();
+
   if (!new_subdirs.isEmpty()) {
     emit watcher_->SubdirsDiscovered(new_subdirs);
   }
@@ -213,6 +328,35 @@ void CollectionWatcher::ScanTransaction::CommitNewOrUpdatedSongs() {
 
 }
 
+void CollectionWatcher::ScanTransaction::CommitSongs() {
+
+  if (!new_songs.isEmpty()) {
+    emit watcher_->NewOrUpdatedSongs(new_songs);
+    new_songs.clear();
+  }
+
+  if (!touched_songs.isEmpty()) {
+    emit watcher_->SongsMTimeUpdated(touched_songs);
+    touched_songs.clear();
+  }
+
+  if (!deleted_songs.isEmpty()) {
+    if (mark_songs_unavailable_) {
+      emit watcher_->SongsUnavailable(deleted_songs);
+    }
+    else {
+      emit watcher_->SongsDeleted(deleted_songs);
+    }
+    deleted_songs.clear();
+  }
+
+  if (!readded_songs.isEmpty()) {
+    emit watcher_->SongsReadded(readded_songs);
+    readded_songs.clear();
+  }
+
+}
+
 
 SongList CollectionWatcher::ScanTransaction::FindSongsInSubdirectory(const QString &path) {
 
@@ -276,6 +420,8 @@ void CollectionWatcher::AddDirectory(const Directory &dir, const SubdirectoryLis
 
   watched_dirs_[dir.id] = dir;
 
+  TagReaderClient::Instance()->AddStoragePath(dir.path, tagreader_workers_);
+
   if (subdirs.isEmpty()) {
     // This is a new directory that we've never seen before. Scan it fully.
     ScanTransaction transaction(this, dir.id, false, false, mark_songs_unavailable_);
@@ -311,6 +457,7 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
     QString real_path = path_info.symLinkTarget();
     for (const Directory &dir : watched_dirs_) {
       if (real_path.startsWith(dir.path)) {
+        t->DropDirectoryListing(path);
         t->AddToProgress(1);
         return;
       }
@@ -319,18 +466,18 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
 
   // Do not scan directories containing a .nomedia or .nomusic file
   if (path_dir.exists(kNoMediaFile) || path_dir.exists(kNoMusicFile)) {
+    t->DropDirectoryListing(path);
     t->AddToProgress(1);
     return;
   }
 
   if (!t->ignores_mtime() && !force_noincremental && t->is_incremental() && subdir.mtime == path_info.lastModified().toSecsSinceEpoch()) {
     // The directory hasn't changed since last time
+    t->DropDirectoryListing(path);
     t->AddToProgress(1);
     return;
   }
 
-  QMap<QString, QStringList> album_art;
-  QStringList files_on_disk;
   SubdirectoryList my_new_subdirs;
 
   // If a directory is moved then only its parent gets a changed notification, so we need to look and see if any of our children don't exist any more.
@@ -344,31 +491,14 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
   }
 
   // First we "quickly" get a list of the files in the directory that we think might be music.  While we're here, we also look for new subdirectories and possible album artwork.
-  QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
-  while (it.hasNext()) {
-    if (stop_requested_) return;
-
-    QString child(it.next());
-    QFileInfo child_info(child);
-
-    if (child_info.isDir()) {
-      if (!child_info.isHidden() && !t->HasSeenSubdir(child)) {
-        // We haven't seen this subdirectory before - add it to a list and later we'll tell the backend about it and scan it.
-        Subdirectory new_subdir;
-        new_subdir.directory_id = -1;
-        new_subdir.path = child;
-        new_subdir.mtime = child_info.lastModified().toSecsSinceEpoch();
-        my_new_subdirs << new_subdir;
-      }
-    }
-    else {
-      QString ext_part(ExtensionPart(child));
-      QString dir_part(DirectoryPart(child));
-
-      if (sValidImages.contains(ext_part))
-        album_art[dir_part] << child;
-      else if (!child_info.isHidden())
-        files_on_disk << child;
+  DirectoryListing listing = t->TakeDirectoryListing(path);
+  QMap<QString, QStringList> &album_art = listing.album_art;
+  QStringList &files_on_disk = listing.files_on_disk;
+
+  for (const Subdirectory &child_subdir : listing.subdirs) {
+    if (!t->HasSeenSubdir(child_subdir.path)) {
+      // We haven't seen this subdirectory before - add it to a list and later we'll tell the backend about it and scan it.
+      my_new_subdirs << child_subdir;
     }
   }
 
@@ -434,6 +564,10 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
       if (matching_song.is_unavailable()) t->readded_songs << matching_song;
 
     }
+    else if (parallel_scan_ && GetMtimeForCue(matching_cue) == 0) {
+      // The song is on disk but not in the DB, read the tags in the background while we continue with the next file.
+      t->ReadFileAsync(file, Song(source_), ImageForSong(file, album_art));
+    }
     else {
       // The song is on disk but not in the DB
       SongList song_list = ScanNewFile(file, path, matching_cue, &cues_processed);
@@ -481,13 +615,49 @@ void CollectionWatcher::ScanSubdirectory(const QString &path, const Subdirectory
 
   // Recurse into the new subdirs that we found
   t->AddToProgressMax(my_new_subdirs.count());
-  for (const Subdirectory &my_new_subdir : my_new_subdirs) {
+  for (int i = 0; i < my_new_subdirs.count(); ++i) {
     if (stop_requested_) return;
-    ScanSubdirectory(my_new_subdir.path, my_new_subdir, t, true);
+    for (int j = i + 1; j < my_new_subdirs.count() && j <= i + kMaxPrefetchedListings; ++j) {
+      t->PrefetchDirectoryListing(my_new_subdirs[j].path);
+    }
+    ScanSubdirectory(my_new_subdirs[i].path, my_new_subdirs[i], t, true);
   }
 
 }
 
+CollectionWatcher::DirectoryListing CollectionWatcher::ListDirectory(const QString &path) {
+
+  DirectoryListing listing;
+
+  QDirIterator it(path, QDir::Dirs | QDir::Files | QDir::Hidden | QDir::NoDotAndDotDot);
+  while (it.hasNext()) {
+    QString child(it.next());
+    QFileInfo child_info(child);
+
+    if (child_info.isDir()) {
+      if (!child_info.isHidden()) {
+        Subdirectory subdir;
+        subdir.directory_id = -1;
+        subdir.path = child;
+        subdir.mtime = child_info.lastModified().toSecsSinceEpoch();
+        listing.subdirs << subdir;
+      }
+    }
+    else {
+      QString ext_part(ExtensionPart(child));
+      QString dir_part(DirectoryPart(child));
+
+      if (sValidImages.contains(ext_part))
+        listing.album_art[dir_part] << child;
+      else if (!child_info.isHidden())
+        listing.files_on_disk << child;
+    }
+  }
+
+  return listing;
+
+}
+
 void CollectionWatcher::UpdateCueAssociatedSongs(const QString &file, const QString &path, const QString &matching_cue, const QUrl &image, ScanTransaction *t) {
 
   QFile cue(matching_cue);
@@ -539,6 +709,11 @@ void CollectionWatcher::UpdateNonCueAssociatedSong(const QString &file, const So
     }
   }
 
+  if (parallel_scan_) {
+    t->ReadFileAsync(file, matching_song, image);
+    return;
+  }
+
   Song song_on_disk(source_);
   song_on_disk.set_directory_id(t->dir());
   TagReaderClient::Instance()->ReadFileBlocking(file, &song_on_disk);
@@ -806,6 +981,8 @@ void CollectionWatcher::ReloadSettings() {
   scan_on_startup_ = s.value("startup_scan", true).toBool();
   monitor_ = s.value("monitor", true).toBool();
   mark_songs_unavailable_ = s.value("mark_songs_unavailable", false).toBool();
+  parallel_scan_ = s.value("parallel_scan", true).toBool();
+  tagreader_workers_ = s.value("tagreader_workers", 0).toInt();
   QStringList filters = s.value("cover_art_patterns", QStringList() << "front" << "cover").toStringList();
   s.endGroup();
 
@@ -908,13 +1085,22 @@ void CollectionWatcher::PerformScan(bool incremental, bool ignore_mtimes) {
     SubdirectoryList subdirs(transaction.GetAllSubdirs());
     transaction.AddToProgressMax(subdirs.count());
 
-    for (const Subdirectory &subdir : subdirs) {
+    for (int i = 0; i < subdirs.count(); ++i) {
       if (stop_requested_) break;
 
-      ScanSubdirectory(subdir.path, subdir, &transaction);
+      // Unchanged directories are skipped by incremental scans, so only list ahead when every directory is going to be read.
+      if (!incremental || ignore_mtimes) {
+        for (int j = i + 1; j < subdirs.count() && j <= i + kMaxPrefetchedListings; ++j) {
+          transaction.PrefetchDirectoryListing(subdirs[j].path);
+        }
+      }
+
+      ScanSubdirectory(subdirs[i].path, subdirs[i], &transaction);
     }
   }
 
+  TagReaderClient::Instance()->LogWorkerStatistics();
+
   emit CompilationsNeedUpdating();
 
 }
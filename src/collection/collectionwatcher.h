@@ -26,6 +26,8 @@
 
 #include <QtGlobal>
 #include <QObject>
+#include <QFuture>
+#include <QThreadPool>
 #include <QHash>
 #include <QMap>
 #include <QSet>
@@ -35,6 +37,7 @@
 
 #include "directory.h"
 #include "core/song.h"
+#include "core/tagreaderclient.h"
 
 class QThread;
 class QTimer;
@@ -84,6 +87,14 @@ class CollectionWatcher : public QObject {
   void SetRescanPaused(bool pause);
 
  private:
+  // The result of listing the contents of a single directory.
+  // With parallel scanning enabled this is produced ahead of time on the enumeration thread.
+  struct DirectoryListing {
+    QStringList files_on_disk;
+    QMap<QString, QStringList> album_art;
+    SubdirectoryList subdirs;
+  };
+
   // This class encapsulates a full or partial scan of a directory.
   // Each directory has one or more subdirectories, and any number of subdirectories can be scanned during one transaction.
   // ScanSubdirectory() adds its results to the members of this transaction class,
@@ -104,6 +115,21 @@ class CollectionWatcher : public QObject {
     void AddToProgress(int n = 1);
     void AddToProgressMax(int n);
 
+    // Starts listing the directory on the enumeration thread, so it is ready by the time ScanSubdirectory() gets to it.
+    void PrefetchDirectoryListing(const QString &path);
+    // Returns the prefetched listing for the directory, or lists it now if it was not prefetched.
+    DirectoryListing TakeDirectoryListing(const QString &path);
+    // Waits for the prefetched listing of a directory that isn't going to be scanned.
+    void DropDirectoryListing(const QString &path);
+
+    // Queues the file to be read by the tagreader without waiting for the result.
+    // matching_song is the song currently in the collection, or an invalid song if the file is new.
+    // Files are sent in ReadFiles requests of kTagReadBatchSize, and at most kMaxTagReadsInFlight files are kept pending,
+    // if there are more this waits for the oldest request to finish.
+    void ReadFileAsync(const QString &file, const Song &matching_song, const QUrl &image);
+    // Waits for all pending tag read requests and adds the songs to the transaction.
+    void WaitForPendingTagReads();
+
     // Emits the signals for new & deleted songs etc and clears the lists. This causes the new stuff to be updated on UI.
     void CommitNewOrUpdatedSongs();
 
@@ -123,6 +149,24 @@ class CollectionWatcher : public QObject {
     ScanTransaction(const ScanTransaction&) {}
     ScanTransaction& operator=(const ScanTransaction&) { return *this; }
 
+    struct PendingTagRead {
+      QString file;
+      Song matching_song;
+      QUrl image;
+    };
+
+    struct PendingTagReadRequest {
+      QList<PendingTagRead> files;
+      TagReaderReply *reply;
+    };
+
+    // Sends the queued files to the tagreader in one request.
+    void SendQueuedTagReads();
+    // Waits for the oldest pending tag read request and adds its songs to the transaction.
+    void FinishOldestTagRead();
+    // Emits only the song signals, used to commit songs in batches while the scan is still running.
+    void CommitSongs();
+
     int task_id_;
     int progress_;
     int progress_max_;
@@ -146,6 +190,11 @@ class CollectionWatcher : public QObject {
 
     SubdirectoryList known_subdirs_;
     bool known_subdirs_dirty_;
+
+    QHash<QString, QFuture<DirectoryListing>> prefetched_listings_;
+    QList<PendingTagRead> queued_tag_reads_;
+    QList<PendingTagReadRequest> pending_tag_reads_;
+    int pending_tag_reads_count_;
   };
 
  private slots:
@@ -162,6 +211,7 @@ class CollectionWatcher : public QObject {
   inline static QString NoExtensionPart(const QString &fileName);
   inline static QString ExtensionPart(const QString &fileName);
   inline static QString DirectoryPart(const QString &fileName);
+  static DirectoryListing ListDirectory(const QString &path);
   QString PickBestImage(const QStringList &images);
   QUrl ImageForSong(const QString &path, QMap<QString, QStringList> &album_art);
   void AddWatch(const Directory &dir, const QString &path);
@@ -195,6 +245,8 @@ class CollectionWatcher : public QObject {
   bool scan_on_startup_;
   bool monitor_;
   bool mark_songs_unavailable_;
+  bool parallel_scan_;
+  int tagreader_workers_;
 
   bool stop_requested_;
   bool rescan_in_progress_; // True if RescanTracksNow() has been called and is working.
@@ -208,7 +260,14 @@ class CollectionWatcher : public QObject {
 
   CueParser *cue_parser_;
 
+  // Single thread listing directories ahead of ScanSubdirectory() during parallel scans.
+  QThreadPool enumerate_threadpool_;
+
   static QStringList sValidImages;
+  static const int kMaxTagReadsInFlight;
+  static const int kTagReadBatchSize;
+  static const int kMaxPrefetchedListings;
+  static const int kCommitBatchSize;
 
   SongList song_rescan_queue_; // Set by ui thread
 
@@ -40,3 +40,7 @@ void SqlRow::Init(const QSqlQuery &query) {
   }
 
 }
+
+SqlQueryCursor::SqlQueryCursor(const QSqlQuery &query) : query_(query), columns_(query.record().count()) {}
+
+SqlQueryCursor::SqlQueryCursor(const CollectionQuery &query) : SqlQueryCursor(static_cast<const QSqlQuery&>(query)) {}
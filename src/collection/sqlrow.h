@@ -37,6 +37,7 @@ class SqlRow {
   SqlRow(const CollectionQuery &query);
 
   const QVariant &value(int i) const { return columns_[i]; }
+  int columns() const { return columns_.count(); }
 
   QList<QVariant> columns_;
 
@@ -49,5 +50,22 @@ class SqlRow {
 
 typedef QList<SqlRow> SqlRowList;
 
+// Reads the current row of a query in place instead of copying every column into a SqlRow first.
+// Create it once after the query is executed and reuse it for each row, it is only valid as long as the query.
+class SqlQueryCursor {
+
+ public:
+  explicit SqlQueryCursor(const QSqlQuery &query);
+  explicit SqlQueryCursor(const CollectionQuery &query);
+
+  QVariant value(const int i) const { return query_.value(i); }
+  int columns() const { return columns_; }
+
+ private:
+  const QSqlQuery &query_;
+  int columns_;
+
+};
+
 #endif
 
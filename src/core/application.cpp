@@ -271,6 +271,9 @@ void Application::Exit() {
   connect(collection(), SIGNAL(ExitFinished()), this, SLOT(ExitReceived()));
   collection()->Exit();
 
+  // The saves are queued to the playlist backend before it exits.
+  playlist_manager()->FinishRestores();
+
   connect(playlist_backend(), SIGNAL(ExitFinished()), this, SLOT(ExitReceived()));
   playlist_backend()->ExitAsync();
 
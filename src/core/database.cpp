@@ -54,7 +54,7 @@
 #include "scopedtransaction.h"
 
 const char *Database::kDatabaseFilename = "strawberry.db";
-const int Database::kSchemaVersion = 13;
+const int Database::kSchemaVersion = 15;
 const char *Database::kMagicAllSongsTables = "%allsongstables";
 
 int Database::sNextConnectionId = 1;
@@ -67,6 +67,7 @@ Database::Database(Application *app, QObject *parent, const QString &database_na
       mutex_(QMutex::Recursive),
 #endif
       injected_database_name_(database_name),
+      use_reader_connections_(database_name != ":memory:"),
       query_hash_(0),
       startup_schema_version_(-1),
       original_thread_(nullptr) {
@@ -135,53 +136,129 @@ QSqlDatabase Database::Connect() {
   db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000");
   //qLog(Debug) << "Opened database with connection id" << connection_id;
 
-  if (!injected_database_name_.isNull())
-    db.setDatabaseName(injected_database_name_);
-  else
-    db.setDatabaseName(directory_ + "/" + kDatabaseFilename);
+  db.setDatabaseName(DatabaseName());
 
   if (!db.open()) {
     app_->AddError("Database: " + db.lastError().text());
     return db;
   }
 
+  if (use_reader_connections_) {
+    // Write-ahead logging lets the reader connections query the database while this connection is writing to it.
+    QSqlQuery q(db);
+    if (!q.exec("PRAGMA journal_mode = WAL")) {
+      qLog(Warning) << "Couldn't enable write-ahead logging:" << q.lastError();
+    }
+    if (!q.exec("PRAGMA synchronous = NORMAL")) {
+      qLog(Warning) << "Couldn't set synchronous mode:" << q.lastError();
+    }
+  }
+
   if (db.tables().count() == 0) {
     // Set up initial schema
     qLog(Info) << "Creating initial database schema";
     UpdateDatabaseSchema(0, db);
   }
 
-  {
-    //  Register unicode from unicode61 tokenizer to drop old FTS3 tables.
-    //  We need it also to drop old devices later when loading devices.
-    //  And that's done in a different thread after schemas are upgraded, so register it anyway.
+  InitConnection(db);
+
+  if (startup_schema_version_ == -1) {
+    UpdateMainSchema(&db);
+  }
+
+  // We might have to initialize the schema in some attached databases now, if they were deleted and don't match up with the main schema version.
+  for (const QString &key : attached_databases_.keys()) {
+    if (attached_databases_[key].is_temporary_ && attached_databases_[key].schema_.isEmpty())
+      continue;
+    // Find out if there are any tables in this database
+    QSqlQuery q(db);
+    q.prepare(QString("SELECT ROWID FROM %1.sqlite_master WHERE type='table'").arg(key));
+    if (!q.exec() || !q.next()) {
+      q.finish();
+      ExecSchemaCommandsFromFile(db, attached_databases_[key].schema_, 0);
+    }
+  }
+
+  return db;
+
+}
+
+QSqlDatabase Database::ConnectReader() {
+
+  // An in-memory database only exists on the connection that created it.
+  if (!use_reader_connections_) return Connect();
+
+  // The writer connection creates the schema and the attached databases the reader needs.
+  Connect();
+
+  QMutexLocker l(&connect_mutex_);
+
+  const QString connection_id = QString("%1_thread_%2_reader").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
+
+  // Try to find an existing connection for this thread
+  QSqlDatabase db;
+  if (QSqlDatabase::connectionNames().contains(connection_id)) {
+    db = QSqlDatabase::database(connection_id);
+  }
+  else {
+    db = QSqlDatabase::addDatabase("QSQLITE", connection_id);
+  }
+  if (db.isOpen()) {
+    return db;
+  }
+  db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=30000;QSQLITE_OPEN_READONLY");
+  db.setDatabaseName(DatabaseName());
+
+  if (!db.open()) {
+    app_->AddError("Database: " + db.lastError().text());
+    return db;
+  }
+
+  InitConnection(db);
+
+  return db;
+
+}
+
+QString Database::DatabaseName() const {
+
+  if (!injected_database_name_.isNull()) return injected_database_name_;
+
+  return directory_ + "/" + kDatabaseFilename;
+
+}
+
+void Database::InitConnection(QSqlDatabase &db) {
+
+  //  Register unicode from unicode61 tokenizer to drop old FTS3 tables.
+  //  We need it also to drop old devices later when loading devices.
+  //  And that's done in a different thread after schemas are upgraded, so register it anyway.
 #ifdef SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER
-    QVariant v = db.driver()->handle();
-    if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
-      sqlite3 *handle = *static_cast<sqlite3**>(v.data());
-      if (handle) {
-        int result = sqlite3_db_config(handle, SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER, 1, NULL);
-        if (result != SQLITE_OK) qLog(Fatal) << "Unable to enable FTS3 tokenizer";
-      }
-      else qLog(Fatal) << "Unable to enable FTS3 tokenizer";
+  QVariant v = db.driver()->handle();
+  if (v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0) {
+    sqlite3 *handle = *static_cast<sqlite3**>(v.data());
+    if (handle) {
+      int result = sqlite3_db_config(handle, SQLITE_DBCONFIG_ENABLE_FTS3_TOKENIZER, 1, NULL);
+      if (result != SQLITE_OK) qLog(Fatal) << "Unable to enable FTS3 tokenizer";
     }
+    else qLog(Fatal) << "Unable to enable FTS3 tokenizer";
+  }
 #endif
-    QSqlQuery get_fts_tokenizer(db);
-    get_fts_tokenizer.prepare("SELECT fts3_tokenizer(:name)");
-    get_fts_tokenizer.bindValue(":name", "unicode61");
-    if (get_fts_tokenizer.exec() && get_fts_tokenizer.next()) {
-      QSqlQuery set_fts_tokenizer(db);
-      set_fts_tokenizer.prepare("SELECT fts3_tokenizer(:name, :pointer)");
-      set_fts_tokenizer.bindValue(":name", "unicode");
-      set_fts_tokenizer.bindValue(":pointer", get_fts_tokenizer.value(0));
-      if (!set_fts_tokenizer.exec()) {
-        qLog(Warning) << "Couldn't register FTS3 tokenizer : " << set_fts_tokenizer.lastError();
-      }
-    }
-    else {
-      qLog(Warning) << "Couldn't get FTS3 tokenizer : " << get_fts_tokenizer.lastError();
+  QSqlQuery get_fts_tokenizer(db);
+  get_fts_tokenizer.prepare("SELECT fts3_tokenizer(:name)");
+  get_fts_tokenizer.bindValue(":name", "unicode61");
+  if (get_fts_tokenizer.exec() && get_fts_tokenizer.next()) {
+    QSqlQuery set_fts_tokenizer(db);
+    set_fts_tokenizer.prepare("SELECT fts3_tokenizer(:name, :pointer)");
+    set_fts_tokenizer.bindValue(":name", "unicode");
+    set_fts_tokenizer.bindValue(":pointer", get_fts_tokenizer.value(0));
+    if (!set_fts_tokenizer.exec()) {
+      qLog(Warning) << "Couldn't register FTS3 tokenizer : " << set_fts_tokenizer.lastError();
     }
   }
+  else {
+    qLog(Warning) << "Couldn't get FTS3 tokenizer : " << get_fts_tokenizer.lastError();
+  }
 
   // Attach external databases
   for (const QString &key : attached_databases_.keys()) {
@@ -199,25 +276,6 @@ QSqlDatabase Database::Connect() {
     }
   }
 
-  if (startup_schema_version_ == -1) {
-    UpdateMainSchema(&db);
-  }
-
-  // We might have to initialize the schema in some attached databases now, if they were deleted and don't match up with the main schema version.
-  for (const QString &key : attached_databases_.keys()) {
-    if (attached_databases_[key].is_temporary_ && attached_databases_[key].schema_.isEmpty())
-      continue;
-    // Find out if there are any tables in this database
-    QSqlQuery q(db);
-    q.prepare(QString("SELECT ROWID FROM %1.sqlite_master WHERE type='table'").arg(key));
-    if (!q.exec() || !q.next()) {
-      q.finish();
-      ExecSchemaCommandsFromFile(db, attached_databases_[key].schema_, 0);
-    }
-  }
-
-  return db;
-
 }
 
 void Database::Close() {
@@ -226,16 +284,17 @@ void Database::Close() {
 
   const QString connection_id = QString("%1_thread_%2").arg(connection_id_).arg(reinterpret_cast<quint64>(QThread::currentThread()));
 
-  // Try to find an existing connection for this thread
-  if (QSqlDatabase::connectionNames().contains(connection_id)) {
+  // Try to find the existing connections for this thread
+  for (const QString &id : QStringList() << connection_id << connection_id + "_reader") {
+    if (!QSqlDatabase::connectionNames().contains(id)) continue;
     {
-      QSqlDatabase db = QSqlDatabase::database(connection_id);
+      QSqlDatabase db = QSqlDatabase::database(id);
       if (db.isOpen()) {
         db.close();
-        //qLog(Debug) << "Closed database with connection id" << connection_id;
+        //qLog(Debug) << "Closed database with connection id" << id;
       }
     }
-    QSqlDatabase::removeDatabase(connection_id);
+    QSqlDatabase::removeDatabase(id);
   }
 
 }
@@ -64,13 +64,18 @@ class Database : public QObject {
 
   void ExitAsync();
   QSqlDatabase Connect();
+  // Returns a read-only connection for this thread, which can be used without holding Mutex() while another thread writes.
+  // Falls back to the normal connection for in-memory databases.
+  QSqlDatabase ConnectReader();
   void Close();
   bool CheckErrors(const QSqlQuery &query);
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
   QRecursiveMutex *Mutex() { return &mutex_; }
+  QRecursiveMutex *ReaderMutex() { return use_reader_connections_ ? nullptr : &mutex_; }
 #else
   QMutex *Mutex() { return &mutex_; }
+  QMutex *ReaderMutex() { return use_reader_connections_ ? nullptr : &mutex_; }
 #endif
 
   void RecreateAttachedDb(const QString &database_name);
@@ -106,6 +111,8 @@ class Database : public QObject {
   bool IntegrityCheck(QSqlDatabase db);
   void BackupFile(const QString &filename);
   bool OpenDatabase(const QString &filename, sqlite3 **connection) const;
+  QString DatabaseName() const;
+  void InitConnection(QSqlDatabase &db);
 
   Application *app_;
 
@@ -129,6 +136,9 @@ class Database : public QObject {
   // Used by tests
   QString injected_database_name_;
 
+  // Reads use their own read-only connections, except for in-memory databases.
+  bool use_reader_connections_;
+
   uint query_hash_;
   QStringList query_cache_;
 
@@ -187,7 +187,9 @@
 
 #ifdef HAVE_MOODBAR
 #  include "moodbar/moodbarcontroller.h"
+#  include "moodbar/moodbarloader.h"
 #  include "moodbar/moodbarproxystyle.h"
+#  include "settings/moodbarsettingspage.h"
 #endif
 
 #include "smartplaylists/smartplaylistsviewcontainer.h"
@@ -299,6 +301,9 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSDBase *osd
       playlist_add_to_another_(nullptr),
       playlistitem_actions_separator_(nullptr),
       playlist_rescan_songs_(nullptr),
+#ifdef HAVE_MOODBAR
+      generate_moodbars_(nullptr),
+#endif
       collection_sort_model_(new QSortFilterProxyModel(this)),
       track_position_timer_(new QTimer(this)),
       track_slider_timer_(new QTimer(this)),
@@ -814,6 +819,10 @@ MainWindow::MainWindow(Application *app, SystemTrayIcon *tray_icon, OSDBase *osd
 #ifdef HAVE_MOODBAR
   // Moodbar connections
   connect(app_->moodbar_controller(), SIGNAL(CurrentMoodbarDataChanged(QByteArray)), ui_->track_slider->moodbar_style(), SLOT(SetMoodbarData(QByteArray)));
+
+  generate_moodbars_ = new QAction(tr("Generate mood files for the collection"), this);
+  ui_->menu_tools->insertAction(ui_->action_abort_collection_scan, generate_moodbars_);
+  connect(generate_moodbars_, SIGNAL(triggered()), app_->moodbar_loader(), SLOT(GenerateCollectionMoodbars()));
 #endif
 
   // Playing widget
@@ -1097,6 +1106,12 @@ void MainWindow::ReloadSettings() {
     ui_->tabs->DisableTab(qobuz_view_);
 #endif
 
+#ifdef HAVE_MOODBAR
+  s.beginGroup(MoodbarSettingsPage::kSettingsGroup);
+  generate_moodbars_->setEnabled(s.value("enabled", false).toBool());
+  s.endGroup();
+#endif
+
   ui_->tabs->ReloadSettings();
 
 }
@@ -2030,7 +2045,7 @@ void MainWindow::EditTagDialogAccepted() {
   // FIXME: This is really lame but we don't know what rows have changed.
   ui_->playlist->view()->update();
 
-  app_->playlist_manager()->current()->Save();
+  app_->playlist_manager()->current()->SaveItems(edit_tag_dialog_->playlist_items());
 
 }
 
@@ -362,6 +362,9 @@ class MainWindow : public QMainWindow, public PlatformInterface {
   QList<QAction*> playlistitem_actions_;
   QAction *playlistitem_actions_separator_;
   QAction *playlist_rescan_songs_;
+#ifdef HAVE_MOODBAR
+  QAction *generate_moodbars_;
+#endif
 
   QModelIndex playlist_menu_index_;
 
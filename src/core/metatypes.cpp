@@ -23,7 +23,6 @@
 #include "metatypes.h"
 
 #ifdef HAVE_GSTREAMER
-#  include <gst/gstbuffer.h>
 #  include <gst/gstelement.h>
 #endif
 
@@ -55,6 +54,7 @@
 #endif
 #include "collection/directory.h"
 #include "playlist/playlistitem.h"
+#include "playlist/playlistbackend.h"
 #include "playlist/playlistsequence.h"
 #include "covermanager/albumcoverloaderresult.h"
 #include "covermanager/albumcoverfetcher.h"
@@ -104,13 +104,13 @@ void RegisterMetaTypes() {
   qRegisterMetaType<Engine::TrackChangeFlags>("Engine::TrackChangeFlags");
   qRegisterMetaType<EngineBase::OutputDetails>("EngineBase::OutputDetails");
 #ifdef HAVE_GSTREAMER
-  qRegisterMetaType<GstBuffer*>("GstBuffer*");
   qRegisterMetaType<GstElement*>("GstElement*");
   qRegisterMetaType<GstEnginePipeline*>("GstEnginePipeline*");
 #endif
   qRegisterMetaType<PlaylistItemList>("PlaylistItemList");
   qRegisterMetaType<PlaylistItemPtr>("PlaylistItemPtr");
   qRegisterMetaType<QList<PlaylistItemPtr> >("QList<PlaylistItemPtr>");
+  qRegisterMetaType<PlaylistBackend::ItemChangeList>("PlaylistBackend::ItemChangeList");
   qRegisterMetaType<PlaylistSequence::RepeatMode>("PlaylistSequence::RepeatMode");
   qRegisterMetaType<PlaylistSequence::ShuffleMode>("PlaylistSequence::ShuffleMode");
   qRegisterMetaType<AlbumCoverLoaderResult>("AlbumCoverLoaderResult");
@@ -145,6 +145,7 @@ const QStringList Song::kFtsColumns = QStringList() << "ftstitle"
 const QString Song::kFtsColumnSpec = Song::kFtsColumns.join(", ");
 const QString Song::kFtsBindSpec = Utilities::Prepend(":", Song::kFtsColumns).join(", ");
 const QString Song::kFtsUpdateSpec = Utilities::Updateify(Song::kFtsColumns).join(", ");
+const QString Song::kFtsSourceColumnSpec = "title, album, artist, albumartist, composer, performer, grouping, genre, comment";
 
 const QString Song::kManuallyUnsetCover = "(unset)";
 const QString Song::kEmbeddedCover = "(embedded)";
@@ -152,6 +153,7 @@ const QString Song::kEmbeddedCover = "(embedded)";
 const QRegularExpression Song::kAlbumRemoveDisc(" ?-? ((\\(|\\[)?)(Disc|CD) ?([0-9]{1,2})((\\)|\\])?)$");
 const QRegularExpression Song::kAlbumRemoveMisc(" ?-? ((\\(|\\[)?)(Remastered|([0-9]{1,4}) *Remaster) ?((\\)|\\])?)$");
 const QRegularExpression Song::kTitleRemoveMisc(" ?-? ((\\(|\\[)?)(Remastered|Live|Remastered Version|([0-9]{1,4}) *Remaster) ?((\\)|\\])?)$");
+const QRegularExpression Song::kUrlWithScheme("..+:.*");
 const QString Song::kVariousArtists("various artists");
 
 const QStringList Song::kArticles = QStringList() << "the " << "a " << "an ";
@@ -830,183 +832,184 @@ void Song::ToProtobuf(pb::tagreader::SongMetadata *pb) const {
 
 }
 
-#define tostr(n) (q.value(n).isNull() ? QString() : q.value(n).toString())
-#define toint(n) (q.value(n).isNull() ? -1 : q.value(n).toInt())
-#define tolonglong(n) (q.value(n).isNull() ? -1 : q.value(n).toLongLong())
-#define tofloat(n) (q.value(n).isNull() ? -1 : q.value(n).toDouble())
+// Each value is fetched from the row once, with a query cursor every fetch goes to the driver.
+#define tostr(v) (v.isNull() ? QString() : v.toString())
+#define toint(v) (v.isNull() ? -1 : v.toInt())
+#define tolonglong(v) (v.isNull() ? -1 : v.toLongLong())
+#define tofloat(v) (v.isNull() ? -1 : v.toDouble())
 
-void Song::InitFromQuery(const SqlRow &q, bool reliable_metadata, int col) {
+template<typename T>
+void Song::InitFromRow(const T &q, const bool reliable_metadata, const int col) {
 
-  //qLog(Debug) << "Song::kColumns.size():" << Song::kColumns.size() << "q.columns_.size():" << q.columns_.size() << "col:" << col;
+  //qLog(Debug) << "Song::kColumns.size():" << Song::kColumns.size() << "q.columns():" << q.columns() << "col:" << col;
 
-  int x = col;
-  d->id_ = toint(col);
+  Q_ASSERT(Song::kColumns.size() == ColumnCount);
+
+  const int columns = q.columns();
+  const QVariant id = q.value(col);
+  d->id_ = toint(id);
 
-  for (int i = 0 ; i < Song::kColumns.size(); i++) {
+  int x = col;
+  for (int i = 0 ; i < ColumnCount; i++) {
     x++;
 
-    if (x >= q.columns_.size()) {
+    if (x >= columns) {
       qLog(Error) << "Skipping" << Song::kColumns.value(i);
       break;
     }
 
-    //qLog(Debug) << "Index:" << i << x << Song::kColumns.value(i) << q.value(x).toString();
-
-    if (Song::kColumns.value(i) == "title") {
-      set_title(tostr(x));
-    }
-    else if (Song::kColumns.value(i) == "album") {
-      set_album(tostr(x));
-    }
-    else if (Song::kColumns.value(i) == "artist") {
-      set_artist(tostr(x));
-    }
-    else if (Song::kColumns.value(i) == "albumartist") {
-      set_albumartist(tostr(x));
-    }
-    else if (Song::kColumns.value(i) == "track") {
-      d->track_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "disc") {
-      d->disc_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "year") {
-      d->year_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "originalyear") {
-      d->originalyear_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "genre") {
-      d->genre_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "compilation") {
-      d->compilation_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "composer") {
-      d->composer_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "performer") {
-      d->performer_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "grouping") {
-      d->grouping_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "comment") {
-      d->comment_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "lyrics") {
-      d->lyrics_ = tostr(x);
-    }
-
-    else if (Song::kColumns.value(i) == "artist_id") {
-      d->artist_id_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "album_id") {
-      d->album_id_ = tostr(x);
-    }
-    else if (Song::kColumns.value(i) == "song_id") {
-      d->song_id_ = tostr(x);
-    }
-
-    else if (Song::kColumns.value(i) == "beginning") {
-      d->beginning_ = q.value(x).isNull() ? 0 : q.value(x).toLongLong();
-    }
-    else if (Song::kColumns.value(i) == "length") {
-      set_length_nanosec(tolonglong(x));
-    }
-
-    else if (Song::kColumns.value(i) == "bitrate") {
-      d->bitrate_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "samplerate") {
-      d->samplerate_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "bitdepth") {
-      d->bitdepth_ = toint(x);
-    }
-
-    else if (Song::kColumns.value(i) == "source") {
-      d->source_ = Source(q.value(x).toInt());
-    }
-    else if (Song::kColumns.value(i) == "directory_id") {
-      d->directory_id_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "url") {
-     set_url(QUrl::fromEncoded(tostr(x).toUtf8()));
-     d->basefilename_ = QFileInfo(d->url_.toLocalFile()).fileName();
-    }
-    else if (Song::kColumns.value(i) == "filetype") {
-      d->filetype_ = FileType(q.value(x).toInt());
-    }
-    else if (Song::kColumns.value(i) == "filesize") {
-      d->filesize_ = toint(x);
-    }
-    else if (Song::kColumns.value(i) == "mtime") {
-      d->mtime_ = tolonglong(x);
-    }
-    else if (Song::kColumns.value(i) == "ctime") {
-      d->ctime_ = tolonglong(x);
-    }
-    else if (Song::kColumns.value(i) == "unavailable") {
-      d->unavailable_ = q.value(x).toBool();
-    }
+    const QVariant value = q.value(x);
 
-    else if (Song::kColumns.value(i) == "playcount") {
-      d->playcount_ = q.value(x).isNull() ? 0 : q.value(x).toInt();
-    }
-    else if (Song::kColumns.value(i) == "skipcount") {
-      d->skipcount_ = q.value(x).isNull() ? 0 : q.value(x).toInt();
-    }
-    else if (Song::kColumns.value(i) == "lastplayed") {
-      d->lastplayed_ = toint(x);
-    }
-
-    else if (Song::kColumns.value(i) == "compilation_detected") {
-      d->compilation_detected_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_on") {
-      d->compilation_on_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_off") {
-      d->compilation_off_ = q.value(x).toBool();
-    }
-    else if (Song::kColumns.value(i) == "compilation_effective") {
-    }
+    //qLog(Debug) << "Index:" << i << x << Song::kColumns.value(i) << value.toString();
 
-    else if (Song::kColumns.value(i) == "art_automatic") {
-      QString art_automatic = tostr(x);
-      if (art_automatic.contains(QRegularExpression("..+:.*"))) {
-        set_art_automatic(QUrl::fromEncoded(art_automatic.toUtf8()));
-      }
-      else {
-        set_art_automatic(QUrl::fromLocalFile(art_automatic));
-      }
-    }
-    else if (Song::kColumns.value(i) == "art_manual") {
-      QString art_manual = tostr(x);
-      if (art_manual.contains(QRegularExpression("..+:.*"))) {
-        set_art_manual(QUrl::fromEncoded(art_manual.toUtf8()));
+    switch (i) {
+      case Column_Title:
+        set_title(tostr(value));
+        break;
+      case Column_Album:
+        set_album(tostr(value));
+        break;
+      case Column_Artist:
+        set_artist(tostr(value));
+        break;
+      case Column_AlbumArtist:
+        set_albumartist(tostr(value));
+        break;
+      case Column_Track:
+        d->track_ = toint(value);
+        break;
+      case Column_Disc:
+        d->disc_ = toint(value);
+        break;
+      case Column_Year:
+        d->year_ = toint(value);
+        break;
+      case Column_OriginalYear:
+        d->originalyear_ = toint(value);
+        break;
+      case Column_Genre:
+        d->genre_ = tostr(value);
+        break;
+      case Column_Compilation:
+        d->compilation_ = value.toBool();
+        break;
+      case Column_Composer:
+        d->composer_ = tostr(value);
+        break;
+      case Column_Performer:
+        d->performer_ = tostr(value);
+        break;
+      case Column_Grouping:
+        d->grouping_ = tostr(value);
+        break;
+      case Column_Comment:
+        d->comment_ = tostr(value);
+        break;
+      case Column_Lyrics:
+        d->lyrics_ = tostr(value);
+        break;
+      case Column_ArtistId:
+        d->artist_id_ = tostr(value);
+        break;
+      case Column_AlbumId:
+        d->album_id_ = tostr(value);
+        break;
+      case Column_SongId:
+        d->song_id_ = tostr(value);
+        break;
+      case Column_Beginning:
+        d->beginning_ = value.isNull() ? 0 : value.toLongLong();
+        break;
+      case Column_Length:
+        set_length_nanosec(tolonglong(value));
+        break;
+      case Column_BitRate:
+        d->bitrate_ = toint(value);
+        break;
+      case Column_SampleRate:
+        d->samplerate_ = toint(value);
+        break;
+      case Column_BitDepth:
+        d->bitdepth_ = toint(value);
+        break;
+      case Column_Source:
+        d->source_ = Source(value.toInt());
+        break;
+      case Column_DirectoryId:
+        d->directory_id_ = toint(value);
+        break;
+      case Column_Url:
+        set_url(QUrl::fromEncoded(tostr(value).toUtf8()));
+        d->basefilename_ = QFileInfo(d->url_.toLocalFile()).fileName();
+        break;
+      case Column_FileType:
+        d->filetype_ = FileType(value.toInt());
+        break;
+      case Column_FileSize:
+        d->filesize_ = toint(value);
+        break;
+      case Column_MTime:
+        d->mtime_ = tolonglong(value);
+        break;
+      case Column_CTime:
+        d->ctime_ = tolonglong(value);
+        break;
+      case Column_Unavailable:
+        d->unavailable_ = value.toBool();
+        break;
+      case Column_PlayCount:
+        d->playcount_ = value.isNull() ? 0 : value.toInt();
+        break;
+      case Column_SkipCount:
+        d->skipcount_ = value.isNull() ? 0 : value.toInt();
+        break;
+      case Column_LastPlayed:
+        d->lastplayed_ = toint(value);
+        break;
+      case Column_CompilationDetected:
+        d->compilation_detected_ = value.toBool();
+        break;
+      case Column_CompilationOn:
+        d->compilation_on_ = value.toBool();
+        break;
+      case Column_CompilationOff:
+        d->compilation_off_ = value.toBool();
+        break;
+      case Column_CompilationEffective:
+        break;
+      case Column_ArtAutomatic: {
+        QString art_automatic = tostr(value);
+        if (art_automatic.contains(kUrlWithScheme)) {
+          set_art_automatic(QUrl::fromEncoded(art_automatic.toUtf8()));
+        }
+        else {
+          set_art_automatic(QUrl::fromLocalFile(art_automatic));
+        }
+        break;
       }
-      else {
-        set_art_manual(QUrl::fromLocalFile(art_manual));
+      case Column_ArtManual: {
+        QString art_manual = tostr(value);
+        if (art_manual.contains(kUrlWithScheme)) {
+          set_art_manual(QUrl::fromEncoded(art_manual.toUtf8()));
+        }
+        else {
+          set_art_manual(QUrl::fromLocalFile(art_manual));
+        }
+        break;
       }
-    }
-
-    else if (Song::kColumns.value(i) == "effective_albumartist") {
-    }
-    else if (Song::kColumns.value(i) == "effective_originalyear") {
-    }
-
-    else if (Song::kColumns.value(i) == "cue_path") {
-      d->cue_path_ = tostr(x);
-    }
-
-    else if (Song::kColumns.value(i) == "rating") {
-      d->rating_ = tofloat(x);
-    }
-
-    else {
-      qLog(Error) << "Forgot to handle" << Song::kColumns.value(i);
+      case Column_EffectiveAlbumArtist:
+        break;
+      case Column_EffectiveOriginalYear:
+        break;
+      case Column_CuePath:
+        d->cue_path_ = tostr(value);
+        break;
+      case Column_Rating:
+        d->rating_ = tofloat(value);
+        break;
+      default:
+        qLog(Error) << "Forgot to handle" << Song::kColumns.value(i);
+        break;
     }
   }
 
@@ -1022,6 +1025,14 @@ void Song::InitFromQuery(const SqlRow &q, bool reliable_metadata, int col) {
 
 }
 
+void Song::InitFromQuery(const SqlRow &query, bool reliable_metadata, int col) {
+  InitFromRow(query, reliable_metadata, col);
+}
+
+void Song::InitFromQuery(const SqlQueryCursor &query, bool reliable_metadata, int col) {
+  InitFromRow(query, reliable_metadata, col);
+}
+
 void Song::InitFromFilePartial(const QString &filename) {
 
   set_url(QUrl::fromLocalFile(filename));
@@ -1307,73 +1318,96 @@ bool Song::MergeFromSimpleMetaBundle(const Engine::SimpleMetaBundle &bundle) {
 
 }
 
-void Song::BindToQuery(QSqlQuery *query) const {
+QVariantList Song::BindValues() const {
 
 #define strval(x) ((x).isNull() ? "" : (x))
 #define intval(x) ((x) <= 0 ? -1 : (x))
 #define notnullintval(x) ((x) == -1 ? QVariant() : (x))
 
-  // Remember to bind these in the same order as kBindSpec
-
-  query->bindValue(":title", strval(d->title_));
-  query->bindValue(":album", strval(d->album_));
-  query->bindValue(":artist", strval(d->artist_));
-  query->bindValue(":albumartist", strval(d->albumartist_));
-  query->bindValue(":track", intval(d->track_));
-  query->bindValue(":disc", intval(d->disc_));
-  query->bindValue(":year", intval(d->year_));
-  query->bindValue(":originalyear", intval(d->originalyear_));
-  query->bindValue(":genre", strval(d->genre_));
-  query->bindValue(":compilation", d->compilation_ ? 1 : 0);
-  query->bindValue(":composer", strval(d->composer_));
-  query->bindValue(":performer", strval(d->performer_));
-  query->bindValue(":grouping", strval(d->grouping_));
-  query->bindValue(":comment", strval(d->comment_));
-  query->bindValue(":lyrics", strval(d->lyrics_));
-
-  query->bindValue(":artist_id", strval(d->artist_id_));
-  query->bindValue(":album_id", strval(d->album_id_));
-  query->bindValue(":song_id", strval(d->song_id_));
-
-  query->bindValue(":beginning", d->beginning_);
-  query->bindValue(":length", intval(length_nanosec()));
-
-  query->bindValue(":bitrate", intval(d->bitrate_));
-  query->bindValue(":samplerate", intval(d->samplerate_));
-  query->bindValue(":bitdepth", intval(d->bitdepth_));
-
-  query->bindValue(":source", d->source_);
-  query->bindValue(":directory_id", notnullintval(d->directory_id_));
-  query->bindValue(":url", d->url_.toString(QUrl::FullyEncoded));
-  query->bindValue(":filetype", d->filetype_);
-  query->bindValue(":filesize", notnullintval(d->filesize_));
-  query->bindValue(":mtime", notnullintval(d->mtime_));
-  query->bindValue(":ctime", notnullintval(d->ctime_));
-  query->bindValue(":unavailable", d->unavailable_ ? 1 : 0);
-
-  query->bindValue(":playcount", d->playcount_);
-  query->bindValue(":skipcount", d->skipcount_);
-  query->bindValue(":lastplayed", intval(d->lastplayed_));
-
-  query->bindValue(":compilation_detected", d->compilation_detected_ ? 1 : 0);
-  query->bindValue(":compilation_on", d->compilation_on_ ? 1 : 0);
-  query->bindValue(":compilation_off", d->compilation_off_ ? 1 : 0);
-  query->bindValue(":compilation_effective", is_compilation() ? 1 : 0);
-
-  query->bindValue(":art_automatic", d->art_automatic_.toString(QUrl::FullyEncoded));
-  query->bindValue(":art_manual", d->art_manual_.toString(QUrl::FullyEncoded));
-
-  query->bindValue(":effective_albumartist", strval(this->effective_albumartist()));
-  query->bindValue(":effective_originalyear", intval(this->effective_originalyear()));
-
-  query->bindValue(":cue_path", d->cue_path_);
-
-  query->bindValue(":rating", intval(d->rating_));
+  // Remember to add these in the same order as kColumns
+  QVariantList values;
+  values.reserve(ColumnCount);
+  values << strval(d->title_);
+  values << strval(d->album_);
+  values << strval(d->artist_);
+  values << strval(d->albumartist_);
+  values << intval(d->track_);
+  values << intval(d->disc_);
+  values << intval(d->year_);
+  values << intval(d->originalyear_);
+  values << strval(d->genre_);
+  values << (d->compilation_ ? 1 : 0);
+  values << strval(d->composer_);
+  values << strval(d->performer_);
+  values << strval(d->grouping_);
+  values << strval(d->comment_);
+  values << strval(d->lyrics_);
+
+  values << strval(d->artist_id_);
+  values << strval(d->album_id_);
+  values << strval(d->song_id_);
+
+  values << d->beginning_;
+  values << intval(length_nanosec());
+
+  values << intval(d->bitrate_);
+  values << intval(d->samplerate_);
+  values << intval(d->bitdepth_);
+
+  values << d->source_;
+  values << notnullintval(d->directory_id_);
+  values << d->url_.toString(QUrl::FullyEncoded);
+  values << d->filetype_;
+  values << notnullintval(d->filesize_);
+  values << notnullintval(d->mtime_);
+  values << notnullintval(d->ctime_);
+  values << (d->unavailable_ ? 1 : 0);
+
+  values << d->playcount_;
+  values << d->skipcount_;
+  values << intval(d->lastplayed_);
+
+  values << (d->compilation_detected_ ? 1 : 0);
+  values << (d->compilation_on_ ? 1 : 0);
+  values << (d->compilation_off_ ? 1 : 0);
+  values << (is_compilation() ? 1 : 0);
+
+  values << d->art_automatic_.toString(QUrl::FullyEncoded);
+  values << d->art_manual_.toString(QUrl::FullyEncoded);
+
+  values << strval(this->effective_albumartist());
+  values << intval(this->effective_originalyear());
+
+  values << d->cue_path_;
+
+  values << intval(d->rating_);
 
 #undef intval
 #undef notnullintval
 #undef strval
 
+  return values;
+
+}
+
+void Song::BindToQuery(QSqlQuery *query) const {
+
+  static const QStringList bind_names = Utilities::Prepend(":", kColumns);
+
+  const QVariantList values = BindValues();
+  for (int i = 0; i < ColumnCount; ++i) {
+    query->bindValue(bind_names[i], values[i]);
+  }
+
+}
+
+void Song::AddBindValues(QSqlQuery *query) const {
+
+  const QVariantList values = BindValues();
+  for (const QVariant &value : values) {
+    query->addBindValue(value);
+  }
+
 }
 
 void Song::BindToFtsQuery(QSqlQuery *query) const {
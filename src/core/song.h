@@ -59,6 +59,7 @@ struct LIBMTP_track_struct;
 #endif
 
 class SqlRow;
+class SqlQueryCursor;
 
 class Song {
 
@@ -106,6 +107,56 @@ class Song {
   Song(const Song &other);
   ~Song();
 
+  // Position of each column in kColumns, so query results can be read by index instead of by name.
+  // Must be kept in the same order as kColumns.
+  enum Column {
+    Column_Title = 0,
+    Column_Album,
+    Column_Artist,
+    Column_AlbumArtist,
+    Column_Track,
+    Column_Disc,
+    Column_Year,
+    Column_OriginalYear,
+    Column_Genre,
+    Column_Compilation,
+    Column_Composer,
+    Column_Performer,
+    Column_Grouping,
+    Column_Comment,
+    Column_Lyrics,
+    Column_ArtistId,
+    Column_AlbumId,
+    Column_SongId,
+    Column_Beginning,
+    Column_Length,
+    Column_BitRate,
+    Column_SampleRate,
+    Column_BitDepth,
+    Column_Source,
+    Column_DirectoryId,
+    Column_Url,
+    Column_FileType,
+    Column_FileSize,
+    Column_MTime,
+    Column_CTime,
+    Column_Unavailable,
+    Column_PlayCount,
+    Column_SkipCount,
+    Column_LastPlayed,
+    Column_CompilationDetected,
+    Column_CompilationOn,
+    Column_CompilationOff,
+    Column_CompilationEffective,
+    Column_ArtAutomatic,
+    Column_ArtManual,
+    Column_EffectiveAlbumArtist,
+    Column_EffectiveOriginalYear,
+    Column_CuePath,
+    Column_Rating,
+    ColumnCount
+  };
+
   static const QStringList kColumns;
   static const QString kColumnSpec;
   static const QString kBindSpec;
@@ -115,6 +166,8 @@ class Song {
   static const QString kFtsColumnSpec;
   static const QString kFtsBindSpec;
   static const QString kFtsUpdateSpec;
+  // Columns of the songs table that fill kFtsColumns, in the same order.
+  static const QString kFtsSourceColumnSpec;
 
   static const QString kManuallyUnsetCover;
   static const QString kEmbeddedCover;
@@ -122,6 +175,7 @@ class Song {
   static const QRegularExpression kAlbumRemoveDisc;
   static const QRegularExpression kAlbumRemoveMisc;
   static const QRegularExpression kTitleRemoveMisc;
+  static const QRegularExpression kUrlWithScheme;
 
   static const QString kVariousArtists;
 
@@ -157,6 +211,7 @@ class Song {
   void Init(const QString &title, const QString &artist, const QString &album, qint64 beginning, qint64 end);
   void InitFromProtobuf(const pb::tagreader::SongMetadata &pb);
   void InitFromQuery(const SqlRow &query, bool reliable_metadata, int col = 0);
+  void InitFromQuery(const SqlQueryCursor &query, bool reliable_metadata, int col = 0);
   void InitFromFilePartial(const QString &filename);  // Just store the filename: incomplete but fast
   void InitArtManual();  // Check if there is already a art in the cache and store the filename in art_manual
 
@@ -178,6 +233,8 @@ class Song {
 
   // Save
   void BindToQuery(QSqlQuery *query) const;
+  // Adds the values for kColumns as positional bind values, for statements with several rows.
+  void AddBindValues(QSqlQuery *query) const;
   void BindToFtsQuery(QSqlQuery *query) const;
   void ToXesam(QVariantMap *map) const;
   void ToProtobuf(pb::tagreader::SongMetadata *pb) const;
@@ -371,6 +428,11 @@ class Song {
 
   QString sortable(const QString &v) const;
 
+  QVariantList BindValues() const;
+
+  template<typename T>
+  void InitFromRow(const T &q, const bool reliable_metadata, const int col);
+
   QSharedDataPointer<Private> d;
 };
 Q_DECLARE_METATYPE(Song)
@@ -69,6 +69,7 @@ using std::placeholders::_1;
 
 QSet<QString> SongLoader::sRawUriSchemes;
 const int SongLoader::kDefaultTimeout = 5000;
+const int SongLoader::kReadFilesBatchSize = 50;
 
 SongLoader::SongLoader(CollectionBackendInterface *collection, const Player *player, QObject *parent) :
       QObject(parent),
@@ -306,9 +307,41 @@ SongLoader::Result SongLoader::LoadLocalAsync(const QString &filename) {
 }
 
 void SongLoader::LoadMetadataBlocking() {
+
+  QList<int> song_indexes;
+  QStringList filenames;
   for (int i = 0; i < songs_.size(); i++) {
-    EffectiveSongLoad(&songs_[i]);
+    Song *song = &songs_[i];
+    if (song->filetype() != Song::FileType_Unknown) continue;
+
+    Song collection_song = collection_->GetSongByUrl(song->url());
+    if (collection_song.is_valid()) {
+      *song = collection_song;
+    }
+    else {
+      song_indexes << i;
+      filenames << song->url().toLocalFile();
+    }
+  }
+
+  // Send all requests before waiting for any of them, so the files are read by all tagreader workers at the same time.
+  QList<TagReaderReply*> replies;
+  for (int i = 0; i < filenames.count(); i += kReadFilesBatchSize) {
+    replies << TagReaderClient::Instance()->ReadFiles(filenames.mid(i, kReadFilesBatchSize));
   }
+
+  for (int i = 0; i < replies.count(); ++i) {
+    TagReaderReply *reply = replies[i];
+    reply->WaitForFinished();
+    for (const pb::tagreader::Message &message : reply->TakePartialReplies()) {
+      const int index = i * kReadFilesBatchSize + message.read_files_response().index();
+      if (index >= 0 && index < song_indexes.count()) {
+        songs_[song_indexes[index]].InitFromProtobuf(message.read_files_response().metadata());
+      }
+    }
+    reply->deleteLater();
+  }
+
 }
 
 void SongLoader::EffectiveSongLoad(Song *song) {
@@ -67,6 +67,7 @@ class SongLoader : public QObject {
   };
 
   static const int kDefaultTimeout;
+  static const int kReadFilesBatchSize;
 
   const QUrl &url() const { return url_; }
   const SongList &songs() const { return songs_; }
@@ -28,11 +28,16 @@
 #include <QThread>
 #include <QByteArray>
 #include <QString>
+#include <QStringList>
 #include <QImage>
+#include <QStorageInfo>
+#include <QSettings>
 #include <QtDebug>
 
 #include "core/logging.h"
 #include "core/workerpool.h"
+#include "core/sharedmemorybuffer.h"
+#include "settings/collectionsettingspage.h"
 
 #include "song.h"
 #include "tagreaderclient.h"
@@ -45,13 +50,27 @@ TagReaderClient::TagReaderClient(QObject *parent) : QObject(parent), worker_pool
   sInstance = this;
   original_thread_ = thread();
 
+  // The pool can't get smaller once the workers are started, so begin with the configured count.
+  // The count for local storage is the lowest automatic one, directories on network storage add workers later.
+  QSettings s;
+  s.beginGroup(CollectionSettingsPage::kSettingsGroup);
+  const int configured_workers = s.value("tagreader_workers", 0).toInt();
+  s.endGroup();
+
   worker_pool_->SetExecutableName(kWorkerExecutableName);
-  worker_pool_->SetWorkerCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+  worker_pool_->SetWorkerCount(WorkerCount(false, configured_workers));
   connect(worker_pool_, SIGNAL(WorkerFailedToStart()), SLOT(WorkerFailedToStart()));
 
 }
 
-void TagReaderClient::Start() { worker_pool_->Start(); }
+void TagReaderClient::Start() {
+
+  // Remove the shared memory of workers that crashed before their replies were read.
+  SharedMemoryBuffer::RemoveStale();
+
+  worker_pool_->Start();
+
+}
 
 void TagReaderClient::ExitAsync() {
   metaObject()->invokeMethod(this, "Exit", Qt::QueuedConnection);
@@ -65,6 +84,59 @@ void TagReaderClient::Exit() {
 
 }
 
+int TagReaderClient::WorkerCount(const bool network_storage, const int configured_workers) {
+
+  if (configured_workers > 0) return configured_workers;
+
+  // Tag reading on local disks is mostly CPU bound, but too many processes only add seeks on spinning disks.
+  // On network filesystems the processes spend most of their time waiting, so use more of them.
+  const int cores = QThread::idealThreadCount();
+  if (network_storage) {
+    return qBound(2, cores, 16);
+  }
+  return qBound(1, cores / 2, 8);
+
+}
+
+bool TagReaderClient::IsNetworkStorage(const QString &path) {
+
+  static const QStringList kNetworkFileSystems = QStringList() << "nfs" << "nfs4" << "cifs" << "smbfs" << "smb3" << "afpfs" << "webdav" << "davfs" << "fuse.sshfs" << "9p" << "afs";
+
+  const QStorageInfo storage(path);
+  if (!storage.isValid()) return false;
+
+  return kNetworkFileSystems.contains(QString::fromUtf8(storage.fileSystemType()).toLower());
+
+}
+
+void TagReaderClient::AddStoragePath(const QString &path, const int configured_workers) {
+
+  const bool network_storage = IsNetworkStorage(path);
+  if (network_storage) {
+    qLog(Debug) << path << "is on network storage";
+  }
+
+  // The pool only adds workers if there are fewer, a lower configured count is used the next time Strawberry starts.
+  worker_pool_->SetWorkerCount(WorkerCount(network_storage, configured_workers));
+
+}
+
+void TagReaderClient::LogWorkerStatistics() const {
+
+  const QList<WorkerStatistics> statistics = worker_pool_->Statistics();
+  for (int i = 0; i < statistics.count(); ++i) {
+    const WorkerStatistics &worker = statistics[i];
+    qLog(Debug) << "Tagreader worker" << i
+                << "queue depth" << worker.queue_depth
+                << "in flight" << worker.in_flight
+                << "finished" << worker.requests_finished
+                << "stolen" << worker.requests_stolen
+                << "average latency" << (worker.requests_finished > 0 ? worker.total_latency_msec / worker.requests_finished : 0) << "ms"
+                << "max latency" << worker.max_latency_msec << "ms";
+  }
+
+}
+
 void TagReaderClient::WorkerFailedToStart() {
   qLog(Error) << "The" << kWorkerExecutableName << "executable was not found in the current directory or on the PATH.  Strawberry will not be able to read music file tags without it.";
 }
@@ -80,6 +152,19 @@ TagReaderReply *TagReaderClient::ReadFile(const QString &filename) {
 
 }
 
+TagReaderReply *TagReaderClient::ReadFiles(const QStringList &filenames) {
+
+  pb::tagreader::Message message;
+  pb::tagreader::ReadFilesRequest *req = message.mutable_read_files_request();
+
+  for (const QString &filename : filenames) {
+    req->add_filenames(DataCommaSizeFromQString(filename));
+  }
+
+  return worker_pool_->SendMessageWithReply(&message);
+
+}
+
 TagReaderReply *TagReaderClient::SaveFile(const QString &filename, const Song &metadata) {
 
   pb::tagreader::Message message;
@@ -105,12 +190,13 @@ TagReaderReply *TagReaderClient::IsMediaFile(const QString &filename) {
 
 }
 
-TagReaderReply *TagReaderClient::LoadEmbeddedArt(const QString &filename) {
+TagReaderReply *TagReaderClient::LoadEmbeddedArt(const QString &filename, const bool allow_shared_memory) {
 
   pb::tagreader::Message message;
   pb::tagreader::LoadEmbeddedArtRequest *req = message.mutable_load_embedded_art_request();
 
   req->set_filename(DataCommaSizeFromQString(filename));
+  if (allow_shared_memory && SharedMemoryBuffer::IsSupported()) req->set_allow_shared_memory(true);
 
   return worker_pool_->SendMessageWithReply(&message);
 
@@ -166,10 +252,21 @@ QImage TagReaderClient::LoadEmbeddedArtBlocking(const QString &filename) {
 
   QImage ret;
 
-  TagReaderReply *reply = LoadEmbeddedArt(filename);
+  TagReaderReply *reply = LoadEmbeddedArt(filename, true);
   if (reply->WaitForFinished()) {
-    const std::string &data_str = reply->message().load_embedded_art_response().data();
-    ret.loadFromData(QByteArray(data_str.data(), data_str.size()));
+    const pb::tagreader::LoadEmbeddedArtResponse &response = reply->message().load_embedded_art_response();
+    if (response.has_shared_memory_name()) {
+      // Decode straight from the worker's shared memory, without copying the image data.
+      // Open() removes the name even if it fails, so nothing is left behind.
+      SharedMemoryBuffer buffer;
+      if (buffer.Open(QStringFromStdString(response.shared_memory_name()), response.shared_memory_size())) {
+        ret.loadFromData(buffer.data(), static_cast<int>(buffer.size()));
+      }
+    }
+    else {
+      const std::string &data_str = response.data();
+      ret.loadFromData(reinterpret_cast<const uchar*>(data_str.data()), static_cast<int>(data_str.size()));
+    }
   }
   reply->deleteLater();
 
@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QList>
 #include <QString>
+#include <QStringList>
 #include <QImage>
 
 #include "core/messagehandler.h"
@@ -46,16 +47,28 @@ class TagReaderClient : public QObject {
 
   typedef AbstractMessageHandler<pb::tagreader::Message> HandlerType;
   typedef HandlerType::ReplyType ReplyType;
+  typedef WorkerPool<HandlerType>::WorkerStatistics WorkerStatistics;
 
   static const char *kWorkerExecutableName;
 
   void Start();
   void ExitAsync();
 
+  // Adds workers if the path is on storage that benefits from more parallel reads than the current worker count.
+  // Network filesystems are latency bound, so they get more workers than local disks.
+  // configured_workers is the number of workers set in the collection settings, or 0 to choose it from the number of cores.
+  void AddStoragePath(const QString &path, const int configured_workers);
+
+  void LogWorkerStatistics() const;
+
   ReplyType *ReadFile(const QString &filename);
+  // Reads many files with one request.  A partial reply with a ReadFilesResponse is streamed back for each file as soon as it's read,
+  // connect to the reply's PartialReplyArrived() signal and use TakePartialReplies() to get them.  Finished() is emitted after the last one.
+  ReplyType *ReadFiles(const QStringList &filenames);
   ReplyType *SaveFile(const QString &filename, const Song &metadata);
   ReplyType *IsMediaFile(const QString &filename);
-  ReplyType *LoadEmbeddedArt(const QString &filename);
+  // With allow_shared_memory a large image can come back in shared memory, the caller has to open the buffer from the response, which removes it.
+  ReplyType *LoadEmbeddedArt(const QString &filename, const bool allow_shared_memory = false);
 
   // Convenience functions that call the above functions and wait for a response.
   // These block the calling thread with a semaphore, and must NOT be called from the TagReaderClient's thread.
@@ -75,6 +88,9 @@ class TagReaderClient : public QObject {
   void WorkerFailedToStart();
 
  private:
+  static int WorkerCount(const bool network_storage, const int configured_workers);
+  static bool IsNetworkStorage(const QString &path);
+
   static TagReaderClient *sInstance;
 
   WorkerPool<HandlerType> *worker_pool_;
@@ -26,6 +26,7 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 #include <memory>
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <string>
@@ -59,7 +60,6 @@
 #include "enginetype.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
-#include "gstbufferconsumer.h"
 
 const char *GstEngine::kAutoSink = "autoaudiosink";
 const char *GstEngine::kALSASink = "alsasink";
@@ -80,7 +80,6 @@ GstEngine::GstEngine(TaskManager *task_manager)
       gst_startup_(nullptr),
       discoverer_(nullptr),
       buffering_task_id_(-1),
-      latest_buffer_(nullptr),
       stereo_balancer_enabled_(false),
       stereo_balance_(0.0f),
       equalizer_enabled_(false),
@@ -90,8 +89,6 @@ GstEngine::GstEngine(TaskManager *task_manager)
       next_element_id_(0),
       is_fading_out_to_pause_(false),
       has_faded_out_(false),
-      scope_chunk_(0),
-      have_new_buffer_(false),
       discovery_finished_cb_id_(-1),
       discovery_discovered_cb_id_(-1)
       {
@@ -110,11 +107,6 @@ GstEngine::~GstEngine() {
   EnsureInitialized();
   current_pipeline_.reset();
 
-  if (latest_buffer_) {
-    gst_buffer_unref(latest_buffer_);
-    latest_buffer_ = nullptr;
-  }
-
   if (discoverer_) {
 
     if (discovery_discovered_cb_id_ != -1)
@@ -370,24 +362,14 @@ qint64 GstEngine::length_nanosec() const {
 
 const Engine::Scope &GstEngine::scope(const int chunk_length) {
 
-  // The new buffer could have a different size
-  if (have_new_buffer_) {
-    if (latest_buffer_) {
-      scope_chunks_ = ceil((static_cast<double>(GST_BUFFER_DURATION(latest_buffer_) / static_cast<double>(chunk_length * kNsecPerMsec))));
-    }
-
-    // if the buffer is shorter than the chunk length
-    if (scope_chunks_ <= 0) {
-      scope_chunks_ = 1;
-    }
-
-    scope_chunk_ = 0;
-    have_new_buffer_ = false;
-  }
+  Q_UNUSED(chunk_length);
 
-  if (latest_buffer_) {
-    UpdateScope(chunk_length);
+  // Read the samples that are playing now, the pipeline decodes ahead of the sink.
+  qint64 samples = 0;
+  if (current_pipeline_) {
+    samples = current_pipeline_->pcm_buffer().Read(current_pipeline_->position(), scope_.data(), scope_.size());
   }
+  std::fill(scope_.begin() + samples, scope_.end(), 0);
 
   return scope_;
 
@@ -465,16 +447,6 @@ GstElement *GstEngine::CreateElement(const QString &factoryName, GstElement *bin
   return element;
 }
 
-void GstEngine::ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format) {
-
-  // Schedule this to run in the GUI thread.  The buffer gets added to the queue and unreffed by UpdateScope.
-  if (!QMetaObject::invokeMethod(this, "AddBufferToScope", Q_ARG(GstBuffer*, buffer), Q_ARG(int, pipeline_id), Q_ARG(QString, format))) {
-    qLog(Warning) << "Failed to invoke AddBufferToScope on GstEngine";
-    gst_buffer_unref(buffer);
-  }
-
-}
-
 void GstEngine::SetStereoBalancerEnabled(const bool enabled) {
 
   stereo_balancer_enabled_ = enabled;
@@ -505,20 +477,6 @@ void GstEngine::SetEqualizerParameters(const int preamp, const QList<int> &band_
 
 }
 
-void GstEngine::AddBufferConsumer(GstBufferConsumer *consumer) {
-
-  buffer_consumers_ << consumer;
-  if (current_pipeline_) current_pipeline_->AddBufferConsumer(consumer);
-
-}
-
-void GstEngine::RemoveBufferConsumer(GstBufferConsumer *consumer) {
-
-  buffer_consumers_.removeAll(consumer);
-  if (current_pipeline_) current_pipeline_->RemoveBufferConsumer(consumer);
-
-}
-
 void GstEngine::timerEvent(QTimerEvent *e) {
 
   if (e->timerId() != timer_id_) return;
@@ -584,23 +542,6 @@ void GstEngine::NewMetaData(const int pipeline_id, const Engine::SimpleMetaBundl
 
 }
 
-void GstEngine::AddBufferToScope(GstBuffer *buf, const int pipeline_id, const QString &format) {
-
-  if (!current_pipeline_ || current_pipeline_->id() != pipeline_id) {
-    gst_buffer_unref(buf);
-    return;
-  }
-
-  if (latest_buffer_) {
-    gst_buffer_unref(latest_buffer_);
-  }
-
-  buffer_format_ = format;
-  latest_buffer_ = buf;
-  have_new_buffer_ = true;
-
-}
-
 void GstEngine::FadeoutFinished() {
   fadeout_pipeline_.reset();
   emit FadeoutFinishedSignal();
@@ -765,7 +706,6 @@ void GstEngine::StartFadeout() {
 
   fadeout_pipeline_ = current_pipeline_;
   disconnect(fadeout_pipeline_.get(), nullptr, nullptr, nullptr);
-  fadeout_pipeline_->RemoveAllBufferConsumers();
 
   fadeout_pipeline_->StartFader(fadeout_duration_nanosec_, QTimeLine::Backward);
   connect(fadeout_pipeline_.get(), SIGNAL(FaderFinished()), SLOT(FadeoutFinished()));
@@ -813,11 +753,6 @@ std::shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline() {
   ret->set_buffer_high_watermark(buffer_high_watermark_);
   ret->set_proxy_settings(proxy_address_, proxy_authentication_, proxy_user_, proxy_pass_);
 
-  ret->AddBufferConsumer(this);
-  for (GstBufferConsumer *consumer : buffer_consumers_) {
-    ret->AddBufferConsumer(consumer);
-  }
-
   connect(ret.get(), SIGNAL(EndOfStreamReached(int, bool)), SLOT(EndOfStreamReached(int, bool)));
   connect(ret.get(), SIGNAL(Error(int, QString, int, int)), SLOT(HandlePipelineError(int, QString, int, int)));
   connect(ret.get(), SIGNAL(MetadataFound(int, Engine::SimpleMetaBundle)), SLOT(NewMetaData(int, Engine::SimpleMetaBundle)));
@@ -837,67 +772,6 @@ std::shared_ptr<GstEnginePipeline> GstEngine::CreatePipeline(const QByteArray &g
 
 }
 
-void GstEngine::UpdateScope(const int chunk_length) {
-
-  typedef Engine::Scope::value_type sample_type;
-
-  // Prevent dbz or invalid chunk size
-  if (!GST_CLOCK_TIME_IS_VALID(GST_BUFFER_DURATION(latest_buffer_))) return;
-  if (GST_BUFFER_DURATION(latest_buffer_) == 0) return;
-
-  GstMapInfo map;
-  gst_buffer_map(latest_buffer_, &map, GST_MAP_READ);
-
-  // Determine where to split the buffer
-  int chunk_density = (map.size * kNsecPerMsec) / GST_BUFFER_DURATION(latest_buffer_);
-
-  int chunk_size = chunk_length * chunk_density;
-
-  // In case a buffer doesn't arrive in time
-  if (scope_chunk_ >= scope_chunks_) {
-    scope_chunk_ = 0;
-    gst_buffer_unmap(latest_buffer_, &map);
-    return;
-  }
-
-  const sample_type *source = reinterpret_cast<sample_type*>(map.data);
-  sample_type *dest = scope_.data();
-  source += (chunk_size / sizeof(sample_type)) * scope_chunk_;
-
-  int bytes = 0;
-
-  // Make sure we don't go beyond the end of the buffer
-  if (scope_chunk_ == scope_chunks_ - 1) {
-    bytes = qMin(static_cast<Engine::Scope::size_type>(map.size - (chunk_size  * scope_chunk_)), scope_.size() * sizeof(sample_type));
-  }
-  else {
-    bytes = qMin(static_cast<Engine::Scope::size_type>(chunk_size), scope_.size() * sizeof(sample_type));
-  }
-
-  scope_chunk_++;
-
-  if (buffer_format_.startsWith("S16LE") ||
-      buffer_format_.startsWith("U16LE") ||
-      buffer_format_.startsWith("S24LE") ||
-      buffer_format_.startsWith("S32LE") ||
-      buffer_format_.startsWith("F32LE")
-  ) {
-    memcpy(dest, source, bytes);
-  }
-  else {
-    memset(dest, 0, bytes);
-  }
-
-  gst_buffer_unmap(latest_buffer_, &map);
-
-  if (scope_chunk_ == scope_chunks_) {
-    gst_buffer_unref(latest_buffer_);
-    latest_buffer_ = nullptr;
-    buffer_format_.clear();
-  }
-
-}
-
 void GstEngine::StreamDiscovered(GstDiscoverer*, GstDiscovererInfo *info, GError*, gpointer self) {
 
   GstEngine *instance = reinterpret_cast<GstEngine*>(self);
@@ -42,7 +42,6 @@
 #include "engine_fwd.h"
 #include "enginebase.h"
 #include "gststartup.h"
-#include "gstbufferconsumer.h"
 
 class QTimer;
 class QTimerEvent;
@@ -54,7 +53,7 @@ class GstEnginePipeline;
  * @short GStreamer engine plugin
  * @author Mark Kretschmann <markey@web.de>
  */
-class GstEngine : public Engine::Base, public GstBufferConsumer {
+class GstEngine : public Engine::Base {
   Q_OBJECT
 
  public:
@@ -89,7 +88,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   void EnsureInitialized() { gst_startup_->EnsureInitialized(); }
 
   GstElement *CreateElement(const QString &factoryName, GstElement *bin = nullptr, const bool showerror = true);
-  void ConsumeBuffer(GstBuffer *buffer, const int pipeline_id, const QString &format) override;
 
  public slots:
   void ReloadSettings() override;
@@ -106,9 +104,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   // Set equalizer preamp and gains, range -100..100. Gains are 10 values.
   void SetEqualizerParameters(const int preamp, const QList<int> &band_gains) override;
 
-  void AddBufferConsumer(GstBufferConsumer *consumer);
-  void RemoveBufferConsumer(GstBufferConsumer *consumer);
-
  protected:
   void timerEvent(QTimerEvent *e) override;
 
@@ -116,7 +111,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   void EndOfStreamReached(const int pipeline_id, const bool has_next_track);
   void HandlePipelineError(const int pipeline_id, const QString &message, const int domain, const int error_code);
   void NewMetaData(const int pipeline_id, const Engine::SimpleMetaBundle &bundle);
-  void AddBufferToScope(GstBuffer *buf, const int pipeline_id, const QString &format);
   void FadeoutFinished();
   void FadeoutPauseFinished();
   void SeekNow();
@@ -139,8 +133,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   std::shared_ptr<GstEnginePipeline> CreatePipeline();
   std::shared_ptr<GstEnginePipeline> CreatePipeline(const QByteArray &gst_url, const QUrl &original_url, const qint64 end_nanosec);
 
-  void UpdateScope(int chunk_length);
-
   static void StreamDiscovered(GstDiscoverer*, GstDiscovererInfo *info, GError*, gpointer self);
   static void StreamDiscoveryFinished(GstDiscoverer*, gpointer);
   static QString GSTdiscovererErrorMessage(GstDiscovererResult result);
@@ -174,10 +166,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   std::shared_ptr<GstEnginePipeline> fadeout_pause_pipeline_;
   QUrl preloaded_url_;
 
-  QList<GstBufferConsumer*> buffer_consumers_;
-
-  GstBuffer *latest_buffer_;
-
   bool stereo_balancer_enabled_;
   float stereo_balance_;
 
@@ -199,11 +187,6 @@ class GstEngine : public Engine::Base, public GstBufferConsumer {
   bool is_fading_out_to_pause_;
   bool has_faded_out_;
 
-  int scope_chunk_;
-  bool have_new_buffer_;
-  int scope_chunks_;
-  QString buffer_format_;
-
   int discovery_finished_cb_id_;
   int discovery_discovered_cb_id_;
 
@@ -33,7 +33,6 @@
 #include <QObject>
 #include <QCoreApplication>
 #include <QtConcurrent>
-#include <QMutex>
 #include <QMetaType>
 #include <QByteArray>
 #include <QList>
@@ -54,8 +53,8 @@
 #include "enginebase.h"
 #include "gstengine.h"
 #include "gstenginepipeline.h"
-#include "gstbufferconsumer.h"
 #include "gstelementdeleter.h"
+#include "sampleconverter.h"
 
 const int GstEnginePipeline::kGstStateTimeoutNanosecs = 10000000;
 const int GstEnginePipeline::kFaderFudgeMsec = 2000;
@@ -111,7 +110,11 @@ GstEnginePipeline::GstEnginePipeline(GstEngine *engine)
       notify_source_cb_id_(-1),
       about_to_finish_cb_id_(-1),
       bus_cb_id_(-1),
-      unsupported_analyzer_(false)
+      unsupported_analyzer_(false),
+      buffer_format_received_(false),
+      buffer_sample_format_(SampleConverter::Format_Unknown),
+      buffer_rate_(0),
+      buffer_channels_(0)
       {
 
   if (!sElementDeleter) {
@@ -244,6 +247,7 @@ bool GstEnginePipeline::InitFromUrl(const QByteArray &stream_url, const QUrl ori
 bool GstEnginePipeline::InitAudioBin() {
 
   gst_segment_init(&last_playbin_segment_, GST_FORMAT_TIME);
+  gst_segment_init(&buffer_segment_, GST_FORMAT_TIME);
 
   // Audio bin
   audiobin_ = gst_bin_new("audiobin");
@@ -442,7 +446,7 @@ bool GstEnginePipeline::InitAudioBin() {
 
   // Add probes and handlers.
   pad = gst_element_get_static_pad(audioqueue_, "src");
-  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, HandoffCallback, this, nullptr);
+  gst_pad_add_probe(pad, static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM), HandoffCallback, this, nullptr);
   gst_object_unref(pad);
 
   GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline_));
@@ -603,108 +607,56 @@ GstPadProbeReturn GstEnginePipeline::HandoffCallback(GstPad *pad, GstPadProbeInf
 
   GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
 
-  GstCaps *caps = gst_pad_get_current_caps(pad);
-  GstStructure *structure = gst_caps_get_structure(caps, 0);
-  QString format = QString(gst_structure_get_string(structure, "format"));
-  int channels = 0;
-  int rate = 0;
-  gst_structure_get_int(structure, "channels", &channels);
-  gst_structure_get_int(structure, "rate", &rate);
-  gst_caps_unref(caps);
+  if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *e = gst_pad_probe_info_get_event(info);
+    switch (GST_EVENT_TYPE(e)) {
+      case GST_EVENT_CAPS:{
+        GstCaps *caps = nullptr;
+        gst_event_parse_caps(e, &caps);
+        instance->SetBufferFormat(caps);
+        break;
+      }
+      case GST_EVENT_SEGMENT:{
+        // Used to timestamp the samples in the PCM buffer with the stream time the pipeline position is in.
+        const GstSegment *segment = nullptr;
+        gst_event_parse_segment(e, &segment);
+        if (segment->format == GST_FORMAT_TIME) gst_segment_copy_into(segment, &instance->buffer_segment_);
+        break;
+      }
+      default:
+        break;
+    }
+    return GST_PAD_PROBE_OK;
+  }
+
+  // The caps were set before the probe was added.
+  if (!instance->buffer_format_received_) {
+    GstCaps *caps = gst_pad_get_current_caps(pad);
+    instance->SetBufferFormat(caps);
+    if (caps) gst_caps_unref(caps);
+  }
 
   GstBuffer *buf = gst_pad_probe_info_get_buffer(info);
-  GstBuffer *buf16 = nullptr;
 
   quint64 start_time = GST_BUFFER_TIMESTAMP(buf) - instance->segment_start_;
   quint64 duration = GST_BUFFER_DURATION(buf);
   qint64 end_time = start_time + duration;
 
-  if (format.startsWith("S16LE")) {
-    instance->unsupported_analyzer_ = false;
-  }
-  else if (format.startsWith("S32LE")) {
-
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
-
-    int32_t *s = reinterpret_cast<int32_t*>(map_info.data);
-    int samples = (map_info.size / sizeof(int32_t)) / channels;
-    int buf16_size = samples * sizeof(int16_t) * channels;
-    int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(d, 0, buf16_size);
-    for (int i = 0 ; i < (samples * channels) ; ++i) {
-      d[i] = static_cast<int16_t>((s[i] >> 16));
+  if (instance->buffer_sample_format_ == SampleConverter::Format_Unknown) {
+    if (!instance->unsupported_analyzer_) {
+      instance->unsupported_analyzer_ = true;
+      qLog(Debug) << "Unsupported audio format for the analyzer" << instance->buffer_format_;
     }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(d, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) * channels, rate);
-    buf = buf16;
-
-    instance->unsupported_analyzer_ = false;
   }
-
-  else if (format.startsWith("F32LE")) {
-
-    GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
-
-    float *s = reinterpret_cast<float*>(map_info.data);
-    int samples = (map_info.size / sizeof(float)) / channels;
-    int buf16_size = samples * sizeof(int16_t) * channels;
-    int16_t *d = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(d, 0, buf16_size);
-    for (int i = 0 ; i < (samples * channels) ; ++i) {
-      float sample_float = (s[i] * 32768.0);
-      d[i] = static_cast<int16_t>(sample_float);
-    }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(d, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) * channels, rate);
-    buf = buf16;
-
+  else if (GST_BUFFER_PTS_IS_VALID(buf)) {
     instance->unsupported_analyzer_ = false;
-  }
-  else if (format.startsWith("S24LE")) {
-
+    const guint64 stream_time = gst_segment_to_stream_time(&instance->buffer_segment_, GST_FORMAT_TIME, GST_BUFFER_PTS(buf));
     GstMapInfo map_info;
-    gst_buffer_map(buf, &map_info, GST_MAP_READ);
-
-    char *s24 = reinterpret_cast<char*>(map_info.data);
-    char *s24e = s24 + map_info.size;
-    int samples = (map_info.size / sizeof(char)) / channels;
-    int buf16_size = samples * sizeof(int16_t) * channels;
-    int16_t *s16 = static_cast<int16_t*>(g_malloc(buf16_size));
-    memset(s16, 0, buf16_size);
-    for (int i = 0 ; i < (samples * channels) ; ++i) {
-      s16[i] = *(reinterpret_cast<int16_t*>(s24+1));
-      s24 += 3;
-      if (s24 >= s24e) break;
+    if (GST_CLOCK_TIME_IS_VALID(stream_time) && gst_buffer_map(buf, &map_info, GST_MAP_READ)) {
+      const qint64 samples = SampleConverter::SampleCount(instance->buffer_sample_format_, map_info.size);
+      instance->pcm_buffer_.Write(instance->buffer_sample_format_, map_info.data, samples, static_cast<qint64>(stream_time), instance->buffer_rate_, instance->buffer_channels_);
+      gst_buffer_unmap(buf, &map_info);
     }
-    gst_buffer_unmap(buf, &map_info);
-    buf16 = gst_buffer_new_wrapped(s16, buf16_size);
-    GST_BUFFER_DURATION(buf16) = GST_FRAMES_TO_CLOCK_TIME(samples * sizeof(int16_t) * channels, rate);
-    buf = buf16;
-
-    instance->unsupported_analyzer_ = false;
-  }
-  else if (!instance->unsupported_analyzer_) {
-    instance->unsupported_analyzer_ = true;
-    qLog(Debug) << "Unsupported audio format for the analyzer" << format;
-  }
-
-  QList<GstBufferConsumer*> consumers;
-  {
-    QMutexLocker l(&instance->buffer_consumers_mutex_);
-    consumers = instance->buffer_consumers_;
-  }
-
-  for (GstBufferConsumer *consumer : consumers) {
-    gst_buffer_ref(buf);
-    consumer->ConsumeBuffer(buf, instance->id(), format);
-  }
-
-  if (buf16) {
-    gst_buffer_unref(buf16);
   }
 
   // Calculate the end time of this buffer so we can stop playback if it's after the end time of this song.
@@ -731,6 +683,22 @@ GstPadProbeReturn GstEnginePipeline::HandoffCallback(GstPad *pad, GstPadProbeInf
 
 }
 
+void GstEnginePipeline::SetBufferFormat(GstCaps *caps) {
+
+  buffer_format_received_ = true;
+  buffer_rate_ = 0;
+  buffer_channels_ = 0;
+
+  GstStructure *structure = caps ? gst_caps_get_structure(caps, 0) : nullptr;
+  buffer_format_ = structure ? QString(gst_structure_get_string(structure, "format")) : QString();
+  buffer_sample_format_ = SampleConverter::FormatFromString(buffer_format_);
+  if (structure) {
+    gst_structure_get_int(structure, "rate", &buffer_rate_);
+    gst_structure_get_int(structure, "channels", &buffer_channels_);
+  }
+
+}
+
 void GstEnginePipeline::AboutToFinishCallback(GstPlayBin*, gpointer self) {
 
   GstEnginePipeline *instance = reinterpret_cast<GstEnginePipeline*>(self);
@@ -1244,21 +1212,6 @@ void GstEnginePipeline::timerEvent(QTimerEvent *e) {
 
 }
 
-void GstEnginePipeline::AddBufferConsumer(GstBufferConsumer *consumer) {
-  QMutexLocker l(&buffer_consumers_mutex_);
-  buffer_consumers_ << consumer;
-}
-
-void GstEnginePipeline::RemoveBufferConsumer(GstBufferConsumer *consumer) {
-  QMutexLocker l(&buffer_consumers_mutex_);
-  buffer_consumers_.removeAll(consumer);
-}
-
-void GstEnginePipeline::RemoveAllBufferConsumers() {
-  QMutexLocker l(&buffer_consumers_mutex_);
-  buffer_consumers_.clear();
-}
-
 void GstEnginePipeline::SetNextUrl(const QByteArray &stream_url, const QUrl &original_url, const qint64 beginning_nanosec, const qint64 end_nanosec) {
 
   next_stream_url_ = stream_url;
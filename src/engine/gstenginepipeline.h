@@ -32,7 +32,6 @@
 
 #include <QtGlobal>
 #include <QObject>
-#include <QMutex>
 #include <QThreadPool>
 #include <QFuture>
 #include <QTimeLine>
@@ -44,9 +43,11 @@
 #include <QString>
 #include <QUrl>
 
+#include "sampleconverter.h"
+#include "pcmringbuffer.h"
+
 class QTimerEvent;
 class GstEngine;
-class GstBufferConsumer;
 class GstElementDeleter;
 
 namespace Engine {
@@ -78,11 +79,6 @@ class GstEnginePipeline : public QObject {
   // Creates the pipeline, returns false on error
   bool InitFromUrl(const QByteArray &stream_url, const QUrl original_url, const qint64 end_nanosec);
 
-  // GstBufferConsumers get fed audio data.  Thread-safe.
-  void AddBufferConsumer(GstBufferConsumer *consumer);
-  void RemoveBufferConsumer(GstBufferConsumer *consumer);
-  void RemoveAllBufferConsumers();
-
   // Control the music playback
   QFuture<GstStateChangeReturn> SetState(const GstState state);
   Q_INVOKABLE bool Seek(const qint64 nanosec);
@@ -113,6 +109,9 @@ class GstEnginePipeline : public QObject {
   GstState state() const;
   qint64 segment_start() const { return segment_start_; }
 
+  // The decoded audio, written by the streaming thread and timestamped with the stream time.  Thread-safe.
+  const PcmRingBuffer &pcm_buffer() const { return pcm_buffer_; }
+
   // Don't allow the user to change the playback state (playing/paused) while the pipeline is buffering.
   bool is_buffering() const { return buffering_; }
 
@@ -152,6 +151,8 @@ class GstEnginePipeline : public QObject {
   static gboolean BusCallback(GstBus*, GstMessage*, gpointer);
   static void TaskEnterCallback(GstTask*, GThread*, gpointer);
 
+  void SetBufferFormat(GstCaps *caps);
+
   void TagMessageReceived(GstMessage*);
   void ErrorMessageReceived(GstMessage*);
   void ElementMessageReceived(GstMessage*);
@@ -220,9 +221,6 @@ class GstEnginePipeline : public QObject {
   QString proxy_user_;
   QString proxy_pass_;
 
-  // These get called when there is a new audio buffer available
-  QList<GstBufferConsumer*> buffer_consumers_;
-  QMutex buffer_consumers_mutex_;
   qint64 segment_start_;
   bool segment_start_received_;
 
@@ -291,6 +289,16 @@ class GstEnginePipeline : public QObject {
 
   bool unsupported_analyzer_;
 
+  // The format of the buffers for the analyzers, set from the caps and segment events on the streaming thread.
+  bool buffer_format_received_;
+  QString buffer_format_;
+  SampleConverter::Format buffer_sample_format_;
+  int buffer_rate_;
+  int buffer_channels_;
+  GstSegment buffer_segment_;
+
+  PcmRingBuffer pcm_buffer_;
+
 };
 
 #endif  // GSTENGINEPIPELINE_H
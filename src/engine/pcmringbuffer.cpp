@@ -0,0 +1,162 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <atomic>
+#include <cstring>
+
+#include <QtGlobal>
+
+#include "core/timeconstants.h"
+#include "pcmringbuffer.h"
+#include "sampleconverter.h"
+
+// About 3 seconds of stereo audio at 44.1 kHz.
+const int PcmRingBuffer::kDefaultCapacity = 256 * 1024;
+const int PcmRingBuffer::kBlocks = 256;
+const int PcmRingBuffer::kReadAttempts = 3;
+
+PcmRingBuffer::PcmRingBuffer(const int capacity)
+    : capacity_(qMax(1, capacity)),
+      samples_(new qint16[capacity_]()),
+      blocks_(new Block[kBlocks]),
+      head_(0),
+      reserved_(0),
+      blocks_written_(0),
+      blocks_reserved_(0) {}
+
+void PcmRingBuffer::Write(const SampleConverter::Format format, const void *source, qint64 count, qint64 timestamp_nanosec, const int rate, const int channels) {
+
+  const qint64 sample_size = SampleConverter::SampleSize(format);
+  if (sample_size == 0 || count <= 0 || rate <= 0 || channels <= 0) return;
+
+  const quint8 *data = static_cast<const quint8*>(source);
+
+  // Only the end of a buffer larger than the ring fits.
+  if (count > capacity_) {
+    const qint64 skip_frames = (count - capacity_ + channels - 1) / channels;
+    data += skip_frames * channels * sample_size;
+    count -= skip_frames * channels;
+    timestamp_nanosec += skip_frames * kNsecPerSec / rate;
+    if (count <= 0) return;
+  }
+
+  const quint64 head = head_.load(std::memory_order_relaxed);
+  const quint64 block_index = blocks_written_.load(std::memory_order_relaxed);
+
+  // Tell the readers which samples and which block are about to be overwritten before touching them.
+  reserved_.store(head + count, std::memory_order_relaxed);
+  blocks_reserved_.store(block_index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  const qint64 offset = static_cast<qint64>(head % capacity_);
+  const qint64 first = qMin(count, capacity_ - offset);
+  SampleConverter::ConvertToS16(format, data, first, samples_.get() + offset);
+  if (count > first) {
+    SampleConverter::ConvertToS16(format, data + first * sample_size, count - first, samples_.get());
+  }
+
+  Block &block = blocks_[block_index % kBlocks];
+  block.start.store(head, std::memory_order_relaxed);
+  block.count.store(count, std::memory_order_relaxed);
+  block.timestamp.store(timestamp_nanosec, std::memory_order_relaxed);
+  block.rate.store(rate, std::memory_order_relaxed);
+  block.channels.store(channels, std::memory_order_relaxed);
+
+  head_.store(head + count, std::memory_order_release);
+  blocks_written_.store(block_index + 1, std::memory_order_release);
+
+}
+
+qint64 PcmRingBuffer::Read(const qint64 position_nanosec, qint16 *dest, qint64 count) const {
+
+  if (count <= 0) return 0;
+
+  for (int i = 0; i < kReadAttempts; ++i) {
+    qint64 copied = qMin(count, static_cast<qint64>(capacity_));
+    if (TryRead(position_nanosec, dest, &copied)) return copied;
+  }
+
+  // The writer kept overtaking us.
+  return 0;
+
+}
+
+bool PcmRingBuffer::TryRead(const qint64 position_nanosec, qint16 *dest, qint64 *count) const {
+
+  const quint64 blocks_written = blocks_written_.load(std::memory_order_acquire);
+  const quint64 head = head_.load(std::memory_order_acquire);
+
+  // Find the last block that starts at or before the position.
+  const quint64 oldest_block = blocks_written > static_cast<quint64>(kBlocks) ? blocks_written - kBlocks : 0;
+  quint64 block_index = blocks_written;
+  for (quint64 i = blocks_written; i > oldest_block; --i) {
+    if (blocks_[(i - 1) % kBlocks].timestamp.load(std::memory_order_relaxed) <= position_nanosec) {
+      block_index = i - 1;
+      break;
+    }
+  }
+  if (block_index == blocks_written) {
+    *count = 0;
+    return true;
+  }
+
+  const Block &block = blocks_[block_index % kBlocks];
+  const quint64 block_start = block.start.load(std::memory_order_relaxed);
+  const qint64 timestamp = block.timestamp.load(std::memory_order_relaxed);
+  const int rate = block.rate.load(std::memory_order_relaxed);
+  const int channels = block.channels.load(std::memory_order_relaxed);
+  if (rate <= 0 || channels <= 0 || block_start >= head) return false;
+
+  // Positions after the last written sample are clamped, so don't let the frame offset overflow.
+  const qint64 offset_nanosec = qMin(position_nanosec - timestamp, static_cast<qint64>(head - block_start) * kNsecPerSec / rate + 1);
+  quint64 start = block_start + offset_nanosec * rate / kNsecPerSec * channels;
+
+  // Return the last samples if the ones after the position were not written yet, keeping whole frames.
+  if (start + *count > head) {
+    start = head > static_cast<quint64>(*count) ? head - *count : 0;
+    if (start < block_start) {
+      const quint64 misalignment = (block_start - start) % channels;
+      if (misalignment != 0) start += misalignment;
+    }
+    else {
+      start -= (start - block_start) % channels;
+    }
+  }
+
+  const quint64 oldest = head > static_cast<quint64>(capacity_) ? head - capacity_ : 0;
+  if (start < oldest) start = oldest;
+  *count = qMin(*count, static_cast<qint64>(head - start));
+
+  const qint64 offset = static_cast<qint64>(start % capacity_);
+  const qint64 first = qMin(*count, capacity_ - offset);
+  memcpy(dest, samples_.get() + offset, first * sizeof(qint16));
+  if (*count > first) {
+    memcpy(dest + first, samples_.get(), (*count - first) * sizeof(qint16));
+  }
+
+  // The copy is only good if the writer didn't start overwriting the samples or the block while we read them.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const quint64 reserved = reserved_.load(std::memory_order_relaxed);
+  const quint64 blocks_reserved = blocks_reserved_.load(std::memory_order_relaxed);
+
+  return reserved <= start + capacity_ && blocks_reserved <= block_index + kBlocks;
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PCMRINGBUFFER_H
+#define PCMRINGBUFFER_H
+
+#include "config.h"
+
+#include <atomic>
+#include <memory>
+
+#include <QtGlobal>
+
+#include "sampleconverter.h"
+
+// The last seconds of decoded audio as interleaved S16 samples, for the analyzers and other visualizations.
+// One thread writes the buffers as they pass through the pipeline, any number of threads can read the samples
+// at a playback position at the same time without locks.
+// The writer never waits for the readers, it overwrites the oldest samples, a reader that was overtaken while
+// copying notices it afterwards and tries again.
+class PcmRingBuffer {
+ public:
+  explicit PcmRingBuffer(const int capacity = kDefaultCapacity);
+
+  Q_DISABLE_COPY(PcmRingBuffer)
+
+  int capacity() const { return capacity_; }
+
+  // Converts count samples of the format and appends them, timestamp is the stream time of the first sample.
+  // Only one thread may write.
+  void Write(const SampleConverter::Format format, const void *source, qint64 count, qint64 timestamp_nanosec, const int rate, const int channels);
+
+  // Copies up to count samples starting at the stream time position to dest, and returns how many were copied.
+  // When the samples after position were not written yet the window ends at the last written sample instead.
+  // Returns 0 when there are no samples for the position.
+  qint64 Read(const qint64 position_nanosec, qint16 *dest, qint64 count) const;
+
+  static const int kDefaultCapacity;
+
+ private:
+  // The timestamp and format of the samples of one written buffer.
+  struct Block {
+    Block() : start(0), count(0), timestamp(0), rate(0), channels(0) {}
+    std::atomic<quint64> start;
+    std::atomic<qint64> count;
+    std::atomic<qint64> timestamp;
+    std::atomic<int> rate;
+    std::atomic<int> channels;
+  };
+
+  static const int kBlocks;
+  static const int kReadAttempts;
+
+  bool TryRead(const qint64 position_nanosec, qint16 *dest, qint64 *count) const;
+
+ private:
+  const int capacity_;
+  std::unique_ptr<qint16[]> samples_;
+  std::unique_ptr<Block[]> blocks_;
+
+  // The number of samples written, and the number that will be written when the current write finishes.
+  std::atomic<quint64> head_;
+  std::atomic<quint64> reserved_;
+  // The number of blocks written, and the number that will be written when the current write finishes.
+  std::atomic<quint64> blocks_written_;
+  std::atomic<quint64> blocks_reserved_;
+};
+
+#endif  // PCMRINGBUFFER_H
@@ -0,0 +1,340 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cstring>
+
+#include <QtGlobal>
+#include <QString>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SAMPLECONVERTER_SSE2
+#  include <emmintrin.h>
+#endif
+
+// AVX2 is picked at runtime, so it needs the target attribute instead of building everything for AVX2.
+#if defined(SAMPLECONVERTER_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#  define SAMPLECONVERTER_AVX2
+#  include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define SAMPLECONVERTER_NEON
+#  include <arm_neon.h>
+#endif
+
+#include "sampleconverter.h"
+
+namespace SampleConverter {
+
+Format FormatFromString(const QString &format) {
+
+  if (format.startsWith("S16LE")) return Format_S16LE;
+  if (format.startsWith("S24LE")) return Format_S24LE;
+  if (format.startsWith("S32LE")) return Format_S32LE;
+  if (format.startsWith("F32LE")) return Format_F32LE;
+
+  return Format_Unknown;
+
+}
+
+qint64 SampleSize(const Format format) {
+
+  switch (format) {
+    case Format_S16LE:
+      return sizeof(qint16);
+    case Format_S24LE:
+      return 3;
+    case Format_S32LE:
+      return sizeof(qint32);
+    case Format_F32LE:
+      return sizeof(float);
+    case Format_Unknown:
+      break;
+  }
+
+  return 0;
+
+}
+
+qint64 SampleCount(const Format format, const qint64 size) {
+
+  const qint64 sample_size = SampleSize(format);
+  return sample_size == 0 ? 0 : size / sample_size;
+
+}
+
+void S24ToS16Scalar(const quint8 *source, const qint64 count, qint16 *dest) {
+
+  // Keep the two high bytes of each little endian sample.
+  for (qint64 i = 0; i < count; ++i) {
+    dest[i] = static_cast<qint16>(static_cast<quint16>(source[i * 3 + 1] | (source[i * 3 + 2] << 8)));
+  }
+
+}
+
+void S32ToS16Scalar(const qint32 *source, const qint64 count, qint16 *dest) {
+
+  for (qint64 i = 0; i < count; ++i) {
+    dest[i] = static_cast<qint16>(source[i] >> 16);
+  }
+
+}
+
+void F32ToS16Scalar(const float *source, const qint64 count, qint16 *dest) {
+
+  // Clip and truncate towards zero like the SIMD conversions.
+  for (qint64 i = 0; i < count; ++i) {
+    const float sample = source[i] * 32768.0F;
+    if (!(sample > -32768.0F)) {
+      dest[i] = -32768;
+    }
+    else if (sample >= 32767.0F) {
+      dest[i] = 32767;
+    }
+    else {
+      dest[i] = static_cast<qint16>(sample);
+    }
+  }
+
+}
+
+}  // namespace SampleConverter
+
+namespace {
+
+using SampleConverter::S24ToS16Scalar;
+using SampleConverter::S32ToS16Scalar;
+using SampleConverter::F32ToS16Scalar;
+
+#ifdef SAMPLECONVERTER_SSE2
+
+// Sign extends the two high bytes of the four 24 bit samples in the first 12 of the 16 bytes read.
+inline __m128i S24x4ToS32SSE2(const quint8 *source) {
+
+  const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+  const __m128i a = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+  const __m128i b = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+  return _mm_srai_epi32(_mm_slli_epi32(_mm_unpacklo_epi64(a, b), 8), 16);
+
+}
+
+void S24ToS16SSE2(const quint8 *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  // The second load reads 4 bytes past the 8 samples.
+  for (; i + 10 <= count; i += 8) {
+    const quint8 *s = source + i * 3;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(S24x4ToS32SSE2(s), S24x4ToS32SSE2(s + 12)));
+  }
+  S24ToS16Scalar(source + i * 3, count - i, dest + i);
+
+}
+
+void S32ToS16SSE2(const qint32 *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i a = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), 16);
+    const __m128i b = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i + 4)), 16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(a, b));
+  }
+  S32ToS16Scalar(source + i, count - i, dest + i);
+
+}
+
+void F32ToS16SSE2(const float *source, const qint64 count, qint16 *dest) {
+
+  const __m128 scale = _mm_set1_ps(32768.0F);
+  const __m128 min = _mm_set1_ps(-32768.0F);
+  const __m128 max = _mm_set1_ps(32767.0F);
+
+  qint64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i a = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(source + i), scale), min), max));
+    const __m128i b = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(source + i + 4), scale), min), max));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_packs_epi32(a, b));
+  }
+  F32ToS16Scalar(source + i, count - i, dest + i);
+
+}
+
+#endif  // SAMPLECONVERTER_SSE2
+
+#ifdef SAMPLECONVERTER_AVX2
+
+#define SAMPLECONVERTER_TARGET_AVX2 __attribute__((target("avx2")))
+
+SAMPLECONVERTER_TARGET_AVX2 inline __m256i Load2x128AVX2(const quint8 *low, const quint8 *high) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(high)), 1);
+}
+
+SAMPLECONVERTER_TARGET_AVX2 void S24ToS16AVX2(const quint8 *source, const qint64 count, qint16 *dest) {
+
+  // Picks the two high bytes of four samples in each lane.
+  const __m256i shuffle = _mm256_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+
+  qint64 i = 0;
+  // The last load reads 4 bytes past the 16 samples.
+  for (; i + 18 <= count; i += 16) {
+    const quint8 *s = source + i * 3;
+    const __m256i a = _mm256_shuffle_epi8(Load2x128AVX2(s, s + 12), shuffle);
+    const __m256i b = _mm256_shuffle_epi8(Load2x128AVX2(s + 24, s + 36), shuffle);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8));
+  }
+  S24ToS16SSE2(source + i * 3, count - i, dest + i);
+
+}
+
+SAMPLECONVERTER_TARGET_AVX2 void S32ToS16AVX2(const qint32 *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i a = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)), 16);
+    const __m256i b = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 8)), 16);
+    // Packing works within the 128 bit lanes, put the quarters back in order.
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+  }
+  S32ToS16SSE2(source + i, count - i, dest + i);
+
+}
+
+SAMPLECONVERTER_TARGET_AVX2 void F32ToS16AVX2(const float *source, const qint64 count, qint16 *dest) {
+
+  const __m256 scale = _mm256_set1_ps(32768.0F);
+  const __m256 min = _mm256_set1_ps(-32768.0F);
+  const __m256 max = _mm256_set1_ps(32767.0F);
+
+  qint64 i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const __m256i a = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(source + i), scale), min), max));
+    const __m256i b = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(source + i + 8), scale), min), max));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8));
+  }
+  F32ToS16SSE2(source + i, count - i, dest + i);
+
+}
+
+#endif  // SAMPLECONVERTER_AVX2
+
+#ifdef SAMPLECONVERTER_NEON
+
+void S24ToS16NEON(const quint8 *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16x3_t v = vld3q_u8(source + i * 3);
+    uint8x16x2_t d;
+    d.val[0] = v.val[1];
+    d.val[1] = v.val[2];
+    vst2q_u8(reinterpret_cast<uint8_t*>(dest + i), d);
+  }
+  S24ToS16Scalar(source + i * 3, count - i, dest + i);
+
+}
+
+void S32ToS16NEON(const qint32 *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    vst1q_s16(dest + i, vcombine_s16(vshrn_n_s32(vld1q_s32(source + i), 16), vshrn_n_s32(vld1q_s32(source + i + 4), 16)));
+  }
+  S32ToS16Scalar(source + i, count - i, dest + i);
+
+}
+
+void F32ToS16NEON(const float *source, const qint64 count, qint16 *dest) {
+
+  qint64 i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // The conversion truncates towards zero, the narrowing saturates.
+    const int32x4_t a = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(source + i), 32768.0F));
+    const int32x4_t b = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(source + i + 4), 32768.0F));
+    vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+  }
+  F32ToS16Scalar(source + i, count - i, dest + i);
+
+}
+
+#endif  // SAMPLECONVERTER_NEON
+
+struct Kernels {
+  const char *name;
+  void (*s24)(const quint8*, const qint64, qint16*);
+  void (*s32)(const qint32*, const qint64, qint16*);
+  void (*f32)(const float*, const qint64, qint16*);
+};
+
+Kernels SelectKernels() {
+
+#ifdef SAMPLECONVERTER_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return Kernels { "AVX2", &S24ToS16AVX2, &S32ToS16AVX2, &F32ToS16AVX2 };
+  }
+#endif
+
+#if defined(SAMPLECONVERTER_SSE2)
+  return Kernels { "SSE2", &S24ToS16SSE2, &S32ToS16SSE2, &F32ToS16SSE2 };
+#elif defined(SAMPLECONVERTER_NEON)
+  return Kernels { "NEON", &S24ToS16NEON, &S32ToS16NEON, &F32ToS16NEON };
+#else
+  return Kernels { "Scalar", &S24ToS16Scalar, &S32ToS16Scalar, &F32ToS16Scalar };
+#endif
+
+}
+
+const Kernels &CurrentKernels() {
+
+  static const Kernels kernels = SelectKernels();
+  return kernels;
+
+}
+
+}  // namespace
+
+namespace SampleConverter {
+
+void ConvertToS16(const Format format, const void *source, const qint64 count, qint16 *dest) {
+
+  switch (format) {
+    case Format_S16LE:
+      memcpy(dest, source, count * sizeof(qint16));
+      break;
+    case Format_S24LE:
+      CurrentKernels().s24(static_cast<const quint8*>(source), count, dest);
+      break;
+    case Format_S32LE:
+      CurrentKernels().s32(static_cast<const qint32*>(source), count, dest);
+      break;
+    case Format_F32LE:
+      CurrentKernels().f32(static_cast<const float*>(source), count, dest);
+      break;
+    case Format_Unknown:
+      break;
+  }
+
+}
+
+QString Implementation() {
+  return QString::fromLatin1(CurrentKernels().name);
+}
+
+}  // namespace SampleConverter
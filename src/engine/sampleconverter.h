@@ -0,0 +1,61 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SAMPLECONVERTER_H
+#define SAMPLECONVERTER_H
+
+#include "config.h"
+
+#include <QtGlobal>
+#include <QString>
+
+// Converts audio samples to S16LE for the analyzers.
+// The conversions use AVX2, SSE2 or NEON when the CPU has them, the scalar ones give the same results.
+namespace SampleConverter {
+
+enum Format {
+  Format_Unknown,
+  Format_S16LE,
+  Format_S24LE,
+  Format_S32LE,
+  Format_F32LE
+};
+
+Format FormatFromString(const QString &format);
+
+// Returns the size of one sample of the format in bytes, or 0 for unknown formats.
+qint64 SampleSize(const Format format);
+
+// Returns the number of samples in size bytes of the format.
+qint64 SampleCount(const Format format, const qint64 size);
+
+// Converts count samples of the format to S16LE.
+void ConvertToS16(const Format format, const void *source, const qint64 count, qint16 *dest);
+
+// Returns the name of the instruction set the conversions use.
+QString Implementation();
+
+// The plain C++ conversions.
+void S24ToS16Scalar(const quint8 *source, const qint64 count, qint16 *dest);
+void S32ToS16Scalar(const qint32 *source, const qint64 count, qint16 *dest);
+void F32ToS16Scalar(const float *source, const qint64 count, qint16 *dest);
+
+}  // namespace SampleConverter
+
+#endif  // SAMPLECONVERTER_H
@@ -41,6 +41,7 @@ class InternetPlaylistItem : public PlaylistItem {
 
   bool InitFromQuery(const SqlRow &query) override;
   Song Metadata() const override;
+  const Song &MetadataRef() const override { return HasTemporaryMetadata() ? temp_metadata_ : metadata_; }
   Song OriginalMetadata() const override { return metadata_; }
   QUrl Url() const override;
   void SetArtManual(const QUrl &cover_url) override;
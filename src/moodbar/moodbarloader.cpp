@@ -22,6 +22,9 @@
 #include <QtGlobal>
 #include <QObject>
 #include <QThread>
+#include <QtConcurrent>
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QCoreApplication>
 #include <QStandardPaths>
 #include <QIODevice>
@@ -32,6 +35,8 @@
 #include <QNetworkDiskCache>
 #include <QTimer>
 #include <QVariant>
+#include <QList>
+#include <QSet>
 #include <QByteArray>
 #include <QString>
 #include <QUrl>
@@ -41,6 +46,9 @@
 #include "core/application.h"
 #include "core/closure.h"
 #include "core/logging.h"
+#include "core/song.h"
+#include "core/taskmanager.h"
+#include "collection/collectionbackend.h"
 
 #include "moodbarpipeline.h"
 
@@ -52,16 +60,22 @@
 
 MoodbarLoader::MoodbarLoader(Application* app, QObject* parent)
     : QObject(parent),
+      app_(app),
       cache_(new QNetworkDiskCache(this)),
       thread_(new QThread(this)),
       kMaxActiveRequests(qMax(1, QThread::idealThreadCount() / 2)),
+      kMaxBatchRequests(qMax(1, QThread::idealThreadCount() - kMaxActiveRequests)),
+      batch_running_(false),
+      batch_task_id_(-1),
+      batch_done_(0),
+      batch_total_(0),
       enabled_(false),
       save_(false) {
 
   cache_->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/moodbar");
   cache_->setMaximumCacheSize(60 * 1024 * 1024);  // 60MB - enough for 20,000 moodbars
 
-  connect(app, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
+  if (app_) connect(app_, SIGNAL(SettingsChanged()), SLOT(ReloadSettings()));
   ReloadSettings();
 
 }
@@ -79,6 +93,13 @@ void MoodbarLoader::ReloadSettings() {
   save_ = s.value("save", false).toBool();
   s.endGroup();
 
+  if (!enabled_ && batch_running_) {
+    // Stop the collection job, the moodbars that are being generated now are still saved.
+    batch_requests_.clear();
+    batch_total_ = batch_done_ + batch_active_requests_.count();
+    UpdateBatchProgress();
+  }
+
   MaybeTakeNextRequest();
 
 }
@@ -127,36 +148,197 @@ MoodbarLoader::Result MoodbarLoader::Load(const QUrl& url, QByteArray* data, Moo
     }
   }
 
+  // There was no existing file, analyze the audio file and create one.
+  MoodbarPipeline* pipeline = CreatePipeline(url);
+  queued_requests_ << url;
+
+  MaybeTakeNextRequest();
+
+  *async_pipeline = pipeline;
+  return WillLoadAsync;
+
+}
+
+bool MoodbarLoader::HasMoodbar(const QUrl &url) {
+
+  for (const QString &possible_mood_file : MoodFilenames(url.toLocalFile())) {
+    if (QFile::exists(possible_mood_file)) return true;
+  }
+
+  return cache_->metaData(url).isValid();
+
+}
+
+MoodbarPipeline *MoodbarLoader::CreatePipeline(const QUrl &url) {
+
   if (!thread_->isRunning()) thread_->start(QThread::IdlePriority);
 
-  // There was no existing file, analyze the audio file and create one.
   MoodbarPipeline* pipeline = new MoodbarPipeline(url);
   pipeline->moveToThread(thread_);
   NewClosure(pipeline, SIGNAL(Finished(bool)), this, SLOT(RequestFinished(MoodbarPipeline*, QUrl)), pipeline, url);
 
   requests_[url] = pipeline;
-  queued_requests_ << url;
 
-  MaybeTakeNextRequest();
+  return pipeline;
 
-  *async_pipeline = pipeline;
-  return WillLoadAsync;
+}
 
+void MoodbarLoader::StartRequest(const QUrl &url) {
+
+  active_requests_ << url;
+
+  qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
+  StartPipeline(requests_[url]);
+
+}
+
+void MoodbarLoader::StartPipeline(MoodbarPipeline *pipeline) {
+  QMetaObject::invokeMethod(pipeline, "Start", Qt::QueuedConnection);
 }
 
 void MoodbarLoader::MaybeTakeNextRequest() {
 
   Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-  if (active_requests_.count() >= kMaxActiveRequests || queued_requests_.isEmpty() || !enabled_) {
+  if (!enabled_) {
     return;
   }
 
-  const QUrl url = queued_requests_.takeFirst();
-  active_requests_ << url;
+  // The songs that are shown keep their pipelines while the collection job runs, the job gets the rest of the cores.
+  while (active_requests_.count() - batch_active_requests_.count() < kMaxActiveRequests && !queued_requests_.isEmpty()) {
+    StartRequest(queued_requests_.takeFirst());
+  }
 
-  qLog(Info) << "Creating moodbar data for" << url.toLocalFile();
-  QMetaObject::invokeMethod(requests_[url], "Start", Qt::QueuedConnection);
+  int skipped = 0;
+  while (batch_active_requests_.count() < kMaxBatchRequests && !batch_requests_.isEmpty()) {
+    const QUrl url = batch_requests_.takeFirst();
+
+    // It might have been shown and loaded since the job was started.
+    if (requests_.contains(url) || HasMoodbar(url)) {
+      BatchRequestDone();
+      // Don't block the GUI thread when most of the collection has moodbars already.
+      if (++skipped >= 100) {
+        QTimer::singleShot(0, this, SLOT(MaybeTakeNextRequest()));
+        return;
+      }
+      continue;
+    }
+
+    CreatePipeline(url);
+    batch_active_requests_ << url;
+    StartRequest(url);
+  }
+
+}
+
+void MoodbarLoader::GenerateCollectionMoodbars() {
+
+  if (!enabled_) {
+    qLog(Warning) << "Moodbars are disabled, not generating moodbars for the collection";
+    return;
+  }
+
+  if (batch_running_) return;
+
+  StartBatch();
+
+  QFuture<QList<QUrl>> future = QtConcurrent::run(&MoodbarLoader::CollectionUrls, app_->collection_backend());
+  QFutureWatcher<QList<QUrl>> *watcher = new QFutureWatcher<QList<QUrl>>(this);
+  watcher->setFuture(future);
+  connect(watcher, SIGNAL(finished()), SLOT(CollectionUrlsLoaded()));
+
+}
+
+void MoodbarLoader::GenerateMoodbars(const QList<QUrl> &urls) {
+
+  if (!enabled_ || batch_running_) return;
+
+  StartBatch();
+  AddBatchRequests(urls);
+
+}
+
+void MoodbarLoader::StartBatch() {
+
+  batch_running_ = true;
+  batch_done_ = 0;
+  batch_total_ = 0;
+  if (app_) batch_task_id_ = app_->task_manager()->StartTask(tr("Generating moodbars"));
+
+}
+
+QList<QUrl> MoodbarLoader::CollectionUrls(CollectionBackend *collection_backend) {
+
+  QList<QUrl> urls;
+  QSet<QUrl> seen_urls;
+
+  for (const Song &song : collection_backend->GetAllSongs()) {
+    const QUrl &url = song.url();
+    // Songs from a cue sheet share the file.
+    if (url.scheme() != "file" || seen_urls.contains(url)) continue;
+    seen_urls << url;
+
+    bool has_mood_file = false;
+    for (const QString &possible_mood_file : MoodFilenames(url.toLocalFile())) {
+      if (QFile::exists(possible_mood_file)) {
+        has_mood_file = true;
+        break;
+      }
+    }
+    if (!has_mood_file) urls << url;
+  }
+
+  return urls;
+
+}
+
+void MoodbarLoader::CollectionUrlsLoaded() {
+
+  QFutureWatcher<QList<QUrl>> *watcher = static_cast<QFutureWatcher<QList<QUrl>>*>(sender());
+  if (!watcher) return;
+  const QList<QUrl> urls = watcher->result();
+  watcher->deleteLater();
+
+  // The job was stopped while the songs were loaded.
+  if (!batch_running_) return;
+
+  qLog(Info) << "Generating moodbars for" << urls.count() << "songs in the collection";
+
+  AddBatchRequests(urls);
+
+}
+
+void MoodbarLoader::AddBatchRequests(const QList<QUrl> &urls) {
+
+  batch_requests_ = urls;
+  batch_total_ = urls.count();
+  UpdateBatchProgress();
+
+  MaybeTakeNextRequest();
+
+}
+
+void MoodbarLoader::BatchRequestDone() {
+
+  ++batch_done_;
+  UpdateBatchProgress();
+
+}
+
+void MoodbarLoader::UpdateBatchProgress() {
+
+  if (!batch_running_) return;
+
+  if (batch_done_ >= batch_total_) {
+    if (app_) app_->task_manager()->SetTaskFinished(batch_task_id_);
+    batch_running_ = false;
+    batch_task_id_ = -1;
+    batch_done_ = 0;
+    batch_total_ = 0;
+    return;
+  }
+
+  if (app_) app_->task_manager()->SetTaskProgress(batch_task_id_, batch_done_, batch_total_);
 
 }
 
@@ -167,22 +349,17 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline *request, const QUrl &url) {
   if (request->success()) {
     qLog(Info) << "Moodbar data generated successfully for" << url.toLocalFile();
 
-    // Save the data in the cache
-    QNetworkCacheMetaData metadata;
-    metadata.setUrl(url);
-
-    QIODevice* cache_file = cache_->prepare(metadata);
-    if (cache_file) {
-      cache_file->write(request->data());
-      cache_->insert(cache_file);
-    }
+    // The moodbars of the collection job are always saved alongside the songs, the cache can't hold a whole collection.
+    const bool batch_request = batch_active_requests_.contains(url);
 
     // Save the data alongside the original as well if we're configured to.
-    if (save_) {
+    bool saved = false;
+    if (save_ || batch_request) {
       const QString mood_filename(MoodFilenames(url.toLocalFile())[0]);
       QFile mood_file(mood_filename);
       if (mood_file.open(QIODevice::WriteOnly)) {
         mood_file.write(request->data());
+        saved = true;
 
 #ifdef Q_OS_WIN32
         if (!SetFileAttributes((LPCTSTR)mood_filename.utf16(), FILE_ATTRIBUTE_HIDDEN)) {
@@ -195,11 +372,24 @@ void MoodbarLoader::RequestFinished(MoodbarPipeline *request, const QUrl &url) {
         qLog(Warning) << "Error opening mood file for writing" << mood_filename;
       }
     }
+
+    // Save the data in the cache, unless it's a mood file of the collection job that would push the moodbars of the songs that are shown out.
+    if (!batch_request || !saved) {
+      QNetworkCacheMetaData metadata;
+      metadata.setUrl(url);
+
+      QIODevice* cache_file = cache_->prepare(metadata);
+      if (cache_file) {
+        cache_file->write(request->data());
+        cache_->insert(cache_file);
+      }
+    }
   }
 
   // Remove the request from the active list and delete it
   requests_.remove(url);
   active_requests_.remove(url);
+  if (batch_active_requests_.remove(url)) BatchRequestDone();
 
   QTimer::singleShot(1000, request, SLOT(deleteLater()));
 
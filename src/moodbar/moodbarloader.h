@@ -30,6 +30,7 @@ class QThread;
 class QByteArray;
 class QNetworkDiskCache;
 class Application;
+class CollectionBackend;
 class MoodbarPipeline;
 
 class MoodbarLoader : public QObject {
@@ -54,25 +55,62 @@ class MoodbarLoader : public QObject {
 
   Result Load(const QUrl& url, QByteArray* data, MoodbarPipeline** async_pipeline);
 
+  // Generates a mood file next to each of the files that haven't got a moodbar yet, as one task.
+  void GenerateMoodbars(const QList<QUrl> &urls);
+
+  bool batch_running() const { return batch_running_; }
+  int batch_done() const { return batch_done_; }
+  int batch_total() const { return batch_total_; }
+
+ public slots:
+  // Generates mood files for all songs in the collection that don't have one yet,
+  // so they are loaded without decoding when they are shown.
+  void GenerateCollectionMoodbars();
+
+ protected:
+  // Starts the pipeline in the loader's thread.
+  virtual void StartPipeline(MoodbarPipeline *pipeline);
+
  private slots:
   void ReloadSettings();
 
   void RequestFinished(MoodbarPipeline *request, const QUrl &url);
   void MaybeTakeNextRequest();
 
+  void CollectionUrlsLoaded();
+
  private:
   static QStringList MoodFilenames(const QString& song_filename);
+  static QList<QUrl> CollectionUrls(CollectionBackend *collection_backend);
+
+  bool HasMoodbar(const QUrl &url);
+  MoodbarPipeline *CreatePipeline(const QUrl &url);
+  void StartRequest(const QUrl &url);
+  void StartBatch();
+  void AddBatchRequests(const QList<QUrl> &urls);
+  void BatchRequestDone();
+  void UpdateBatchProgress();
 
  private:
+  Application *app_;
   QNetworkDiskCache* cache_;
   QThread* thread_;
 
   const int kMaxActiveRequests;
+  const int kMaxBatchRequests;
 
   QMap<QUrl, MoodbarPipeline*> requests_;
   QList<QUrl> queued_requests_;
   QSet<QUrl> active_requests_;
 
+  // The collection moodbars job, its pipelines are run next to the requests for the songs that are shown.
+  bool batch_running_;
+  int batch_task_id_;
+  QList<QUrl> batch_requests_;
+  QSet<QUrl> batch_active_requests_;
+  int batch_done_;
+  int batch_total_;
+
   bool enabled_;
   bool save_;
 };
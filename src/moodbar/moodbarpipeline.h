@@ -41,6 +41,7 @@ class MoodbarPipeline : public QObject {
 
   static bool IsAvailable();
 
+  const QUrl &url() const { return local_filename_; }
   bool success() const { return success_; }
   const QByteArray& data() const { return data_; }
 
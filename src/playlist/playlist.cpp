@@ -29,7 +29,10 @@
 #include <iterator>
 #include <type_traits>
 #include <unordered_map>
-#include <random>
+#include <numeric>
+#include <vector>
+#include <array>
+#include <limits>
 
 #include <QtGlobal>
 #include <QObject>
@@ -42,7 +45,11 @@
 #include <QFile>
 #include <QList>
 #include <QMap>
+#include <QHash>
 #include <QSet>
+#include <QPair>
+#include <QVector>
+#include <QThread>
 #include <QMimeData>
 #include <QVariant>
 #include <QString>
@@ -90,9 +97,6 @@
 #include "internet/internetplaylistitem.h"
 #include "internet/internetsongmimedata.h"
 
-using std::placeholders::_1;
-using std::placeholders::_2;
-
 const char *Playlist::kCddaMimeType = "x-content/audio-cdda";
 const char *Playlist::kRowsMimetype = "application/x-strawberry-playlist-rows";
 const char *Playlist::kPlayNowMimetype = "application/x-strawberry-play-now";
@@ -114,6 +118,13 @@ const int Playlist::kUndoItemLimit = 500;
 const qint64 Playlist::kMinScrobblePointNsecs = 31ll * kNsecPerSec;
 const qint64 Playlist::kMaxScrobblePointNsecs = 240ll * kNsecPerSec;
 
+const qint64 Playlist::kPositionStep = 1024;
+
+const int Playlist::kMetadataBatchSize = 250;
+const int Playlist::kParallelSortMinItems = 10000;
+
+const int Playlist::kRestorePageSize = 2000;
+
 Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, CollectionBackend *collection, const int id, const QString &special_type, const bool favorite, QObject *parent)
     : QAbstractListModel(parent),
       is_loading_(false),
@@ -132,6 +143,12 @@ Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, Collecti
       undo_stack_(new QUndoStack(this)),
       special_type_(special_type),
       cancel_restore_(false),
+      restoring_(false),
+      restore_position_(std::numeric_limits<qint64>::min()),
+      restore_skip_(0),
+      restore_greyout_(false),
+      restore_last_played_(-1),
+      last_played_restored_(true),
       scrobbled_(false),
       scrobble_point_(-1),
       editing_(-1),
@@ -145,6 +162,10 @@ Playlist::Playlist(PlaylistBackend *backend, TaskManager *task_manager, Collecti
   connect(this, SIGNAL(rowsInserted(QModelIndex, int, int)), SIGNAL(PlaylistChanged()));
   connect(this, SIGNAL(rowsRemoved(QModelIndex, int, int)), SIGNAL(PlaylistChanged()));
 
+  if (backend_) {
+    connect(backend_, SIGNAL(PlaylistSaveFailed(int)), SLOT(SaveFailed(int)));
+  }
+
   Restore();
 
   proxy_->setSourceModel(this);
@@ -213,6 +234,83 @@ bool Playlist::column_is_editable(Playlist::Column column) {
 
 }
 
+bool Playlist::column_is_numeric(const Column column) {
+
+  switch (column) {
+    case Column_Length:
+    case Column_Track:
+    case Column_Disc:
+    case Column_Year:
+    case Column_OriginalYear:
+    case Column_PlayCount:
+    case Column_SkipCount:
+    case Column_LastPlayed:
+    case Column_Samplerate:
+    case Column_Bitdepth:
+    case Column_Bitrate:
+    case Column_Filesize:
+    case Column_Filetype:
+    case Column_DateModified:
+    case Column_DateCreated:
+    case Column_Source:
+      return true;
+    default:
+      break;
+  }
+  return false;
+
+}
+
+qint64 Playlist::column_number(const Song &song, const Column column) {
+
+  // Keep in sync with data()
+  switch (column) {
+    case Column_Length:             return song.length_nanosec();
+    case Column_Track:              return song.track();
+    case Column_Disc:               return song.disc();
+    case Column_Year:               return song.year();
+    case Column_OriginalYear:       return song.effective_originalyear();
+    case Column_PlayCount:          return song.playcount();
+    case Column_SkipCount:          return song.skipcount();
+    case Column_LastPlayed:         return song.lastplayed();
+    case Column_Samplerate:         return song.samplerate();
+    case Column_Bitdepth:           return song.bitdepth();
+    case Column_Bitrate:            return song.bitrate();
+    case Column_Filesize:           return song.filesize();
+    case Column_Filetype:           return song.filetype();
+    case Column_DateModified:       return song.mtime();
+    case Column_DateCreated:        return song.ctime();
+    case Column_Source:             return song.source();
+    default:                        break;
+  }
+  return 0;
+
+}
+
+QString Playlist::column_text(const Song &song, const Column column) {
+
+  // Keep in sync with data()
+  switch (column) {
+    case Column_Title:              return song.PrettyTitle();
+    case Column_Artist:             return song.artist();
+    case Column_Album:              return song.album();
+    case Column_Genre:              return song.genre();
+    case Column_AlbumArtist:        return song.playlist_albumartist();
+    case Column_Composer:           return song.composer();
+    case Column_Performer:          return song.performer();
+    case Column_Grouping:           return song.grouping();
+    case Column_Filename:           return song.effective_stream_url().toString();
+    case Column_BaseFilename:       return song.basefilename();
+    case Column_Comment:            return song.comment().simplified();
+    case Column_Rating:             return QString::number(song.rating());
+    default:
+      if (column_is_numeric(column)) return QString::number(column_number(song, column));
+      break;
+  }
+  return QString();
+
+}
+
 bool Playlist::set_column_value(Song &song, Playlist::Column column, const QVariant &value) {
 
   if (!song.IsEditable()) return false;
@@ -278,15 +376,19 @@ QVariant Playlist::data(const QModelIndex &idx, int role) const {
       return queue_->PositionOf(idx);
 
     case Role_CanSetRating:
-      return idx.column() == Column_Rating && items_[idx.row()]->IsLocalCollectionItem() && items_[idx.row()]->Metadata().id() != -1;
+      return idx.column() == Column_Rating && items_[idx.row()]->IsLocalCollectionItem() && items_[idx.row()]->MetadataRef().id() != -1;
 
     case Qt::EditRole:
     case Qt::ToolTipRole:
     case Qt::DisplayRole: {
       PlaylistItemPtr item = items_[idx.row()];
-      Song song = item->Metadata();
+      const Song &song = item->MetadataRef();
+      // Until the view has the metadata loaded, only the length of restored collection items is known.
+      if (!item->HasMetadata()) {
+        return idx.column() == Column_Length ? QVariant(song.length_nanosec()) : QVariant();
+      }
 
-      // Don't forget to change Playlist::CompareItems when adding new columns
+      // Don't forget to change Playlist::CompareItems, SortKeys(), column_number() and column_text() when adding new columns
       switch (idx.column()) {
         case Column_Title:              return song.PrettyTitle();
         case Column_Artist:             return song.artist();
@@ -637,8 +739,7 @@ void Playlist::set_current_row(const int i, const AutoScroll autoscroll, const b
     ReshuffleIndices();
 
     // Bring the one we've been asked to play to the start of the list
-    virtual_items_.takeAt(virtual_items_.indexOf(i));
-    virtual_items_.prepend(i);
+    virtual_items_.MoveToFront(i);
     current_virtual_index_ = 0;
   }
   else if (is_shuffled_) {
@@ -648,6 +749,20 @@ void Playlist::set_current_row(const int i, const AutoScroll autoscroll, const b
     current_virtual_index_ = i;
   }
 
+  // The player needs the metadata of the current item now, it's usually loaded already with the items after the previous one.
+  // The next items are loaded ahead, as finding the next item can depend on their albums.
+  if (current_item_index_.isValid()) {
+    LoadItemMetadataNow(QList<int>() << current_item_index_.row());
+  }
+  if (current_virtual_index_ != -1) {
+    QList<int> rows;
+    for (int j = current_virtual_index_ + 1; j < virtual_items_.count() && j <= current_virtual_index_ + kMetadataBatchSize; ++j) {
+      rows << virtual_items_[j];
+    }
+    if (queue_->PeekNext() != -1) rows << queue_->PeekNext();
+    LoadItemMetadata(rows);
+  }
+
   if (current_item_index_.isValid() && !is_stopping) {
     InformOfCurrentSongChange(autoscroll, false);
   }
@@ -860,7 +975,9 @@ void Playlist::MoveItemWithoutUndo(const int source, const int dest) {
 void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
 
   layoutAboutToBeChanged();
+  const PlaylistItemList old_items = items_;
   PlaylistItemList moved_items;
+  QList<qint64> moved_positions;
 
   if (pos < 0) {
     pos = items_.count();
@@ -871,6 +988,7 @@ void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
   int start = pos;
   for (int source_row : source_rows) {
     moved_items << items_.takeAt(source_row - offset);
+    moved_positions << positions_.takeAt(source_row - offset);
     if (pos > source_row) {
       start--;
     }
@@ -878,10 +996,14 @@ void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
   }
 
   // Put the items back in
+  QList<int> moved_rows;
   for (int i = start; i < start + moved_items.count(); ++i) {
     moved_items[i - start]->RemoveForegroundColor(kDynamicHistoryPriority);
     items_.insert(i, moved_items[i - start]);
+    positions_.insert(i, moved_positions[i - start]);
+    moved_rows << i;
   }
+  RecordMoves(moved_rows);
 
   // Update persistent indexes
   for (const QModelIndex &pidx : persistentIndexList()) {
@@ -900,6 +1022,7 @@ void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
       changePersistentIndex(pidx, index(pidx.row() + d, pidx.column(), QModelIndex()));
     }
   }
+  ReorderVirtualItems(old_items);
   current_virtual_index_ = virtual_items_.indexOf(current_row());
 
   layoutChanged();
@@ -910,7 +1033,9 @@ void Playlist::MoveItemsWithoutUndo(const QList<int> &source_rows, int pos) {
 void Playlist::MoveItemsWithoutUndo(int start, const QList<int> &dest_rows) {
 
   layoutAboutToBeChanged();
+  const PlaylistItemList old_items = items_;
   PlaylistItemList moved_items;
+  QList<qint64> moved_positions;
 
   int pos = start;
   for (int dest_row : dest_rows) {
@@ -922,15 +1047,21 @@ void Playlist::MoveItemsWithoutUndo(int start, const QList<int> &dest_rows) {
   }
 
   // Take the items out of the list first
-  for (int i = 0; i < dest_rows.count(); i++)
+  for (int i = 0; i < dest_rows.count(); i++) {
     moved_items << items_.takeAt(start);
+    moved_positions << positions_.takeAt(start);
+  }
 
   // Put the items back in
   int offset = 0;
   for (int dest_row : dest_rows) {
     items_.insert(dest_row, moved_items[offset]);
+    positions_.insert(dest_row, moved_positions[offset]);
     offset++;
   }
+  QList<int> moved_rows = dest_rows;
+  std::sort(moved_rows.begin(), moved_rows.end());
+  RecordMoves(moved_rows);
 
   // Update persistent indexes
   for (const QModelIndex &pidx : persistentIndexList()) {
@@ -950,6 +1081,7 @@ void Playlist::MoveItemsWithoutUndo(int start, const QList<int> &dest_rows) {
       changePersistentIndex(pidx, index(pidx.row() + d, pidx.column(), QModelIndex()));
     }
   }
+  ReorderVirtualItems(old_items);
   current_virtual_index_ = virtual_items_.indexOf(current_row());
 
   layoutChanged();
@@ -1028,7 +1160,7 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, const int p
   for (int i = start; i <= end; ++i) {
     PlaylistItemPtr item = items[i - start];
     items_.insert(i, item);
-    virtual_items_ << virtual_items_.count();
+    positions_.insert(i, 0);
 
     if (item->source() == Song::Source_Collection) {
       int id = item->Metadata().id();
@@ -1045,6 +1177,11 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, const int p
   }
   endInsertRows();
 
+  InsertVirtualItems(start, end);
+
+  // Items being restored already have their rows, ItemsLoaded() sets their positions
+  if (!is_loading_) RecordInserts(start, end);
+
   if (enqueue) {
     QModelIndexList indexes;
     for (int i = start; i <= end; ++i) {
@@ -1066,10 +1203,45 @@ void Playlist::InsertItemsWithoutUndo(const PlaylistItemList &items, const int p
   if (auto_sort_) {
     sort(sort_column_, sort_order_);
   }
-  else {
-    ReshuffleIndices();
+
+}
+
+void Playlist::InsertVirtualItems(const int start, const int end) {
+
+  // New items are shuffled in among the ones that haven't been played yet, the playlist isn't reshuffled.
+  QStringList album_keys;
+  if (is_shuffled_ && playlist_sequence_ && playlist_sequence_->shuffle_mode() == PlaylistSequence::Shuffle_Albums) {
+    for (int i = start; i <= end; ++i) {
+      album_keys << items_[i]->Metadata().AlbumKey();
+    }
+    // Items without their metadata are shuffled by album again once it's loaded.
+    LoadAllItemMetadata([this]() { ReshuffleIndices(); });
+  }
+  virtual_items_.InsertRows(start, end - start + 1, current_virtual_index_ + 1, album_keys);
+
+  if (!virtual_items_.is_shuffled() && current_row() != -1) {
+    current_virtual_index_ = virtual_items_.indexOf(current_row());
+  }
+
+}
+
+void Playlist::ReorderVirtualItems(const PlaylistItemList &old_items) {
+
+  if (!virtual_items_.is_shuffled()) return;
+
+  QHash<const PlaylistItem*, int> new_rows;
+  new_rows.reserve(items_.count());
+  for (int i = 0; i < items_.count(); ++i) {
+    new_rows.insert(items_[i].get(), i);
   }
 
+  QVector<int> rows;
+  rows.reserve(old_items.count());
+  for (const PlaylistItemPtr &item : old_items) {
+    rows << new_rows.value(item.get());
+  }
+  virtual_items_.Reorder(rows, current_virtual_index_ + 1);
+
 }
 
 void Playlist::InsertCollectionItems(const SongList &songs, const int pos, const bool play_now, const bool enqueue, const bool enqueue_next) {
@@ -1133,6 +1305,7 @@ void Playlist::UpdateItems(SongList songs) {
           new_item = PlaylistItemPtr(new SongPlaylistItem(song));
         }
         items_[i] = new_item;
+        RecordUpdate(i);
         emit dataChanged(index(i, 0), index(i, ColumnCount - 1));
         // Also update undo actions
         for (int y = 0 ; y < undo_stack_->count() ; y++) {
@@ -1255,6 +1428,189 @@ bool Playlist::ComparePathDepths(const Qt::SortOrder order, std::shared_ptr<Play
 
 }
 
+QVector<qint64> Playlist::SortKeys(const PlaylistItemList &items, const int column) {
+
+  QVector<qint64> keys;
+  keys.reserve(items.count());
+  QStringList strings;
+
+#define sort_key(field) keys << item->MetadataRef().field(); break
+#define sort_text(field) strings << item->MetadataRef().field(); break
+
+  for (const PlaylistItemPtr &item : items) {
+    switch (column) {
+      case Column_Title:        sort_text(title_sortable);
+      case Column_Artist:       sort_text(artist_sortable);
+      case Column_Album:        sort_text(album_sortable);
+      case Column_Length:       sort_key(length_nanosec);
+      case Column_Track:        sort_key(track);
+      case Column_Disc:         sort_key(disc);
+      case Column_Year:         sort_key(year);
+      case Column_OriginalYear: sort_key(originalyear);
+      case Column_Genre:        sort_text(genre);
+      case Column_AlbumArtist:  sort_text(playlist_albumartist_sortable);
+      case Column_Composer:     sort_text(composer);
+      case Column_Performer:    sort_text(performer);
+      case Column_Grouping:     sort_text(grouping);
+
+      case Column_PlayCount:    sort_key(playcount);
+      case Column_SkipCount:    sort_key(skipcount);
+      case Column_LastPlayed:   sort_key(lastplayed);
+
+      case Column_Bitrate:      sort_key(bitrate);
+      case Column_Samplerate:   sort_key(samplerate);
+      case Column_Bitdepth:     sort_key(bitdepth);
+      case Column_Filename:     strings << item->Url().path(); break;
+      case Column_BaseFilename: sort_text(basefilename);
+      case Column_Filesize:     sort_key(filesize);
+      case Column_Filetype:     sort_key(filetype);
+      case Column_DateModified: sort_key(mtime);
+      case Column_DateCreated:  sort_key(ctime);
+
+      case Column_Comment:      sort_text(comment);
+      case Column_Source:       sort_key(source);
+
+      // Ratings are steps of 0.1, so this keeps their order.
+      case Column_Rating:       keys << qRound64(item->MetadataRef().rating() * 1000.0); break;
+
+      default:                  keys << 0; break;
+    }
+  }
+
+#undef sort_key
+#undef sort_text
+
+  if (!strings.isEmpty()) keys = SortRanks(strings, column != Column_BaseFilename);
+
+  return keys;
+
+}
+
+QVector<qint64> Playlist::SortRanks(const QStringList &strings, const bool locale_aware) {
+
+  // Most strings are shared by many items, so only the distinct ones are compared.
+  QHash<QString, int> ids;
+  QStringList distinct;
+  QVector<int> string_ids;
+  string_ids.reserve(strings.count());
+  for (const QString &string : strings) {
+    const QString value = locale_aware ? string.toLower() : string;
+    QHash<QString, int>::const_iterator it = ids.constFind(value);
+    if (it == ids.constEnd()) {
+      it = ids.insert(value, distinct.count());
+      distinct << value;
+    }
+    string_ids << it.value();
+  }
+
+  QVector<int> order(distinct.count());
+  std::iota(order.begin(), order.end(), 0);
+  if (locale_aware) {
+    std::sort(order.begin(), order.end(), [&distinct](const int a, const int b) { return QString::localeAwareCompare(distinct[a], distinct[b]) < 0; });
+  }
+  else {
+    std::sort(order.begin(), order.end(), [&distinct](const int a, const int b) { return distinct[a] < distinct[b]; });
+  }
+
+  // Strings that collate equal get the same rank.
+  QVector<qint64> ranks(distinct.count());
+  for (int i = 0; i < order.count(); ++i) {
+    const bool equal = i > 0 && (locale_aware ? QString::localeAwareCompare(distinct[order[i - 1]], distinct[order[i]]) == 0 : distinct[order[i - 1]] == distinct[order[i]]);
+    ranks[order[i]] = equal ? ranks[order[i - 1]] : i;
+  }
+
+  QVector<qint64> keys;
+  keys.reserve(string_ids.count());
+  for (const int id : string_ids) keys << ranks[id];
+
+  return keys;
+
+}
+
+PlaylistItemList Playlist::SortItems(const PlaylistItemList &items, const int column, const Qt::SortOrder order) {
+
+  QList<QVector<qint64>> key_columns;
+  if (column == Column_Album) {
+    // When sorting by album, also take into account discs and tracks.
+    key_columns << SortKeys(items, Column_Album) << SortKeys(items, Column_Disc) << SortKeys(items, Column_Track);
+  }
+  else if (column == Column_Filename) {
+    // When sorting by full paths we also expect a hierarchical order. This returns a breath-first ordering of paths.
+    QVector<qint64> depths;
+    depths.reserve(items.count());
+    for (const PlaylistItemPtr &item : items) depths << item->Url().path().count('/');
+    key_columns << depths << SortKeys(items, Column_Filename);
+  }
+  else {
+    if (column < 0 || column >= ColumnCount || column == Column_Mood) qLog(Error) << "No such column" << column;
+    key_columns << SortKeys(items, column);
+  }
+
+  // The keys of each item are next to each other, so a comparison reads one place in memory.
+  const int count = items.count();
+  const int key_count = key_columns.count();
+  std::vector<qint64> keys(static_cast<size_t>(count) * key_count);
+  for (int i = 0; i < count; ++i) {
+    for (int k = 0; k < key_count; ++k) {
+      keys[static_cast<size_t>(i) * key_count + k] = key_columns[k][i];
+    }
+  }
+  key_columns.clear();
+
+  // Equal items keep their order, so the result is the same as a stable sort whichever way the rows are split.
+  const bool ascending = order == Qt::AscendingOrder;
+  auto less = [&keys, key_count, ascending](const int a, const int b) {
+    const qint64 *key_a = &keys[static_cast<size_t>(a) * key_count];
+    const qint64 *key_b = &keys[static_cast<size_t>(b) * key_count];
+    for (int k = 0; k < key_count; ++k) {
+      if (key_a[k] != key_b[k]) return ascending ? key_a[k] < key_b[k] : key_b[k] < key_a[k];
+    }
+    return a < b;
+  };
+
+  std::vector<int> rows(count);
+  std::iota(rows.begin(), rows.end(), 0);
+
+  if (count < kParallelSortMinItems) {
+    std::sort(rows.begin(), rows.end(), less);
+  }
+  else {
+    // Sort runs of rows on the thread pool, then merge pairs of runs until one is left.
+    const int chunk_size = (count + QThread::idealThreadCount() - 1) / qMax(1, QThread::idealThreadCount());
+    QList<QPair<int, int>> runs;
+    for (int first = 0; first < count; first += chunk_size) {
+      runs << qMakePair(first, qMin(first + chunk_size, count));
+    }
+    QtConcurrent::blockingMap(runs, [&rows, &less](const QPair<int, int> &run) {
+      std::sort(rows.begin() + run.first, rows.begin() + run.second, less);
+    });
+    while (runs.count() > 1) {
+      QList<QPair<int, int>> merged;
+      QList<std::array<int, 3>> merges;
+      for (int i = 0; i < runs.count(); i += 2) {
+        if (i + 1 < runs.count()) {
+          merges << std::array<int, 3>{ { runs[i].first, runs[i].second, runs[i + 1].second } };
+          merged << qMakePair(runs[i].first, runs[i + 1].second);
+        }
+        else {
+          merged << runs[i];
+        }
+      }
+      QtConcurrent::blockingMap(merges, [&rows, &less](const std::array<int, 3> &merge) {
+        std::inplace_merge(rows.begin() + merge[0], rows.begin() + merge[1], rows.begin() + merge[2], less);
+      });
+      runs = merged;
+    }
+  }
+
+  PlaylistItemList sorted_items;
+  sorted_items.reserve(count);
+  for (const int row : rows) sorted_items << items[row];
+
+  return sorted_items;
+
+}
+
 QString Playlist::column_name(Column column) {
 
   switch (column) {
@@ -1321,31 +1677,16 @@ void Playlist::sort(int column, Qt::SortOrder order) {
 
   if (ignore_sorting_) return;
 
-  PlaylistItemList new_items(items_);
-  PlaylistItemList::iterator begin = new_items.begin();
+  if (!LoadAllItemMetadata([this, column, order]() { sort(column, order); })) return;
 
+  int begin = 0;
   if (dynamic_playlist_ && current_item_index_.isValid())
-    begin += current_item_index_.row() + 1;
+    begin = current_item_index_.row() + 1;
 
-  if (column == Column_Album) {
-    // When sorting by album, also take into account discs and tracks.
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Track, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Disc, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Album, order, _1, _2));
-  }
-  else if (column == Column_Filename) {
-    // When sorting by full paths we also expect a hierarchical order. This returns a breath-first ordering of paths.
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, Column_Filename, order, _1, _2));
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::ComparePathDepths, order, _1, _2));
-  }
-  else {
-    std::stable_sort(begin, new_items.end(), std::bind(&Playlist::CompareItems, column, order, _1, _2));
-  }
+  PlaylistItemList new_items = items_.mid(0, begin) + SortItems(items_.mid(begin), column, order);
 
   undo_stack_->push(new PlaylistUndoCommands::SortItems(this, column, order, new_items));
 
-  ReshuffleIndices();
-
 }
 
 void Playlist::ReOrderWithoutUndo(const PlaylistItemList &new_items) {
@@ -1365,8 +1706,15 @@ void Playlist::ReOrderWithoutUndo(const PlaylistItemList &new_items) {
     changePersistentIndex(idx, index(new_rows[item], idx.column(), idx.parent()));
   }
 
+  ReorderVirtualItems(old_items);
+  if (current_row() != -1) {
+    current_virtual_index_ = virtual_items_.indexOf(current_row());
+  }
+
   layoutChanged();
 
+  RenumberPositions();
+
   emit PlaylistChanged();
   Save();
 
@@ -1388,11 +1736,123 @@ void Playlist::SetCurrentIsPaused(const bool paused) {
     dataChanged(index(current_item_index_.row(), 0), index(current_item_index_.row(), ColumnCount - 1));
 }
 
-void Playlist::Save() const {
+void Playlist::Save() {
+
+  // The pages of a restore are read from the saved playlist, so it's not changed until the restore is finished.
+  // The changes are kept until then, FinishRestore() saves them when exiting before that.
+  if (is_loading_ || (restoring_ && !cancel_restore_)) return;
+
+  if (!backend_) {
+    pending_changes_.clear();
+    return;
+  }
+
+  // If the changes can't be written, SaveFailed() makes the next save rewrite the whole playlist.
+  backend_->SavePlaylistAsync(id_, pending_changes_, last_played_row(), dynamic_playlist_);
+  pending_changes_.clear();
+
+}
+
+void Playlist::SaveFailed(const int playlist) {
+
+  if (playlist != id_) return;
+
+  // The changes saved after the failed ones can be missing rows too, so rewrite everything rather than retrying them.
+  RenumberPositions();
+
+}
+
+void Playlist::SaveItems(const PlaylistItemList &items) {
+
+  for (PlaylistItemPtr item : items) {
+    for (int row = 0; row < items_.count(); ++row) {
+      if (items_[row] == item) RecordUpdate(row);
+    }
+  }
+
+  Save();
+
+}
+
+bool Playlist::AssignPositions(const QList<int> &rows) {
+
+  int i = 0;
+  while (i < rows.count()) {
+    // Find the run of consecutive rows starting here, the items on both sides of it keep their positions.
+    int end = i + 1;
+    while (end < rows.count() && rows[end] == rows[end - 1] + 1) ++end;
+    const int first_row = rows[i];
+    const int last_row = rows[end - 1];
+    const qint64 count = end - i;
+
+    const qint64 lower = first_row > 0 ? positions_[first_row - 1] : 0;
+    const qint64 upper = last_row + 1 < positions_.count() ? positions_[last_row + 1] : lower + (count + 1) * kPositionStep;
+    const qint64 step = (upper - lower) / (count + 1);
+    if (step < 1) return false;
+
+    for (int row = first_row; row <= last_row; ++row) {
+      positions_[row] = lower + (row - first_row + 1) * step;
+    }
+    i = end;
+  }
+
+  return true;
+
+}
+
+void Playlist::RenumberPositions() {
+
+  // The rewrite replaces anything that hasn't been saved yet.
+  pending_changes_.clear();
+  pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Clear, PlaylistItemPtr(), 0);
+  positions_.clear();
+  for (int i = 0; i < items_.count(); ++i) {
+    positions_ << (i + 1) * kPositionStep;
+    pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Insert, items_[i], positions_[i]);
+  }
+
+}
+
+void Playlist::RecordInserts(const int start, const int end) {
+
+  QList<int> rows;
+  for (int i = start; i <= end; ++i) rows << i;
+
+  if (!AssignPositions(rows)) {
+    RenumberPositions();
+    return;
+  }
+
+  for (int i = start; i <= end; ++i) {
+    pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Insert, items_[i], positions_[i]);
+  }
+
+}
+
+void Playlist::RecordMoves(const QList<int> &rows) {
 
-  if (!backend_ || is_loading_) return;
+  QList<qint64> old_positions;
+  for (int row : rows) old_positions << positions_[row];
 
-  backend_->SavePlaylistAsync(id_, items_, last_played_row(), dynamic_playlist_);
+  if (!AssignPositions(rows)) {
+    RenumberPositions();
+    return;
+  }
+
+  for (int i = 0; i < rows.count(); ++i) {
+    const int row = rows[i];
+    if (positions_[row] != old_positions[i]) {
+      pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Move, items_[row], positions_[row], old_positions[i]);
+    }
+  }
+
+}
+
+void Playlist::RecordUpdate(const int row) {
+
+  if (is_loading_) return;
+
+  pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Update, items_[row], positions_[row]);
 
 }
 
@@ -1401,43 +1861,141 @@ void Playlist::Restore() {
   if (!backend_) return;
 
   items_.clear();
-  virtual_items_.clear();
+  positions_.clear();
+  virtual_items_.Clear();
   collection_items_by_id_.clear();
 
   cancel_restore_ = false;
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-  QFuture<QList<PlaylistItemPtr>> future = QtConcurrent::run(&PlaylistBackend::GetPlaylistItems, backend_, id_);
-#else
-  QFuture<QList<PlaylistItemPtr>> future = QtConcurrent::run(backend_, &PlaylistBackend::GetPlaylistItems, id_);
-#endif
-  NewClosure(future, this, SLOT(ItemsLoaded(QFuture<PlaylistItemList>)), future);
+  restoring_ = true;
+  restore_position_ = std::numeric_limits<qint64>::min();
+  restore_skip_ = 0;
+  restore_last_played_ = backend_->GetPlaylist(id_).last_played;
+  last_played_restored_ = false;
+
+  QSettings s;
+  s.beginGroup(kSettingsGroup);
+  restore_greyout_ = s.value("greyout_songs_startup", true).toBool();
+  s.endGroup();
+
+  RestorePage();
 
 }
 
-void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
+void Playlist::RestorePage() {
 
-  if (cancel_restore_) return;
+  QFuture<RestorePageResult> future = QtConcurrent::run(&Playlist::LoadRestorePage, backend_, id_, restore_position_, restore_skip_, restore_greyout_);
+  NewClosure(future, this, SLOT(ItemsLoaded(QFuture<Playlist::RestorePageResult>)), future);
 
-  PlaylistItemList items = future.result();
+}
+
+Playlist::RestorePageResult Playlist::LoadRestorePage(PlaylistBackend *backend, const int playlist, const qint64 position, const int skip, const bool greyout) {
+
+  RestorePageResult page;
+  page.items = backend->GetPlaylistItemsPage(playlist, position, skip, kRestorePageSize, &page.positions);
+  const PlaylistItemList &items = page.items;
+
+  // Gray out deleted songs here, before the items are in the playlist.
+  if (greyout) {
+    for (PlaylistItemPtr item : items) {
+      const QUrl url = item->Url();
+      if (url.isLocalFile() && !QFile::exists(url.toLocalFile())) {
+        item->SetForegroundColor(kInvalidSongPriority, kInvalidSongColor);
+      }
+    }
+  }
+
+  return page;
+
+}
+
+void Playlist::ItemsLoaded(QFuture<Playlist::RestorePageResult> future) {
+
+  // FinishRestore() loaded the pages that were left itself.
+  if (cancel_restore_ || !restoring_) return;
+
+  AddRestorePage(future.result());
+  if (restoring_) RestorePage();
+
+}
+
+void Playlist::FinishRestore() {
+
+  if (!restoring_ || cancel_restore_) return;
+
+  // Edits are only saved once the restore is finished, as they're saved on top of the rows of the whole playlist.
+  if (pending_changes_.isEmpty() && last_played_row() == restore_last_played_) return;
+
+  while (restoring_) {
+    AddRestorePage(LoadRestorePage(backend_, id_, restore_position_, restore_skip_, restore_greyout_));
+  }
+
+}
+
+void Playlist::AddRestorePage(const RestorePageResult &page) {
+
+  const QList<qint64> &positions = page.positions;
+
+  // The next page starts at the position of the last item of this one.
+  const bool finished = page.items.count() < kRestorePageSize;
+  if (!positions.isEmpty()) {
+    const qint64 position = positions.last();
+    int skip = 0;
+    for (int i = positions.count() - 1; i >= 0 && positions[i] == position; --i) {
+      ++skip;
+    }
+    if (skip == positions.count() && position == restore_position_) skip += restore_skip_;
+    restore_position_ = position;
+    restore_skip_ = skip;
+  }
 
   // Backend returns empty elements for collection items which it couldn't match (because they got deleted); we don't need those
-  QMutableListIterator<PlaylistItemPtr> it(items);
-  while (it.hasNext()) {
-    PlaylistItemPtr item = it.next();
+  PlaylistItemList items;
+  QHash<const PlaylistItem*, qint64> item_positions;
+  for (int i = 0; i < page.items.count(); ++i) {
+    PlaylistItemPtr item = page.items[i];
+    if (item->IsLocalCollectionItem() && item->Metadata().id() == -1) {
+      pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Remove, item, positions[i]);
+      continue;
+    }
+    items << item;
+    item_positions.insert(item.get(), positions[i]);
+  }
 
-    if (item->IsLocalCollectionItem() && item->Metadata().url().isEmpty()) {
-      it.remove();
+  if (!items.isEmpty()) {
+    const int start = rowCount();
+    is_loading_ = true;
+    InsertItems(items, -1);
+    is_loading_ = false;
+    // The loaded items are new objects, so they can be found by their address.
+    for (int row = start; row < items_.count(); ++row) {
+      positions_[row] = item_positions.value(items_[row].get());
     }
   }
 
-  is_loading_ = true;
-  InsertItems(items, 0);
-  is_loading_ = false;
+  // The playlist can be used as soon as the last played song is in it, the rest keeps loading in the background.
+  if (!last_played_restored_ && (finished || restore_last_played_ < rowCount())) {
+    // The newly loaded list of items might be shorter than it was before so look out for a bad last_played index
+    last_played_item_index_ = restore_last_played_ == -1 || restore_last_played_ >= rowCount() ? QModelIndex() : index(restore_last_played_);
+    last_played_restored_ = true;
+    emit RestoreFinished();
+    emit PlaylistLoaded();
+  }
+
+  if (!finished) return;
+  restoring_ = false;
 
-  PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
+  // Position keys should be unique and in playlist order, but rewrite the playlist if they're not rather than saving on top of broken rows.
+  // Items added while restoring can also have taken the positions of items that were loaded after them.
+  for (int i = 1; i < positions_.count(); ++i) {
+    if (positions_[i] <= positions_[i - 1]) {
+      qLog(Debug) << "Renumbering playlist" << id_;
+      RenumberPositions();
+      break;
+    }
+  }
+  if (!pending_changes_.isEmpty() || last_played_row() != restore_last_played_) Save();
 
-  // The newly loaded list of items might be shorter than it was before so look out for a bad last_played index
-  last_played_item_index_ = p.last_played == -1 || p.last_played >= rowCount() ? QModelIndex() : index(p.last_played);
+  PlaylistBackend::Playlist p = backend_->GetPlaylist(id_);
 
   if (p.dynamic_type == PlaylistGenerator::Type_Query) {
     PlaylistGeneratorPtr gen = PlaylistGenerator::Create(p.dynamic_type);
@@ -1455,24 +2013,6 @@ void Playlist::ItemsLoaded(QFuture<PlaylistItemList> future) {
     }
   }
 
-  emit RestoreFinished();
-
-  QSettings s;
-  s.beginGroup(kSettingsGroup);
-  bool greyout = s.value("greyout_songs_startup", true).toBool();
-  s.endGroup();
-
-  // Should we gray out deleted songs asynchronously on startup?
-  if (greyout) {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    (void)QtConcurrent::run(&Playlist::InvalidateDeletedSongs, this);
-#else
-    (void)QtConcurrent::run(this, &Playlist::InvalidateDeletedSongs);
-#endif
-  }
-
-  emit PlaylistLoaded();
-
 }
 
 static bool DescendingIntLessThan(int a, int b) { return a > b; }
@@ -1555,11 +2095,20 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(const int row, const int count
   }
   beginRemoveRows(QModelIndex(), row, row + count - 1);
 
+  const bool clear = count == items_.count();
+  if (clear) {
+    pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Clear, PlaylistItemPtr(), 0);
+  }
+
   // Remove items
   PlaylistItemList ret;
   for (int i = 0; i < count; ++i) {
     PlaylistItemPtr item(items_.takeAt(row));
+    const qint64 position = positions_.takeAt(row);
     ret << item;
+    if (!clear) {
+      pending_changes_ << PlaylistBackend::ItemChange(PlaylistBackend::ItemChange::Type_Remove, item, position);
+    }
 
     if (item->source() == Song::Source_Collection) {
       int id = item->Metadata().id();
@@ -1571,13 +2120,7 @@ PlaylistItemList Playlist::RemoveItemsWithoutUndo(const int row, const int count
 
   endRemoveRows();
 
-  QList<int>::iterator it = virtual_items_.begin();
-  while (it != virtual_items_.end()) {
-    if (*it >= items_.count())
-      it = virtual_items_.erase(it);
-    else
-      ++it;
-  }
+  virtual_items_.RemoveRows(row, count);
 
   // Reset current_virtual_index_
   if (current_row() == -1)
@@ -1644,6 +2187,13 @@ bool Playlist::stop_after_current() const {
 
 }
 
+const Song *Playlist::metadata_at(const int index) const {
+
+  if (!has_item_at(index) || !items_[index]->HasMetadata()) return nullptr;
+  return &items_[index]->MetadataRef();
+
+}
+
 PlaylistItemPtr Playlist::current_item() const {
 
   // QList[] runs in constant time, so no need to cache current_item
@@ -1734,12 +2284,16 @@ void Playlist::RemoveItemsNotInQueue() {
 
 void Playlist::ReloadItems(const QList<int> &rows) {
 
+  // Collection items that aren't loaded yet don't reload, they get the metadata from the collection first.
+  LoadItemMetadataNow(rows);
+
   for (int row : rows) {
     PlaylistItemPtr item = item_at(row);
 
     Song old_metadata = item->Metadata();
 
     item->Reload();
+    RecordUpdate(row);
 
     if (row == current_row()) {
       const bool minor = old_metadata.title() == item->Metadata().title() &&
@@ -1796,88 +2350,32 @@ void Playlist::Shuffle() {
 
 }
 
-namespace {
-bool AlbumShuffleComparator(const QMap<QString, int> &album_key_positions, const QMap<int, QString> &album_keys, const int left, const int right) {
-
-  const int left_pos = album_key_positions[album_keys[left]];
-  const int right_pos = album_key_positions[album_keys[right]];
-
-  if (left_pos == right_pos) return left < right;
-  return left_pos < right_pos;
-
-}
-}
-
 void Playlist::ReshuffleIndices() {
 
   if (!playlist_sequence_) {
     return;
   }
 
-  if (playlist_sequence_->shuffle_mode() == PlaylistSequence::Shuffle_Off) {
-    // No shuffling - sort the virtual item list normally.
-    std::sort(virtual_items_.begin(), virtual_items_.end());
-    if (current_row() != -1)
-      current_virtual_index_ = virtual_items_.indexOf(current_row());
-    return;
-  }
-
-  // If the user is already playing a song, advance the begin iterator to only shuffle items that haven't been played yet.
-  QList<int>::iterator begin = virtual_items_.begin();
-  QList<int>::iterator end = virtual_items_.end();
-  if (current_virtual_index_ != -1)
-    std::advance(begin, current_virtual_index_ + 1);
-
-  std::random_device rd;
-  std::mt19937 g(rd());
-
-  switch (playlist_sequence_->shuffle_mode()) {
-    case PlaylistSequence::Shuffle_Off:
-      // Handled above.
-      break;
-
-    case PlaylistSequence::Shuffle_All:
-    case PlaylistSequence::Shuffle_InsideAlbum:
-      std::shuffle(begin, end, g);
-      break;
-
-    case PlaylistSequence::Shuffle_Albums: {
-      QMap<int, QString> album_keys;  // real index -> key
-      QSet<QString> album_key_set;    // unique keys
-
-      // Find all the unique albums in the playlist
-      for (QList<int>::iterator it = begin; it != end; ++it) {
-        const int index = *it;
-        const QString key = items_[index]->Metadata().AlbumKey();
-        album_keys[index] = key;
-        album_key_set << key;
-      }
+  const PlaylistSequence::ShuffleMode shuffle_mode = playlist_sequence_->shuffle_mode();
 
-      // Shuffle them
-      QStringList shuffled_album_keys = album_key_set.values();
-      std::shuffle(shuffled_album_keys.begin(), shuffled_album_keys.end(), g);
-
-      // If the user is currently playing a song, force its album to be first
-      // Or if the song was not playing but it was selected, force its album to be first.
-      if (current_virtual_index_ != -1 || current_row() != -1) {
-        const QString key = items_[current_row()]->Metadata().AlbumKey();
-        const int pos = shuffled_album_keys.indexOf(key);
-        if (pos >= 1) {
-          std::swap(shuffled_album_keys[0], shuffled_album_keys[pos]);
-        }
-      }
-
-      // Create album key -> position mapping for fast lookup
-      QMap<QString, int> album_key_positions;
-      for (int i = 0; i < shuffled_album_keys.count(); ++i) {
-        album_key_positions[shuffled_album_keys[i]] = i;
-      }
-
-      // Sort the virtual items
-      std::stable_sort(begin, end, std::bind(AlbumShuffleComparator, album_key_positions, album_keys, _1, _2));
-
-      break;
+  QStringList album_keys;
+  int first_album_row = -1;
+  if (shuffle_mode == PlaylistSequence::Shuffle_Albums) {
+    if (!LoadAllItemMetadata([this]() { ReshuffleIndices(); })) return;
+    album_keys.reserve(items_.count());
+    for (const PlaylistItemPtr &item : items_) {
+      album_keys << item->Metadata().AlbumKey();
     }
+    // If the user is currently playing a song, force its album to be first
+    // Or if the song was not playing but it was selected, force its album to be first.
+    first_album_row = current_row();
+  }
+
+  // If the user is already playing a song, only shuffle items that haven't been played yet.
+  // Without shuffle the virtual index is the row.
+  virtual_items_.Shuffle(shuffle_mode, current_virtual_index_ + 1, album_keys, first_album_row);
+  if (shuffle_mode == PlaylistSequence::Shuffle_Off && current_row() != -1) {
+    current_virtual_index_ = virtual_items_.indexOf(current_row());
   }
 
 }
@@ -1893,7 +2391,14 @@ void Playlist::set_sequence(PlaylistSequence *v) {
 
 QSortFilterProxyModel *Playlist::proxy() const { return proxy_; }
 
-SongList Playlist::GetAllSongs() const {
+SongList Playlist::GetAllSongs() {
+
+  // The callers need the songs now, load what the view hasn't loaded yet.
+  QList<int> rows;
+  for (int row = 0; row < items_.count(); ++row) {
+    if (!items_[row]->HasMetadata()) rows << row;
+  }
+  LoadItemMetadataNow(rows);
 
   SongList ret;
   for (PlaylistItemPtr item : items_) {
@@ -1955,6 +2460,129 @@ void Playlist::QueueLayoutChanged() {
 
 }
 
+void Playlist::LoadItemMetadata(const QList<int> &rows) {
+
+  QList<int> ids;
+  for (int row : rows) {
+    if (row < 0 || row >= items_.count() || items_[row]->HasMetadata()) continue;
+    const int id = items_[row]->Metadata().id();
+    if (!loading_metadata_ids_.contains(id)) {
+      loading_metadata_ids_ << id;
+      ids << id;
+    }
+  }
+  if (ids.isEmpty()) return;
+
+  if (!collection_) {
+    for (int id : ids) loading_metadata_ids_.remove(id);
+    SetItemMetadata(ids, SongList());
+    return;
+  }
+
+  QFuture<SongList> future = QtConcurrent::run(&Playlist::LoadItemSongs, collection_, ids);
+  NewClosure(future, this, SLOT(ItemMetadataLoaded(QFuture<SongList>, QList<int>)), future, ids);
+
+}
+
+bool Playlist::LoadAllItemMetadata(std::function<void()> callback) {
+
+  QList<int> rows;
+  for (int row = 0; row < items_.count(); ++row) {
+    if (!items_[row]->HasMetadata()) rows << row;
+  }
+  if (rows.isEmpty()) return true;
+
+  LoadItemMetadata(rows);
+  if (loading_metadata_ids_.isEmpty()) return true;
+
+  metadata_loaded_callbacks_ << callback;
+  return false;
+
+}
+
+void Playlist::LoadItemMetadataNow(const QList<int> &rows) {
+
+  QList<int> ids;
+  for (int row : rows) {
+    if (row < 0 || row >= items_.count() || items_[row]->HasMetadata()) continue;
+    ids << items_[row]->Metadata().id();
+  }
+  // Same batches as the background loading, so a large playlist doesn't become one huge query.
+  for (int i = 0; i < ids.count(); i += kMetadataBatchSize) {
+    const QList<int> batch_ids = ids.mid(i, kMetadataBatchSize);
+    SetItemMetadata(batch_ids, collection_ ? collection_->GetSongsById(batch_ids) : SongList());
+  }
+
+}
+
+SongList Playlist::LoadItemSongs(CollectionBackend *collection, const QList<int> &ids) {
+
+  SongList songs;
+  for (int i = 0; i < ids.count(); i += kMetadataBatchSize) {
+    songs << collection->GetSongsById(ids.mid(i, kMetadataBatchSize));
+  }
+  collection->Close();
+
+  return songs;
+
+}
+
+void Playlist::ItemMetadataLoaded(QFuture<SongList> future, const QList<int> &ids) {
+
+  for (int id : ids) loading_metadata_ids_.remove(id);
+
+  SetItemMetadata(ids, future.result());
+
+  if (!loading_metadata_ids_.isEmpty()) return;
+
+  // The callbacks can start loading items that were added meanwhile, which queues them again.
+  const QList<std::function<void()>> callbacks = metadata_loaded_callbacks_;
+  metadata_loaded_callbacks_.clear();
+  for (const std::function<void()> &callback : callbacks) {
+    callback();
+  }
+
+}
+
+void Playlist::SetItemMetadata(const QList<int> &ids, const SongList &songs) {
+
+  QSet<const PlaylistItem*> changed_items;
+  for (const Song &song : songs) {
+    for (PlaylistItemPtr item : collection_items_by_id_.values(song.id())) {
+      if (!item->HasMetadata()) {
+        std::static_pointer_cast<CollectionPlaylistItem>(item)->SetMetadata(song);
+        changed_items << item.get();
+      }
+    }
+  }
+
+  // Songs removed from the collection since the playlist was restored only have what was restored, grey them out so they're not loaded again.
+  for (int id : ids) {
+    for (PlaylistItemPtr item : collection_items_by_id_.values(id)) {
+      if (!item->HasMetadata()) {
+        std::static_pointer_cast<CollectionPlaylistItem>(item)->SetMetadata(item->Metadata());
+        item->SetForegroundColor(kInvalidSongPriority, kInvalidSongColor);
+        changed_items << item.get();
+      }
+    }
+  }
+
+  if (changed_items.isEmpty()) return;
+
+  int first_row = -1;
+  int last_row = -1;
+  for (int row = 0; row < items_.count(); ++row) {
+    if (changed_items.contains(items_[row].get())) {
+      if (first_row == -1) first_row = row;
+      last_row = row;
+    }
+  }
+  if (first_row != -1) {
+    emit dataChanged(index(first_row, 0), index(last_row, ColumnCount - 1));
+  }
+
+}
+
 void Playlist::ItemChanged(const int row) {
 
   QModelIndex idx = index(row, ColumnCount - 1);
@@ -2057,6 +2685,8 @@ struct SongSimilarEqual {
 
 void Playlist::RemoveDuplicateSongs() {
 
+  if (!LoadAllItemMetadata([this]() { RemoveDuplicateSongs(); })) return;
+
   QList<int> rows_to_remove;
   std::unordered_map<Song, int, SongSimilarHash, SongSimilarEqual> unique_songs;
 
@@ -2181,6 +2811,7 @@ void Playlist::AlbumCoverLoaded(const Song &song, const AlbumCoverLoaderResult &
     if (item && item->Metadata() == song && (!item->Metadata().art_manual_is_valid() || (result.type == AlbumCoverLoaderResult::Type_ManuallyUnset && !item->Metadata().has_manually_unset_cover()))) {
       qLog(Debug) << "Updating art manual for local song" << song.title() << song.album() << song.title() << "to" << result.cover_url << "in playlist.";
       item->SetArtManual(result.cover_url);
+      RecordUpdate(current_row());
       Save();
     }
   }
@@ -24,6 +24,8 @@
 
 #include "config.h"
 
+#include <functional>
+
 #include <QtGlobal>
 #include <QObject>
 #include <QAbstractItemModel>
@@ -31,8 +33,10 @@
 #include <QPersistentModelIndex>
 #include <QFuture>
 #include <QList>
+#include <QVector>
 #include <QMap>
 #include <QMultiMap>
+#include <QSet>
 #include <QMetaType>
 #include <QVariant>
 #include <QString>
@@ -45,7 +49,9 @@
 #include "core/tagreaderclient.h"
 #include "covermanager/albumcoverloaderresult.h"
 #include "playlistitem.h"
+#include "playlistbackend.h"
 #include "playlistsequence.h"
+#include "playlistvirtualitems.h"
 #include "smartplaylists/playlistgenerator_fwd.h"
 
 class QMimeData;
@@ -53,7 +59,6 @@ class QSortFilterProxyModel;
 class QUndoStack;
 
 class CollectionBackend;
-class PlaylistBackend;
 class PlaylistFilter;
 class Queue;
 class TaskManager;
@@ -175,7 +180,18 @@ class Playlist : public QAbstractListModel {
   static const qint64 kMinScrobblePointNsecs;
   static const qint64 kMaxScrobblePointNsecs;
 
+  static const qint64 kPositionStep;
+
+  static const int kMetadataBatchSize;
+
+  static const int kParallelSortMinItems;
+
+  static const int kRestorePageSize;
+
   static bool CompareItems(const int column, const Qt::SortOrder order, PlaylistItemPtr a, PlaylistItemPtr b);
+  // Returns the items in the order sort() puts them in, stable like sorting with CompareItems() but the keys are computed once per item.
+  // Sorting by album also sorts by disc and track, sorting by file name sorts by path depth first.
+  static PlaylistItemList SortItems(const PlaylistItemList &items, const int column, const Qt::SortOrder order);
 
   static QString column_name(Column column);
   static QString abbreviated_column_name(Column column);
@@ -183,15 +199,34 @@ class Playlist : public QAbstractListModel {
   static bool column_is_editable(Playlist::Column column);
   static bool set_column_value(Song &song, Column column, const QVariant &value);
 
+  // Typed versions of what data() returns for Qt::DisplayRole, used by the view's delegates and the filter so they don't wrap every cell in a QVariant.
+  // Numeric columns are only available through column_number(), column_text() returns them the way QVariant::toString() would.
+  static bool column_is_numeric(const Column column);
+  static qint64 column_number(const Song &song, const Column column);
+  static QString column_text(const Song &song, const Column column);
+
   // Persistence
-  void Save() const;
+  void Save();
   void Restore();
+  // Loads the rest of a playlist that is still being restored right away, so the edits made meanwhile can be saved.
+  void FinishRestore();
+  // Saves the metadata of items that were changed outside of the playlist, items not in this playlist are ignored.
+  void SaveItems(const PlaylistItemList &items);
+
+  // Restored collection items only know their id, length and URL, this loads the metadata of the items in the rows that haven't got it yet in the background.
+  // The view loads the rows it shows.
+  void LoadItemMetadata(const QList<int> &rows);
+  // Returns true if every item has its metadata, otherwise the missing metadata is loaded in the background and callback is called when it's there.
+  // Anything reading the metadata of the whole playlist should return and wait for the callback when this returns false.
+  bool LoadAllItemMetadata(std::function<void()> callback);
 
   // Accessors
   QSortFilterProxyModel *proxy() const;
   Queue *queue() const { return queue_; }
 
   int id() const { return id_; }
+  // Sort key of the row in the playlist_items table, 0 if the row hasn't been given one yet.
+  qint64 position_at(const int row) const { return positions_[row]; }
   const QString &ui_path() const { return ui_path_; }
   void set_ui_path(const QString &path) { ui_path_ = path; }
   bool is_favorite() const { return favorite_; }
@@ -214,6 +249,8 @@ class Playlist : public QAbstractListModel {
 
   const PlaylistItemPtr &item_at(const int index) const { return items_[index]; }
   bool has_item_at(const int index) const { return index >= 0 && index < rowCount(); }
+  // The song shown in the row, or nullptr if the item's metadata isn't loaded yet. Only valid until the playlist changes.
+  const Song *metadata_at(const int index) const;
 
   PlaylistItemPtr current_item() const;
 
@@ -222,7 +259,7 @@ class Playlist : public QAbstractListModel {
 
   PlaylistItemList collection_items_by_id(const int id) const;
 
-  SongList GetAllSongs() const;
+  SongList GetAllSongs();
   PlaylistItemList GetAllItems() const;
   quint64 GetTotalLength() const;  // in seconds
 
@@ -344,6 +381,16 @@ class Playlist : public QAbstractListModel {
   void QueueChanged();
 
  private:
+  // A page of a restored playlist and the position keys of its items.
+  struct RestorePageResult {
+    PlaylistItemList items;
+    QList<qint64> positions;
+  };
+
+  // One sort key per item for the column, strings are replaced by their rank in the order CompareItems() sorts them in.
+  static QVector<qint64> SortKeys(const PlaylistItemList &items, const int column);
+  static QVector<qint64> SortRanks(const QStringList &strings, const bool locale_aware);
+
   void SetCurrentIsPaused(const bool paused);
   int NextVirtualIndex(int i, const bool ignore_repeat_track) const;
   int PreviousVirtualIndex(int i, const bool ignore_repeat_track) const;
@@ -360,6 +407,26 @@ class Playlist : public QAbstractListModel {
   void MoveItemsWithoutUndo(int start, const QList<int> &dest_rows);
   void ReOrderWithoutUndo(const PlaylistItemList &new_items);
 
+  // Gives the items in the sorted rows new position keys between their neighbours, returns false if there's no room left between them.
+  bool AssignPositions(const QList<int> &rows);
+  // Gives all items new evenly spaced position keys, the next save rewrites the whole playlist.
+  void RenumberPositions();
+  void RecordInserts(const int start, const int end);
+  // Loads the metadata right away, for the current item, which the player needs before anything else can happen, and for callers that need the songs now.
+  void LoadItemMetadataNow(const QList<int> &rows);
+  // Items whose ids aren't in songs were removed from the collection.
+  void SetItemMetadata(const QList<int> &ids, const SongList &songs);
+  static SongList LoadItemSongs(CollectionBackend *collection, const QList<int> &ids);
+
+  void RestorePage();
+  static RestorePageResult LoadRestorePage(PlaylistBackend *backend, const int playlist, const qint64 position, const int skip, const bool greyout);
+  // Adds the items of a page to the playlist, restoring_ is false after the last page.
+  void AddRestorePage(const RestorePageResult &page);
+  void InsertVirtualItems(const int start, const int end);
+  void ReorderVirtualItems(const PlaylistItemList &old_items);
+  void RecordMoves(const QList<int> &rows);
+  void RecordUpdate(const int row);
+
   void RemoveItemsNotInQueue();
 
   // Removes rows with given indices from this playlist.
@@ -375,9 +442,11 @@ class Playlist : public QAbstractListModel {
   void QueueLayoutChanged();
   void SongSaveComplete(TagReaderReply *reply, const QPersistentModelIndex &index);
   void ItemReloadComplete(const QPersistentModelIndex &index);
-  void ItemsLoaded(QFuture<PlaylistItemList> future);
+  void ItemsLoaded(QFuture<Playlist::RestorePageResult> future);
+  void SaveFailed(const int playlist);
   void SongInsertVetoListenerDestroyed();
   void AlbumCoverLoaded(const Song &song, const AlbumCoverLoaderResult &result);
+  void ItemMetadataLoaded(QFuture<SongList> future, const QList<int> &ids);
 
  private:
   bool is_loading_;
@@ -394,9 +463,14 @@ class Playlist : public QAbstractListModel {
   bool favorite_;
 
   PlaylistItemList items_;
+  // Position keys of the rows of items_, they're kept here and not in the items as an item can be in more than one playlist.
+  QList<qint64> positions_;
+
+  // Changes to items_ since the last save.
+  PlaylistBackend::ItemChangeList pending_changes_;
 
   // Contains the indices into items_ in the order that they will be played.
-  QList<int> virtual_items_;
+  PlaylistVirtualItems virtual_items_;
 
   // A map of collection ID to playlist item - for fast lookups when collection items change.
   QMultiMap<int, PlaylistItemPtr> collection_items_by_id_;
@@ -424,6 +498,14 @@ class Playlist : public QAbstractListModel {
 
   // Cancel async restore if songs are already replaced
   bool cancel_restore_;
+  // The playlist is restored in pages, changes made meanwhile are saved when it's finished.
+  bool restoring_;
+  // The next page starts at this position after skipping the items with it that were already loaded.
+  qint64 restore_position_;
+  int restore_skip_;
+  bool restore_greyout_;
+  int restore_last_played_;
+  bool last_played_restored_;
 
   bool scrobbled_;
   qint64 scrobble_point_;
@@ -436,6 +518,10 @@ class Playlist : public QAbstractListModel {
   int sort_column_;
   Qt::SortOrder sort_order_;
 
+  // Collection ids of the items whose metadata is being loaded, and what to call when there's nothing left to load.
+  QSet<int> loading_metadata_ids_;
+  QList<std::function<void()>> metadata_loaded_callbacks_;
+
 };
 
 #endif  // PLAYLIST_H
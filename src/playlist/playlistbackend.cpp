@@ -24,6 +24,7 @@
 #include <memory>
 #include <functional>
 #include <cassert>
+#include <limits>
 
 #include <QObject>
 #include <QApplication>
@@ -35,6 +36,7 @@
 #include <QByteArray>
 #include <QHash>
 #include <QList>
+#include <QSet>
 #include <QVariant>
 #include <QString>
 #include <QStringBuilder>
@@ -59,8 +61,6 @@
 
 using std::placeholders::_1;
 
-const int PlaylistBackend::kSongTableJoins = 2;
-
 PlaylistBackend::PlaylistBackend(Application *app, QObject *parent)
     : QObject(parent), app_(app), db_(app_->database()), original_thread_(nullptr) {
 
@@ -68,6 +68,13 @@ PlaylistBackend::PlaylistBackend(Application *app, QObject *parent)
 
 }
 
+PlaylistBackend::PlaylistBackend(Database *db, QObject *parent)
+    : QObject(parent), app_(nullptr), db_(db), original_thread_(nullptr) {
+
+  original_thread_ = thread();
+
+}
+
 void PlaylistBackend::Close() {
 
   if (db_) {
@@ -173,17 +180,22 @@ PlaylistBackend::Playlist PlaylistBackend::GetPlaylist(int id) {
 
 }
 
-QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist) {
+QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist, const qint64 position, const int skip, const int limit) {
 
-  QMutexLocker l(db_->Mutex());
-  QSqlDatabase db(db_->Connect());
+  QMutexLocker l(db_->ReaderMutex());
+  QSqlDatabase db(db_->ConnectReader());
 
-  QString query = "SELECT songs.ROWID, " + Song::JoinSpec("songs") + ", p.ROWID, " + Song::JoinSpec("p") + ", p.type FROM playlist_items AS p LEFT JOIN songs ON p.collection_id = songs.ROWID WHERE p.playlist = :playlist";
+  // Collection items are only joined with the songs table for their id, length and URL, their metadata is loaded by the playlist when it's needed.
+  // Pages start at a position rather than an offset so they use the position index, the ROWID orders items that share a position.
+  QString query = "SELECT p.ROWID, " + Song::JoinSpec("p") + ", p.type, p.position, songs.ROWID, songs.length, songs.url FROM playlist_items AS p LEFT JOIN songs ON p.collection_id = songs.ROWID WHERE p.playlist = :playlist AND p.position >= :position ORDER BY p.position, p.ROWID LIMIT :limit OFFSET :skip";
   QSqlQuery q(db);
   // Forward iterations only may be faster
   q.setForwardOnly(true);
   q.prepare(query);
   q.bindValue(":playlist", playlist);
+  q.bindValue(":position", position);
+  q.bindValue(":limit", limit);
+  q.bindValue(":skip", skip);
   q.exec();
 
   return q;
@@ -192,18 +204,27 @@ QSqlQuery PlaylistBackend::GetPlaylistRows(int playlist) {
 
 QList<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
 
+  return GetPlaylistItemsPage(playlist, std::numeric_limits<qint64>::min(), 0, -1);
+
+}
+
+QList<PlaylistItemPtr> PlaylistBackend::GetPlaylistItemsPage(int playlist, const qint64 position, const int skip, const int limit, QList<qint64> *positions) {
+
   QList<PlaylistItemPtr> playlistitems;
 
   {
 
-    QSqlQuery q = GetPlaylistRows(playlist);
+    QSqlQuery q = GetPlaylistRows(playlist, position, skip, limit);
     // Note that as this only accesses the query, not the db, we don't need the mutex.
     if (db_->CheckErrors(q)) return QList<PlaylistItemPtr>();
 
     // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
     std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
     while (q.next()) {
-      playlistitems << NewPlaylistItemFromQuery(SqlRow(q), state_ptr);
+      SqlRow row(q);
+      playlistitems << NewPlaylistItemFromQuery(row, state_ptr);
+      // The position follows the playlist_items columns, the ROWID and the type
+      if (positions) *positions << row.value(Song::kColumns.count() + 2).toLongLong();
     }
 
   }
@@ -218,24 +239,31 @@ QList<PlaylistItemPtr> PlaylistBackend::GetPlaylistItems(int playlist) {
 
 QList<Song> PlaylistBackend::GetPlaylistSongs(int playlist) {
 
-  SongList songs;
+  const QList<PlaylistItemPtr> items = GetPlaylistItems(playlist);
 
-  {
-
-    QSqlQuery q = GetPlaylistRows(playlist);
-    // Note that as this only accesses the query, not the db, we don't need the mutex.
-    if (db_->CheckErrors(q)) return QList<Song>();
-
-    // it's probable that we'll have a few songs associated with the same CUE so we're caching results of parsing CUEs
-    std::shared_ptr<NewSongFromQueryState> state_ptr(new NewSongFromQueryState());
-    while (q.next()) {
-      songs << NewSongFromQuery(SqlRow(q), state_ptr);
+  // Load the metadata of the collection items in one go
+  QList<int> collection_ids;
+  for (PlaylistItemPtr item : items) {
+    if (!item->HasMetadata()) collection_ids << item->Metadata().id();
+  }
+  QHash<int, Song> collection_songs;
+  if (!collection_ids.isEmpty()) {
+    for (const Song &song : app_->collection_backend()->GetSongsById(collection_ids)) {
+      collection_songs.insert(song.id(), song);
+    }
+    if (QThread::currentThread() != thread() && QThread::currentThread() != qApp->thread()) {
+      Close();
     }
-
   }
 
-  if (QThread::currentThread() != thread() && QThread::currentThread() != qApp->thread()) {
-    Close();
+  SongList songs;
+  for (PlaylistItemPtr item : items) {
+    if (item->HasMetadata()) {
+      songs << item->Metadata();
+    }
+    else if (collection_songs.contains(item->Metadata().id())) {
+      songs << collection_songs[item->Metadata().id()];
+    }
   }
 
   return songs;
@@ -244,23 +272,16 @@ QList<Song> PlaylistBackend::GetPlaylistSongs(int playlist) {
 
 PlaylistItemPtr PlaylistBackend::NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
 
-  // The song tables get joined first, plus one each for the song ROWIDs
-  const int playlist_row = (Song::kColumns.count() + 1) * kSongTableJoins;
+  // The playlist_items columns come first, plus one for the ROWID
+  const int type_column = Song::kColumns.count() + 1;
 
-  PlaylistItemPtr item(PlaylistItem::NewFromSource(Song::Source(row.value(playlist_row).toInt())));
+  PlaylistItemPtr item(PlaylistItem::NewFromSource(Song::Source(row.value(type_column).toInt())));
   if (item) {
     item->InitFromQuery(row);
-    return RestoreCueData(item, state);
+    item = RestoreCueData(item, state);
   }
-  else {
-    return item;
-  }
-
-}
-
-Song PlaylistBackend::NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state) {
 
-  return NewPlaylistItemFromQuery(row, state)->Metadata();
+  return item;
 
 }
 
@@ -269,7 +290,7 @@ Song PlaylistBackend::NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSon
 PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state) {
 
   // We need collection to run a CueParser; also, this method applies only to file-type PlaylistItems
-  if (item->source() != Song::Source_LocalFile) return item;
+  if (!app_ || item->source() != Song::Source_LocalFile) return item;
 
   CueParser cue_parser(app_->collection_backend());
 
@@ -313,40 +334,28 @@ PlaylistItemPtr PlaylistBackend::RestoreCueData(PlaylistItemPtr item, std::share
 
 }
 
-void PlaylistBackend::SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played, PlaylistGeneratorPtr dynamic) {
+void PlaylistBackend::SavePlaylistAsync(int playlist, const PlaylistBackend::ItemChangeList &changes, int last_played, PlaylistGeneratorPtr dynamic) {
 
-  metaObject()->invokeMethod(this, "SavePlaylist", Qt::QueuedConnection, Q_ARG(int, playlist), Q_ARG(PlaylistItemList, items), Q_ARG(int, last_played), Q_ARG(PlaylistGeneratorPtr, dynamic));
+  metaObject()->invokeMethod(this, "SavePlaylist", Qt::QueuedConnection, Q_ARG(int, playlist), Q_ARG(PlaylistBackend::ItemChangeList, changes), Q_ARG(int, last_played), Q_ARG(PlaylistGeneratorPtr, dynamic));
 
 }
 
-void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList &items, int last_played, PlaylistGeneratorPtr dynamic) {
+void PlaylistBackend::SavePlaylist(int playlist, const PlaylistBackend::ItemChangeList &changes, int last_played, PlaylistGeneratorPtr dynamic) {
 
   QMutexLocker l(db_->Mutex());
   QSqlDatabase db(db_->Connect());
 
-  qLog(Debug) << "Saving playlist" << playlist;
+  qLog(Debug) << "Saving" << changes.count() << "changes to playlist" << playlist;
 
-  QSqlQuery clear(db);
-  clear.prepare("DELETE FROM playlist_items WHERE playlist = :playlist");
-  QSqlQuery insert(db);
-  insert.prepare("INSERT INTO playlist_items (playlist, type, collection_id, " + Song::kColumnSpec + ") VALUES (:playlist, :type, :collection_id, " + Song::kBindSpec + ")");
   QSqlQuery update(db);
   update.prepare("UPDATE playlists SET last_played=:last_played, dynamic_playlist_type=:dynamic_type, dynamic_playlist_data=:dynamic_data, dynamic_playlist_backend=:dynamic_backend WHERE ROWID=:playlist");
 
   ScopedTransaction transaction(&db);
 
-  // Clear the existing items in the playlist
-  clear.bindValue(":playlist", playlist);
-  clear.exec();
-  if (db_->CheckErrors(clear)) return;
-
-  // Save the new ones
-  for (PlaylistItemPtr item : items) {
-    insert.bindValue(":playlist", playlist);
-    item->BindToQuery(&insert);
-
-    insert.exec();
-    db_->CheckErrors(insert);
+  if (!SaveItemChanges(db, playlist, changes)) {
+    qLog(Error) << "Failed to save playlist" << playlist;
+    emit PlaylistSaveFailed(playlist);
+    return;
   }
 
   // Update the last played track number
@@ -363,12 +372,94 @@ void PlaylistBackend::SavePlaylist(int playlist, const PlaylistItemList &items,
   }
   update.bindValue(":playlist", playlist);
   update.exec();
-  if (db_->CheckErrors(update)) return;
+  if (db_->CheckErrors(update)) {
+    emit PlaylistSaveFailed(playlist);
+    return;
+  }
 
   transaction.Commit();
 
 }
 
+bool PlaylistBackend::SaveItemChanges(QSqlDatabase &db, const int playlist, const PlaylistBackend::ItemChangeList &changes) {
+
+  QSqlQuery clear(db);
+  clear.prepare("DELETE FROM playlist_items WHERE playlist = :playlist");
+  QSqlQuery insert(db);
+  insert.prepare("INSERT INTO playlist_items (playlist, position, type, collection_id, " + Song::kColumnSpec + ") VALUES (:playlist, :position, :type, :collection_id, " + Song::kBindSpec + ")");
+  QSqlQuery update_item(db);
+  update_item.prepare("UPDATE playlist_items SET type = :type, collection_id = :collection_id, " + Song::kUpdateSpec + " WHERE playlist = :playlist AND position = :position");
+  QSqlQuery remove(db);
+  remove.prepare("DELETE FROM playlist_items WHERE playlist = :playlist AND position = :position");
+  QSqlQuery move(db);
+  move.prepare("UPDATE playlist_items SET position = :position WHERE playlist = :playlist AND position = :old_position");
+
+  for (int i = 0; i < changes.count(); ++i) {
+    const ItemChange &change = changes[i];
+    switch (change.type) {
+      case ItemChange::Type_Clear:
+        clear.bindValue(":playlist", playlist);
+        clear.exec();
+        if (db_->CheckErrors(clear)) return false;
+        break;
+
+      case ItemChange::Type_Insert:
+        insert.bindValue(":playlist", playlist);
+        insert.bindValue(":position", change.position);
+        change.item->BindToQuery(&insert);
+        insert.exec();
+        if (db_->CheckErrors(insert)) return false;
+        break;
+
+      case ItemChange::Type_Update:
+        change.item->BindToQuery(&update_item);
+        update_item.bindValue(":playlist", playlist);
+        update_item.bindValue(":position", change.position);
+        update_item.exec();
+        if (db_->CheckErrors(update_item) || update_item.numRowsAffected() != 1) return false;
+        break;
+
+      case ItemChange::Type_Remove:
+        remove.bindValue(":playlist", playlist);
+        remove.bindValue(":position", change.position);
+        remove.exec();
+        if (db_->CheckErrors(remove) || remove.numRowsAffected() != 1) return false;
+        break;
+
+      case ItemChange::Type_Move:{
+        // A moved row can take the old position of another row moved in the same run,
+        // so the rows are first parked at their negated old position, which no other row can have.
+        // A run ends at a row that is moved again, as it's only found at its new position after the run.
+        QSet<qint64> new_positions;
+        int end = i;
+        while (end < changes.count() && changes[end].type == ItemChange::Type_Move && !new_positions.contains(changes[end].old_position)) {
+          new_positions << changes[end].position;
+          ++end;
+        }
+        for (int j = i; j < end; ++j) {
+          move.bindValue(":playlist", playlist);
+          move.bindValue(":position", -changes[j].old_position);
+          move.bindValue(":old_position", changes[j].old_position);
+          move.exec();
+          if (db_->CheckErrors(move) || move.numRowsAffected() != 1) return false;
+        }
+        for (int j = i; j < end; ++j) {
+          move.bindValue(":playlist", playlist);
+          move.bindValue(":position", changes[j].position);
+          move.bindValue(":old_position", -changes[j].old_position);
+          move.exec();
+          if (db_->CheckErrors(move) || move.numRowsAffected() != 1) return false;
+        }
+        i = end - 1;
+        break;
+      }
+    }
+  }
+
+  return true;
+
+}
+
 int PlaylistBackend::CreatePlaylist(const QString &name, const QString &special_type) {
 
   QMutexLocker l(db_->Mutex());
@@ -25,13 +25,16 @@
 #include "config.h"
 
 #include <memory>
+#include <limits>
 
+#include <QtGlobal>
 #include <QObject>
 #include <QMutex>
 #include <QHash>
 #include <QList>
 #include <QSet>
 #include <QString>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 
 #include "core/song.h"
@@ -48,6 +51,8 @@ class PlaylistBackend : public QObject {
 
  public:
   Q_INVOKABLE explicit PlaylistBackend(Application *app, QObject *parent = nullptr);
+  // Without an application, items with a CUE sheet aren't reloaded from it.
+  explicit PlaylistBackend(Database *db, QObject *parent = nullptr);
 
   struct Playlist {
     Playlist() : id(-1), favorite(false), last_played(0) {}
@@ -64,7 +69,26 @@ class PlaylistBackend : public QObject {
   };
   typedef QList<Playlist> PlaylistList;
 
-  static const int kSongTableJoins;
+  // A change to the items of a playlist, recorded by Playlist so a save only writes the affected rows.
+  // Rows are identified by their position key, which is unique within a playlist and sorts the rows in playlist order.
+  struct ItemChange {
+    enum Type {
+      Type_Clear,
+      Type_Insert,
+      Type_Update,
+      Type_Remove,
+      Type_Move
+    };
+
+    ItemChange() : type(Type_Clear), position(0), old_position(0) {}
+    ItemChange(const Type _type, PlaylistItemPtr _item, const qint64 _position, const qint64 _old_position = 0) : type(_type), item(_item), position(_position), old_position(_old_position) {}
+
+    Type type;
+    PlaylistItemPtr item;
+    qint64 position;
+    qint64 old_position;
+  };
+  typedef QList<ItemChange> ItemChangeList;
 
   void Close();
   void ExitAsync();
@@ -75,13 +99,16 @@ class PlaylistBackend : public QObject {
   PlaylistBackend::Playlist GetPlaylist(int id);
 
   QList<PlaylistItemPtr> GetPlaylistItems(int playlist);
+  // Returns up to limit items in playlist order from the given position on, after skipping the first skip of them.
+  // The position keys of the items' rows are added to positions.
+  QList<PlaylistItemPtr> GetPlaylistItemsPage(int playlist, const qint64 position, const int skip, const int limit, QList<qint64> *positions = nullptr);
   QList<Song> GetPlaylistSongs(int playlist);
 
   void SetPlaylistOrder(const QList<int> &ids);
   void SetPlaylistUiPath(int id, const QString &path);
 
   int CreatePlaylist(const QString &name, const QString &special_type);
-  void SavePlaylistAsync(int playlist, const PlaylistItemList &items, int last_played, PlaylistGeneratorPtr dynamic);
+  void SavePlaylistAsync(int playlist, const PlaylistBackend::ItemChangeList &changes, int last_played, PlaylistGeneratorPtr dynamic);
   void RenamePlaylist(int id, const QString &new_name);
   void FavoritePlaylist(int id, bool is_favorite);
   void RemovePlaylist(int id);
@@ -90,10 +117,12 @@ class PlaylistBackend : public QObject {
 
  public slots:
   void Exit();
-  void SavePlaylist(int playlist, const PlaylistItemList &items, int last_played, PlaylistGeneratorPtr dynamic);
+  void SavePlaylist(int playlist, const PlaylistBackend::ItemChangeList &changes, int last_played, PlaylistGeneratorPtr dynamic);
 
 signals:
   void ExitFinished();
+  // Nothing of the save was written, the playlist should be saved again in full.
+  void PlaylistSaveFailed(int playlist);
 
  private:
   struct NewSongFromQueryState {
@@ -101,10 +130,11 @@ signals:
     QMutex mutex_;
   };
 
-  QSqlQuery GetPlaylistRows(int playlist);
+  QSqlQuery GetPlaylistRows(int playlist, const qint64 position = std::numeric_limits<qint64>::min(), const int skip = 0, const int limit = -1);
 
-  Song NewSongFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
   PlaylistItemPtr NewPlaylistItemFromQuery(const SqlRow &row, std::shared_ptr<NewSongFromQueryState> state);
+  // Returns false if a change failed or didn't find its row, the changes are only valid if they're all written.
+  bool SaveItemChanges(QSqlDatabase &db, const int playlist, const PlaylistBackend::ItemChangeList &changes);
   PlaylistItemPtr RestoreCueData(PlaylistItemPtr item, std::shared_ptr<NewSongFromQueryState> state);
 
   enum GetPlaylistsFlags {
@@ -119,4 +149,6 @@ signals:
   QThread *original_thread_;
 };
 
+Q_DECLARE_METATYPE(PlaylistBackend::ItemChangeList)
+
 #endif  // PLAYLISTBACKEND_H
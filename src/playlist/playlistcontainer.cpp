@@ -404,6 +404,9 @@ void PlaylistContainer::MaybeUpdateFilter() {
 
 void PlaylistContainer::UpdateFilter() {
 
+  // The filter has to see the metadata of every item, filter again when it's loaded
+  if (!ui_->filter->text().isEmpty() && !manager_->current()->LoadAllItemMetadata([this]() { UpdateFilter(); })) return;
+
   manager_->current()->proxy()->setFilterFixedString(ui_->filter->text());
   ui_->playlist->JumpToCurrentlyPlayingTrack();
 
@@ -29,6 +29,7 @@
 #include <QtConcurrentRun>
 #include <QFuture>
 #include <QAbstractItemModel>
+#include <QAbstractProxyModel>
 #include <QAbstractItemView>
 #include <QCompleter>
 #include <QDateTime>
@@ -205,6 +206,74 @@ QString PlaylistDelegateBase::displayText(const QVariant &value, const QLocale&)
 
 }
 
+QString PlaylistDelegateBase::SongText(const Song &song, const Playlist::Column column, const QLocale&) const {
+
+  QString text;
+  if (Playlist::column_is_numeric(column)) {
+    const qint64 v = Playlist::column_number(song, column);
+    if (v > 0) text = QString::number(v);
+  }
+  else {
+    text = Playlist::column_text(song, column);
+  }
+
+  if (!text.isNull() && !suffix_.isNull()) text += " " + suffix_;
+  return text;
+
+}
+
+const Song *PlaylistDelegateBase::SongForIndex(const QModelIndex &index) {
+
+  QModelIndex source_index = index;
+  const QAbstractProxyModel *proxy = qobject_cast<const QAbstractProxyModel*>(index.model());
+  if (proxy) source_index = proxy->mapToSource(index);
+
+  const Playlist *playlist = qobject_cast<const Playlist*>(source_index.model());
+  if (!playlist) return nullptr;
+
+  return playlist->metadata_at(source_index.row());
+
+}
+
+void PlaylistDelegateBase::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const {
+
+  const Song *song = SongForIndex(index);
+  if (!song) {
+    // Not loaded yet, the view queues loading the visible rows before painting and they are repainted on dataChanged.
+    QueuedItemDelegate::initStyleOption(option, index);
+    return;
+  }
+
+  // This is QStyledItemDelegate::initStyleOption(), except that the text is formatted from the song instead of a QVariant of Qt::DisplayRole.
+  // Playlists have no check state or decoration.
+  QVariant value = index.data(Qt::FontRole);
+  if (value.isValid() && !value.isNull()) {
+    option->font = qvariant_cast<QFont>(value).resolve(option->font);
+    option->fontMetrics = QFontMetrics(option->font);
+  }
+
+  value = index.data(Qt::TextAlignmentRole);
+  if (value.isValid() && !value.isNull()) {
+    option->displayAlignment = Qt::Alignment(value.toInt());
+  }
+
+  value = index.data(Qt::ForegroundRole);
+  if (value.canConvert<QBrush>()) {
+    option->palette.setBrush(QPalette::Text, qvariant_cast<QBrush>(value));
+  }
+
+  option->index = index;
+
+  option->text = SongText(*song, static_cast<Playlist::Column>(index.column()), option->locale);
+  if (!option->text.isNull()) {
+    option->features |= QStyleOptionViewItem::HasDisplay;
+  }
+
+  option->backgroundBrush = qvariant_cast<QBrush>(index.data(Qt::BackgroundRole));
+  option->styleObject = nullptr;
+
+}
+
 QSize PlaylistDelegateBase::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const {
 
   QSize size = QueuedItemDelegate::sizeHint(option, index);
@@ -258,7 +327,8 @@ bool PlaylistDelegateBase::helpEvent(QHelpEvent *event, QAbstractItemView *view,
   if (!event || !view) return false;
 
   QHelpEvent *he = static_cast<QHelpEvent*>(event);
-  QString text = displayText(index.data(), QLocale::system());
+  const Song *song = SongForIndex(index);
+  QString text = song ? SongText(*song, static_cast<Playlist::Column>(index.column()), QLocale::system()) : displayText(index.data(), QLocale::system());
 
   // Special case: we want newlines in the comment tooltip
   if (index.column() == Playlist::Column_Comment) {
@@ -311,6 +381,15 @@ QString LengthItemDelegate::displayText(const QVariant &value, const QLocale&) c
 }
 
 
+QString LengthItemDelegate::SongText(const Song &song, const Playlist::Column column, const QLocale&) const {
+
+  const qint64 nanoseconds = Playlist::column_number(song, column);
+
+  if (nanoseconds > 0) return Utilities::PrettyTimeNanosec(nanoseconds);
+  return QString();
+
+}
+
 QString SizeItemDelegate::displayText(const QVariant &value, const QLocale&) const {
 
   bool ok = false;
@@ -321,6 +400,12 @@ QString SizeItemDelegate::displayText(const QVariant &value, const QLocale&) con
 
 }
 
+QString SizeItemDelegate::SongText(const Song &song, const Playlist::Column column, const QLocale&) const {
+
+  return Utilities::PrettySize(Playlist::column_number(song, column));
+
+}
+
 QString DateItemDelegate::displayText(const QVariant &value, const QLocale &locale) const {
 
   Q_UNUSED(locale);
@@ -335,6 +420,16 @@ QString DateItemDelegate::displayText(const QVariant &value, const QLocale &loca
 
 }
 
+QString DateItemDelegate::SongText(const Song &song, const Playlist::Column column, const QLocale&) const {
+
+  const qint64 time = Playlist::column_number(song, column);
+
+  if (time == -1) return QString();
+
+  return QDateTime::fromSecsSinceEpoch(time).toString(QLocale::system().dateTimeFormat(QLocale::ShortFormat));
+
+}
+
 QString LastPlayedItemDelegate::displayText(const QVariant &value, const QLocale &locale) const {
 
   bool ok = false;
@@ -347,6 +442,16 @@ QString LastPlayedItemDelegate::displayText(const QVariant &value, const QLocale
 
 }
 
+QString LastPlayedItemDelegate::SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const {
+
+  const qint64 time = Playlist::column_number(song, column);
+
+  if (time == -1) return tr("Never");
+
+  return Utilities::Ago(static_cast<int>(time), locale);
+
+}
+
 QString FileTypeItemDelegate::displayText(const QVariant &value, const QLocale &locale) const {
 
   Q_UNUSED(locale);
@@ -360,6 +465,12 @@ QString FileTypeItemDelegate::displayText(const QVariant &value, const QLocale &
 
 }
 
+QString FileTypeItemDelegate::SongText(const Song &song, const Playlist::Column, const QLocale&) const {
+
+  return Song::TextForFiletype(song.filetype());
+
+}
+
 QWidget *TextItemDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &idx) const {
   Q_UNUSED(option);
   Q_UNUSED(idx);
@@ -457,6 +568,18 @@ QString NativeSeparatorsDelegate::displayText(const QVariant &value, const QLoca
 
 }
 
+QString NativeSeparatorsDelegate::SongText(const Song &song, const Playlist::Column column, const QLocale&) const {
+
+  if (column != Playlist::Column_Filename) return QDir::toNativeSeparators(Playlist::column_text(song, column));
+
+  const QUrl &url = song.effective_stream_url();
+  if (url.isLocalFile()) {
+    return QDir::toNativeSeparators(url.toLocalFile());
+  }
+  return url.toString();
+
+}
+
 SongSourceDelegate::SongSourceDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
 
 QString SongSourceDelegate::displayText(const QVariant &value, const QLocale&) const {
@@ -464,6 +587,10 @@ QString SongSourceDelegate::displayText(const QVariant &value, const QLocale&) c
   return QString();
 }
 
+QString SongSourceDelegate::SongText(const Song&, const Playlist::Column, const QLocale&) const {
+  return QString();
+}
+
 QPixmap SongSourceDelegate::LookupPixmap(const Song::Source &source, const QSize &size) const {
 
   QPixmap pixmap;
@@ -488,7 +615,8 @@ void SongSourceDelegate::paint(QPainter *painter, const QStyleOptionViewItem &op
   QStyleOptionViewItem option_copy(option);
   initStyleOption(&option_copy, idx);
 
-  const Song::Source source = Song::Source(idx.data().toInt());
+  const Song *song = SongForIndex(idx);
+  const Song::Source source = song ? song->source() : Song::Source(idx.data().toInt());
   QPixmap pixmap = LookupPixmap(source, option_copy.decorationSize);
 
   QWidget *parent_widget = qobject_cast<QWidget*>(parent());
@@ -514,7 +642,8 @@ void RatingItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &op
 
   const bool hover = mouse_over_index_.isValid() && (mouse_over_index_ == idx || (selected_indexes_.contains(mouse_over_index_) && selected_indexes_.contains(idx)));
 
-  const double rating = (hover ? RatingPainter::RatingForPos(mouse_over_pos_, option.rect) : idx.data().toDouble());
+  const Song *song = SongForIndex(idx);
+  const double rating = (hover ? RatingPainter::RatingForPos(mouse_over_pos_, option.rect) : (song ? song->rating() : idx.data().toDouble()));
 
   painter_.Paint(painter, option.rect, rating);
 
@@ -538,3 +667,14 @@ QString RatingItemDelegate::displayText(const QVariant &value, const QLocale&) c
   return QString::number(rating, 'f', 1);
 
 }
+
+QString RatingItemDelegate::SongText(const Song &song, const Playlist::Column, const QLocale&) const {
+
+  if (song.rating() <= 0) return QString();
+
+  // Round to the nearest 0.5
+  const double rating = float(int(song.rating() * RatingPainter::kStarCount * 2 + 0.5)) / 2;
+
+  return QString::number(rating, 'f', 1);
+
+}
@@ -89,12 +89,20 @@ class PlaylistDelegateBase : public QueuedItemDelegate {
 
   QStyleOptionViewItem Adjusted(const QStyleOptionViewItem &option, const QModelIndex &index) const;
 
+  // Like displayText(), but formats the column straight from the song, subclasses overriding one should override both.
+  virtual QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const;
+
   static const int kMinHeight;
 
  public slots:
   bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option, const QModelIndex &index) override;
 
  protected:
+  void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+
+  // The song shown at the index, or nullptr if the item's metadata isn't loaded yet.
+  static const Song *SongForIndex(const QModelIndex &index);
+
   QTreeView *view_;
   QString suffix_;
 };
@@ -103,30 +111,35 @@ class LengthItemDelegate : public PlaylistDelegateBase {
  public:
   explicit LengthItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class SizeItemDelegate : public PlaylistDelegateBase {
  public:
   explicit SizeItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class DateItemDelegate : public PlaylistDelegateBase {
  public:
   explicit DateItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class LastPlayedItemDelegate : public PlaylistDelegateBase {
  public:
   explicit LastPlayedItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class FileTypeItemDelegate : public PlaylistDelegateBase {
  public:
   explicit FileTypeItemDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class TextItemDelegate : public PlaylistDelegateBase {
@@ -172,12 +185,14 @@ class NativeSeparatorsDelegate : public PlaylistDelegateBase {
  public:
   explicit NativeSeparatorsDelegate(QObject *parent) : PlaylistDelegateBase(parent) {}
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 };
 
 class SongSourceDelegate : public PlaylistDelegateBase {
  public:
   explicit SongSourceDelegate(QObject *parent);
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
   void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &idx) const override;
 
  private:
@@ -192,6 +207,7 @@ class RatingItemDelegate : public PlaylistDelegateBase {
   void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &idx) const override;
   QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &idx) const override;
   QString displayText(const QVariant &value, const QLocale &locale) const override;
+  QString SongText(const Song &song, const Playlist::Column column, const QLocale &locale) const override;
 
   void set_mouse_over(const QModelIndex &idx, const QModelIndexList &selected_indexes, const QPoint &pos) {
     mouse_over_index_ = idx;
@@ -20,7 +20,13 @@
 
 #include "config.h"
 
+#include <QtGlobal>
+#include <QtConcurrent>
 #include <QObject>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QBitArray>
 #include <QString>
 #include <QRegularExpression>
 #include <QAbstractItemModel>
@@ -30,10 +36,14 @@
 #include "playlistfilter.h"
 #include "playlistfilterparser.h"
 
+const int PlaylistFilter::kChunkSize = 4096;
+
 PlaylistFilter::PlaylistFilter(QObject *parent)
     : QSortFilterProxyModel(parent),
       filter_tree_(new NopFilter),
-    query_hash_(0)
+      filter_program_(new FilterProgram),
+      query_hash_(0),
+      accepted_valid_(false)
 
 {
   setDynamicSortFilter(true);
@@ -71,6 +81,32 @@ PlaylistFilter::PlaylistFilter(QObject *parent)
 PlaylistFilter::~PlaylistFilter() {
 }
 
+void PlaylistFilter::setSourceModel(QAbstractItemModel *source_model) {
+
+  if (sourceModel()) {
+    QObject::disconnect(sourceModel(), SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(SourceRowsInserted(QModelIndex, int, int)));
+    QObject::disconnect(sourceModel(), SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(SourceRowsRemoved(QModelIndex, int, int)));
+    QObject::disconnect(sourceModel(), SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
+    QObject::disconnect(sourceModel(), SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(SourceLayoutChanged()));
+    QObject::disconnect(sourceModel(), SIGNAL(layoutChanged()), this, SLOT(SourceLayoutChanged()));
+    QObject::disconnect(sourceModel(), SIGNAL(modelReset()), this, SLOT(SourceLayoutChanged()));
+  }
+
+  ClearCache();
+
+  if (source_model) {
+    QObject::connect(source_model, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(SourceRowsInserted(QModelIndex, int, int)));
+    QObject::connect(source_model, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(SourceRowsRemoved(QModelIndex, int, int)));
+    QObject::connect(source_model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(SourceDataChanged(QModelIndex, QModelIndex)));
+    QObject::connect(source_model, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(SourceLayoutChanged()));
+    QObject::connect(source_model, SIGNAL(layoutChanged()), this, SLOT(SourceLayoutChanged()));
+    QObject::connect(source_model, SIGNAL(modelReset()), this, SLOT(SourceLayoutChanged()));
+  }
+
+  QSortFilterProxyModel::setSourceModel(source_model);
+
+}
+
 void PlaylistFilter::sort(int column, Qt::SortOrder order) {
   // Pass this through to the Playlist, it does sorting itself
   sourceModel()->sort(column, order);
@@ -90,14 +126,228 @@ bool PlaylistFilter::filterAcceptsRow(int row, const QModelIndex &parent) const
   uint hash = qHash(filter);
 #endif
   if (hash != query_hash_) {
-    // Parse the query
-    FilterParser p(filter, column_names_, numerical_columns_);
-    filter_tree_.reset(p.parse());
-
+    SetFilter(filter);
     query_hash_ = hash;
   }
 
+  if (filter_program_->is_trivial()) return true;
+
   // Test the row
-  return filter_tree_->accept(row, parent, sourceModel());
+  if (parent.isValid()) return filter_tree_->accept(row, parent, sourceModel());
+
+  if (!accepted_valid_ || accepted_.size() != sourceModel()->rowCount()) {
+    EvaluateAll(false);
+  }
+
+  return accepted_.testBit(row);
+
+}
+
+void PlaylistFilter::SetFilter(const QString &filter) const {
+
+  // Parse the query
+  FilterParser p(filter, column_names_, numerical_columns_);
+  FilterTree *tree = p.parse();
+  FilterProgram *program = new FilterProgram;
+  tree->Compile(program);
+
+  const bool refinement = accepted_valid_ && !filter_program_->is_trivial() && accepted_.size() == sourceModel()->rowCount() && program->IsRefinementOf(*filter_program_);
+
+  filter_program_.reset(program);
+  filter_tree_.reset(tree);
+
+  if (program->is_trivial()) {
+    accepted_valid_ = false;
+  }
+  else if (refinement) {
+    // Only the rows accepted by the previous query can be accepted by this one.
+    EvaluateAll(true);
+  }
+  else {
+    accepted_valid_ = false;
+  }
+
+}
+
+QList<QPair<int, int>> PlaylistFilter::Chunks(const int first, const int last) {
+
+  QList<QPair<int, int>> chunks;
+  for (int i = first; i <= last; i += kChunkSize) {
+    chunks << qMakePair(i, qMin(i + kChunkSize - 1, last));
+  }
+  return chunks;
+
+}
+
+void PlaylistFilter::EvaluateAll(const bool only_accepted) const {
+
+  const int row_count = sourceModel()->rowCount();
+
+  QList<int> columns;
+  for (int column : filter_program_->columns()) {
+    if (column < 0 || column >= Playlist::ColumnCount || column_cache_[column].count() == row_count) continue;
+    column_cache_[column].resize(row_count);
+    columns << column;
+  }
+  CacheColumns(columns, 0, row_count - 1);
+
+  if (!only_accepted) accepted_.fill(false, row_count);
+
+  QList<QPair<int, int>> chunks = Chunks(0, row_count - 1);
+  QtConcurrent::blockingMap(chunks, [this, only_accepted](const QPair<int, int> &chunk) {
+    for (int row = chunk.first; row <= chunk.second; ++row) {
+      if (only_accepted && !accepted_.testBit(row)) continue;
+      accepted_.setBit(row, filter_program_->Evaluate(column_cache_, row));
+    }
+  });
+
+  accepted_valid_ = true;
+
+}
+
+void PlaylistFilter::EvaluateRows(const int first, const int last) const {
+
+  QList<int> columns;
+  for (int column : filter_program_->columns()) {
+    if (column >= 0 && column < Playlist::ColumnCount && column_cache_[column].count() != sourceModel()->rowCount()) {
+      // The program reads a column that isn't cached yet, evaluate everything the next time a row is filtered.
+      accepted_valid_ = false;
+      return;
+    }
+  }
+
+  for (int row = first; row <= last; ++row) {
+    accepted_.setBit(row, filter_program_->Evaluate(column_cache_, row));
+  }
+
+}
+
+void PlaylistFilter::CacheColumns(const QList<int> &columns, const int first, const int last) const {
+
+  if (columns.isEmpty() || first > last) return;
+
+  const Playlist *playlist = qobject_cast<const Playlist*>(sourceModel());
+  if (!playlist) {
+    for (int column : columns) {
+      for (int row = first; row <= last; ++row) {
+        column_cache_[column][row] = sourceModel()->index(row, column).data().toString().toLower();
+      }
+    }
+    return;
+  }
+
+  // The songs are only read, so the texts can be made on the thread pool.
+  // Rows without metadata are skipped, the playlist container loads all of it before filtering and the rows are cached again when the playlist emits dataChanged.
+  QVector<QString*> column_data;
+  column_data.reserve(columns.count());
+  for (int column : columns) column_data << column_cache_[column].data();
+
+  QList<QPair<int, int>> chunks = Chunks(first, last);
+  QtConcurrent::blockingMap(chunks, [playlist, &columns, &column_data](const QPair<int, int> &chunk) {
+    for (int row = chunk.first; row <= chunk.second; ++row) {
+      const Song *song = playlist->metadata_at(row);
+      if (!song) continue;
+      for (int i = 0; i < columns.count(); ++i) {
+        column_data[i][row] = Playlist::column_text(*song, static_cast<Playlist::Column>(columns[i])).toLower();
+      }
+    }
+  });
+
+}
+
+void PlaylistFilter::ClearCache() {
+
+  for (int column = 0; column < Playlist::ColumnCount; ++column) {
+    column_cache_[column].clear();
+  }
+  accepted_.clear();
+  accepted_valid_ = false;
+
+}
+
+void PlaylistFilter::SourceRowsInserted(const QModelIndex &parent, const int first, const int last) {
+
+  if (parent.isValid()) return;
+
+  const int count = last - first + 1;
+  const int row_count = sourceModel()->rowCount();
+
+  QList<int> columns;
+  for (int column = 0; column < Playlist::ColumnCount; ++column) {
+    if (column_cache_[column].isEmpty() || column_cache_[column].count() != row_count - count) {
+      column_cache_[column].clear();
+      continue;
+    }
+    column_cache_[column].insert(first, count, QString());
+    columns << column;
+  }
+  CacheColumns(columns, first, last);
+
+  if (!accepted_valid_ || accepted_.size() != row_count - count) {
+    accepted_valid_ = false;
+    return;
+  }
+
+  QBitArray accepted(row_count);
+  for (int row = 0; row < accepted_.size(); ++row) {
+    if (accepted_.testBit(row)) accepted.setBit(row < first ? row : row + count);
+  }
+  accepted_ = accepted;
+
+  EvaluateRows(first, last);
+
+}
+
+void PlaylistFilter::SourceRowsRemoved(const QModelIndex &parent, const int first, const int last) {
+
+  if (parent.isValid()) return;
+
+  const int count = last - first + 1;
+  const int row_count = sourceModel()->rowCount();
+
+  for (int column = 0; column < Playlist::ColumnCount; ++column) {
+    if (column_cache_[column].count() == row_count + count) {
+      column_cache_[column].remove(first, count);
+    }
+    else {
+      column_cache_[column].clear();
+    }
+  }
+
+  if (!accepted_valid_ || accepted_.size() != row_count + count) {
+    accepted_valid_ = false;
+    return;
+  }
+
+  QBitArray accepted(row_count);
+  for (int row = 0; row < row_count; ++row) {
+    if (accepted_.testBit(row < first ? row : row + count)) accepted.setBit(row);
+  }
+  accepted_ = accepted;
+
+}
+
+void PlaylistFilter::SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right) {
+
+  if (top_left.parent().isValid()) return;
+
+  const int row_count = sourceModel()->rowCount();
+  const int first = top_left.row();
+  const int last = qMin(bottom_right.row(), row_count - 1);
+  if (first < 0 || first > last) return;
+
+  QList<int> columns;
+  for (int column = qMax(0, top_left.column()); column <= qMin(bottom_right.column(), static_cast<int>(Playlist::ColumnCount) - 1); ++column) {
+    if (column_cache_[column].count() == row_count) columns << column;
+  }
+  CacheColumns(columns, first, last);
+
+  if (accepted_valid_ && accepted_.size() == row_count && !filter_program_->is_trivial()) {
+    EvaluateRows(first, last);
+  }
+
+}
 
+void PlaylistFilter::SourceLayoutChanged() {
+  ClearCache();
 }
@@ -27,11 +27,21 @@
 #include <QObject>
 #include <QMap>
 #include <QSet>
+#include <QList>
+#include <QVector>
+#include <QPair>
+#include <QBitArray>
 #include <QScopedPointer>
 #include <QString>
 #include <QSortFilterProxyModel>
 
+#include "playlist.h"
+
+class QAbstractItemModel;
+class QModelIndex;
+
 class FilterTree;
+class FilterProgram;
 
 class PlaylistFilter : public QSortFilterProxyModel {
   Q_OBJECT
@@ -43,19 +53,50 @@ class PlaylistFilter : public QSortFilterProxyModel {
   // QAbstractItemModel
   void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
+  // QAbstractProxyModel
+  void setSourceModel(QAbstractItemModel *source_model) override;
+
   // QSortFilterProxyModel
   // public so Playlist::NextVirtualIndex and friends can get at it
   bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
 
+ private slots:
+  // Connected before QSortFilterProxyModel's own slots, so the accepted rows are up to date when it filters the changed rows.
+  void SourceRowsInserted(const QModelIndex &parent, const int first, const int last);
+  void SourceRowsRemoved(const QModelIndex &parent, const int first, const int last);
+  void SourceDataChanged(const QModelIndex &top_left, const QModelIndex &bottom_right);
+  void SourceLayoutChanged();
+
  private:
+  // Rows are evaluated in chunks of this many rows on the thread pool.
+  // It's a multiple of 8 so that no two chunks write to the same byte of accepted_.
+  static const int kChunkSize;
+
+  static QList<QPair<int, int>> Chunks(const int first, const int last);
+
+  void SetFilter(const QString &filter) const;
+  // Evaluates every row, or only the rows accepted by the previous program if it's refined by the current one.
+  void EvaluateAll(const bool only_accepted) const;
+  void EvaluateRows(const int first, const int last) const;
+  // Fills rows first to last of the cache of the columns.
+  void CacheColumns(const QList<int> &columns, const int first, const int last) const;
+  void ClearCache();
+
   // Mutable because they're modified from filterAcceptsRow() const
   mutable QScopedPointer<FilterTree> filter_tree_;
+  mutable QScopedPointer<FilterProgram> filter_program_;
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
   mutable size_t query_hash_;
 #else
   mutable uint query_hash_;
 #endif
 
+  // The lowercase text of every source row, only for the columns read by a filter so far.
+  mutable QVector<QString> column_cache_[Playlist::ColumnCount];
+  // The source rows accepted by filter_program_.
+  mutable QBitArray accepted_;
+  mutable bool accepted_valid_;
+
   QMap<QString, int> column_names_;
   QSet<int> numerical_columns_;
 };
@@ -28,6 +28,7 @@
 #include <QVariant>
 #include <QString>
 #include <QtAlgorithms>
+#include <QVarLengthArray>
 #include <QAbstractItemModel>
 
 #include "playlist.h"
@@ -37,6 +38,8 @@ class SearchTermComparator {
  public:
   virtual ~SearchTermComparator() {}
   virtual bool Matches(const QString &element) const = 0;
+  // The search term if this only checks whether the field contains it.
+  virtual QString substring() const { return QString(); }
 };
 
 // "compares" by checking if the field contains the search term
@@ -46,6 +49,7 @@ class DefaultComparator : public SearchTermComparator {
   bool Matches(const QString &element) const override {
     return element.contains(search_term_);
   }
+  QString substring() const override { return search_term_; }
  private:
   QString search_term_;
 };
@@ -178,18 +182,41 @@ class RatingComparatorDecorator : public SearchTermComparator {
   QScopedPointer<SearchTermComparator> cmp_;
 };
 
+// The song of a playlist row, so the terms can read the columns without going through data(), nullptr if the model isn't a playlist.
+static const Song *SongForRow(const int row, const QAbstractItemModel *const model) {
+
+  const Playlist *playlist = qobject_cast<const Playlist*>(model);
+  return playlist ? playlist->metadata_at(row) : nullptr;
+
+}
+
+static QString ColumnText(const Song *song, const int row, const int column, const QModelIndex &parent, const QAbstractItemModel *const model) {
+
+  if (song) return Playlist::column_text(*song, static_cast<Playlist::Column>(column)).toLower();
+  return model->index(row, column, parent).data().toString().toLower();
+
+}
+
 // filter that applies a SearchTermComparator to all fields of a playlist entry
 class FilterTerm : public FilterTree {
  public:
   explicit FilterTerm(SearchTermComparator *comparator, const QList<int> &columns) : cmp_(comparator), columns_(columns) {}
 
   bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const override {
+    const Song *song = SongForRow(row, model);
     for (int i : columns_) {
-      QModelIndex idx(model->index(row, i, parent));
-      if (cmp_->Matches(idx.data().toString().toLower())) return true;
+      if (cmp_->Matches(ColumnText(song, row, i, parent, model))) return true;
     }
     return false;
   }
+  void Compile(FilterProgram *program) const override {
+    FilterProgram::Instruction instruction;
+    instruction.op = FilterProgram::Op_Match;
+    instruction.columns = columns_;
+    instruction.comparator = cmp_.data();
+    instruction.substring = cmp_->substring();
+    program->Add(instruction);
+  }
   FilterType type() override { return Term; }
  private:
   QScopedPointer<SearchTermComparator> cmp_;
@@ -202,8 +229,15 @@ class FilterColumnTerm : public FilterTree {
   FilterColumnTerm(int column, SearchTermComparator *comparator) : col(column), cmp_(comparator) {}
 
   bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const override {
-    QModelIndex idx(model->index(row, col, parent));
-    return cmp_->Matches(idx.data().toString().toLower());
+    return cmp_->Matches(ColumnText(SongForRow(row, model), row, col, parent, model));
+  }
+  void Compile(FilterProgram *program) const override {
+    FilterProgram::Instruction instruction;
+    instruction.op = FilterProgram::Op_Match;
+    instruction.columns << col;
+    instruction.comparator = cmp_.data();
+    instruction.substring = cmp_->substring();
+    program->Add(instruction);
   }
   FilterType type() override { return Column; }
  private:
@@ -218,6 +252,12 @@ class NotFilter : public FilterTree {
   bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const override {
     return !child_->accept(row, parent, model);
   }
+  void Compile(FilterProgram *program) const override {
+    child_->Compile(program);
+    FilterProgram::Instruction instruction;
+    instruction.op = FilterProgram::Op_Not;
+    program->Add(instruction);
+  }
   FilterType type() override { return Not; }
  private:
   QScopedPointer<const FilterTree> child_;
@@ -233,6 +273,15 @@ class OrFilter : public FilterTree {
     }
     return false;
   }
+  void Compile(FilterProgram *program) const override {
+    for (FilterTree *child : children_) {
+      child->Compile(program);
+    }
+    FilterProgram::Instruction instruction;
+    instruction.op = FilterProgram::Op_Or;
+    instruction.count = children_.count();
+    program->Add(instruction);
+  }
   FilterType type() override { return Or; }
  private:
   QList<FilterTree*> children_;
@@ -248,11 +297,136 @@ class AndFilter : public FilterTree {
     }
     return true;
   }
+  void Compile(FilterProgram *program) const override {
+    for (FilterTree *child : children_) {
+      child->Compile(program);
+    }
+    FilterProgram::Instruction instruction;
+    instruction.op = FilterProgram::Op_And;
+    instruction.count = children_.count();
+    program->Add(instruction);
+  }
   FilterType type() override { return And; }
  private:
   QList<FilterTree*> children_;
 };
 
+void NopFilter::Compile(FilterProgram *program) const {
+  program->Add(FilterProgram::Instruction());
+}
+
+bool FilterProgram::is_trivial() const {
+
+  for (const Instruction &instruction : instructions_) {
+    if (instruction.op != Op_True && instruction.op != Op_And && instruction.op != Op_Or) return false;
+  }
+  return true;
+
+}
+
+QSet<int> FilterProgram::columns() const {
+
+  QSet<int> ret;
+  for (const Instruction &instruction : instructions_) {
+    for (int column : instruction.columns) ret << column;
+  }
+  return ret;
+
+}
+
+bool FilterProgram::Evaluate(const QVector<QString> *column_texts, const int row) const {
+
+  QVarLengthArray<bool, 32> stack;
+  for (const Instruction &instruction : instructions_) {
+    switch (instruction.op) {
+      case Op_True:
+        stack.append(true);
+        break;
+      case Op_Match: {
+        bool match = false;
+        for (int column : instruction.columns) {
+          if (instruction.comparator->Matches(column_texts[column][row])) {
+            match = true;
+            break;
+          }
+        }
+        stack.append(match);
+        break;
+      }
+      case Op_Not:
+        stack.last() = !stack.last();
+        break;
+      case Op_And:
+      case Op_Or: {
+        const int first = stack.count() - instruction.count;
+        bool result = instruction.op == Op_And;
+        for (int i = first; i < stack.count(); ++i) {
+          if (stack[i] != result) {
+            result = !result;
+            break;
+          }
+        }
+        stack.resize(first);
+        stack.append(result);
+        break;
+      }
+    }
+  }
+
+  return stack.isEmpty() || stack.last();
+
+}
+
+bool FilterProgram::IsConjunction() const {
+
+  for (const Instruction &instruction : instructions_) {
+    switch (instruction.op) {
+      case Op_True:
+      case Op_And:
+        break;
+      case Op_Or:
+        if (instruction.count > 1) return false;
+        break;
+      case Op_Match:
+        if (instruction.substring.isEmpty()) return false;
+        break;
+      case Op_Not:
+        return false;
+    }
+  }
+  return true;
+
+}
+
+bool FilterProgram::IsRefinementOf(const FilterProgram &old_program) const {
+
+  if (!IsConjunction() || !old_program.IsConjunction() || old_program.is_trivial()) return false;
+
+  // Each old term must be implied by a new term that looks for a longer text in fewer columns.
+  for (const Instruction &old_instruction : old_program.instructions_) {
+    if (old_instruction.op != Op_Match) continue;
+    bool implied = false;
+    for (const Instruction &instruction : instructions_) {
+      if (instruction.op != Op_Match || !instruction.substring.contains(old_instruction.substring)) continue;
+      bool columns_covered = true;
+      for (int column : instruction.columns) {
+        if (!old_instruction.columns.contains(column)) {
+          columns_covered = false;
+          break;
+        }
+      }
+      if (columns_covered) {
+        implied = true;
+        break;
+      }
+    }
+    if (!implied) return false;
+  }
+
+  return true;
+
+}
+
 FilterParser::FilterParser(const QString &filter, const QMap<QString, int> &columns, const QSet<int> &numerical_cols) : filterstring_(filter), columns_(columns), numerical_columns_(numerical_cols) {}
 
 FilterTree *FilterParser::parse() {
@@ -23,6 +23,8 @@
 
 #include "config.h"
 
+#include <QList>
+#include <QVector>
 #include <QSet>
 #include <QMap>
 #include <QString>
@@ -30,11 +32,16 @@
 class QAbstractItemModel;
 class QModelIndex;
 
+class SearchTermComparator;
+class FilterProgram;
+
 // structure for filter parse tree
 class FilterTree {
  public:
   virtual ~FilterTree() {}
   virtual bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const = 0;
+  // Appends the instructions evaluating this subtree to the program, the program refers to the tree's comparators.
+  virtual void Compile(FilterProgram *program) const = 0;
   enum FilterType {
     Nop = 0,
     Or,
@@ -50,9 +57,52 @@ class FilterTree {
 class NopFilter : public FilterTree {
  public:
   bool accept(int row, const QModelIndex &parent, const QAbstractItemModel *const model) const override { Q_UNUSED(row); Q_UNUSED(parent); Q_UNUSED(model); return true; }
+  void Compile(FilterProgram *program) const override;
   FilterType type() override { return Nop; }
 };
 
+// A filter tree flattened into postfix instructions, evaluated with a small stack of booleans.
+// Rows are evaluated over lowercase column texts prepared in advance instead of going through the model, so they can be evaluated on any thread.
+class FilterProgram {
+ public:
+  enum Op {
+    Op_True,
+    Op_Match,  // Pushes whether any of the columns matches the comparator
+    Op_Not,
+    Op_And,    // Pops count values and pushes whether all of them are true
+    Op_Or      // Pops count values and pushes whether any of them is true
+  };
+
+  struct Instruction {
+    Instruction() : op(Op_True), comparator(nullptr), count(0) {}
+    Op op;
+    QList<int> columns;
+    const SearchTermComparator *comparator;
+    // The search term of a plain "contains" match, empty for other comparators.
+    QString substring;
+    int count;
+  };
+
+  void Add(const Instruction &instruction) { instructions_ << instruction; }
+
+  // Whether the program accepts every row without looking at it.
+  bool is_trivial() const;
+  // The columns the program reads.
+  QSet<int> columns() const;
+
+  // column_texts is indexed by column, the columns returned by columns() must hold the lowercase text of row.
+  bool Evaluate(const QVector<QString> *column_texts, const int row) const;
+
+  // Whether every row accepted by this program is also accepted by old_program, like when more letters are typed.
+  // Only programs made of plain "contains" terms joined by AND are compared, anything else isn't a refinement.
+  bool IsRefinementOf(const FilterProgram &old_program) const;
+
+ private:
+  bool IsConjunction() const;
+
+  QList<Instruction> instructions_;
+};
+
 
 // A utility class to parse search filter strings into a decision tree
 // that can decide whether a playlist entry matches the filter.
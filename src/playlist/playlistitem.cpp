@@ -23,6 +23,7 @@
 
 #include <QtConcurrentRun>
 #include <QFuture>
+#include <QVariant>
 #include <QString>
 #include <QColor>
 #include <QSqlQuery>
@@ -87,7 +88,23 @@ void PlaylistItem::BindToQuery(QSqlQuery *query) const {
   query->bindValue(":type", source_);
   query->bindValue(":collection_id", DatabaseValue(Column_CollectionId));
 
-  DatabaseSongMetadata().BindToQuery(query);
+  if (IsLocalCollectionItem()) {
+    // Collection items are saved by id only, the metadata is in the songs table.
+    for (const QString &column : Song::kColumns) {
+      query->bindValue(":" + column, QVariant());
+    }
+  }
+  else {
+    DatabaseSongMetadata().BindToQuery(query);
+  }
+
+}
+
+const Song &PlaylistItem::MetadataRef() const {
+
+  // Items that hold their song return it directly, this is only used by those that don't.
+  metadata_ref_ = Metadata();
+  return metadata_ref_;
 
 }
 
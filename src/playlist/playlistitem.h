@@ -74,7 +74,11 @@ class PlaylistItem : public std::enable_shared_from_this<PlaylistItem> {
   QFuture<void> BackgroundReload();
 
   virtual Song Metadata() const = 0;
+  // Same as Metadata(), but without copying the song, for the view which reads it for every cell it paints.
+  virtual const Song &MetadataRef() const;
   virtual Song OriginalMetadata() const = 0;
+  // False for items restored with only a reference to their metadata, until Playlist loads it.
+  virtual bool HasMetadata() const { return true; }
   virtual QUrl Url() const = 0;
 
   void SetTemporaryMetadata(const Song &metadata);
@@ -123,6 +127,7 @@ class PlaylistItem : public std::enable_shared_from_this<PlaylistItem> {
   Song::Source source_;
 
   Song temp_metadata_;
+  mutable Song metadata_ref_;
 
   QMap<short, QColor> background_colors_;
   QMap<short, QColor> foreground_colors_;
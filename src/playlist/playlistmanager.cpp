@@ -39,6 +39,8 @@
 #include <QRegularExpression>
 #include <QUrl>
 #include <QAbstractItemModel>
+#include <QSortFilterProxyModel>
+#include <QItemSelection>
 #include <QScrollBar>
 #include <QSettings>
 #include <QtDebug>
@@ -476,8 +478,21 @@ void PlaylistManager::UpdateSummaryText() {
 }
 
 void PlaylistManager::SelectionChanged(const QItemSelection &selection) {
+
   playlists_[current_id()].selection = selection;
+
+  // Actions on the selected items need their metadata
+  QList<int> rows;
+  for (const QItemSelectionRange &range : selection) {
+    if (!range.isValid()) continue;
+    for (int i = range.top(); i <= range.bottom(); ++i) {
+      rows << current()->proxy()->mapToSource(range.model()->index(i, 0, range.parent())).row();
+    }
+  }
+  current()->LoadItemMetadata(rows);
+
   UpdateSummaryText();
+
 }
 
 void PlaylistManager::SongsDiscovered(const SongList &songs) {
@@ -543,6 +558,12 @@ void PlaylistManager::InvalidateDeletedSongs() {
   }
 }
 
+void PlaylistManager::FinishRestores() {
+  for (Playlist *playlist : GetAllPlaylists()) {
+    playlist->FinishRestore();
+  }
+}
+
 void PlaylistManager::RemoveDeletedSongs() {
 
   for (Playlist *playlist : GetAllPlaylists()) {
@@ -158,6 +158,8 @@ class PlaylistManager : public PlaylistManagerInterface {
   void RemoveDeletedSongs() override;
   // Returns true if the playlist is open
   bool IsPlaylistOpen(const int id);
+  // Saves the edits made to playlists that are still being restored, called before exiting.
+  void FinishRestores();
 
   // Returns a pretty automatic name for playlist created from the given list of songs.
   static QString GetNameForNewPlaylist(const SongList& songs);
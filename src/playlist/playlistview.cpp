@@ -882,6 +882,22 @@ void PlaylistView::scrollContentsBy(int dx, int dy) {
 
 }
 
+void PlaylistView::LoadVisibleItemMetadata() {
+
+  if (!playlist_ || model() != playlist_->proxy()) return;
+
+  QModelIndex idx = indexAt(viewport()->rect().topLeft());
+  const QModelIndex last = indexAt(viewport()->rect().bottomLeft());
+  QList<int> rows;
+  while (idx.isValid()) {
+    rows << playlist_->proxy()->mapToSource(idx).row();
+    if (idx.row() == last.row()) break;
+    idx = indexBelow(idx);
+  }
+  playlist_->LoadItemMetadata(rows);
+
+}
+
 void PlaylistView::InhibitAutoscrollTimeout() {
   // For 30 seconds after the user clicks on or scrolls the playlist we promise not to automatically scroll the view to keep up with a track change.
   inhibit_autoscroll_ = false;
@@ -940,6 +956,8 @@ void PlaylistView::paintEvent(QPaintEvent *event) {
   // The drawTree is kinda expensive, so we cache the result and draw from the cache while the user is dragging.
   // The cached pixmap gets invalidated in dragLeaveEvent, dropEvent and scrollContentsBy.
 
+  LoadVisibleItemMetadata();
+
   // Draw background
   if (background_image_type_ == AppearanceSettingsPage::BackgroundImageType_Custom || background_image_type_ == AppearanceSettingsPage::BackgroundImageType_Album) {
     if (!background_image_.isNull() || !previous_background_image_.isNull()) {
@@ -192,6 +192,8 @@ class PlaylistView : public QTreeView {
   void ReloadBarPixmaps();
   QList<QPixmap> LoadBarPixmap(const QString &filename);
   void UpdateCachedCurrentRowPixmap(QStyleOptionViewItem option, const QModelIndex &idx);
+  // Restored collection items get their metadata loaded when they're shown.
+  void LoadVisibleItemMetadata();
 
   void set_background_image_type(AppearanceSettingsPage::BackgroundImageType bg) {
     background_image_type_ = bg;
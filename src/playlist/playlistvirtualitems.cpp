@@ -0,0 +1,444 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "playlistsequence.h"
+#include "playlistvirtualitems.h"
+
+PlaylistVirtualItems::PlaylistVirtualItems()
+    : shuffle_mode_(PlaylistSequence::Shuffle_Off),
+      count_(0),
+      rows_(nullptr),
+      order_(nullptr),
+      random_(std::random_device()()) {}
+
+PlaylistVirtualItems::~PlaylistVirtualItems() {
+  Clear();
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+int PlaylistVirtualItems::Size(const Node *node) {
+  return node ? (node->*L).size : 0;
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+void PlaylistVirtualItems::Update(Node *node) {
+
+  Link &link = node->*L;
+  link.size = 1 + Size<L>(link.left) + Size<L>(link.right);
+  if (link.left) (link.left->*L).parent = node;
+  if (link.right) (link.right->*L).parent = node;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+PlaylistVirtualItems::Node *PlaylistVirtualItems::Merge(Node *left, Node *right) {
+
+  if (!left) return right;
+  if (!right) return left;
+
+  Node *root = nullptr;
+  if ((left->*L).priority > (right->*L).priority) {
+    (left->*L).right = Merge<L>((left->*L).right, right);
+    root = left;
+  }
+  else {
+    (right->*L).left = Merge<L>(left, (right->*L).left);
+    root = right;
+  }
+  Update<L>(root);
+  (root->*L).parent = nullptr;
+
+  return root;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+void PlaylistVirtualItems::Split(Node *node, const int count, Node **left, Node **right) {
+
+  if (!node) {
+    *left = nullptr;
+    *right = nullptr;
+    return;
+  }
+
+  Link &link = node->*L;
+  if (Size<L>(link.left) < count) {
+    Split<L>(link.right, count - Size<L>(link.left) - 1, &link.right, right);
+    *left = node;
+  }
+  else {
+    Split<L>(link.left, count, left, &link.left);
+    *right = node;
+  }
+  Update<L>(node);
+  link.parent = nullptr;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+PlaylistVirtualItems::Node *PlaylistVirtualItems::Select(Node *node, int i) {
+
+  while (node) {
+    const int left_size = Size<L>((node->*L).left);
+    if (i < left_size) {
+      node = (node->*L).left;
+    }
+    else if (i == left_size) {
+      return node;
+    }
+    else {
+      i -= left_size + 1;
+      node = (node->*L).right;
+    }
+  }
+
+  return nullptr;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+int PlaylistVirtualItems::Rank(const Node *node) {
+
+  int rank = Size<L>((node->*L).left);
+  for (const Node *parent = (node->*L).parent; parent; node = parent, parent = (parent->*L).parent) {
+    if ((parent->*L).right == node) rank += Size<L>((parent->*L).left) + 1;
+  }
+
+  return rank;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+PlaylistVirtualItems::Node *PlaylistVirtualItems::Build(const std::vector<Node*> &nodes) {
+
+  // Builds the treap of the nodes in this order in linear time, keeping the priorities they already have.
+  std::vector<Node*> stack;
+  for (Node *node : nodes) {
+    Link &link = node->*L;
+    link.left = nullptr;
+    link.right = nullptr;
+    link.parent = nullptr;
+    Node *last = nullptr;
+    while (!stack.empty() && (stack.back()->*L).priority < link.priority) {
+      last = stack.back();
+      stack.pop_back();
+    }
+    link.left = last;
+    if (!stack.empty()) (stack.back()->*L).right = node;
+    stack.push_back(node);
+  }
+
+  if (stack.empty()) return nullptr;
+
+  UpdateTree<L>(stack.front());
+  return stack.front();
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+void PlaylistVirtualItems::UpdateTree(Node *node) {
+
+  if (!node) return;
+
+  UpdateTree<L>((node->*L).left);
+  UpdateTree<L>((node->*L).right);
+  Update<L>(node);
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+void PlaylistVirtualItems::Remove(Node **root, Node *node) {
+
+  Link &link = node->*L;
+  Node *parent = link.parent;
+  Node *child = Merge<L>(link.left, link.right);
+  if (child) (child->*L).parent = parent;
+
+  if (!parent) {
+    *root = child;
+  }
+  else if ((parent->*L).left == node) {
+    (parent->*L).left = child;
+  }
+  else {
+    (parent->*L).right = child;
+  }
+  for (; parent; parent = (parent->*L).parent) {
+    Update<L>(parent);
+  }
+
+  link.left = nullptr;
+  link.right = nullptr;
+  link.parent = nullptr;
+  link.size = 1;
+
+}
+
+template<PlaylistVirtualItems::Link PlaylistVirtualItems::Node::*L>
+void PlaylistVirtualItems::Collect(Node *node, std::vector<Node*> *nodes) {
+
+  if (!node) return;
+
+  Collect<L>((node->*L).left, nodes);
+  nodes->push_back(node);
+  Collect<L>((node->*L).right, nodes);
+
+}
+
+PlaylistVirtualItems::Node *PlaylistVirtualItems::NewNode() {
+
+  Node *node = new Node;
+  node->rows.priority = static_cast<quint32>(random_());
+  node->order.priority = static_cast<quint32>(random_());
+  node->key = random_();
+  return node;
+
+}
+
+quint64 PlaylistVirtualItems::AlbumKey(const QString &album_key) {
+
+  QHash<QString, quint64>::const_iterator it = album_keys_.constFind(album_key);
+  if (it != album_keys_.constEnd()) return it.value();
+
+  const quint64 key = random_();
+  album_keys_.insert(album_key, key);
+  return key;
+
+}
+
+bool PlaylistVirtualItems::Less(const Node *left, const Node *right) const {
+
+  if (shuffle_mode_ == PlaylistSequence::Shuffle_Albums) {
+    // Albums in random order, the songs of an album in playlist order.
+    if (left->album != right->album) return left->album < right->album;
+    return Rank<&Node::rows>(left) < Rank<&Node::rows>(right);
+  }
+
+  return left->key < right->key;
+
+}
+
+void PlaylistVirtualItems::InsertOrdered(Node *node, const int first_unplayed) {
+
+  Node *played = nullptr, *unplayed = nullptr;
+  Split<&Node::order>(order_, qBound(0, first_unplayed, Size<&Node::order>(order_)), &played, &unplayed);
+
+  int rank = 0;
+  for (Node *n = unplayed; n;) {
+    if (Less(n, node)) {
+      rank += Size<&Node::order>(n->order.left) + 1;
+      n = n->order.right;
+    }
+    else {
+      n = n->order.left;
+    }
+  }
+
+  Node *left = nullptr, *right = nullptr;
+  Split<&Node::order>(unplayed, rank, &left, &right);
+  order_ = Merge<&Node::order>(played, Merge<&Node::order>(Merge<&Node::order>(left, node), right));
+
+}
+
+void PlaylistVirtualItems::SortUnplayed(const int first_unplayed) {
+
+  Node *played = nullptr, *unplayed = nullptr;
+  Split<&Node::order>(order_, qBound(0, first_unplayed, count_), &played, &unplayed);
+
+  std::vector<Node*> nodes;
+  Collect<&Node::order>(unplayed, &nodes);
+
+  std::sort(nodes.begin(), nodes.end(), [this](const Node *left, const Node *right) { return Less(left, right); });
+  order_ = Merge<&Node::order>(played, Build<&Node::order>(nodes));
+
+}
+
+int PlaylistVirtualItems::at(const int i) const {
+
+  if (i < 0 || i >= count_) return -1;
+  if (!is_shuffled()) return i;
+
+  return Rank<&Node::rows>(Select<&Node::order>(order_, i));
+
+}
+
+int PlaylistVirtualItems::indexOf(const int row) const {
+
+  if (row < 0 || row >= count_) return -1;
+  if (!is_shuffled()) return row;
+
+  return Rank<&Node::order>(Select<&Node::rows>(rows_, row));
+
+}
+
+void PlaylistVirtualItems::Clear() {
+
+  std::vector<Node*> nodes;
+  Collect<&Node::rows>(rows_, &nodes);
+  qDeleteAll(nodes);
+
+  rows_ = nullptr;
+  order_ = nullptr;
+  count_ = 0;
+  album_keys_.clear();
+
+}
+
+void PlaylistVirtualItems::InsertRows(const int row, const int count, const int first_unplayed, const QStringList &album_keys) {
+
+  if (row < 0 || row > count_ || count <= 0) return;
+
+  count_ += count;
+  if (!is_shuffled()) return;
+
+  std::vector<Node*> nodes;
+  nodes.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    Node *node = NewNode();
+    if (shuffle_mode_ == PlaylistSequence::Shuffle_Albums && i < album_keys.count()) {
+      node->album = AlbumKey(album_keys[i]);
+    }
+    nodes.push_back(node);
+  }
+
+  Node *left = nullptr, *right = nullptr;
+  Split<&Node::rows>(rows_, row, &left, &right);
+  rows_ = Merge<&Node::rows>(Merge<&Node::rows>(left, Build<&Node::rows>(nodes)), right);
+
+  for (Node *node : nodes) {
+    InsertOrdered(node, first_unplayed);
+  }
+
+}
+
+void PlaylistVirtualItems::RemoveRows(const int row, const int count) {
+
+  if (row < 0 || count <= 0 || row + count > count_) return;
+
+  count_ -= count;
+  if (!is_shuffled()) return;
+
+  Node *left = nullptr, *middle = nullptr, *right = nullptr;
+  Split<&Node::rows>(rows_, row, &left, &middle);
+  Split<&Node::rows>(middle, count, &middle, &right);
+  rows_ = Merge<&Node::rows>(left, right);
+
+  std::vector<Node*> nodes;
+  Collect<&Node::rows>(middle, &nodes);
+  for (Node *node : nodes) {
+    Remove<&Node::order>(&order_, node);
+    delete node;
+  }
+
+}
+
+void PlaylistVirtualItems::Reorder(const QVector<int> &new_rows, const int first_unplayed) {
+
+  if (!is_shuffled() || new_rows.count() != count_) return;
+
+  std::vector<Node*> nodes;
+  nodes.reserve(count_);
+  Collect<&Node::rows>(rows_, &nodes);
+
+  std::vector<Node*> reordered(nodes.size());
+  for (int row = 0; row < count_; ++row) {
+    reordered[new_rows[row]] = nodes[row];
+  }
+  rows_ = Build<&Node::rows>(reordered);
+
+  // The songs of an album are ordered by row, new rows are inserted among them with a binary search.
+  if (shuffle_mode_ == PlaylistSequence::Shuffle_Albums) {
+    SortUnplayed(first_unplayed);
+  }
+
+}
+
+void PlaylistVirtualItems::MoveToFront(const int row) {
+
+  if (!is_shuffled()) return;
+
+  Node *node = Select<&Node::rows>(rows_, row);
+  if (!node) return;
+
+  Remove<&Node::order>(&order_, node);
+  order_ = Merge<&Node::order>(node, order_);
+
+}
+
+void PlaylistVirtualItems::Shuffle(const PlaylistSequence::ShuffleMode shuffle_mode, const int first_unplayed, const QStringList &album_keys, const int first_album_row) {
+
+  if (shuffle_mode == PlaylistSequence::Shuffle_Off) {
+    const int count = count_;
+    Clear();
+    count_ = count;
+    shuffle_mode_ = shuffle_mode;
+    return;
+  }
+
+  if (!is_shuffled()) {
+    // Start from the playlist order.
+    std::vector<Node*> nodes;
+    nodes.reserve(count_);
+    for (int i = 0; i < count_; ++i) {
+      nodes.push_back(NewNode());
+    }
+    rows_ = Build<&Node::rows>(nodes);
+    order_ = Build<&Node::order>(nodes);
+  }
+  shuffle_mode_ = shuffle_mode;
+  album_keys_.clear();
+
+  Node *played = nullptr, *unplayed = nullptr;
+  Split<&Node::order>(order_, qBound(0, first_unplayed, count_), &played, &unplayed);
+
+  std::vector<Node*> nodes;
+  Collect<&Node::order>(unplayed, &nodes);
+  order_ = Merge<&Node::order>(played, unplayed);
+
+  if (shuffle_mode_ == PlaylistSequence::Shuffle_Albums) {
+    if (first_album_row >= 0 && first_album_row < album_keys.count()) {
+      album_keys_.insert(album_keys[first_album_row], 0);
+    }
+    for (Node *node : nodes) {
+      const int row = Rank<&Node::rows>(node);
+      node->album = row < album_keys.count() ? AlbumKey(album_keys[row]) : 0;
+    }
+  }
+  else {
+    for (Node *node : nodes) {
+      node->key = random_();
+    }
+  }
+
+  SortUnplayed(first_unplayed);
+
+}
@@ -0,0 +1,121 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PLAYLISTVIRTUALITEMS_H
+#define PLAYLISTVIRTUALITEMS_H
+
+#include "config.h"
+
+#include <random>
+#include <vector>
+
+#include <QtGlobal>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+
+#include "playlistsequence.h"
+
+// The order the rows of a playlist are played in, the rows at the "virtual" indexes.
+// Without shuffle the virtual index of a row is the row itself and nothing is stored.
+// When shuffled every row has a node in two treaps, one ordered by row and one ordered by virtual index,
+// so looking up either index, inserting and removing rows are O(log n) and don't need to reshuffle the playlist.
+// The unplayed rows, the ones after the virtual index passed as first_unplayed, are kept sorted on random keys,
+// new rows get their own random key and are inserted among them, which leaves the order as random as a full reshuffle.
+class PlaylistVirtualItems {
+ public:
+  PlaylistVirtualItems();
+  ~PlaylistVirtualItems();
+
+  Q_DISABLE_COPY(PlaylistVirtualItems)
+
+  int count() const { return count_; }
+  bool is_shuffled() const { return shuffle_mode_ != PlaylistSequence::Shuffle_Off; }
+
+  // Returns the row at virtual index i.
+  int at(const int i) const;
+  int operator[](const int i) const { return at(i); }
+
+  // Returns the virtual index of the row, or -1.
+  int indexOf(const int row) const;
+
+  void Clear();
+
+  // Adds count rows starting at row. album_keys has the album key of each new row for album shuffle.
+  void InsertRows(const int row, const int count, const int first_unplayed, const QStringList &album_keys = QStringList());
+  void RemoveRows(const int row, const int count);
+
+  // Moves every row to new_rows[row], the virtual order of the items stays the same.
+  // For album shuffle the songs of each album from virtual index first_unplayed on are put in their new playlist order.
+  void Reorder(const QVector<int> &new_rows, const int first_unplayed);
+
+  // Puts the row first in the virtual order.
+  void MoveToFront(const int row);
+
+  // Reshuffles the rows from virtual index first_unplayed on, the ones before it keep their place.
+  // For album shuffle album_keys has the album key of every row, and the album of first_album_row is played first.
+  void Shuffle(const PlaylistSequence::ShuffleMode shuffle_mode, const int first_unplayed, const QStringList &album_keys = QStringList(), const int first_album_row = -1);
+
+ private:
+  struct Node;
+  struct Link {
+    Link() : left(nullptr), right(nullptr), parent(nullptr), size(1), priority(0) {}
+    Node *left;
+    Node *right;
+    Node *parent;
+    int size;
+    quint32 priority;
+  };
+  struct Node {
+    Node() : key(0), album(0) {}
+    Link rows;
+    Link order;
+    quint64 key;
+    quint64 album;
+  };
+
+  template<Link Node::*L> static int Size(const Node *node);
+  template<Link Node::*L> static void Update(Node *node);
+  template<Link Node::*L> static Node *Merge(Node *left, Node *right);
+  template<Link Node::*L> static void Split(Node *node, const int count, Node **left, Node **right);
+  template<Link Node::*L> static Node *Select(Node *node, int i);
+  template<Link Node::*L> static int Rank(const Node *node);
+  template<Link Node::*L> static Node *Build(const std::vector<Node*> &nodes);
+  template<Link Node::*L> static void UpdateTree(Node *node);
+  template<Link Node::*L> static void Remove(Node **root, Node *node);
+  template<Link Node::*L> static void Collect(Node *node, std::vector<Node*> *nodes);
+
+  Node *NewNode();
+  quint64 AlbumKey(const QString &album_key);
+  bool Less(const Node *left, const Node *right) const;
+  void InsertOrdered(Node *node, const int first_unplayed);
+  // Sorts the nodes from virtual index first_unplayed on with Less.
+  void SortUnplayed(const int first_unplayed);
+
+ private:
+  PlaylistSequence::ShuffleMode shuffle_mode_;
+  int count_;
+  Node *rows_;
+  Node *order_;
+  QHash<QString, quint64> album_keys_;
+  std::mt19937_64 random_;
+};
+
+#endif  // PLAYLISTVIRTUALITEMS_H
@@ -33,7 +33,7 @@ SongPlaylistItem::SongPlaylistItem(const Song::Source &source) : PlaylistItem(so
 SongPlaylistItem::SongPlaylistItem(const Song &song) : PlaylistItem(song.source()), song_(song) {}
 
 bool SongPlaylistItem::InitFromQuery(const SqlRow &query) {
-  song_.InitFromQuery(query, false, (Song::kColumns.count()+1));
+  song_.InitFromQuery(query, false);
   return true;
 }
 
@@ -41,6 +41,7 @@ class SongPlaylistItem : public PlaylistItem {
   void Reload() override;
 
   Song Metadata() const override;
+  const Song &MetadataRef() const override { return HasTemporaryMetadata() ? temp_metadata_ : song_; }
   Song OriginalMetadata() const override { return song_; }
 
   QUrl Url() const override;
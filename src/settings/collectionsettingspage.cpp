@@ -152,9 +152,12 @@ void CollectionSettingsPage::Load() {
   ui_->auto_open->setChecked(s.value("auto_open", true).toBool());
   ui_->pretty_covers->setChecked(s.value("pretty_covers", true).toBool());
   ui_->show_dividers->setChecked(s.value("show_dividers", true).toBool());
+  ui_->memory_index->setChecked(s.value("memory_index", false).toBool());
   ui_->startup_scan->setChecked(s.value("startup_scan", true).toBool());
   ui_->monitor->setChecked(s.value("monitor", true).toBool());
   ui_->mark_songs_unavailable->setChecked(s.value("mark_songs_unavailable", false).toBool());
+  ui_->parallel_scan->setChecked(s.value("parallel_scan", true).toBool());
+  ui_->spinbox_tagreader_workers->setValue(s.value("tagreader_workers", 0).toInt());
 
   QStringList filters = s.value("cover_art_patterns", QStringList() << "front" << "cover").toStringList();
   ui_->cover_art_patterns->setText(filters.join(","));
@@ -203,9 +206,12 @@ void CollectionSettingsPage::Save() {
   s.setValue("auto_open", ui_->auto_open->isChecked());
   s.setValue("pretty_covers", ui_->pretty_covers->isChecked());
   s.setValue("show_dividers", ui_->show_dividers->isChecked());
+  s.setValue("memory_index", ui_->memory_index->isChecked());
   s.setValue("startup_scan", ui_->startup_scan->isChecked());
   s.setValue("monitor", ui_->monitor->isChecked());
   s.setValue("mark_songs_unavailable", ui_->mark_songs_unavailable->isChecked());
+  s.setValue("parallel_scan", ui_->parallel_scan->isChecked());
+  s.setValue("tagreader_workers", ui_->spinbox_tagreader_workers->value());
 
   QString filter_text = ui_->cover_art_patterns->text();
 
@@ -0,0 +1,133 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+#include <QWidget>
+#include <QSize>
+#include <QImage>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QResizeEvent>
+
+#include "test_utils.h"
+
+#include "core/logging.h"
+#include "analyzer/analyzerbase.h"
+#include "analyzer/blockanalyzer.h"
+#include "analyzer/rainbowanalyzer.h"
+
+namespace {
+
+// Paints the analyzers without showing them.
+template <typename T>
+class AnalyzerForTest : public T {
+ public:
+  AnalyzerForTest() : T(nullptr) {
+    this->changeTimeout(1000 / 60);
+    this->is_playing_ = true;
+  }
+
+  void Resize(const QSize &size) {
+    this->resize(size);
+    QResizeEvent e(size, size);
+    this->resizeEvent(&e);
+  }
+
+  // Paints a frame like paintEvent() does.
+  void Paint(QImage *image, const Analyzer::Scope &scope) {
+    QPainter p(image);
+    this->analyze(p, scope, true);
+  }
+};
+
+Analyzer::Scope MakeScope(const int bands, const int frame) {
+
+  Analyzer::Scope scope(bands);
+  for (int i = 0; i < bands; ++i) {
+    scope[i] = static_cast<float>(0.5 + 0.5 * std::sin(i * 0.2 + frame * 0.3));
+  }
+  return scope;
+
+}
+
+TEST(BlockAnalyzerTest, DrawsChangedColumns) {
+
+  static const QSize kSize(400, 60);
+
+  AnalyzerForTest<BlockAnalyzer> analyzer;
+  analyzer.Resize(kSize);
+  QImage image(kSize, QImage::Format_RGB32);
+
+  for (int frame = 0; frame < 50; ++frame) {
+    analyzer.Paint(&image, MakeScope(100, frame));
+  }
+
+  // Drawing the whole canvas again gives the same frame as drawing the columns that changed.
+  AnalyzerForTest<BlockAnalyzer> redrawn;
+  redrawn.Resize(kSize);
+  QImage redrawn_image(kSize, QImage::Format_RGB32);
+  for (int frame = 0; frame < 50; ++frame) {
+    redrawn.Resize(kSize);
+    redrawn.Paint(&redrawn_image, MakeScope(100, frame));
+  }
+
+  EXPECT_EQ(redrawn_image, image);
+
+}
+
+// Measures the time to paint a frame at 60 fps, run it with: analyzer_test --gtest_also_run_disabled_tests
+TEST(AnalyzerBenchmark, DISABLED_PaintFrames) {
+
+  static const int kFrames = 600;
+  static const QSize kSizes[] = { QSize(159, 20), QSize(640, 60), QSize(1279, 120) };
+
+  for (const QSize &size : kSizes) {
+    QImage image(size, QImage::Format_RGB32);
+
+    AnalyzerForTest<BlockAnalyzer> block;
+    block.Resize(size);
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      block.Paint(&image, MakeScope(256, frame));
+    }
+    const qint64 block_nsec = timer.nsecsElapsed() / kFrames;
+
+    AnalyzerForTest<Rainbow::NyanCatAnalyzer> rainbow;
+    rainbow.Resize(size);
+    timer.start();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      rainbow.Paint(&image, MakeScope(6, frame));
+    }
+    const qint64 rainbow_nsec = timer.nsecsElapsed() / kFrames;
+
+    // A frame at 60 fps is 16.7 ms.
+    qLog(Info) << size << "block analyzer:" << block_nsec / 1000 << "usec per frame," << block_nsec * 60 / 1e7 << "% CPU at 60 fps";
+    qLog(Info) << size << "rainbow analyzer:" << rainbow_nsec / 1000 << "usec per frame," << rainbow_nsec * 60 / 1e7 << "% CPU at 60 fps";
+  }
+
+}
+
+}  // namespace
@@ -35,6 +35,7 @@
 #include "core/database.h"
 #include "core/logging.h"
 #include "collection/collectionbackend.h"
+#include "collection/collectionquery.h"
 #include "collection/collection.h"
 
 namespace {
@@ -429,4 +430,138 @@ TEST_F(SingleSong, TestUrls) {
 
 }
 
+// Test adding and updating enough songs at once to use the bulk insert path.
+class BulkSongs : public CollectionBackendTest {
+ protected:
+  static const int kSongCount = 105;
+
+  void SetUp() override {
+
+    CollectionBackendTest::SetUp();
+
+    backend_->AddDirectory("/tmp");
+
+    for (int i = 0; i < kSongCount; ++i) {
+      Song song = MakeDummySong(1);
+      song.set_title(QString("Title %1").arg(i));
+      song.set_artist("Artist");
+      song.set_album("Album");
+      song.set_url(QUrl::fromLocalFile(QString("/tmp/%1.flac").arg(i)));
+      songs_ << song;
+    }
+
+    // A song in a directory that doesn't exist should be skipped
+    Song song = MakeDummySong(2);
+    song.set_url(QUrl::fromLocalFile("/nonexistent/foo.flac"));
+    songs_ << song;
+
+  }
+
+  SongList songs_;
+};
+
+TEST_F(BulkSongs, AddSongs) {
+
+  QSignalSpy added_spy(backend_.get(), SIGNAL(SongsDiscovered(SongList)));
+
+  backend_->AddOrUpdateSongs(songs_);
+
+  ASSERT_EQ(1, added_spy.count());
+  SongList added = *(reinterpret_cast<SongList*>(added_spy[0][0].data()));
+  ASSERT_EQ(kSongCount, added.count());
+
+  for (const Song &song : added) {
+    const Song stored = backend_->GetSongById(song.id());
+    ASSERT_TRUE(stored.is_valid());
+    EXPECT_EQ(song.title(), stored.title());
+    EXPECT_EQ(song.url(), stored.url());
+  }
+
+  // The FTS index is filled in one pass at the end
+  QueryOptions options;
+  options.set_filter("Title");
+  CollectionQuery query(options);
+  query.SetColumnSpec("%songs_table.ROWID");
+  ASSERT_TRUE(backend_->ExecQuery(&query));
+  int matches = 0;
+  while (query.Next()) ++matches;
+  EXPECT_EQ(kSongCount, matches);
+
+}
+
+TEST_F(BulkSongs, UpdateSongs) {
+
+  backend_->AddOrUpdateSongs(songs_);
+
+  SongList songs = backend_->FindSongsInDirectory(1);
+  ASSERT_EQ(kSongCount, songs.count());
+  for (Song &song : songs) {
+    song.set_artist("New artist");
+  }
+
+  QSignalSpy added_spy(backend_.get(), SIGNAL(SongsDiscovered(SongList)));
+  QSignalSpy deleted_spy(backend_.get(), SIGNAL(SongsDeleted(SongList)));
+
+  backend_->AddOrUpdateSongs(songs);
+
+  ASSERT_EQ(1, deleted_spy.count());
+  ASSERT_EQ(1, added_spy.count());
+  EXPECT_EQ(kSongCount, reinterpret_cast<SongList*>(deleted_spy[0][0].data())->count());
+  EXPECT_EQ(kSongCount, reinterpret_cast<SongList*>(added_spy[0][0].data())->count());
+
+  EXPECT_EQ(QStringList() << "New artist", backend_->GetAllArtists());
+  EXPECT_EQ(kSongCount, backend_->FindSongsInDirectory(1).count());
+
+}
+
+TEST_F(BulkSongs, UpdateSongsBySongId) {
+
+  for (int i = 0; i < songs_.count(); ++i) {
+    songs_[i].set_song_id(QString("song-%1").arg(i));
+  }
+  backend_->AddOrUpdateSongs(songs_);
+  ASSERT_EQ(kSongCount, backend_->FindSongsInDirectory(1).count());
+
+  // Songs without a database ID are matched by their song ID, songs that are in the batch twice are written once.
+  SongList songs;
+  for (int i = 0; i < kSongCount; ++i) {
+    Song song = songs_[i];
+    song.set_artist("Old artist");
+    songs << song;
+  }
+  for (int i = 0; i < kSongCount; ++i) {
+    Song song = songs_[i];
+    song.set_artist("New artist");
+    songs << song;
+  }
+  Song new_song = MakeDummySong(1);
+  new_song.set_url(QUrl::fromLocalFile("/tmp/new.flac"));
+  new_song.set_artist("New artist");
+  new_song.set_song_id("song-new");
+  songs << new_song << new_song;
+
+  QSignalSpy added_spy(backend_.get(), SIGNAL(SongsDiscovered(SongList)));
+  QSignalSpy deleted_spy(backend_.get(), SIGNAL(SongsDeleted(SongList)));
+
+  backend_->AddOrUpdateSongs(songs);
+
+  ASSERT_EQ(1, deleted_spy.count());
+  ASSERT_EQ(1, added_spy.count());
+  EXPECT_EQ(kSongCount, reinterpret_cast<SongList*>(deleted_spy[0][0].data())->count());
+  SongList added = *(reinterpret_cast<SongList*>(added_spy[0][0].data()));
+  EXPECT_EQ(kSongCount + 1, added.count());
+
+  EXPECT_EQ(QStringList() << "New artist", backend_->GetAllArtists());
+  EXPECT_EQ(kSongCount + 1, backend_->FindSongsInDirectory(1).count());
+
+  // The IDs of the added songs are the IDs of the rows in the database.
+  for (const Song &song : added) {
+    const Song stored = backend_->GetSongById(song.id());
+    ASSERT_TRUE(stored.is_valid());
+    EXPECT_EQ(song.song_id(), stored.song_id());
+    EXPECT_EQ(song.url(), stored.url());
+  }
+
+}
+
 } // namespace
@@ -0,0 +1,196 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+#include "test_utils.h"
+
+#include "core/song.h"
+#include "core/database.h"
+#include "collection/collection.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionquery.h"
+#include "collection/collectionindex.h"
+
+namespace {
+
+class CollectionIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new CollectionBackend);
+    backend_->Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+    backend_->AddDirectory("/music");
+
+    SongList songs;
+    songs << MakeSong("Help!", "The Beatles", "", "Help!", 1965);
+    songs << MakeSong("Yesterday", "The Beatles", "", "Help!", 1965);
+    songs << MakeSong("Beat It", "Michael Jackson", "", "Thriller", 1982);
+    songs << MakeSong("Café del Mar", "Energy 52", "", "Trance Hits", 1993);
+    songs << MakeSong("Sandstorm", "Darude", "Various Artists", "Trance Hits", 1999);
+    songs.last().set_compilation(true);
+    backend_->AddOrUpdateSongs(songs);
+
+    backend_->SetIndexEnabled(true);
+
+  }
+
+  static Song MakeSong(const QString &title, const QString &artist, const QString &albumartist, const QString &album, const int year) {
+
+    static int n = 0;
+    Song song;
+    song.Init(title, artist, album, 1);
+    song.set_albumartist(albumartist);
+    song.set_year(year);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(QString("/music/%1.flac").arg(++n)));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+    return song;
+
+  }
+
+  // Runs the query in SQLite and in the index and returns the distinct values of the column.
+  void Compare(const QueryOptions &options, const QString &column, const CollectionIndex::Column index_column, const QList<CollectionQuery::Condition> &conditions = QList<CollectionQuery::Condition>()) {
+
+    CollectionQuery sql_query(options);
+    sql_query.SetColumnSpec("DISTINCT " + column);
+    for (const CollectionQuery::Condition &condition : conditions) sql_query.AddWhere(condition.column, condition.value);
+    ASSERT_TRUE(backend_->ExecQuery(&sql_query));
+    QSet<QString> expected;
+    while (sql_query.Next()) expected << sql_query.Value(0).toString();
+
+    CollectionQuery index_query(options);
+    for (const CollectionQuery::Condition &condition : conditions) index_query.AddWhere(condition.column, condition.value);
+    SongList songs;
+    ASSERT_TRUE(backend_->index()->Query(index_query, QList<CollectionIndex::Column>() << index_column, &songs));
+    QSet<QString> actual;
+    for (const Song &song : songs) {
+      actual << (index_column == CollectionIndex::Column_Album ? song.album() : song.artist());
+    }
+
+    EXPECT_EQ(expected, actual) << options.filter().toStdString();
+
+  }
+
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<CollectionBackend> backend_;
+};
+
+TEST_F(CollectionIndexTest, Loaded) {
+
+  EXPECT_TRUE(backend_->index()->is_loaded());
+  EXPECT_EQ(5, backend_->index()->song_count());
+
+}
+
+TEST_F(CollectionIndexTest, MatchesDatabase) {
+
+  Compare(QueryOptions(), "artist", CollectionIndex::Column_Artist);
+  Compare(QueryOptions(), "album", CollectionIndex::Column_Album, QList<CollectionQuery::Condition>() << CollectionQuery::Condition("artist", "The Beatles"));
+  Compare(QueryOptions(), "album", CollectionIndex::Column_Album, QList<CollectionQuery::Condition>() << CollectionQuery::Condition("compilation_effective", 1));
+
+  for (const QString &filter : QStringList() << "beat" << "beatles help" << "the beat" << "artist:beat" << "title:beat" << "cafe" << "café" << "hits" << "nothing") {
+    QueryOptions options;
+    options.set_filter(filter);
+    Compare(options, "artist", CollectionIndex::Column_Artist);
+  }
+
+}
+
+TEST_F(CollectionIndexTest, FollowsBackend) {
+
+  Song song = backend_->GetSongById(1);
+  ASSERT_TRUE(song.is_valid());
+
+  song.set_artist("Beatles Tribute");
+  backend_->AddOrUpdateSongs(SongList() << song);
+  Compare(QueryOptions(), "artist", CollectionIndex::Column_Artist);
+
+  backend_->DeleteSongs(SongList() << song);
+  EXPECT_EQ(4, backend_->index()->song_count());
+  Compare(QueryOptions(), "artist", CollectionIndex::Column_Artist);
+
+}
+
+TEST_F(CollectionIndexTest, FilterRefinement) {
+
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("beat", "beatl"));
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("beat", "beatles help"));
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("beat", "help beat"));
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("beat", "artist:beat"));
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("the", "the-beat"));
+  EXPECT_TRUE(CollectionIndex::IsFilterRefinement("artist:", "artist:beat"));
+
+  EXPECT_FALSE(CollectionIndex::IsFilterRefinement("", "beat"));
+  EXPECT_FALSE(CollectionIndex::IsFilterRefinement("beatl", "beat"));
+  EXPECT_FALSE(CollectionIndex::IsFilterRefinement("beat help", "beatl"));
+  EXPECT_FALSE(CollectionIndex::IsFilterRefinement("artist", "artist:"));
+  EXPECT_FALSE(CollectionIndex::IsFilterRefinement("artist:beat", "title:beatl"));
+
+}
+
+TEST_F(CollectionIndexTest, Narrow) {
+
+  QueryOptions options;
+  options.set_filter("t");
+  CollectionQuery query(options);
+  query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+  SongList songs;
+  ASSERT_TRUE(backend_->index()->Query(query, QList<CollectionIndex::Column>(), &songs));
+
+  CollectionIndex index;
+  index.Reset(songs);
+  for (const QString &filter : QStringList() << "th" << "the" << "the b" << "the beatles") {
+    index.Narrow(filter);
+    options.set_filter(filter);
+    SongList expected;
+    ASSERT_TRUE(backend_->index()->Query(CollectionQuery(options), QList<CollectionIndex::Column>(), &expected));
+    EXPECT_EQ(expected.count(), index.song_count()) << filter.toStdString();
+    for (const Song &song : expected) {
+      EXPECT_TRUE(CollectionIndex::Matches(song, filter));
+    }
+  }
+
+  EXPECT_FALSE(CollectionIndex::Matches(backend_->GetSongById(3), "the beatles"));
+
+}
+
+TEST_F(CollectionIndexTest, DuplicatesFallBackToDatabase) {
+
+  QueryOptions options;
+  options.set_query_mode(QueryOptions::QueryMode_Duplicates);
+  SongList songs;
+  EXPECT_FALSE(backend_->index()->Query(CollectionQuery(options), QList<CollectionIndex::Column>(), &songs));
+
+}
+
+}  // namespace
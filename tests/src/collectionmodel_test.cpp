@@ -27,6 +27,9 @@
 #include <QString>
 #include <QUrl>
 #include <QThread>
+#include <QThreadPool>
+#include <QCoreApplication>
+#include <QTemporaryDir>
 #include <QSignalSpy>
 #include <QSortFilterProxyModel>
 #include <QtDebug>
@@ -36,6 +39,7 @@
 #include "core/logging.h"
 #include "core/database.h"
 #include "collection/collectionmodel.h"
+#include "collection/collectionitem.h"
 #include "collection/collectionbackend.h"
 #include "collection/collection.h"
 
@@ -671,4 +675,133 @@ TEST_F(CollectionModelTest, TestContainerNodes) {
 }
 #endif
 
+// Background queries need a database every thread can open, an in-memory database only exists on one connection.
+class CollectionModelAsyncTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+
+    ASSERT_TRUE(database_dir_.isValid());
+    database_.reset(new Database(nullptr, nullptr, database_dir_.filePath("strawberry.db")));
+    backend_.reset(new CollectionBackend);
+    backend_->Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+    backend_->AddDirectory("/music");
+
+    backend_->AddOrUpdateSongs(SongList() << MakeSong(0) << MakeSong(1));
+
+    model_.reset(new CollectionModel(backend_.get(), nullptr));
+    model_->set_show_dividers(false);
+    model_->Init(true);
+    WaitForQueries();
+
+  }
+
+  void TearDown() override {
+
+    model_.reset();
+    backend_->Close();
+    backend_.reset();
+    database_.reset();
+
+  }
+
+  static Song MakeSong(const int i) {
+
+    Song song;
+    song.Init(QString("Title %1").arg(i), QString("Artist %1").arg(i), "Album", 1);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(QString("/music/%1.flac").arg(i)));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+    return song;
+
+  }
+
+  static void WaitForQueries() {
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+  }
+
+  QTemporaryDir database_dir_;
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<CollectionBackend> backend_;
+  std::unique_ptr<CollectionModel> model_;
+};
+
+TEST_F(CollectionModelAsyncTest, LazyPopulateInBackground) {
+
+  ASSERT_EQ(2, model_->rowCount(QModelIndex()));
+  QModelIndex artist_index = model_->index(0, 0, QModelIndex());
+
+  model_->fetchMore(artist_index);
+  EXPECT_FALSE(model_->canFetchMore(artist_index));
+  ASSERT_EQ(1, model_->rowCount(artist_index));
+  EXPECT_EQ(CollectionItem::Type_LoadingIndicator, model_->index(0, 0, artist_index).data(CollectionModel::Role_Type).toInt());
+
+  WaitForQueries();
+
+  ASSERT_EQ(1, model_->rowCount(artist_index));
+  EXPECT_EQ(CollectionItem::Type_Container, model_->index(0, 0, artist_index).data(CollectionModel::Role_Type).toInt());
+  EXPECT_EQ("Album", model_->index(0, 0, artist_index).data().toString());
+
+}
+
+TEST_F(CollectionModelAsyncTest, CancelPopulate) {
+
+  QModelIndex artist_index = model_->index(0, 0, QModelIndex());
+
+  model_->fetchMore(artist_index);
+  model_->CancelPopulate(artist_index);
+  EXPECT_EQ(0, model_->rowCount(artist_index));
+  EXPECT_TRUE(model_->canFetchMore(artist_index));
+
+  // The result of the cancelled query is dropped.
+  WaitForQueries();
+  EXPECT_EQ(0, model_->rowCount(artist_index));
+
+  // Populating it now doesn't wait for a background query.
+  model_->Populate(artist_index);
+  EXPECT_EQ(1, model_->rowCount(artist_index));
+
+}
+
+TEST_F(CollectionModelAsyncTest, SongsDiscoveredInOneRange) {
+
+  QSignalSpy inserted_spy(model_.get(), SIGNAL(rowsInserted(QModelIndex, int, int)));
+
+  backend_->AddOrUpdateSongs(SongList() << MakeSong(2));
+  backend_->AddOrUpdateSongs(SongList() << MakeSong(3));
+  EXPECT_EQ(2, model_->rowCount(QModelIndex()));
+
+  QCoreApplication::processEvents();
+
+  ASSERT_EQ(4, model_->rowCount(QModelIndex()));
+  ASSERT_EQ(1, inserted_spy.count());
+  EXPECT_EQ(2, inserted_spy[0][1].toInt());
+  EXPECT_EQ(3, inserted_spy[0][2].toInt());
+
+}
+
+TEST_F(CollectionModelAsyncTest, FilterUpdatesTreeInPlace) {
+
+  QModelIndex artist_index = model_->index(0, 0, QModelIndex());
+  model_->Populate(artist_index);
+  CollectionItem *artist = model_->IndexToItem(artist_index);
+
+  QSignalSpy reset_spy(model_.get(), SIGNAL(modelReset()));
+  QSignalSpy removed_spy(model_.get(), SIGNAL(rowsRemoved(QModelIndex, int, int)));
+
+  // The reset query, then the refresh of the expanded artist.
+  model_->SetFilterText(artist->display_text);
+  WaitForQueries();
+  WaitForQueries();
+
+  EXPECT_EQ(0, reset_spy.count());
+  EXPECT_EQ(1, removed_spy.count());
+  ASSERT_EQ(1, model_->rowCount(QModelIndex()));
+  EXPECT_EQ(artist, model_->IndexToItem(model_->index(0, 0, QModelIndex())));
+  EXPECT_EQ(1, model_->rowCount(model_->index(0, 0, QModelIndex())));
+
+}
+
 }  // namespace
@@ -0,0 +1,126 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QString>
+
+#include "test_utils.h"
+
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/database.h"
+#include "core/taskmanager.h"
+#include "core/tagreaderclient.h"
+#include "collection/collection.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionwatcher.h"
+
+namespace {
+
+// Scans a synthetic library of copies of the test FLAC file and reports the throughput.
+// The benchmark needs the strawberry-tagreader executable next to the test or in $PATH, so it is disabled by default.
+// Run it with: collectionwatcher_test --gtest_also_run_disabled_tests
+class CollectionWatcherBenchmark : public ::testing::Test {
+ protected:
+  static const int kArtists = 20;
+  static const int kAlbumsPerArtist = 10;
+  static const int kTracksPerAlbum = 12;
+
+  void SetUp() override {
+
+    ASSERT_TRUE(library_dir_.isValid());
+    for (int artist = 0; artist < kArtists; ++artist) {
+      for (int album = 0; album < kAlbumsPerArtist; ++album) {
+        const QString album_path = QString("%1/artist%2/album%3").arg(library_dir_.path()).arg(artist).arg(album);
+        ASSERT_TRUE(QDir().mkpath(album_path));
+        for (int track = 0; track < kTracksPerAlbum; ++track) {
+          ASSERT_TRUE(QFile::copy(":/audio/strawberry.flac", QString("%1/%2.flac").arg(album_path).arg(track)));
+        }
+      }
+    }
+
+    tagreader_thread_.reset(new QThread);
+    tagreader_client_ = new TagReaderClient;
+    tagreader_client_->moveToThread(tagreader_thread_.get());
+    tagreader_thread_->start();
+    tagreader_client_->Start();
+
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new CollectionBackend);
+    backend_->Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+
+    task_manager_.reset(new TaskManager);
+
+    watcher_.reset(new CollectionWatcher(Song::Source_Collection));
+    watcher_->set_backend(backend_.get());
+    watcher_->set_task_manager(task_manager_.get());
+
+    QObject::connect(backend_.get(), SIGNAL(DirectoryDiscovered(Directory, SubdirectoryList)), watcher_.get(), SLOT(AddDirectory(Directory, SubdirectoryList)));
+    QObject::connect(watcher_.get(), SIGNAL(NewOrUpdatedSongs(SongList)), backend_.get(), SLOT(AddOrUpdateSongs(SongList)));
+    QObject::connect(watcher_.get(), SIGNAL(SubdirsDiscovered(SubdirectoryList)), backend_.get(), SLOT(AddOrUpdateSubdirs(SubdirectoryList)));
+
+  }
+
+  void TearDown() override {
+
+    watcher_.reset();
+    tagreader_thread_->quit();
+    tagreader_thread_->wait();
+    delete tagreader_client_;
+
+  }
+
+  QTemporaryDir library_dir_;
+  std::unique_ptr<QThread> tagreader_thread_;
+  TagReaderClient *tagreader_client_;
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<CollectionBackend> backend_;
+  std::unique_ptr<TaskManager> task_manager_;
+  std::unique_ptr<CollectionWatcher> watcher_;
+};
+
+TEST_F(CollectionWatcherBenchmark, DISABLED_FullScan) {
+
+  const int files = kArtists * kAlbumsPerArtist * kTracksPerAlbum;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // The watcher lives in this thread, so the whole scan runs inside AddDirectory().
+  backend_->AddDirectory(library_dir_.path());
+
+  const qint64 elapsed = timer.elapsed();
+
+  EXPECT_EQ(files, backend_->FindSongsInDirectory(1).count());
+
+  qLog(Info) << "Scanned" << files << "files in" << elapsed << "ms," << (files * 1000.0 / qMax(elapsed, qint64(1))) << "files/sec";
+
+}
+
+}  // namespace
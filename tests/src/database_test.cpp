@@ -0,0 +1,153 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+#include <QtConcurrent>
+#include <QFuture>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QUrl>
+
+#include "test_utils.h"
+
+#include "core/logging.h"
+#include "core/song.h"
+#include "core/database.h"
+#include "collection/collection.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionquery.h"
+
+namespace {
+
+class DatabaseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+
+    ASSERT_TRUE(database_dir_.isValid());
+    database_.reset(new Database(nullptr, nullptr, database_dir_.filePath("strawberry.db")));
+    backend_.reset(new CollectionBackend);
+    backend_->Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+    backend_->AddDirectory("/music");
+
+  }
+
+  void TearDown() override {
+
+    backend_->Close();
+    backend_.reset();
+    database_.reset();
+
+  }
+
+  static SongList MakeSongs(const int batch, const int count) {
+
+    SongList songs;
+    for (int i = 0; i < count; ++i) {
+      Song song;
+      song.Init(QString("Title %1").arg(i), QString("Artist %1").arg(batch), QString("Album %1").arg(batch), 1);
+      song.set_directory_id(1);
+      song.set_url(QUrl::fromLocalFile(QString("/music/%1/%2.flac").arg(batch).arg(i)));
+      song.set_mtime(1);
+      song.set_ctime(1);
+      song.set_filesize(1);
+      songs << song;
+    }
+    return songs;
+
+  }
+
+  QTemporaryDir database_dir_;
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<CollectionBackend> backend_;
+};
+
+TEST_F(DatabaseTest, WriteAheadLogging) {
+
+  QSqlDatabase db(database_->Connect());
+  QSqlQuery q(db);
+  ASSERT_TRUE(q.exec("PRAGMA journal_mode"));
+  ASSERT_TRUE(q.next());
+  EXPECT_EQ("wal", q.value(0).toString().toLower());
+
+}
+
+TEST_F(DatabaseTest, ReaderConnectionIsReadOnly) {
+
+  QSqlDatabase db(database_->ConnectReader());
+  EXPECT_NE(database_->Connect().connectionName(), db.connectionName());
+
+  QSqlQuery q(db);
+  EXPECT_FALSE(q.exec(QString("DELETE FROM %1").arg(SCollection::kSongsTable)));
+
+}
+
+// Runs filter queries on this thread while another thread adds songs in large transactions, the way a scan does.
+// The readers should neither fail nor wait for a whole write transaction to finish.
+TEST_F(DatabaseTest, ConcurrentScanAndFilterQueries) {
+
+  static const int kBatches = 20;
+  static const int kSongsPerBatch = 500;
+
+  QAtomicInt writing(1);
+  QFuture<void> writer = QtConcurrent::run([this, &writing]() {
+    for (int batch = 0; batch < kBatches; ++batch) {
+      backend_->AddOrUpdateSongs(MakeSongs(batch, kSongsPerBatch));
+    }
+    backend_->Close();
+    writing.storeRelease(0);
+  });
+
+  int queries = 0;
+  qint64 max_latency = 0;
+  QElapsedTimer timer;
+  do {
+    QueryOptions options;
+    options.set_filter("Title");
+    timer.start();
+    CollectionQuery query(options);
+    query.SetColumnSpec("%songs_table.ROWID, " + Song::kColumnSpec);
+    {
+      QMutexLocker l(database_->ReaderMutex());
+      const bool success = backend_->ExecQuery(&query);
+      EXPECT_TRUE(success);
+      while (success && query.Next()) {}
+    }
+    max_latency = qMax(max_latency, timer.elapsed());
+    ++queries;
+  } while (writing.loadAcquire() == 1);
+  writer.waitForFinished();
+
+  EXPECT_EQ(kBatches * kSongsPerBatch, backend_->GetAllSongs().count());
+
+  qLog(Info) << "Ran" << queries << "filter queries during the scan, the slowest took" << max_latency << "ms";
+
+}
+
+}  // namespace
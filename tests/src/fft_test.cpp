@@ -0,0 +1,93 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+
+#include "test_utils.h"
+
+#include "analyzer/fft.h"
+
+namespace {
+
+// The windowed transform computed the slow way.
+std::vector<float> NaiveSpectrum(const std::vector<float> &samples) {
+
+  const int size = static_cast<int>(samples.size());
+  std::vector<float> magnitudes(size / 2);
+  for (int k = 0; k < size / 2; ++k) {
+    double re = 0.0;
+    double im = 0.0;
+    for (int i = 0; i < size; ++i) {
+      const double sample = samples[i] * (1.0 - std::cos(2.0 * M_PI * i / size));
+      re += sample * std::cos(2.0 * M_PI * k * i / size);
+      im -= sample * std::sin(2.0 * M_PI * k * i / size);
+    }
+    magnitudes[k] = static_cast<float>(std::sqrt(re * re + im * im));
+  }
+  return magnitudes;
+
+}
+
+class FFTTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(FFTTest, MatchesNaiveTransform) {
+
+  FFT fft(GetParam());
+  ASSERT_EQ(1 << GetParam(), fft.size());
+
+  std::vector<float> samples(fft.size());
+  for (int i = 0; i < fft.size(); ++i) {
+    samples[i] = static_cast<float>(std::sin(i * 0.37) * 0.5 + std::cos(i * 1.91) * 0.25 + ((i * 7919) % 13) / 26.0);
+  }
+
+  std::vector<float> magnitudes(fft.size() / 2);
+  fft.Spectrum(samples.data(), magnitudes.data());
+
+  const std::vector<float> expected = NaiveSpectrum(samples);
+  for (int k = 0; k < fft.size() / 2; ++k) {
+    EXPECT_NEAR(expected[k], magnitudes[k], 1e-3 * fft.size()) << "bin " << k;
+  }
+
+}
+
+INSTANTIATE_TEST_CASE_P(Sizes, FFTTest, ::testing::Values(2, 3, 4, 7, 9));
+
+TEST(FFTTest, SinePeak) {
+
+  FFT fft(9);
+  std::vector<float> samples(fft.size());
+  for (int i = 0; i < fft.size(); ++i) {
+    samples[i] = static_cast<float>(0.8 * std::sin(2.0 * M_PI * 40 * i / fft.size()));
+  }
+
+  std::vector<float> magnitudes(fft.size() / 2);
+  fft.Spectrum(samples.data(), magnitudes.data());
+
+  EXPECT_NEAR(0.8 * fft.size() / 2, magnitudes[40], 1e-2);
+  EXPECT_LT(magnitudes[38], 1e-2);
+  EXPECT_LT(magnitudes[42], 1e-2);
+
+}
+
+}  // namespace
@@ -0,0 +1,221 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+#include <QThread>
+#include <QTemporaryDir>
+#include <QStandardPaths>
+#include <QSettings>
+#include <QFile>
+#include <QIODevice>
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+
+#include "test_utils.h"
+
+#include "moodbar/moodbarloader.h"
+#include "moodbar/moodbarpipeline.h"
+#include "settings/moodbarsettingspage.h"
+
+namespace {
+
+// Keeps the pipelines it's asked to start, so the tests finish them.
+class MoodbarLoaderForTest : public MoodbarLoader {
+ public:
+  MoodbarLoaderForTest() : MoodbarLoader(nullptr) {}
+
+  void Finish(MoodbarPipeline *pipeline) {
+    started_.removeAll(pipeline);
+    emit pipeline->Finished(false);
+  }
+
+  void FinishAll() {
+    while (!started_.isEmpty()) Finish(started_.first());
+  }
+
+  void SetEnabled(const bool enabled) {
+    QSettings s;
+    s.beginGroup(MoodbarSettingsPage::kSettingsGroup);
+    s.setValue("enabled", enabled);
+    s.endGroup();
+    QMetaObject::invokeMethod(this, "ReloadSettings");
+  }
+
+  QList<MoodbarPipeline*> started_;
+
+ protected:
+  void StartPipeline(MoodbarPipeline *pipeline) override { started_ << pipeline; }
+};
+
+class MoodbarLoaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+
+    QStandardPaths::setTestModeEnabled(true);
+    QSettings s;
+    s.beginGroup(MoodbarSettingsPage::kSettingsGroup);
+    s.setValue("enabled", true);
+    s.setValue("save", false);
+    s.endGroup();
+
+    ASSERT_TRUE(temp_dir_.isValid());
+    loader_.reset(new MoodbarLoaderForTest);
+
+  }
+
+  void TearDown() override {
+
+    loader_->FinishAll();
+    loader_.reset();
+    QSettings s;
+    s.remove(MoodbarSettingsPage::kSettingsGroup);
+
+  }
+
+  QUrl MakeFile(const QString &name, const bool has_mood_file) {
+
+    QFile file(temp_dir_.filePath(name + ".flac"));
+    EXPECT_TRUE(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    if (has_mood_file) {
+      QFile mood_file(temp_dir_.filePath(name + ".mood"));
+      EXPECT_TRUE(mood_file.open(QIODevice::WriteOnly));
+      mood_file.write(QByteArray(1000, 0));
+    }
+
+    return QUrl::fromLocalFile(file.fileName());
+
+  }
+
+  QList<QUrl> MakeFiles(const int count, const QString &prefix = QString()) {
+
+    QList<QUrl> urls;
+    for (int i = 0; i < count; ++i) {
+      urls << MakeFile(prefix + QString::number(i), false);
+    }
+    return urls;
+
+  }
+
+  static QList<QUrl> Urls(const QList<MoodbarPipeline*> &pipelines) {
+
+    QList<QUrl> urls;
+    for (MoodbarPipeline *pipeline : pipelines) {
+      urls << pipeline->url();
+    }
+    return urls;
+
+  }
+
+  QTemporaryDir temp_dir_;
+  std::unique_ptr<MoodbarLoaderForTest> loader_;
+};
+
+TEST_F(MoodbarLoaderTest, CountsBatchRequests) {
+
+  const QList<QUrl> urls = QList<QUrl>() << MakeFile("a", false) << MakeFile("b", true) << MakeFile("c", false) << MakeFile("d", true) << MakeFile("e", false);
+
+  // e is loaded for the playlist already, it's counted without being generated again.
+  QByteArray data;
+  MoodbarPipeline *pipeline = nullptr;
+  ASSERT_EQ(MoodbarLoader::WillLoadAsync, loader_->Load(urls[4], &data, &pipeline));
+  ASSERT_EQ(1, loader_->started_.count());
+
+  loader_->GenerateMoodbars(urls);
+  ASSERT_TRUE(loader_->batch_running());
+  EXPECT_EQ(5, loader_->batch_total());
+
+  QList<QUrl> generated;
+  while (loader_->started_.count() > 1) {
+    EXPECT_LT(loader_->batch_done(), loader_->batch_total());
+    MoodbarPipeline *next = loader_->started_[1];
+    generated << next->url();
+    loader_->Finish(next);
+  }
+
+  EXPECT_EQ(QList<QUrl>() << urls[0] << urls[2], generated);
+  EXPECT_FALSE(loader_->batch_running());
+  EXPECT_EQ(0, loader_->batch_done());
+  EXPECT_EQ(0, loader_->batch_total());
+
+  // The request for the playlist is still running.
+  EXPECT_EQ(QList<QUrl>() << urls[4], Urls(loader_->started_));
+
+}
+
+TEST_F(MoodbarLoaderTest, KeepsPipelinesForShownSongs) {
+
+  loader_->GenerateMoodbars(MakeFiles(QThread::idealThreadCount() * 2 + 5));
+  const int batch_pipelines = loader_->started_.count();
+  ASSERT_GT(batch_pipelines, 0);
+  ASSERT_TRUE(loader_->batch_running());
+
+  // A song that is shown starts right away while every pipeline of the job is busy.
+  const QUrl url = MakeFile("shown", false);
+  QByteArray data;
+  MoodbarPipeline *pipeline = nullptr;
+  ASSERT_EQ(MoodbarLoader::WillLoadAsync, loader_->Load(url, &data, &pipeline));
+  ASSERT_EQ(batch_pipelines + 1, loader_->started_.count());
+  EXPECT_EQ(url, loader_->started_.last()->url());
+
+  // Finishing it doesn't count for the job or start more of it.
+  const int batch_done = loader_->batch_done();
+  loader_->Finish(pipeline);
+  EXPECT_EQ(batch_done, loader_->batch_done());
+  EXPECT_EQ(batch_pipelines, loader_->started_.count());
+
+}
+
+TEST_F(MoodbarLoaderTest, StopsBatchWhenDisabled) {
+
+  const int count = QThread::idealThreadCount() * 2 + 5;
+  loader_->GenerateMoodbars(MakeFiles(count));
+  const int running = loader_->started_.count();
+  ASSERT_GT(running, 0);
+  ASSERT_LT(running, count);
+
+  // The pipelines that are running finish, the rest of the job is dropped.
+  loader_->SetEnabled(false);
+  EXPECT_TRUE(loader_->batch_running());
+  EXPECT_EQ(running, loader_->batch_total());
+
+  loader_->Finish(loader_->started_.first());
+  EXPECT_EQ(running - 1, loader_->started_.count());
+
+  loader_->FinishAll();
+  EXPECT_FALSE(loader_->batch_running());
+
+  // Nothing is started while moodbars are disabled.
+  loader_->GenerateMoodbars(MakeFiles(3, "disabled"));
+  EXPECT_FALSE(loader_->batch_running());
+  EXPECT_TRUE(loader_->started_.isEmpty());
+
+}
+
+}  // namespace
@@ -0,0 +1,141 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+
+#include "test_utils.h"
+
+#include "core/timeconstants.h"
+#include "engine/pcmringbuffer.h"
+#include "engine/sampleconverter.h"
+
+namespace {
+
+// 1000 stereo frames per second make one frame a millisecond.
+static const int kRate = 1000;
+static const int kChannels = 2;
+
+// Writes frames with both samples set to the frame number, starting at the stream time of first_frame.
+void WriteFrames(PcmRingBuffer *buffer, const int first_frame, const int frames) {
+
+  std::vector<qint16> samples;
+  for (int i = first_frame; i < first_frame + frames; ++i) {
+    samples.push_back(static_cast<qint16>(i));
+    samples.push_back(static_cast<qint16>(i));
+  }
+  buffer->Write(SampleConverter::Format_S16LE, samples.data(), samples.size(), first_frame * kNsecPerMsec, kRate, kChannels);
+
+}
+
+TEST(PcmRingBufferTest, ReadsPosition) {
+
+  PcmRingBuffer buffer(1024);
+  qint16 dest[8];
+
+  EXPECT_EQ(0, buffer.Read(0, dest, 8));
+
+  WriteFrames(&buffer, 100, 50);
+  WriteFrames(&buffer, 150, 50);
+
+  // Nothing was written for positions before the first buffer.
+  EXPECT_EQ(0, buffer.Read(99 * kNsecPerMsec, dest, 8));
+
+  ASSERT_EQ(8, buffer.Read(148 * kNsecPerMsec, dest, 8));
+  EXPECT_EQ(148, dest[0]);
+  EXPECT_EQ(148, dest[1]);
+  EXPECT_EQ(151, dest[7]);
+
+  // The window ends at the last written frame when the position is ahead of the writer.
+  ASSERT_EQ(8, buffer.Read(198 * kNsecPerMsec, dest, 8));
+  EXPECT_EQ(196, dest[0]);
+  EXPECT_EQ(199, dest[7]);
+
+}
+
+TEST(PcmRingBufferTest, OverwritesOldest) {
+
+  PcmRingBuffer buffer(256);
+  qint16 dest[8];
+
+  for (int frame = 0; frame < 1000; frame += 30) {
+    WriteFrames(&buffer, frame, 30);
+  }
+
+  // Only the last 128 frames are left, across the end of the ring.
+  ASSERT_EQ(8, buffer.Read(900 * kNsecPerMsec, dest, 8));
+  EXPECT_EQ(900, dest[0]);
+  EXPECT_EQ(903, dest[7]);
+
+  ASSERT_EQ(8, buffer.Read(10 * kNsecPerMsec, dest, 8));
+  EXPECT_EQ(1020 - 128, dest[0]);
+
+  // After seeking back the new buffers are found first.
+  WriteFrames(&buffer, 10, 20);
+  ASSERT_EQ(8, buffer.Read(12 * kNsecPerMsec, dest, 8));
+  EXPECT_EQ(12, dest[0]);
+
+}
+
+TEST(PcmRingBufferTest, ConcurrentReaders) {
+
+  static const int kFrames = 2000000;
+  static const int kFramesPerWrite = 333;
+
+  PcmRingBuffer buffer(4096);
+  std::atomic<bool> done(false);
+  std::atomic<int> bad_windows(0);
+  std::atomic<int> windows(0);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&]() {
+      qint16 dest[256];
+      while (!done) {
+        const qint64 count = buffer.Read(kFrames * kNsecPerMsec, dest, 256);
+        if (count == 0) continue;
+        ++windows;
+        // Every window has to be whole consecutive frames, never a mix of old and new samples.
+        for (qint64 j = 2; j < count; j += 2) {
+          if (dest[j] != static_cast<qint16>(dest[j - 2] + 1) || dest[j] != dest[j + 1]) {
+            ++bad_windows;
+            break;
+          }
+        }
+      }
+    });
+  }
+
+  for (int frame = 0; frame < kFrames; frame += kFramesPerWrite) {
+    WriteFrames(&buffer, frame, kFramesPerWrite);
+  }
+  done = true;
+  for (std::thread &reader : readers) reader.join();
+
+  EXPECT_EQ(0, bad_windows);
+  EXPECT_LT(0, windows);
+
+}
+
+}  // namespace
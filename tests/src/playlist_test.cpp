@@ -20,20 +20,35 @@
  */
 
 #include <memory>
+#include <algorithm>
+#include <functional>
 
 #include <gtest/gtest.h>
 
 #include "test_utils.h"
 
+#include "core/logging.h"
 #include "collection/collectionplaylistitem.h"
 #include "playlist/playlist.h"
+#include "playlist/playlistundocommands.h"
+#include "playlist/songplaylistitem.h"
+#include "playlist/playlistvirtualitems.h"
 #include "mock_settingsprovider.h"
 #include "mock_playlistitem.h"
 
 #include <QtDebug>
+#include <QVariant>
+#include <QUrl>
 #include <QUndoStack>
+#include <QSortFilterProxyModel>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QSet>
+#include <QString>
+#include <QStringList>
 
 using ::testing::Return;
+using namespace std::placeholders;
 
 namespace {
 
@@ -90,6 +105,32 @@ TEST_F(PlaylistTest, InsertItems) {
 
 }
 
+TEST_F(PlaylistTest, TypedColumnsMatchData) {
+
+  Song song;
+  song.Init("Title", "Artist", "Album", 123);
+  song.set_track(7);
+  song.set_year(1999);
+  song.set_bitrate(320);
+  song.set_comment("Two\nlines");
+  song.set_url(QUrl("http://example.com/stream.mp3"));
+  playlist_.InsertItems(PlaylistItemList() << PlaylistItemPtr(new CollectionPlaylistItem(song)));
+
+  const Song *metadata = playlist_.metadata_at(0);
+  ASSERT_TRUE(metadata);
+  EXPECT_EQ(nullptr, playlist_.metadata_at(1));
+
+  for (int i = 0; i < Playlist::ColumnCount; ++i) {
+    const Playlist::Column column = static_cast<Playlist::Column>(i);
+    const QVariant value = playlist_.data(playlist_.index(0, column));
+    EXPECT_EQ(value.toString(), Playlist::column_text(*metadata, column)) << i;
+    if (Playlist::column_is_numeric(column)) {
+      EXPECT_EQ(value.toLongLong(), Playlist::column_number(*metadata, column)) << i;
+    }
+  }
+
+}
+
 TEST_F(PlaylistTest, Indexes) {
 
   playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("One") << MakeMockItemP("Two") << MakeMockItemP("Three"));
@@ -266,6 +307,47 @@ TEST_F(PlaylistTest, InsertAfterCurrent) {
 
 }
 
+TEST_F(PlaylistTest, Filter) {
+
+  playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("Beat It", "Michael Jackson") << MakeMockItemP("Help!", "The Beatles") << MakeMockItemP("Yesterday", "The Beatles"));
+
+  QSortFilterProxyModel *proxy = playlist_.proxy();
+  auto set_filter = [proxy](const QString &filter) {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    proxy->setFilterRegularExpression(filter);
+#else
+    proxy->setFilterRegExp(filter);
+#endif
+  };
+
+  set_filter("beat");
+  EXPECT_EQ(3, proxy->rowCount());
+
+  // Refinements only evaluate the rows accepted so far
+  set_filter("beatles");
+  EXPECT_EQ(2, proxy->rowCount());
+  set_filter("beatles yes");
+  EXPECT_EQ(1, proxy->rowCount());
+
+  set_filter("beatles -yes");
+  EXPECT_EQ(1, proxy->rowCount());
+  set_filter("artist:beatles OR title:beat");
+  EXPECT_EQ(3, proxy->rowCount());
+  set_filter("artist:beatles");
+  EXPECT_EQ(2, proxy->rowCount());
+
+  // Changes to the playlist are filtered without evaluating it again
+  playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("Let It Be", "The Beatles") << MakeMockItemP("Thriller", "Michael Jackson"), 1);
+  EXPECT_EQ(3, proxy->rowCount());
+  playlist_.removeRows(0, 2, QModelIndex());
+  EXPECT_EQ(2, proxy->rowCount());
+  EXPECT_EQ("Help!", proxy->index(0, Playlist::Column_Title).data().toString());
+
+  set_filter(QString());
+  EXPECT_EQ(3, proxy->rowCount());
+
+}
+
 TEST_F(PlaylistTest, Clear) {
 
   playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("One") << MakeMockItemP("Two") << MakeMockItemP("Three"));
@@ -541,4 +623,172 @@ TEST_F(PlaylistTest, CollectionIdMapMulti) {
 }
 
 
+TEST_F(PlaylistTest, PositionsFollowPlaylistOrder) {
+
+  playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("One") << MakeMockItemP("Two") << MakeMockItemP("Three"));
+  playlist_.InsertItems(PlaylistItemList() << MakeMockItemP("Four") << MakeMockItemP("Five"), 1);
+  playlist_.undo_stack()->push(new PlaylistUndoCommands::MoveItems(&playlist_, QList<int>() << 0 << 2, 4));
+  ASSERT_EQ(5, playlist_.rowCount(QModelIndex()));
+
+  for (int i = 0; i < playlist_.rowCount(QModelIndex()); ++i) {
+    EXPECT_LT(0, playlist_.position_at(i));
+    if (i > 0) EXPECT_LT(playlist_.position_at(i - 1), playlist_.position_at(i));
+  }
+
+  // Moving the items back gives them new positions in the gaps they came from
+  playlist_.undo_stack()->undo();
+  EXPECT_EQ("One", playlist_.item_at(0)->Metadata().title());
+  EXPECT_EQ("Five", playlist_.item_at(2)->Metadata().title());
+  for (int i = 1; i < playlist_.rowCount(QModelIndex()); ++i) {
+    EXPECT_LT(playlist_.position_at(i - 1), playlist_.position_at(i));
+  }
+
+}
+
+// Items with few albums and repeated discs and tracks, so sorting has many ties to keep in order.
+PlaylistItemList MakeSortItems(const int count) {
+
+  PlaylistItemList items;
+  for (int i = 0; i < count; ++i) {
+    Song song;
+    song.Init(QString("Title %1").arg(i), QString("Artist %1").arg(i % 7), QString("%1 Album %2").arg(i % 2 == 0 ? "the" : "The").arg((i * 7919) % (count / 10 + 1)), 1);
+    song.set_disc((i * 31) % 3);
+    song.set_track((i * 17) % 12);
+    song.set_url(QUrl::fromLocalFile(QString("/music/%1/%2.flac").arg(i % 5).arg(i)));
+    items << PlaylistItemPtr(new SongPlaylistItem(song));
+  }
+  return items;
+
+}
+
+TEST_F(PlaylistTest, SortItemsMatchesCompareItems) {
+
+  const PlaylistItemList items = MakeSortItems(500);
+
+  for (const Qt::SortOrder order : QList<Qt::SortOrder>() << Qt::AscendingOrder << Qt::DescendingOrder) {
+    PlaylistItemList expected(items);
+    std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Track, order, _1, _2));
+    std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Disc, order, _1, _2));
+    std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Album, order, _1, _2));
+    EXPECT_EQ(expected, Playlist::SortItems(items, Playlist::Column_Album, order));
+
+    expected = items;
+    std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Artist, order, _1, _2));
+    EXPECT_EQ(expected, Playlist::SortItems(items, Playlist::Column_Artist, order));
+  }
+
+}
+
+TEST_F(PlaylistTest, VirtualItems) {
+
+  PlaylistVirtualItems virtual_items;
+  virtual_items.InsertRows(0, 100, 0);
+  EXPECT_EQ(42, virtual_items.at(42));
+
+  virtual_items.Shuffle(PlaylistSequence::Shuffle_All, 10);
+  virtual_items.InsertRows(50, 20, 10);
+  virtual_items.RemoveRows(0, 5);
+  virtual_items.MoveToFront(60);
+  ASSERT_EQ(115, virtual_items.count());
+
+  QSet<int> rows;
+  for (int i = 0; i < virtual_items.count(); ++i) {
+    const int row = virtual_items.at(i);
+    rows << row;
+    EXPECT_EQ(i, virtual_items.indexOf(row));
+  }
+  EXPECT_EQ(115, rows.count());
+  EXPECT_EQ(60, virtual_items.at(0));
+
+  // The songs of an album are played together in playlist order.
+  QStringList album_keys;
+  for (int i = 0; i < virtual_items.count(); ++i) {
+    album_keys << QString::number(i % 7);
+  }
+  virtual_items.Shuffle(PlaylistSequence::Shuffle_Albums, 0, album_keys, 3);
+  virtual_items.InsertRows(115, 7, 0, QStringList() << "0" << "1" << "2" << "3" << "4" << "5" << "6");
+  album_keys << "0" << "1" << "2" << "3" << "4" << "5" << "6";
+
+  QSet<QString> albums;
+  for (int i = 0; i < virtual_items.count(); ++i) {
+    const int row = virtual_items.at(i);
+    if (i == 0) EXPECT_EQ("3", album_keys[row]);
+    if (i > 0 && album_keys[virtual_items.at(i - 1)] == album_keys[row]) {
+      EXPECT_LT(virtual_items.at(i - 1), row);
+    }
+    else {
+      EXPECT_FALSE(albums.contains(album_keys[row]));
+      albums << album_keys[row];
+    }
+  }
+
+  virtual_items.Shuffle(PlaylistSequence::Shuffle_Off, 0);
+  EXPECT_EQ(42, virtual_items.indexOf(42));
+
+}
+
+TEST_F(PlaylistTest, VirtualItemsReorderAlbums) {
+
+  QStringList album_keys;
+  for (int i = 0; i < 20; ++i) {
+    album_keys << QString::number(i % 4);
+  }
+
+  PlaylistVirtualItems virtual_items;
+  virtual_items.InsertRows(0, album_keys.count(), 0);
+  virtual_items.Shuffle(PlaylistSequence::Shuffle_Albums, 0, album_keys);
+
+  // Reverse the playlist, then add a song of each album.
+  QVector<int> new_rows;
+  QStringList reordered_album_keys;
+  for (int row = 0; row < album_keys.count(); ++row) {
+    new_rows << album_keys.count() - 1 - row;
+    reordered_album_keys.prepend(album_keys[row]);
+  }
+  virtual_items.Reorder(new_rows, 0);
+  virtual_items.InsertRows(20, 4, 0, QStringList() << "0" << "1" << "2" << "3");
+  reordered_album_keys << "0" << "1" << "2" << "3";
+  ASSERT_EQ(24, virtual_items.count());
+
+  // The songs of an album are still played together in the new playlist order.
+  QSet<QString> albums;
+  for (int i = 0; i < virtual_items.count(); ++i) {
+    const int row = virtual_items.at(i);
+    if (i > 0 && reordered_album_keys[virtual_items.at(i - 1)] == reordered_album_keys[row]) {
+      EXPECT_LT(virtual_items.at(i - 1), row);
+    }
+    else {
+      EXPECT_FALSE(albums.contains(reordered_album_keys[row]));
+      albums << reordered_album_keys[row];
+    }
+  }
+  EXPECT_EQ(4, albums.count());
+
+}
+
+// Measures sorting a large playlist by album, run it with: playlist_test --gtest_also_run_disabled_tests
+TEST_F(PlaylistTest, DISABLED_SortByAlbumBenchmark) {
+
+  static const int kItems = 500000;
+
+  const PlaylistItemList items = MakeSortItems(kItems);
+
+  QElapsedTimer timer;
+  timer.start();
+  const PlaylistItemList sorted = Playlist::SortItems(items, Playlist::Column_Album, Qt::AscendingOrder);
+  const qint64 elapsed = timer.elapsed();
+  ASSERT_EQ(kItems, sorted.count());
+
+  timer.start();
+  PlaylistItemList expected(items);
+  std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Track, Qt::AscendingOrder, _1, _2));
+  std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Disc, Qt::AscendingOrder, _1, _2));
+  std::stable_sort(expected.begin(), expected.end(), std::bind(&Playlist::CompareItems, Playlist::Column_Album, Qt::AscendingOrder, _1, _2));
+  const qint64 elapsed_compare = timer.elapsed();
+  EXPECT_EQ(expected, sorted);
+
+  qLog(Info) << "Sorted" << kItems << "items by album in" << elapsed << "ms, sorting with CompareItems took" << elapsed_compare << "ms";
+
+}
+
 }  // namespace
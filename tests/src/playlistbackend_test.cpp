@@ -0,0 +1,341 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <QFile>
+#include <QIODevice>
+#include <QSignalSpy>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "test_utils.h"
+
+#include "core/song.h"
+#include "core/database.h"
+#include "collection/collection.h"
+#include "collection/collectionbackend.h"
+#include "collection/collectionplaylistitem.h"
+#include "playlist/playlist.h"
+#include "playlist/playlistbackend.h"
+#include "playlist/playlistsequence.h"
+#include "playlist/playlistundocommands.h"
+#include "playlist/songplaylistitem.h"
+#include "mock_settingsprovider.h"
+
+namespace {
+
+class PlaylistBackendTest : public ::testing::Test {
+ protected:
+  PlaylistBackendTest() : sequence_(nullptr, new DummySettingsProvider) {}
+
+  void SetUp() override {
+
+    // Playlists are restored in another thread, which doesn't see an in-memory database.
+    ASSERT_TRUE(temp_dir_.isValid());
+    database_.reset(new Database(nullptr, nullptr, temp_dir_.filePath("strawberry.db")));
+    backend_.reset(new PlaylistBackend(database_.get()));
+
+  }
+
+  void TearDown() override {
+
+    backend_.reset();
+    database_->Close();
+    database_.reset();
+
+  }
+
+  static PlaylistItemPtr MakeItem(const QString &title) {
+
+    Song song(Song::Source_LocalFile);
+    song.Init(title, "Artist", "Album", 123);
+    song.set_url(QUrl::fromLocalFile("/nonexistent/" + title + ".flac"));
+    return PlaylistItemPtr(new SongPlaylistItem(song));
+
+  }
+
+  static PlaylistItemList MakeItems(const QStringList &titles) {
+
+    PlaylistItemList items;
+    for (const QString &title : titles) {
+      items << MakeItem(title);
+    }
+    return items;
+
+  }
+
+  // Restores a playlist from the database like it's restored at startup.
+  std::unique_ptr<Playlist> Load(const int id, CollectionBackend *collection = nullptr) {
+
+    std::unique_ptr<Playlist> playlist(new Playlist(backend_.get(), nullptr, collection, id));
+    QSignalSpy loaded(playlist.get(), SIGNAL(PlaylistLoaded()));
+    EXPECT_TRUE(loaded.wait());
+    playlist->set_sequence(&sequence_);
+    return playlist;
+
+  }
+
+  // Runs the saves, which are queued to the backend.
+  static void WaitForSave() {
+    QCoreApplication::processEvents();
+  }
+
+  static QStringList Titles(const Playlist &playlist) {
+
+    QStringList titles;
+    for (int i = 0; i < playlist.rowCount(); ++i) {
+      titles << playlist.item_at(i)->Metadata().title();
+    }
+    return titles;
+
+  }
+
+  QTemporaryDir temp_dir_;
+  std::unique_ptr<Database> database_;
+  std::unique_ptr<PlaylistBackend> backend_;
+  PlaylistSequence sequence_;
+};
+
+TEST_F(PlaylistBackendTest, SavesEdits) {
+
+  const int id = backend_->CreatePlaylist("Test", QString());
+  std::unique_ptr<Playlist> playlist = Load(id);
+
+  playlist->InsertItems(MakeItems(QStringList() << "One" << "Two" << "Three" << "Four" << "Five"));
+  WaitForSave();
+  EXPECT_EQ(Titles(*playlist), Titles(*Load(id)));
+
+  // Each edit is saved on its own, on top of the rows saved before it.
+  playlist->undo_stack()->push(new PlaylistUndoCommands::MoveItems(playlist.get(), QList<int>() << 0 << 2, 4));
+  playlist->undo_stack()->push(new PlaylistUndoCommands::RemoveItems(playlist.get(), 1, 1));
+  playlist->InsertItems(MakeItems(QStringList() << "Six"), 2);
+  playlist->undo_stack()->undo();
+  playlist->InsertItems(MakeItems(QStringList() << "Seven"), 0);
+  WaitForSave();
+
+  std::unique_ptr<Playlist> restored = Load(id);
+  EXPECT_EQ(QStringList() << "Seven" << "Two" << "One" << "Three" << "Five", Titles(*restored));
+  EXPECT_EQ(Titles(*playlist), Titles(*restored));
+  for (int i = 1; i < restored->rowCount(); ++i) {
+    EXPECT_LT(restored->position_at(i - 1), restored->position_at(i));
+  }
+
+}
+
+TEST_F(PlaylistBackendTest, SavesItemsInSeveralPlaylists) {
+
+  const int first_id = backend_->CreatePlaylist("First", QString());
+  const int second_id = backend_->CreatePlaylist("Second", QString());
+  std::unique_ptr<Playlist> first = Load(first_id);
+  std::unique_ptr<Playlist> second = Load(second_id);
+
+  first->InsertItems(MakeItems(QStringList() << "One" << "Two" << "Three"));
+  second->InsertItems(MakeItems(QStringList() << "A" << "B" << "C" << "D"));
+
+  // Dropping items on another playlist puts the same items in both, each playlist has its own rows for them.
+  second->InsertItems(PlaylistItemList() << first->item_at(0) << first->item_at(2), 1);
+  first->undo_stack()->push(new PlaylistUndoCommands::MoveItems(first.get(), QList<int>() << 0, 3));
+  second->undo_stack()->push(new PlaylistUndoCommands::MoveItems(second.get(), QList<int>() << 2, 0));
+  WaitForSave();
+
+  EXPECT_EQ(QStringList() << "Two" << "Three" << "One", Titles(*Load(first_id)));
+  EXPECT_EQ(QStringList() << "Three" << "A" << "One" << "B" << "C" << "D", Titles(*Load(second_id)));
+
+}
+
+TEST_F(PlaylistBackendTest, RewritesPlaylistAfterFailedSave) {
+
+  const int id = backend_->CreatePlaylist("Test", QString());
+  std::unique_ptr<Playlist> playlist = Load(id);
+
+  playlist->InsertItems(MakeItems(QStringList() << "One" << "Two" << "Three"));
+  WaitForSave();
+
+  // The rows the next save changes are gone, so it fails and nothing of it is written.
+  {
+    QSqlDatabase db(database_->Connect());
+    QSqlQuery q(db);
+    ASSERT_TRUE(q.exec("DELETE FROM playlist_items"));
+  }
+  playlist->undo_stack()->push(new PlaylistUndoCommands::MoveItems(playlist.get(), QList<int>() << 0, 3));
+  WaitForSave();
+  EXPECT_EQ(0, Load(id)->rowCount());
+
+  // The next save writes the whole playlist.
+  playlist->Save();
+  WaitForSave();
+  EXPECT_EQ(QStringList() << "Two" << "Three" << "One", Titles(*Load(id)));
+
+}
+
+TEST_F(PlaylistBackendTest, LoadsCollectionItemMetadata) {
+
+  CollectionBackend collection;
+  collection.Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+  collection.AddDirectory("/nonexistent");
+
+  // The files exist, so the items aren't greyed out when they're restored.
+  SongList songs;
+  for (const QString &title : QStringList() << "One" << "Two" << "Three") {
+    QFile file(temp_dir_.filePath(title + ".flac"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.close();
+    Song song(Song::Source_Collection);
+    song.Init(title, "Artist " + title, "Album " + title, 123 + songs.count());
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile(file.fileName()));
+    song.set_mtime(1);
+    song.set_ctime(1);
+    song.set_filesize(1);
+    songs << song;
+  }
+  collection.AddOrUpdateSongs(songs);
+  songs = collection.GetAllSongs();
+  ASSERT_EQ(3, songs.count());
+  std::sort(songs.begin(), songs.end(), [](const Song &a, const Song &b) { return a.length_nanosec() < b.length_nanosec(); });
+
+  const int id = backend_->CreatePlaylist("Test", QString());
+  {
+    std::unique_ptr<Playlist> playlist = Load(id, &collection);
+    PlaylistItemList items;
+    for (const Song &song : songs) {
+      items << PlaylistItemPtr(new CollectionPlaylistItem(song));
+    }
+    playlist->InsertItems(items);
+    WaitForSave();
+  }
+
+  // Restored items only know their id, length and URL until their metadata is loaded.
+  std::unique_ptr<Playlist> restored = Load(id, &collection);
+  ASSERT_EQ(3, restored->rowCount());
+  for (int row = 0; row < restored->rowCount(); ++row) {
+    EXPECT_FALSE(restored->item_at(row)->HasMetadata());
+    EXPECT_FALSE(restored->data(restored->index(row, Playlist::Column_Title)).isValid());
+    EXPECT_EQ(songs[row].length_nanosec(), restored->data(restored->index(row, Playlist::Column_Length)).toLongLong());
+    EXPECT_EQ(songs[row].url(), restored->item_at(row)->Url());
+  }
+
+  // Songs removed from the collection since are greyed out.
+  collection.DeleteSongs(SongList() << songs[1]);
+
+  QSignalSpy data_changed(restored.get(), SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+  restored->LoadItemMetadata(QList<int>() << 0 << 1 << 2);
+  ASSERT_TRUE(data_changed.wait());
+
+  for (int row : QList<int>() << 0 << 2) {
+    EXPECT_TRUE(restored->item_at(row)->HasMetadata());
+    EXPECT_EQ(songs[row].title(), restored->data(restored->index(row, Playlist::Column_Title)).toString());
+    EXPECT_EQ(songs[row].artist(), restored->data(restored->index(row, Playlist::Column_Artist)).toString());
+    EXPECT_EQ(songs[row].album(), restored->data(restored->index(row, Playlist::Column_Album)).toString());
+    EXPECT_EQ(songs[row].length_nanosec(), restored->data(restored->index(row, Playlist::Column_Length)).toLongLong());
+    EXPECT_EQ(songs[row].url(), restored->item_at(row)->Url());
+    EXPECT_FALSE(restored->item_at(row)->HasForegroundColor(Playlist::kInvalidSongPriority));
+  }
+  EXPECT_TRUE(restored->item_at(1)->HasForegroundColor(Playlist::kInvalidSongPriority));
+
+}
+
+TEST_F(PlaylistBackendTest, GreysOutDeletedCollectionItems) {
+
+  CollectionBackend collection;
+  collection.Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+  collection.AddDirectory("/nonexistent");
+
+  Song song(Song::Source_Collection);
+  song.Init("One", "Artist", "Album", 123);
+  song.set_directory_id(1);
+  song.set_url(QUrl::fromLocalFile("/nonexistent/One.flac"));
+  song.set_mtime(1);
+  song.set_ctime(1);
+  song.set_filesize(1);
+  collection.AddOrUpdateSongs(SongList() << song);
+  const SongList songs = collection.GetAllSongs();
+  ASSERT_EQ(1, songs.count());
+
+  const int id = backend_->CreatePlaylist("Test", QString());
+  {
+    std::unique_ptr<Playlist> playlist = Load(id, &collection);
+    playlist->InsertItems(PlaylistItemList() << PlaylistItemPtr(new CollectionPlaylistItem(songs.first())));
+    WaitForSave();
+  }
+
+  // The files of restored items are checked before their metadata is loaded.
+  std::unique_ptr<Playlist> restored = Load(id, &collection);
+  PlaylistItemPtr item = restored->item_at(0);
+  EXPECT_FALSE(item->HasMetadata());
+  EXPECT_EQ(songs.first().url(), item->Url());
+  EXPECT_TRUE(item->HasForegroundColor(Playlist::kInvalidSongPriority));
+
+  item->RemoveForegroundColor(Playlist::kInvalidSongPriority);
+  restored->InvalidateDeletedSongs();
+  EXPECT_FALSE(item->HasMetadata());
+  EXPECT_TRUE(item->HasForegroundColor(Playlist::kInvalidSongPriority));
+
+}
+
+TEST_F(PlaylistBackendTest, SavesEditsMadeWhileRestoring) {
+
+  const int count = Playlist::kRestorePageSize * 2 + 10;
+  const int id = backend_->CreatePlaylist("Test", QString());
+  {
+    std::unique_ptr<Playlist> playlist = Load(id);
+    QStringList titles;
+    for (int i = 0; i < count; ++i) {
+      titles << QString::number(i);
+    }
+    playlist->InsertItems(MakeItems(titles));
+    WaitForSave();
+  }
+
+  // The playlist can be used once the first page is in it.
+  std::unique_ptr<Playlist> playlist = Load(id);
+  ASSERT_EQ(Playlist::kRestorePageSize, playlist->rowCount());
+
+  playlist->InsertItems(MakeItems(QStringList() << "Edit"), 0);
+  playlist->undo_stack()->push(new PlaylistUndoCommands::RemoveItems(playlist.get(), 2, 1));
+  playlist->undo_stack()->push(new PlaylistUndoCommands::MoveItems(playlist.get(), QList<int>() << 3, 10));
+
+  // Exiting loads the rest of the playlist and saves the edits with it.
+  playlist->FinishRestore();
+  ASSERT_EQ(count, playlist->rowCount());
+  QThreadPool::globalInstance()->waitForDone();
+  WaitForSave();
+
+  std::unique_ptr<Playlist> restored = Load(id);
+  while (restored->rowCount() < count) {
+    QSignalSpy inserted(restored.get(), SIGNAL(rowsInserted(QModelIndex, int, int)));
+    ASSERT_TRUE(inserted.wait());
+  }
+  EXPECT_EQ(Titles(*playlist), Titles(*restored));
+  EXPECT_EQ("Edit", restored->item_at(0)->Metadata().title());
+
+}
+
+}  // namespace
@@ -0,0 +1,161 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+#include <QString>
+
+#include "test_utils.h"
+
+#include "core/logging.h"
+#include "engine/sampleconverter.h"
+
+namespace {
+
+std::vector<quint8> MakeSamples(const SampleConverter::Format format, const qint64 count) {
+
+  std::mt19937 random(count);
+  std::vector<quint8> data;
+
+  switch (format) {
+    case SampleConverter::Format_S24LE:{
+      std::uniform_int_distribution<int> dist(0, 255);
+      data.resize(count * 3);
+      for (quint8 &byte : data) byte = static_cast<quint8>(dist(random));
+      break;
+    }
+    case SampleConverter::Format_S32LE:{
+      std::uniform_int_distribution<qint32> dist(std::numeric_limits<qint32>::min(), std::numeric_limits<qint32>::max());
+      data.resize(count * sizeof(qint32));
+      qint32 *samples = reinterpret_cast<qint32*>(data.data());
+      for (qint64 i = 0 ; i < count ; ++i) samples[i] = dist(random);
+      break;
+    }
+    case SampleConverter::Format_F32LE:{
+      // Include samples outside [-1, 1] so the clipping is tested too.
+      std::uniform_real_distribution<float> dist(-1.5F, 1.5F);
+      data.resize(count * sizeof(float));
+      float *samples = reinterpret_cast<float*>(data.data());
+      for (qint64 i = 0 ; i < count ; ++i) samples[i] = dist(random);
+      if (count > 2) {
+        samples[0] = 1.0F;
+        samples[1] = -1.0F;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  return data;
+
+}
+
+std::vector<qint16> ConvertScalar(const SampleConverter::Format format, const std::vector<quint8> &data, const qint64 count) {
+
+  std::vector<qint16> dest(count);
+  switch (format) {
+    case SampleConverter::Format_S24LE:
+      SampleConverter::S24ToS16Scalar(data.data(), count, dest.data());
+      break;
+    case SampleConverter::Format_S32LE:
+      SampleConverter::S32ToS16Scalar(reinterpret_cast<const qint32*>(data.data()), count, dest.data());
+      break;
+    case SampleConverter::Format_F32LE:
+      SampleConverter::F32ToS16Scalar(reinterpret_cast<const float*>(data.data()), count, dest.data());
+      break;
+    default:
+      break;
+  }
+  return dest;
+
+}
+
+class SampleConverterTest : public ::testing::TestWithParam<SampleConverter::Format> {};
+
+TEST_P(SampleConverterTest, MatchesScalar) {
+
+  const SampleConverter::Format format = GetParam();
+
+  // Lengths around the vector widths, so the tails are converted too.
+  for (qint64 count = 0 ; count < 100 ; ++count) {
+    const std::vector<quint8> data = MakeSamples(format, count);
+    std::vector<qint16> dest(count);
+    SampleConverter::ConvertToS16(format, data.data(), count, dest.data());
+    ASSERT_EQ(ConvertScalar(format, data, count), dest) << SampleConverter::Implementation().toStdString() << " " << count << " samples";
+  }
+
+}
+
+TEST_P(SampleConverterTest, SampleCount) {
+
+  const SampleConverter::Format format = GetParam();
+  const qint64 sample_size = format == SampleConverter::Format_S24LE ? 3 : 4;
+  EXPECT_EQ(1000, SampleConverter::SampleCount(format, 1000 * sample_size));
+  EXPECT_EQ(1000, SampleConverter::SampleCount(format, 1000 * sample_size + 1));
+
+}
+
+// Measures converting an hour of stereo 44.1 kHz audio, run it with: sampleconverter_test --gtest_also_run_disabled_tests
+TEST_P(SampleConverterTest, DISABLED_Benchmark) {
+
+  static const qint64 kBufferSamples = 4096;
+  static const qint64 kBuffers = 3600 * 44100 * 2 / kBufferSamples;
+
+  const SampleConverter::Format format = GetParam();
+  const std::vector<quint8> data = MakeSamples(format, kBufferSamples);
+  std::vector<qint16> dest(kBufferSamples);
+
+  QElapsedTimer timer;
+  timer.start();
+  for (qint64 i = 0 ; i < kBuffers ; ++i) {
+    SampleConverter::ConvertToS16(format, data.data(), kBufferSamples, dest.data());
+  }
+  const qint64 elapsed = timer.elapsed();
+
+  timer.start();
+  for (qint64 i = 0 ; i < kBuffers ; ++i) {
+    dest = ConvertScalar(format, data, kBufferSamples);
+  }
+  const qint64 elapsed_scalar = timer.elapsed();
+
+  qLog(Info) << "Converted" << kBuffers * kBufferSamples << "samples in" << elapsed << "ms using" << SampleConverter::Implementation() << ", scalar conversion took" << elapsed_scalar << "ms";
+
+}
+
+INSTANTIATE_TEST_CASE_P(Formats, SampleConverterTest, ::testing::Values(SampleConverter::Format_S24LE, SampleConverter::Format_S32LE, SampleConverter::Format_F32LE));
+
+TEST(SampleConverterFormatTest, FormatFromString) {
+
+  EXPECT_EQ(SampleConverter::Format_S16LE, SampleConverter::FormatFromString("S16LE"));
+  EXPECT_EQ(SampleConverter::Format_S24LE, SampleConverter::FormatFromString("S24LE"));
+  EXPECT_EQ(SampleConverter::Format_S32LE, SampleConverter::FormatFromString("S32LE"));
+  EXPECT_EQ(SampleConverter::Format_F32LE, SampleConverter::FormatFromString("F32LE"));
+  EXPECT_EQ(SampleConverter::Format_Unknown, SampleConverter::FormatFromString("S24_32LE"));
+  EXPECT_EQ(SampleConverter::Format_Unknown, SampleConverter::FormatFromString(QString()));
+
+}
+
+}  // namespace
@@ -0,0 +1,95 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include <gtest/gtest.h>
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+
+#include "test_utils.h"
+
+#include "core/sharedmemorybuffer.h"
+
+namespace {
+
+QByteArray MakeData(const int size) {
+
+  QByteArray data(size, 0);
+  for (int i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 7);
+  }
+  return data;
+
+}
+
+TEST(SharedMemoryBufferTest, RoundTrip) {
+
+  if (!SharedMemoryBuffer::IsSupported()) return;
+
+  const QByteArray data = MakeData(300 * 1024);
+  const QString name = SharedMemoryBuffer::Create(data);
+  ASSERT_FALSE(name.isEmpty());
+  SharedMemoryBuffer::HandedOver(name);
+
+  {
+    SharedMemoryBuffer buffer;
+    ASSERT_TRUE(buffer.Open(name, data.size()));
+    EXPECT_EQ(data.size(), buffer.size());
+    EXPECT_EQ(data, QByteArray(reinterpret_cast<const char*>(buffer.data()), static_cast<int>(buffer.size())));
+  }
+
+  // The reader removed the name when it opened it.
+  SharedMemoryBuffer buffer;
+  EXPECT_FALSE(buffer.Open(name, data.size()));
+
+}
+
+TEST(SharedMemoryBufferTest, RemovesUnopened) {
+
+  if (!SharedMemoryBuffer::IsSupported()) return;
+
+  const QByteArray data = MakeData(1024);
+
+  // Names the reader doesn't open are removed by the reader.
+  const QString removed = SharedMemoryBuffer::Create(data);
+  ASSERT_FALSE(removed.isEmpty());
+  SharedMemoryBuffer::HandedOver(removed);
+  SharedMemoryBuffer::Remove(removed);
+
+  // Names that were never handed over are removed by the writer.
+  const QString created = SharedMemoryBuffer::Create(data);
+  ASSERT_FALSE(created.isEmpty());
+  SharedMemoryBuffer::RemoveCreated();
+
+  // The objects of running processes are not stale.
+  const QString live = SharedMemoryBuffer::Create(data);
+  ASSERT_FALSE(live.isEmpty());
+  SharedMemoryBuffer::RemoveStale();
+
+  SharedMemoryBuffer buffer;
+  EXPECT_FALSE(buffer.Open(removed, data.size()));
+  EXPECT_FALSE(buffer.Open(created, data.size()));
+  EXPECT_TRUE(buffer.Open(live, data.size()));
+
+}
+
+}  // namespace
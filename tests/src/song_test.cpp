@@ -0,0 +1,159 @@
+/*
+ * Strawberry Music Player
+ * Copyright 2021, Jonas Kvinge <jonas@jkvinge.net>
+ *
+ * Strawberry is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Strawberry is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Strawberry.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <memory>
+
+#include <gtest/gtest.h>
+
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QUrl>
+
+#include "test_utils.h"
+
+#include "core/logging.h"
+#include "core/timeconstants.h"
+#include "core/song.h"
+#include "core/database.h"
+#include "collection/collection.h"
+#include "collection/collectionbackend.h"
+#include "collection/sqlrow.h"
+
+namespace {
+
+class SongTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    database_.reset(new MemoryDatabase(nullptr));
+    backend_.reset(new CollectionBackend);
+    backend_->Init(database_.get(), Song::Source_Collection, SCollection::kSongsTable, SCollection::kDirsTable, SCollection::kSubdirsTable, SCollection::kFtsTable);
+    // Songs are only added to directories that exist
+    backend_->AddDirectory("/music");
+  }
+
+  Song MakeSong() {
+
+    Song song;
+    song.Init("Title", "Artist", "Album", 123 * kNsecPerSec);
+    song.set_albumartist("Album artist");
+    song.set_track(5);
+    song.set_disc(2);
+    song.set_year(1999);
+    song.set_originalyear(1989);
+    song.set_genre("Genre");
+    song.set_composer("Composer");
+    song.set_performer("Performer");
+    song.set_grouping("Grouping");
+    song.set_comment("Comment");
+    song.set_lyrics("Lyrics");
+    song.set_bitrate(320);
+    song.set_samplerate(44100);
+    song.set_bitdepth(16);
+    song.set_source(Song::Source_Collection);
+    song.set_directory_id(1);
+    song.set_url(QUrl::fromLocalFile("/music/song.flac"));
+    song.set_filetype(Song::FileType_FLAC);
+    song.set_filesize(1234);
+    song.set_mtime(100);
+    song.set_ctime(200);
+    song.set_playcount(3);
+    song.set_skipcount(4);
+    song.set_lastplayed(300);
+    song.set_art_automatic(QUrl::fromLocalFile("/music/cover.jpg"));
+    song.set_art_manual(QUrl("https://example.com/cover.jpg"));
+    song.set_rating(0.5);
+    return song;
+
+  }
+
+  std::shared_ptr<Database> database_;
+  std::unique_ptr<CollectionBackend> backend_;
+};
+
+TEST_F(SongTest, InitFromQueryRoundTrip) {
+
+  const Song song = MakeSong();
+  backend_->AddOrUpdateSongs(SongList() << song);
+
+  const Song loaded = backend_->GetSongById(1);
+  ASSERT_TRUE(loaded.is_valid());
+  EXPECT_EQ(1, loaded.id());
+  EXPECT_EQ(song.title(), loaded.title());
+  EXPECT_EQ(song.artist(), loaded.artist());
+  EXPECT_EQ(song.album(), loaded.album());
+  EXPECT_EQ(song.albumartist(), loaded.albumartist());
+  EXPECT_EQ(song.track(), loaded.track());
+  EXPECT_EQ(song.disc(), loaded.disc());
+  EXPECT_EQ(song.year(), loaded.year());
+  EXPECT_EQ(song.originalyear(), loaded.originalyear());
+  EXPECT_EQ(song.genre(), loaded.genre());
+  EXPECT_EQ(song.composer(), loaded.composer());
+  EXPECT_EQ(song.performer(), loaded.performer());
+  EXPECT_EQ(song.grouping(), loaded.grouping());
+  EXPECT_EQ(song.comment(), loaded.comment());
+  EXPECT_EQ(song.lyrics(), loaded.lyrics());
+  EXPECT_EQ(song.length_nanosec(), loaded.length_nanosec());
+  EXPECT_EQ(song.bitrate(), loaded.bitrate());
+  EXPECT_EQ(song.samplerate(), loaded.samplerate());
+  EXPECT_EQ(song.bitdepth(), loaded.bitdepth());
+  EXPECT_EQ(song.source(), loaded.source());
+  EXPECT_EQ(song.directory_id(), loaded.directory_id());
+  EXPECT_EQ(song.url(), loaded.url());
+  EXPECT_EQ(song.filetype(), loaded.filetype());
+  EXPECT_EQ(song.filesize(), loaded.filesize());
+  EXPECT_EQ(song.mtime(), loaded.mtime());
+  EXPECT_EQ(song.ctime(), loaded.ctime());
+  EXPECT_EQ(song.playcount(), loaded.playcount());
+  EXPECT_EQ(song.skipcount(), loaded.skipcount());
+  EXPECT_EQ(song.lastplayed(), loaded.lastplayed());
+  EXPECT_EQ(song.art_automatic(), loaded.art_automatic());
+  EXPECT_EQ(song.art_manual(), loaded.art_manual());
+  EXPECT_FLOAT_EQ(song.rating(), loaded.rating());
+
+}
+
+// Measures the cost of decoding a row, run it with: song_test --gtest_also_run_disabled_tests
+TEST_F(SongTest, DISABLED_InitFromQueryBenchmark) {
+
+  static const int kIterations = 1000000;
+
+  backend_->AddOrUpdateSongs(SongList() << MakeSong());
+
+  QSqlDatabase db(database_->Connect());
+  QSqlQuery q(db);
+  ASSERT_TRUE(q.exec("SELECT ROWID, " + Song::kColumnSpec + " FROM " + SCollection::kSongsTable));
+  ASSERT_TRUE(q.next());
+  const SqlRow row(q);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  for (int i = 0; i < kIterations; ++i) {
+    Song song;
+    song.InitFromQuery(row, true);
+  }
+
+  const qint64 elapsed = timer.elapsed();
+  qLog(Info) << "Decoded" << kIterations << "rows in" << elapsed << "ms," << (elapsed * 1000000.0 / kIterations) << "ns/row";
+
+}
+
+}  // namespace